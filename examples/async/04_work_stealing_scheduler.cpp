@@ -0,0 +1,588 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <coroutine>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <latch>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <random>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <vix/console.hpp>
+
+#include <vix/async/core/io_context.hpp>
+#include <vix/async/core/task.hpp>
+
+using vix::async::core::io_context;
+using vix::async::core::task;
+
+// Multi-queue, work-stealing executor for coroutine continuations.
+//
+// When several threads call io_context::run(), they all pop from the one
+// io_context scheduler queue. This executor gives every thread its own
+// run queue instead:
+//
+//   - post() / schedule() from a worker go to that worker's local queue;
+//   - wake() puts the most recently woken coroutine in a LIFO slot, so it
+//     runs next while its data is still in cache;
+//   - idle workers steal half of a random victim's queue;
+//   - threads outside the executor push to a shared injection queue.
+//
+// Tasks hop onto it with `co_await ws.schedule()`. I/O still completes on
+// the io_context; only the continuations after the hop run here.
+namespace ws
+{
+  class work_stealing_scheduler
+  {
+  public:
+    struct stats
+    {
+      std::uint64_t executed{0};
+      std::uint64_t lifo_hits{0};
+      std::uint64_t stolen{0};
+      std::uint64_t injected{0};
+    };
+
+    explicit work_stealing_scheduler(std::size_t thread_count)
+    {
+      thread_count = std::max<std::size_t>(1, thread_count);
+
+      workers_.reserve(thread_count);
+      for (std::size_t i = 0; i < thread_count; ++i)
+      {
+        workers_.push_back(std::make_unique<worker>());
+      }
+
+      threads_.reserve(thread_count);
+      for (std::size_t i = 0; i < thread_count; ++i)
+      {
+        threads_.emplace_back([this, i]()
+                              { run_worker(i); });
+      }
+    }
+
+    work_stealing_scheduler(const work_stealing_scheduler &) = delete;
+    work_stealing_scheduler &operator=(const work_stealing_scheduler &) = delete;
+
+    ~work_stealing_scheduler()
+    {
+      stop();
+    }
+
+    // Runs a callback. Local queue when called from a worker, shared
+    // injection queue otherwise.
+    void post(std::function<void()> fn)
+    {
+      push(job{{}, std::move(fn)}, false);
+    }
+
+    // Resumes a coroutine. From a worker it takes the LIFO slot, so a
+    // coroutine woken by the running one runs next on the same thread.
+    void wake(std::coroutine_handle<> h)
+    {
+      push(job{h, {}}, true);
+    }
+
+    // Awaitable that moves the current coroutine onto this executor, or
+    // yields to the back of the local queue when already on it.
+    auto schedule() noexcept
+    {
+      struct awaiter
+      {
+        work_stealing_scheduler *self;
+
+        bool await_ready() const noexcept { return false; }
+
+        void await_suspend(std::coroutine_handle<> h)
+        {
+          self->push(job{h, {}}, false);
+        }
+
+        void await_resume() const noexcept {}
+      };
+
+      return awaiter{this};
+    }
+
+    void stop() noexcept
+    {
+      {
+        std::lock_guard<std::mutex> lock(park_mutex_);
+
+        if (stopping_)
+          return;
+
+        stopping_ = true;
+        ++epoch_;
+      }
+
+      park_cv_.notify_all();
+
+      for (auto &t : threads_)
+      {
+        if (t.joinable())
+          t.join();
+      }
+    }
+
+    std::size_t thread_count() const noexcept { return workers_.size(); }
+
+    stats snapshot() const noexcept
+    {
+      stats out;
+
+      for (const auto &w : workers_)
+      {
+        out.executed += w->executed.load(std::memory_order_relaxed);
+        out.lifo_hits += w->lifo_hits.load(std::memory_order_relaxed);
+        out.stolen += w->stolen.load(std::memory_order_relaxed);
+        out.injected += w->injected.load(std::memory_order_relaxed);
+      }
+
+      return out;
+    }
+
+  private:
+    struct job
+    {
+      std::coroutine_handle<> handle;
+      std::function<void()> fn;
+
+      explicit operator bool() const noexcept { return handle || fn; }
+
+      void operator()()
+      {
+        if (handle)
+          handle.resume();
+        else
+          fn();
+      }
+    };
+
+    struct alignas(64) worker
+    {
+      std::mutex mutex;
+      std::deque<job> local;
+      job lifo;
+
+      std::atomic<std::uint64_t> executed{0};
+      std::atomic<std::uint64_t> lifo_hits{0};
+      std::atomic<std::uint64_t> stolen{0};
+      std::atomic<std::uint64_t> injected{0};
+    };
+
+    struct current_worker
+    {
+      const work_stealing_scheduler *owner{nullptr};
+      std::size_t index{0};
+    };
+
+    static current_worker &tls() noexcept
+    {
+      static thread_local current_worker current;
+      return current;
+    }
+
+    // A coroutine that keeps waking a peer through the LIFO slot could
+    // starve the local queue. After this many LIFO runs in a row, the
+    // worker falls back to the queue.
+    static constexpr int max_lifo_streak = 3;
+
+    static constexpr std::size_t max_inject_batch = 32;
+
+    void push(job j, bool lifo)
+    {
+      const current_worker &cur = tls();
+
+      if (cur.owner == this)
+      {
+        worker &w = *workers_[cur.index];
+        std::lock_guard<std::mutex> lock(w.mutex);
+
+        if (lifo)
+        {
+          if (w.lifo)
+            w.local.push_back(std::move(w.lifo));
+
+          w.lifo = std::move(j);
+        }
+        else
+        {
+          w.local.push_back(std::move(j));
+        }
+      }
+      else
+      {
+        std::lock_guard<std::mutex> lock(inject_mutex_);
+        inject_.push_back(std::move(j));
+      }
+
+      notify_one();
+    }
+
+    void notify_one()
+    {
+      // Pairs with the fence in park(): either this load sees the sleeper,
+      // or the sleeper's final queue check sees the job pushed above.
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+
+      if (sleepers_.load(std::memory_order_relaxed) == 0)
+        return;
+
+      {
+        std::lock_guard<std::mutex> lock(park_mutex_);
+        ++epoch_;
+      }
+
+      park_cv_.notify_one();
+    }
+
+    job pop_local(std::size_t index, int &lifo_streak)
+    {
+      worker &w = *workers_[index];
+      std::lock_guard<std::mutex> lock(w.mutex);
+
+      if (w.lifo && (lifo_streak < max_lifo_streak || w.local.empty()))
+      {
+        ++lifo_streak;
+        w.lifo_hits.fetch_add(1, std::memory_order_relaxed);
+        return std::exchange(w.lifo, job{});
+      }
+
+      lifo_streak = 0;
+
+      if (w.local.empty())
+        return std::exchange(w.lifo, job{});
+
+      job j = std::move(w.local.front());
+      w.local.pop_front();
+      return j;
+    }
+
+    // Moves a fair share of the injection queue into the local queue, so
+    // external posts do not keep every worker on the shared lock.
+    job pop_inject(std::size_t index)
+    {
+      std::deque<job> batch;
+
+      {
+        std::lock_guard<std::mutex> lock(inject_mutex_);
+
+        const std::size_t count =
+            std::min<std::size_t>(max_inject_batch, inject_.size() / workers_.size() + 1);
+
+        for (std::size_t i = 0; i < count && !inject_.empty(); ++i)
+        {
+          batch.push_back(std::move(inject_.front()));
+          inject_.pop_front();
+        }
+      }
+
+      if (batch.empty())
+        return {};
+
+      workers_[index]->injected.fetch_add(batch.size(), std::memory_order_relaxed);
+
+      job first = std::move(batch.front());
+      batch.pop_front();
+
+      if (!batch.empty())
+      {
+        worker &w = *workers_[index];
+        std::lock_guard<std::mutex> lock(w.mutex);
+
+        for (auto &j : batch)
+          w.local.push_back(std::move(j));
+      }
+
+      return first;
+    }
+
+    // Takes the older half of a random victim's queue. Runs the first job
+    // and keeps the rest locally.
+    job steal(std::size_t index, std::minstd_rand &rng)
+    {
+      const std::size_t n = workers_.size();
+
+      if (n < 2)
+        return {};
+
+      const std::size_t start = rng() % n;
+
+      for (std::size_t k = 0; k < n; ++k)
+      {
+        const std::size_t victim = (start + k) % n;
+
+        if (victim == index)
+          continue;
+
+        std::deque<job> taken;
+
+        {
+          worker &v = *workers_[victim];
+          std::lock_guard<std::mutex> lock(v.mutex);
+
+          const std::size_t count = (v.local.size() + 1) / 2;
+
+          for (std::size_t i = 0; i < count; ++i)
+          {
+            taken.push_back(std::move(v.local.front()));
+            v.local.pop_front();
+          }
+        }
+
+        if (taken.empty())
+          continue;
+
+        workers_[index]->stolen.fetch_add(taken.size(), std::memory_order_relaxed);
+
+        job first = std::move(taken.front());
+        taken.pop_front();
+
+        if (!taken.empty())
+        {
+          worker &w = *workers_[index];
+          std::lock_guard<std::mutex> lock(w.mutex);
+
+          for (auto &j : taken)
+            w.local.push_back(std::move(j));
+        }
+
+        return first;
+      }
+
+      return {};
+    }
+
+    job find_job(std::size_t index, int &lifo_streak, std::minstd_rand &rng)
+    {
+      if (job j = pop_local(index, lifo_streak))
+        return j;
+
+      if (job j = pop_inject(index))
+        return j;
+
+      return steal(index, rng);
+    }
+
+    bool has_visible_work(std::size_t index)
+    {
+      {
+        std::lock_guard<std::mutex> lock(inject_mutex_);
+        if (!inject_.empty())
+          return true;
+      }
+
+      for (std::size_t i = 0; i < workers_.size(); ++i)
+      {
+        worker &w = *workers_[i];
+        std::lock_guard<std::mutex> lock(w.mutex);
+
+        if (!w.local.empty() || (i == index && w.lifo))
+          return true;
+      }
+
+      return false;
+    }
+
+    // Returns false when the executor is stopping.
+    bool park(std::size_t index)
+    {
+      std::unique_lock<std::mutex> lock(park_mutex_);
+
+      if (stopping_)
+        return false;
+
+      const std::uint64_t seen = epoch_;
+      sleepers_.fetch_add(1, std::memory_order_relaxed);
+      lock.unlock();
+
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+
+      if (has_visible_work(index))
+      {
+        sleepers_.fetch_sub(1, std::memory_order_relaxed);
+        return true;
+      }
+
+      lock.lock();
+      park_cv_.wait(lock, [&]()
+                    { return stopping_ || epoch_ != seen; });
+      sleepers_.fetch_sub(1, std::memory_order_relaxed);
+
+      return !stopping_;
+    }
+
+    void run_worker(std::size_t index)
+    {
+      tls() = current_worker{this, index};
+
+      std::minstd_rand rng(static_cast<std::minstd_rand::result_type>(index + 1));
+      int lifo_streak = 0;
+
+      for (;;)
+      {
+        if (job j = find_job(index, lifo_streak, rng))
+        {
+          j();
+          workers_[index]->executed.fetch_add(1, std::memory_order_relaxed);
+          continue;
+        }
+
+        if (!park(index))
+          break;
+      }
+
+      tls() = current_worker{};
+    }
+
+    std::vector<std::unique_ptr<worker>> workers_;
+    std::vector<std::thread> threads_;
+
+    std::mutex inject_mutex_;
+    std::deque<job> inject_;
+
+    std::mutex park_mutex_;
+    std::condition_variable park_cv_;
+    std::atomic<std::size_t> sleepers_{0};
+    std::uint64_t epoch_{0};
+    bool stopping_{false};
+  };
+} // namespace ws
+
+static constexpr int coroutine_count = 2000;
+static constexpr int hops_per_coroutine = 200;
+
+static std::atomic<std::uint64_t> work_sink{0};
+
+static void small_work(std::uint64_t &acc)
+{
+  for (int i = 0; i < 64; ++i)
+    acc = acc * 6364136223846793005ULL + 1442695040888963407ULL;
+}
+
+static task<void> hop_on_io_context(io_context &ctx, std::latch &done)
+{
+  std::uint64_t acc = 1;
+
+  for (int i = 0; i < hops_per_coroutine; ++i)
+  {
+    co_await ctx.get_scheduler().schedule();
+    small_work(acc);
+  }
+
+  work_sink.fetch_add(acc, std::memory_order_relaxed);
+  done.count_down();
+  co_return;
+}
+
+static task<void> hop_on_work_stealing(ws::work_stealing_scheduler &sched, std::latch &done)
+{
+  std::uint64_t acc = 1;
+
+  for (int i = 0; i < hops_per_coroutine; ++i)
+  {
+    co_await sched.schedule();
+    small_work(acc);
+  }
+
+  work_sink.fetch_add(acc, std::memory_order_relaxed);
+  done.count_down();
+  co_return;
+}
+
+static double run_io_context(std::size_t threads)
+{
+  io_context ctx;
+  std::latch done(coroutine_count);
+
+  std::vector<task<void>> tasks;
+  tasks.reserve(coroutine_count);
+
+  for (int i = 0; i < coroutine_count; ++i)
+  {
+    tasks.push_back(hop_on_io_context(ctx, done));
+    ctx.post(tasks.back().handle());
+  }
+
+  const auto start = std::chrono::steady_clock::now();
+
+  std::vector<std::thread> runners;
+  for (std::size_t i = 0; i < threads; ++i)
+    runners.emplace_back([&ctx]()
+                         { ctx.run(); });
+
+  done.wait();
+  const auto elapsed = std::chrono::steady_clock::now() - start;
+
+  ctx.stop();
+  for (auto &t : runners)
+    t.join();
+
+  return std::chrono::duration<double>(elapsed).count();
+}
+
+static double run_work_stealing(std::size_t threads, ws::work_stealing_scheduler::stats &stats)
+{
+  std::latch done(coroutine_count);
+
+  std::vector<task<void>> tasks;
+  tasks.reserve(coroutine_count);
+
+  const auto start = std::chrono::steady_clock::now();
+  std::chrono::steady_clock::duration elapsed{};
+
+  {
+    ws::work_stealing_scheduler sched(threads);
+
+    for (int i = 0; i < coroutine_count; ++i)
+    {
+      tasks.push_back(hop_on_work_stealing(sched, done));
+      sched.wake(tasks.back().handle());
+    }
+
+    done.wait();
+    elapsed = std::chrono::steady_clock::now() - start;
+
+    stats = sched.snapshot();
+  } // joins the workers before the coroutine frames are destroyed
+
+  return std::chrono::duration<double>(elapsed).count();
+}
+
+int main()
+{
+  const std::size_t hw = std::max(1u, std::thread::hardware_concurrency());
+
+  std::vector<std::size_t> thread_counts{1, 2, 4, hw};
+  std::sort(thread_counts.begin(), thread_counts.end());
+  thread_counts.erase(std::unique(thread_counts.begin(), thread_counts.end()), thread_counts.end());
+
+  const double total_hops = static_cast<double>(coroutine_count) * hops_per_coroutine;
+
+  vix::console.info("[async] coroutines =", coroutine_count, "hops each =", hops_per_coroutine);
+
+  for (const std::size_t threads : thread_counts)
+  {
+    const double shared = run_io_context(threads);
+
+    ws::work_stealing_scheduler::stats stats;
+    const double stealing = run_work_stealing(threads, stats);
+
+    vix::console.info("[async] threads =", threads,
+                      "| io_context run() x N:", static_cast<std::uint64_t>(total_hops / shared), "hops/s",
+                      "| work-stealing:", static_cast<std::uint64_t>(total_hops / stealing), "hops/s",
+                      "| stolen =", stats.stolen,
+                      "lifo =", stats.lifo_hits);
+  }
+
+  return 0;
+}
@@ -0,0 +1,389 @@
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <coroutine>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <new>
+#include <optional>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <vix/console.hpp>
+
+// Pooled coroutine frames.
+//
+// Every coroutine frame comes from operator new unless the promise type
+// declares its own. A request going through nested tasks (read, handle,
+// write, session loop) therefore costs several heap allocations. This
+// example shows the promise-level allocator a task type can adopt:
+// per-thread free lists in power-of-two size classes, with optional
+// statistics on frame sizes.
+//
+// demo_task<T, Pooled> has the same shape as vix::async::core::task<T>
+// (lazy start, symmetric transfer to the awaiting coroutine). The only
+// difference between the pooled and plain variants is the promise base.
+namespace frames
+{
+  class frame_pool
+  {
+  public:
+    static constexpr std::size_t min_class_size = 64;
+    static constexpr std::size_t class_count = 7; // 64 B .. 4 KiB
+    static constexpr std::size_t max_class_size = min_class_size << (class_count - 1);
+    static constexpr std::size_t max_cached_per_class = 256;
+
+    struct stats
+    {
+      std::uint64_t allocations{0};
+      std::uint64_t pool_hits{0};
+      std::uint64_t large_frames{0};
+      std::array<std::uint64_t, class_count> per_class{};
+    };
+
+    static void *allocate(std::size_t size)
+    {
+      const std::size_t cls = class_of(size);
+
+      if (stats_enabled_.load(std::memory_order_relaxed))
+        record(cls);
+
+      if (cls == class_count || !cache_alive_)
+        return ::operator new(cls == class_count ? size : class_size(cls));
+
+      thread_cache &cache = local_cache();
+
+      if (free_node *node = cache.heads[cls])
+      {
+        cache.heads[cls] = node->next;
+        --cache.counts[cls];
+
+        if (stats_enabled_.load(std::memory_order_relaxed))
+          pool_hits_.fetch_add(1, std::memory_order_relaxed);
+
+        return node;
+      }
+
+      return ::operator new(class_size(cls));
+    }
+
+    // Frames freed on another thread join that thread's cache; each cache
+    // is capped, and the excess goes back to the global heap.
+    static void deallocate(void *p, std::size_t size) noexcept
+    {
+      const std::size_t cls = class_of(size);
+
+      if (cls == class_count || !cache_alive_)
+      {
+        ::operator delete(p);
+        return;
+      }
+
+      thread_cache &cache = local_cache();
+
+      if (cache.counts[cls] >= max_cached_per_class)
+      {
+        ::operator delete(p);
+        return;
+      }
+
+      auto *node = static_cast<free_node *>(p);
+      node->next = cache.heads[cls];
+      cache.heads[cls] = node;
+      ++cache.counts[cls];
+    }
+
+    static void enable_stats(bool enabled) noexcept
+    {
+      stats_enabled_.store(enabled, std::memory_order_relaxed);
+    }
+
+    static stats snapshot() noexcept
+    {
+      stats out;
+      out.allocations = allocations_.load(std::memory_order_relaxed);
+      out.pool_hits = pool_hits_.load(std::memory_order_relaxed);
+      out.large_frames = large_frames_.load(std::memory_order_relaxed);
+
+      for (std::size_t i = 0; i < class_count; ++i)
+        out.per_class[i] = per_class_[i].load(std::memory_order_relaxed);
+
+      return out;
+    }
+
+    static constexpr std::size_t class_size(std::size_t cls) noexcept
+    {
+      return min_class_size << cls;
+    }
+
+  private:
+    struct free_node
+    {
+      free_node *next;
+    };
+
+    struct thread_cache
+    {
+      std::array<free_node *, class_count> heads{};
+      std::array<std::size_t, class_count> counts{};
+
+      ~thread_cache()
+      {
+        cache_alive_ = false;
+
+        for (free_node *head : heads)
+        {
+          while (head)
+          {
+            free_node *next = head->next;
+            ::operator delete(head);
+            head = next;
+          }
+        }
+      }
+    };
+
+    // Returns class_count for frames larger than max_class_size.
+    static constexpr std::size_t class_of(std::size_t size) noexcept
+    {
+      std::size_t cls = 0;
+
+      while (cls < class_count && class_size(cls) < size)
+        ++cls;
+
+      return cls;
+    }
+
+    static thread_cache &local_cache() noexcept
+    {
+      thread_local thread_cache cache;
+      return cache;
+    }
+
+    static void record(std::size_t cls) noexcept
+    {
+      allocations_.fetch_add(1, std::memory_order_relaxed);
+
+      if (cls == class_count)
+        large_frames_.fetch_add(1, std::memory_order_relaxed);
+      else
+        per_class_[cls].fetch_add(1, std::memory_order_relaxed);
+    }
+
+    // Trivially destructible, so it stays readable while other
+    // thread_local destructors run and free their last frames.
+    static inline thread_local bool cache_alive_ = true;
+
+    static inline std::atomic<bool> stats_enabled_{false};
+    static inline std::atomic<std::uint64_t> allocations_{0};
+    static inline std::atomic<std::uint64_t> pool_hits_{0};
+    static inline std::atomic<std::uint64_t> large_frames_{0};
+    static inline std::array<std::atomic<std::uint64_t>, class_count> per_class_{};
+  };
+
+  // Promise base that routes coroutine frame allocation to frame_pool.
+  // The sized operator delete receives the same size as operator new.
+  struct pooled_frame
+  {
+    static void *operator new(std::size_t size)
+    {
+      return frame_pool::allocate(size);
+    }
+
+    static void operator delete(void *p, std::size_t size) noexcept
+    {
+      frame_pool::deallocate(p, size);
+    }
+  };
+
+  struct heap_frame
+  {
+  };
+
+  template <class T, bool Pooled>
+  class demo_task
+  {
+  public:
+    struct promise_type : std::conditional_t<Pooled, pooled_frame, heap_frame>
+    {
+      std::coroutine_handle<> continuation;
+      std::optional<T> value;
+      std::exception_ptr error;
+
+      demo_task get_return_object()
+      {
+        return demo_task(std::coroutine_handle<promise_type>::from_promise(*this));
+      }
+
+      std::suspend_always initial_suspend() noexcept { return {}; }
+
+      auto final_suspend() noexcept
+      {
+        struct awaiter
+        {
+          bool await_ready() noexcept { return false; }
+
+          std::coroutine_handle<> await_suspend(std::coroutine_handle<promise_type> h) noexcept
+          {
+            auto next = h.promise().continuation;
+            return next ? next : std::noop_coroutine();
+          }
+
+          void await_resume() noexcept {}
+        };
+
+        return awaiter{};
+      }
+
+      void return_value(T v) { value = std::move(v); }
+      void unhandled_exception() { error = std::current_exception(); }
+    };
+
+    demo_task(demo_task &&other) noexcept
+        : h_(std::exchange(other.h_, {}))
+    {
+    }
+
+    demo_task(const demo_task &) = delete;
+    demo_task &operator=(const demo_task &) = delete;
+    demo_task &operator=(demo_task &&) = delete;
+
+    ~demo_task()
+    {
+      if (h_)
+        h_.destroy();
+    }
+
+    bool await_ready() const noexcept { return false; }
+
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) noexcept
+    {
+      h_.promise().continuation = awaiting;
+      return h_;
+    }
+
+    T await_resume()
+    {
+      if (h_.promise().error)
+        std::rethrow_exception(h_.promise().error);
+
+      return std::move(*h_.promise().value);
+    }
+
+    // Drives a task whose awaits all complete synchronously.
+    T run_sync()
+    {
+      h_.resume();
+      return await_resume();
+    }
+
+  private:
+    explicit demo_task(std::coroutine_handle<promise_type> h)
+        : h_(h)
+    {
+    }
+
+    std::coroutine_handle<promise_type> h_;
+  };
+} // namespace frames
+
+// The nested shape of one HTTP request: the session loop awaits a request
+// handler, which awaits a read and a write on the transport.
+template <bool Pooled>
+struct session_model
+{
+  template <class T>
+  using task = frames::demo_task<T, Pooled>;
+
+  static task<std::size_t> async_read(std::size_t request)
+  {
+    std::array<char, 96> header{};
+    header[request % header.size()] = 1;
+    co_return 512 + header[0];
+  }
+
+  static task<std::size_t> async_write(std::size_t bytes)
+  {
+    co_return bytes + 128;
+  }
+
+  static task<std::size_t> handle_request(std::size_t request)
+  {
+    const std::size_t in = co_await async_read(request);
+    const std::size_t out = co_await async_write(in);
+    co_return in + out;
+  }
+
+  static task<std::size_t> session(std::size_t requests)
+  {
+    std::size_t total = 0;
+
+    for (std::size_t i = 0; i < requests; ++i)
+      total += co_await handle_request(i);
+
+    co_return total;
+  }
+};
+
+template <bool Pooled>
+static double requests_per_second(std::size_t threads, std::size_t sessions, std::size_t requests)
+{
+  std::atomic<std::size_t> sink{0};
+  std::vector<std::thread> workers;
+
+  const auto start = std::chrono::steady_clock::now();
+
+  for (std::size_t t = 0; t < threads; ++t)
+  {
+    workers.emplace_back([&]()
+                         {
+      for (std::size_t s = 0; s < sessions; ++s)
+        sink.fetch_add(session_model<Pooled>::session(requests).run_sync(), std::memory_order_relaxed); });
+  }
+
+  for (auto &w : workers)
+    w.join();
+
+  const double seconds =
+      std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+  return static_cast<double>(threads * sessions * requests) / seconds;
+}
+
+int main()
+{
+  constexpr std::size_t threads = 4;
+  constexpr std::size_t sessions = 2000;
+  constexpr std::size_t requests = 100;
+
+  // Frame size statistics for one session.
+  frames::frame_pool::enable_stats(true);
+  (void)session_model<true>::session(requests).run_sync();
+  frames::frame_pool::enable_stats(false);
+
+  const auto stats = frames::frame_pool::snapshot();
+
+  vix::console.info("[async] frames per session =", stats.allocations,
+                    "pool hits =", stats.pool_hits,
+                    "large =", stats.large_frames);
+
+  for (std::size_t i = 0; i < frames::frame_pool::class_count; ++i)
+  {
+    if (stats.per_class[i] != 0)
+    {
+      vix::console.info("[async]   <=", frames::frame_pool::class_size(i), "bytes:",
+                        stats.per_class[i], "frames");
+    }
+  }
+
+  const double heap = requests_per_second<false>(threads, sessions, requests);
+  const double pooled = requests_per_second<true>(threads, sessions, requests);
+
+  vix::console.info("[async] heap frames:  ", static_cast<std::uint64_t>(heap), "requests/s");
+  vix::console.info("[async] pooled frames:", static_cast<std::uint64_t>(pooled), "requests/s");
+
+  return 0;
+}
@@ -0,0 +1,717 @@
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <coroutine>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#if defined(__linux__) && __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#define VIX_EXAMPLE_HAS_IO_URING 1
+#endif
+
+#include <vix/console.hpp>
+
+#include <vix/async/core/io_context.hpp>
+#include <vix/async/core/task.hpp>
+
+using vix::async::core::io_context;
+using vix::async::core::task;
+
+// Async positional file I/O for an io_context.
+//
+// file_service offers async_read_at, async_write_at and async_fsync as
+// awaitables. On Linux it submits them to io_uring through the raw
+// syscalls, so no extra library is needed. Where io_uring is unavailable
+// (old kernel, seccomp, other platforms), the same operations run on a
+// small fixed set of blocking threads. Either way the awaiting coroutine
+// resumes on the io_context scheduler, like network completions.
+//
+// Errors are reported as std::system_error, like the net APIs. A single
+// read or write moves at most max_transfer bytes and may come back short,
+// as pread/pwrite do; the helpers below loop until done.
+namespace files
+{
+  enum class op_kind
+  {
+    read,
+    write,
+    fsync,
+  };
+
+  class file_service;
+
+  // Linux caps one read/write at MAX_RW_COUNT (2 GiB - 4 KiB), and an
+  // io_uring SQE length is 32 bits. Larger requests transfer this much.
+  inline constexpr std::size_t max_transfer = 0x7ffff000;
+
+  struct file_op
+  {
+    file_service *service{nullptr};
+    op_kind kind{op_kind::read};
+    int fd{-1};
+    void *data{nullptr};
+    std::size_t size{0};
+    std::uint64_t offset{0};
+
+    long result{0};
+    std::coroutine_handle<> waiter;
+
+    bool await_ready() const noexcept { return false; }
+    void await_suspend(std::coroutine_handle<> h);
+    std::size_t await_resume() const
+    {
+      if (result < 0)
+        throw std::system_error(static_cast<int>(-result), std::system_category());
+
+      return static_cast<std::size_t>(result);
+    }
+  };
+
+  // Fixed set of threads running pread/pwrite/fsync.
+  class blocking_backend
+  {
+  public:
+    template <class Complete>
+    blocking_backend(std::size_t threads, std::size_t max_queued, Complete complete)
+        : max_queued_(std::max<std::size_t>(1, max_queued))
+    {
+      for (std::size_t i = 0; i < std::max<std::size_t>(1, threads); ++i)
+      {
+        threads_.emplace_back([this, complete]()
+                              {
+          for (;;)
+          {
+            file_op *op = nullptr;
+
+            {
+              std::unique_lock<std::mutex> lock(mutex_);
+              cv_.wait(lock, [this]() { return stopping_ || !queue_.empty(); });
+
+              if (queue_.empty())
+                return;
+
+              op = queue_.front();
+              queue_.pop_front();
+            }
+
+            op->result = run(*op);
+            complete(op);
+          } });
+      }
+    }
+
+    ~blocking_backend()
+    {
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+      }
+
+      cv_.notify_all();
+
+      for (auto &t : threads_)
+        t.join();
+    }
+
+    // Returns false when max_queued operations are already waiting.
+    bool submit(file_op *op)
+    {
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+
+        if (queue_.size() >= max_queued_)
+          return false;
+
+        queue_.push_back(op);
+      }
+
+      cv_.notify_one();
+      return true;
+    }
+
+  private:
+    static long run(const file_op &op) noexcept
+    {
+      ssize_t n = 0;
+
+      const std::size_t size = std::min(op.size, max_transfer);
+
+      switch (op.kind)
+      {
+      case op_kind::read:
+        n = ::pread(op.fd, op.data, size, static_cast<off_t>(op.offset));
+        break;
+      case op_kind::write:
+        n = ::pwrite(op.fd, op.data, size, static_cast<off_t>(op.offset));
+        break;
+      case op_kind::fsync:
+        n = ::fsync(op.fd);
+        break;
+      }
+
+      return n < 0 ? -static_cast<long>(errno) : static_cast<long>(n);
+    }
+
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::deque<file_op *> queue_;
+    std::size_t max_queued_;
+    bool stopping_{false};
+    std::vector<std::thread> threads_;
+  };
+
+#if defined(VIX_EXAMPLE_HAS_IO_URING)
+  // Minimal io_uring driver: one ring, submissions under a mutex, and one
+  // reaper thread waiting for completions.
+  //
+  // Every submit() leaves the SQ empty: an SQE the kernel did not take is
+  // taken back and the op goes to the blocking pool. That keeps room for
+  // the shutdown NOP, and no op waits on an SQE nobody will submit.
+  //
+  // At most one ring's worth of ops is in flight, so the CQ (twice the SQ)
+  // never overflows. Further ops wait in a queue that the reaper feeds
+  // into the ring as completions free room.
+  class uring_backend
+  {
+  public:
+    template <class Complete, class Fallback>
+    uring_backend(unsigned entries, Complete complete, Fallback fallback)
+    {
+      io_uring_params params{};
+      fd_ = static_cast<int>(::syscall(__NR_io_uring_setup, entries, &params));
+
+      if (fd_ < 0)
+        return;
+
+      if (!map_rings(params) || !supports_file_ops())
+      {
+        unmap_rings();
+        ::close(fd_);
+        fd_ = -1;
+        return;
+      }
+
+      reaper_ = std::thread([this, complete, fallback]()
+                            { reap(complete, fallback); });
+    }
+
+    ~uring_backend()
+    {
+      if (fd_ < 0)
+        return;
+
+      stopping_.store(true, std::memory_order_release);
+
+      // A NOP with user_data 0 wakes the reaper so it can observe stopping_.
+      // The SQ is empty between submits, so the push succeeds; enter can
+      // fail transiently (EAGAIN, EBUSY while the reaper drains the CQ),
+      // so retry until the kernel has taken it.
+      for (;;)
+      {
+        {
+          std::lock_guard<std::mutex> lock(submit_mutex_);
+
+          if (pending_locked() == 0)
+            push_sqe_locked(IORING_OP_NOP, -1, nullptr, 0, 0, 0);
+
+          enter(pending_locked(), 0, 0);
+
+          if (pending_locked() == 0)
+            break;
+        }
+
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+      }
+
+      // The reaper keeps going until every in-flight op has completed, so
+      // each awaiting coroutine is resumed.
+      reaper_.join();
+      unmap_rings();
+      ::close(fd_);
+    }
+
+    bool available() const noexcept { return fd_ >= 0; }
+
+    // Returns false when the kernel did not take the op.
+    bool submit(file_op *op)
+    {
+      std::lock_guard<std::mutex> lock(submit_mutex_);
+
+      if (!waiting_.empty() || inflight_.load(std::memory_order_relaxed) >= sq_entries_)
+      {
+        waiting_.push_back(op);
+        return true;
+      }
+
+      return push_op_locked(op);
+    }
+
+  private:
+    bool push_op_locked(file_op *op)
+    {
+      std::uint8_t opcode = IORING_OP_NOP;
+
+      switch (op->kind)
+      {
+      case op_kind::read:
+        opcode = IORING_OP_READ;
+        break;
+      case op_kind::write:
+        opcode = IORING_OP_WRITE;
+        break;
+      case op_kind::fsync:
+        opcode = IORING_OP_FSYNC;
+        break;
+      }
+
+      if (!push_sqe_locked(opcode, op->fd, op->data, static_cast<unsigned>(std::min(op->size, max_transfer)),
+                           op->offset, reinterpret_cast<std::uint64_t>(op)))
+        return false;
+
+      // Counted before the kernel can complete it.
+      inflight_.fetch_add(1, std::memory_order_relaxed);
+      enter(pending_locked(), 0, 0);
+
+      // Without SQPOLL the kernel only reads the SQ inside enter, and we
+      // hold the submit lock, so an unconsumed SQE can be taken back.
+      if (pending_locked() != 0)
+      {
+        std::atomic_ref<unsigned>(*sq_tail_).store(*sq_tail_ - 1, std::memory_order_release);
+        inflight_.fetch_sub(1, std::memory_order_relaxed);
+        return false;
+      }
+
+      return true;
+    }
+
+    // IORING_OP_READ/WRITE need Linux 5.6, which also added the probe; a
+    // kernel without the probe gets the blocking pool.
+    bool supports_file_ops() const noexcept
+    {
+      constexpr unsigned ops = 256;
+      std::vector<std::byte> storage(sizeof(io_uring_probe) + ops * sizeof(io_uring_probe_op));
+      auto *probe = reinterpret_cast<io_uring_probe *>(storage.data());
+
+      if (::syscall(__NR_io_uring_register, fd_, IORING_REGISTER_PROBE, probe, ops) < 0)
+        return false;
+
+      for (const std::uint8_t op : {IORING_OP_READ, IORING_OP_WRITE, IORING_OP_FSYNC})
+      {
+        if (op > probe->last_op || (probe->ops[op].flags & IO_URING_OP_SUPPORTED) == 0)
+          return false;
+      }
+
+      return true;
+    }
+
+    bool map_rings(const io_uring_params &p)
+    {
+      sq_len_ = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+      cq_len_ = p.cq_off.cqes + p.cq_entries * sizeof(io_uring_cqe);
+
+      const bool single = (p.features & IORING_FEAT_SINGLE_MMAP) != 0;
+      if (single)
+        sq_len_ = cq_len_ = std::max(sq_len_, cq_len_);
+
+      sq_ring_ = ::mmap(nullptr, sq_len_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd_, IORING_OFF_SQ_RING);
+      if (sq_ring_ == MAP_FAILED)
+        return false;
+
+      cq_ring_ = single ? sq_ring_
+                        : ::mmap(nullptr, cq_len_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd_, IORING_OFF_CQ_RING);
+      if (cq_ring_ == MAP_FAILED)
+        return false;
+
+      sqes_len_ = p.sq_entries * sizeof(io_uring_sqe);
+      sqes_ = static_cast<io_uring_sqe *>(
+          ::mmap(nullptr, sqes_len_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd_, IORING_OFF_SQES));
+      if (sqes_ == MAP_FAILED)
+        return false;
+
+      auto *sq = static_cast<char *>(sq_ring_);
+      sq_head_ = reinterpret_cast<unsigned *>(sq + p.sq_off.head);
+      sq_tail_ = reinterpret_cast<unsigned *>(sq + p.sq_off.tail);
+      sq_mask_ = *reinterpret_cast<unsigned *>(sq + p.sq_off.ring_mask);
+      sq_entries_ = *reinterpret_cast<unsigned *>(sq + p.sq_off.ring_entries);
+      sq_array_ = reinterpret_cast<unsigned *>(sq + p.sq_off.array);
+
+      auto *cq = static_cast<char *>(cq_ring_);
+      cq_head_ = reinterpret_cast<unsigned *>(cq + p.cq_off.head);
+      cq_tail_ = reinterpret_cast<unsigned *>(cq + p.cq_off.tail);
+      cq_mask_ = *reinterpret_cast<unsigned *>(cq + p.cq_off.ring_mask);
+      cqes_ = reinterpret_cast<io_uring_cqe *>(cq + p.cq_off.cqes);
+
+      return true;
+    }
+
+    void unmap_rings() noexcept
+    {
+      if (sqes_ && sqes_ != MAP_FAILED)
+        ::munmap(sqes_, sqes_len_);
+
+      if (cq_ring_ && cq_ring_ != MAP_FAILED && cq_ring_ != sq_ring_)
+        ::munmap(cq_ring_, cq_len_);
+
+      if (sq_ring_ && sq_ring_ != MAP_FAILED)
+        ::munmap(sq_ring_, sq_len_);
+    }
+
+    int enter(unsigned to_submit, unsigned min_complete, unsigned flags) noexcept
+    {
+      for (;;)
+      {
+        const long rc = ::syscall(__NR_io_uring_enter, fd_, to_submit, min_complete, flags, nullptr, 0);
+
+        if (rc >= 0 || errno != EINTR)
+          return static_cast<int>(rc);
+      }
+    }
+
+    unsigned pending_locked() const noexcept
+    {
+      return *sq_tail_ - std::atomic_ref<unsigned>(*sq_head_).load(std::memory_order_acquire);
+    }
+
+    bool push_sqe_locked(std::uint8_t opcode, int fd, void *addr, unsigned len,
+                         std::uint64_t offset, std::uint64_t user_data) noexcept
+    {
+      const unsigned tail = *sq_tail_;
+      const unsigned head = std::atomic_ref<unsigned>(*sq_head_).load(std::memory_order_acquire);
+
+      if (tail - head >= sq_entries_)
+        return false;
+
+      const unsigned index = tail & sq_mask_;
+      io_uring_sqe &sqe = sqes_[index];
+
+      std::memset(&sqe, 0, sizeof(sqe));
+      sqe.opcode = opcode;
+      sqe.fd = fd;
+      sqe.addr = reinterpret_cast<std::uint64_t>(addr);
+      sqe.len = len;
+      sqe.off = offset;
+      sqe.user_data = user_data;
+
+      sq_array_[index] = index;
+      std::atomic_ref<unsigned>(*sq_tail_).store(tail + 1, std::memory_order_release);
+
+      return true;
+    }
+
+    // Moves queued ops into the ring while there is room. An op the
+    // kernel refuses goes to `fallback`, outside the submit lock.
+    template <class Fallback>
+    void feed(Fallback &fallback)
+    {
+      std::vector<file_op *> refused;
+
+      {
+        std::lock_guard<std::mutex> lock(submit_mutex_);
+
+        while (!waiting_.empty() && inflight_.load(std::memory_order_relaxed) < sq_entries_)
+        {
+          file_op *op = waiting_.front();
+          waiting_.pop_front();
+
+          if (!push_op_locked(op))
+            refused.push_back(op);
+        }
+      }
+
+      for (file_op *op : refused)
+        fallback(op);
+    }
+
+    template <class Complete, class Fallback>
+    void reap(Complete complete, Fallback fallback)
+    {
+      while (!stopping_.load(std::memory_order_acquire) || inflight_.load(std::memory_order_acquire) != 0)
+      {
+        enter(0, 1, IORING_ENTER_GETEVENTS);
+
+        unsigned head = *cq_head_;
+        const unsigned tail = std::atomic_ref<unsigned>(*cq_tail_).load(std::memory_order_acquire);
+
+        for (; head != tail; ++head)
+        {
+          const io_uring_cqe &cqe = cqes_[head & cq_mask_];
+
+          if (auto *op = reinterpret_cast<file_op *>(cqe.user_data))
+          {
+            op->result = cqe.res;
+            inflight_.fetch_sub(1, std::memory_order_release);
+            complete(op);
+          }
+        }
+
+        std::atomic_ref<unsigned>(*cq_head_).store(head, std::memory_order_release);
+
+        // Queued ops only leave through here, so the loop keeps going
+        // until they are in flight and done too.
+        feed(fallback);
+      }
+    }
+
+    int fd_{-1};
+
+    void *sq_ring_{nullptr};
+    void *cq_ring_{nullptr};
+    std::size_t sq_len_{0};
+    std::size_t cq_len_{0};
+    std::size_t sqes_len_{0};
+
+    unsigned *sq_head_{nullptr};
+    unsigned *sq_tail_{nullptr};
+    unsigned *sq_array_{nullptr};
+    unsigned sq_mask_{0};
+    unsigned sq_entries_{0};
+    io_uring_sqe *sqes_{nullptr};
+
+    unsigned *cq_head_{nullptr};
+    unsigned *cq_tail_{nullptr};
+    unsigned cq_mask_{0};
+    io_uring_cqe *cqes_{nullptr};
+
+    std::mutex submit_mutex_;
+    std::deque<file_op *> waiting_;
+    std::atomic<bool> stopping_{false};
+    std::atomic<unsigned> inflight_{0};
+    std::thread reaper_;
+  };
+#endif
+
+  struct file_service_options
+  {
+    bool prefer_io_uring{true};
+    unsigned ring_entries{256};
+    std::size_t blocking_threads{4};
+    std::size_t blocking_max_queued{1024}; // beyond this, ops fail with EAGAIN
+  };
+
+  class file_service
+  {
+  public:
+    explicit file_service(io_context &ctx, file_service_options options = {})
+        : ctx_(ctx),
+          blocking_(options.blocking_threads, options.blocking_max_queued, [this](file_op *op)
+                    { complete(op); })
+    {
+#if defined(VIX_EXAMPLE_HAS_IO_URING)
+      if (options.prefer_io_uring)
+      {
+        uring_ = std::make_unique<uring_backend>(
+            options.ring_entries, [this](file_op *op)
+            { complete(op); },
+            [this](file_op *op)
+            { submit_blocking(op); });
+
+        if (!uring_->available())
+          uring_.reset();
+      }
+#else
+      (void)options;
+#endif
+    }
+
+    const char *backend_name() const noexcept
+    {
+#if defined(VIX_EXAMPLE_HAS_IO_URING)
+      if (uring_)
+        return "io_uring";
+#endif
+      return "blocking pool";
+    }
+
+    file_op async_read_at(int fd, std::span<std::byte> buffer, std::uint64_t offset)
+    {
+      return file_op{this, op_kind::read, fd, buffer.data(), buffer.size(), offset, 0, {}};
+    }
+
+    file_op async_write_at(int fd, std::span<const std::byte> buffer, std::uint64_t offset)
+    {
+      return file_op{this, op_kind::write, fd, const_cast<std::byte *>(buffer.data()), buffer.size(), offset, 0, {}};
+    }
+
+    file_op async_fsync(int fd)
+    {
+      return file_op{this, op_kind::fsync, fd, nullptr, 0, 0, 0, {}};
+    }
+
+    void submit(file_op *op)
+    {
+#if defined(VIX_EXAMPLE_HAS_IO_URING)
+      // An op the kernel refuses falls back to the blocking pool.
+      if (uring_ && uring_->submit(op))
+        return;
+#endif
+      submit_blocking(op);
+    }
+
+  private:
+    void submit_blocking(file_op *op)
+    {
+      if (blocking_.submit(op))
+        return;
+
+      // Overloaded: fail the op rather than queue without bound.
+      op->result = -EAGAIN;
+      complete(op);
+    }
+
+    void complete(file_op *op)
+    {
+      ctx_.post(op->waiter);
+    }
+
+    io_context &ctx_;
+    blocking_backend blocking_;
+#if defined(VIX_EXAMPLE_HAS_IO_URING)
+    std::unique_ptr<uring_backend> uring_;
+#endif
+  };
+
+  inline void file_op::await_suspend(std::coroutine_handle<> h)
+  {
+    waiter = h;
+    service->submit(this);
+  }
+
+  // Owns a file descriptor for the duration of a coroutine.
+  class unique_fd
+  {
+  public:
+    explicit unique_fd(int fd) noexcept : fd_(fd) {}
+    unique_fd(const unique_fd &) = delete;
+    unique_fd &operator=(const unique_fd &) = delete;
+    ~unique_fd()
+    {
+      if (fd_ >= 0)
+        ::close(fd_);
+    }
+
+    int get() const noexcept { return fd_; }
+
+  private:
+    int fd_;
+  };
+
+  inline int open_or_throw(const std::string &path, int flags, mode_t mode = 0644)
+  {
+    const int fd = ::open(path.c_str(), flags | O_CLOEXEC, mode);
+
+    if (fd < 0)
+      throw std::system_error(errno, std::system_category(), path);
+
+    return fd;
+  }
+
+  // Reads a whole file in chunks without blocking the io_context thread.
+  inline task<std::string> async_read_text(file_service &files, std::string path,
+                                           std::size_t chunk_size = 64 * 1024)
+  {
+    unique_fd fd(open_or_throw(path, O_RDONLY));
+
+    std::string out;
+    std::vector<std::byte> chunk(chunk_size);
+    std::uint64_t offset = 0;
+
+    for (;;)
+    {
+      const std::size_t n = co_await files.async_read_at(fd.get(), chunk, offset);
+
+      if (n == 0)
+        break;
+
+      out.append(reinterpret_cast<const char *>(chunk.data()), n);
+      offset += n;
+    }
+
+    co_return out;
+  }
+
+  // Writes a whole file and makes it durable before returning.
+  inline task<std::size_t> async_write_text(file_service &files, std::string path, std::string text)
+  {
+    unique_fd fd(open_or_throw(path, O_WRONLY | O_CREAT | O_TRUNC));
+
+    const auto *bytes = reinterpret_cast<const std::byte *>(text.data());
+    std::size_t written = 0;
+
+    while (written < text.size())
+    {
+      const std::size_t n = co_await files.async_write_at(
+          fd.get(), std::span<const std::byte>(bytes + written, text.size() - written), written);
+
+      // pwrite only returns 0 when no space is left; retrying would spin.
+      if (n == 0)
+        throw std::system_error(std::make_error_code(std::errc::no_space_on_device), path);
+
+      written += n;
+    }
+
+    co_await files.async_fsync(fd.get());
+    co_return written;
+  }
+} // namespace files
+
+static task<void> app(io_context &ctx, files::file_service &fs)
+{
+  vix::console.info("[async] file backend:", fs.backend_name());
+
+  const std::string path = "async_file_io_example.txt";
+
+  std::string text;
+  for (int i = 0; i < 10000; ++i)
+    text += "line " + std::to_string(i) + "\n";
+
+  const std::size_t written = co_await files::async_write_text(fs, path, text);
+  vix::console.info("[async] wrote", written, "bytes (fsynced)");
+
+  const std::string back = co_await files::async_read_text(fs, path, 4096);
+  vix::console.info("[async] read", back.size(), "bytes, match =", back == text ? "yes" : "no");
+
+  try
+  {
+    co_await files::async_read_text(fs, "does/not/exist.txt");
+  }
+  catch (const std::system_error &e)
+  {
+    vix::console.warn("[async] expected error:", e.code().message());
+  }
+
+  ::unlink(path.c_str());
+
+  ctx.stop();
+  co_return;
+}
+
+int main()
+{
+  io_context ctx;
+  files::file_service fs(ctx);
+
+  auto t = app(ctx, fs);
+  ctx.post(t.handle());
+
+  ctx.run();
+  return 0;
+}
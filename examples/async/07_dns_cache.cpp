@@ -0,0 +1,551 @@
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <coroutine>
+#include <cstdint>
+#include <cstdio>
+#include <exception>
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <sstream>
+#include <string>
+#include <system_error>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <arpa/inet.h>
+
+#include <vix/console.hpp>
+
+#include <vix/async/core/io_context.hpp>
+#include <vix/async/core/spawn.hpp>
+#include <vix/async/core/task.hpp>
+
+#include <vix/async/net/dns.hpp>
+
+using vix::async::core::io_context;
+using vix::async::core::task;
+using vix::async::net::resolved_address;
+
+// Caching DNS resolver.
+//
+// caching_resolver sits in front of an upstream lookup (normally
+// dns_resolver) and keeps answers per host:
+//
+//  - answers live for their TTL, clamped to [min_ttl, max_ttl]
+//  - concurrent lookups for the same host share one upstream query
+//  - an expired answer is still served for stale_ttl while one
+//    background query refreshes it
+//  - failures are cached for negative_ttl
+//  - a hosts-style file can pin answers, e.g. for tests
+//
+// getaddrinfo does not expose record TTLs, so answers from dns_resolver
+// use default_ttl. Upstreams that know the TTL can report it.
+namespace dnscache
+{
+  using clock = std::chrono::steady_clock;
+
+  struct dns_cache_options
+  {
+    std::chrono::seconds default_ttl{60};
+    std::chrono::seconds min_ttl{5};
+    std::chrono::seconds max_ttl{3600};
+    std::chrono::seconds stale_ttl{30};
+    std::chrono::seconds negative_ttl{5};
+    std::size_t max_entries{4096};
+  };
+
+  struct upstream_answer
+  {
+    std::vector<std::string> ips;
+    std::optional<std::chrono::seconds> ttl;
+  };
+
+  // Resolves one host name. Throws std::system_error on failure.
+  using upstream_fn = std::function<task<upstream_answer>(std::string host)>;
+
+  struct dns_cache_stats
+  {
+    std::uint64_t hits{0};
+    std::uint64_t stale_hits{0};
+    std::uint64_t negative_hits{0};
+    std::uint64_t misses{0};
+    std::uint64_t coalesced{0};
+    std::uint64_t upstream_queries{0};
+  };
+
+  namespace detail
+  {
+    inline task<upstream_answer> resolve_with(std::shared_ptr<vix::async::net::dns_resolver> resolver,
+                                              std::string host)
+    {
+      auto addresses = co_await resolver->async_resolve(host, 0);
+
+      upstream_answer answer;
+      for (auto &address : addresses)
+      {
+        if (std::find(answer.ips.begin(), answer.ips.end(), address.ip) == answer.ips.end())
+          answer.ips.push_back(std::move(address.ip));
+      }
+
+      co_return answer;
+    }
+
+    inline bool is_ip_literal(const std::string &host)
+    {
+      unsigned char buf[16];
+      return ::inet_pton(AF_INET, host.c_str(), buf) == 1 ||
+             ::inet_pton(AF_INET6, host.c_str(), buf) == 1;
+    }
+
+    // Host names are case-insensitive and may end with the root dot.
+    inline std::string normalize(std::string host)
+    {
+      if (!host.empty() && host.back() == '.')
+        host.pop_back();
+
+      for (char &c : host)
+        c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+
+      return host;
+    }
+  } // namespace detail
+
+  // Upstream backed by the async dns_resolver.
+  inline upstream_fn from_resolver(io_context &ctx)
+  {
+    std::shared_ptr<vix::async::net::dns_resolver> resolver = vix::async::net::make_dns_resolver(ctx);
+
+    return [resolver](std::string host)
+    {
+      return detail::resolve_with(resolver, std::move(host));
+    };
+  }
+
+  class caching_resolver
+  {
+  public:
+    caching_resolver(io_context &ctx, upstream_fn upstream, dns_cache_options options = {})
+        : ctx_(ctx),
+          upstream_(std::move(upstream)),
+          options_(options)
+    {
+    }
+
+    task<std::vector<resolved_address>> async_resolve(std::string host, std::uint16_t port)
+    {
+      if (detail::is_ip_literal(host))
+        co_return std::vector<resolved_address>{{std::move(host), port}};
+
+      const std::string key = detail::normalize(std::move(host));
+      std::shared_ptr<flight> pending;
+      std::shared_ptr<flight> refresh;
+      std::shared_ptr<const std::vector<std::string>> stale;
+      bool leader = false;
+
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        const auto now = clock::now();
+
+        if (auto it = entries_.find(key); it != entries_.end())
+        {
+          entry &e = it->second;
+
+          if (e.pinned || now < e.expires)
+          {
+            if (e.error)
+            {
+              ++stats_.negative_hits;
+              std::rethrow_exception(e.error);
+            }
+
+            ++stats_.hits;
+            co_return with_port(*e.ips, port);
+          }
+
+          if (e.ips && now < e.stale_until)
+          {
+            ++stats_.stale_hits;
+            stale = e.ips;
+
+            if (!inflight_.contains(key))
+              refresh = start_flight_locked(key);
+          }
+        }
+
+        if (!stale)
+        {
+          if (auto it = inflight_.find(key); it != inflight_.end())
+          {
+            ++stats_.coalesced;
+            pending = it->second;
+          }
+          else
+          {
+            ++stats_.misses;
+            pending = start_flight_locked(key);
+            leader = true;
+          }
+        }
+      }
+
+      // query() locks mutex_ first and may run inline, so it is only
+      // started once the lock is released.
+      if (refresh)
+        vix::async::core::spawn_detached(ctx_, query(key, std::move(refresh)));
+
+      if (stale)
+        co_return with_port(*stale, port);
+
+      if (leader)
+        co_await query(key, pending);
+      else
+        co_await join{this, pending.get()};
+
+      if (pending->error)
+        std::rethrow_exception(pending->error);
+
+      co_return with_port(*pending->ips, port);
+    }
+
+    // Pins host -> ip answers. Pinned entries never expire and take
+    // precedence over upstream answers.
+    void add_override(const std::string &host, std::vector<std::string> ips)
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+
+      entry &e = entries_[detail::normalize(host)];
+      e.ips = std::make_shared<const std::vector<std::string>>(std::move(ips));
+      e.error = nullptr;
+      e.pinned = true;
+    }
+
+    // Loads an /etc/hosts style file: "ip name [name...]", '#' comments.
+    // Returns the number of names pinned.
+    std::size_t load_hosts_file(const std::string &path)
+    {
+      std::ifstream in(path);
+      if (!in)
+        throw std::system_error(std::make_error_code(std::errc::no_such_file_or_directory), path);
+
+      std::unordered_map<std::string, std::vector<std::string>> names;
+      std::string line;
+
+      while (std::getline(in, line))
+      {
+        if (const auto hash = line.find('#'); hash != std::string::npos)
+          line.resize(hash);
+
+        std::istringstream fields(line);
+        std::string ip;
+        std::string name;
+
+        if (!(fields >> ip) || !detail::is_ip_literal(ip))
+          continue;
+
+        while (fields >> name)
+          names[detail::normalize(name)].push_back(ip);
+      }
+
+      for (auto &[name, ips] : names)
+        add_override(name, std::move(ips));
+
+      return names.size();
+    }
+
+    void clear()
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      std::erase_if(entries_, [](const auto &kv)
+                    { return !kv.second.pinned; });
+    }
+
+    dns_cache_stats stats() const
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      return stats_;
+    }
+
+  private:
+    struct entry
+    {
+      std::shared_ptr<const std::vector<std::string>> ips;
+      std::exception_ptr error;
+      clock::time_point expires{};
+      clock::time_point stale_until{};
+      bool pinned{false};
+    };
+
+    struct flight
+    {
+      std::vector<std::coroutine_handle<>> waiters;
+      bool done{false};
+      std::shared_ptr<const std::vector<std::string>> ips;
+      std::exception_ptr error;
+    };
+
+    // Waits for another caller's upstream query.
+    struct join
+    {
+      caching_resolver *self;
+      flight *f;
+
+      bool await_ready() const noexcept { return false; }
+
+      bool await_suspend(std::coroutine_handle<> h)
+      {
+        std::lock_guard<std::mutex> lock(self->mutex_);
+
+        if (f->done)
+          return false;
+
+        f->waiters.push_back(h);
+        return true;
+      }
+
+      void await_resume() const noexcept {}
+    };
+
+    static std::vector<resolved_address> with_port(const std::vector<std::string> &ips, std::uint16_t port)
+    {
+      std::vector<resolved_address> out;
+      out.reserve(ips.size());
+
+      for (const auto &ip : ips)
+        out.push_back({ip, port});
+
+      return out;
+    }
+
+    // Registers the upstream query for `key`; the caller starts it after
+    // unlocking.
+    std::shared_ptr<flight> start_flight_locked(const std::string &key)
+    {
+      auto f = std::make_shared<flight>();
+      inflight_.emplace(key, f);
+      return f;
+    }
+
+    task<void> query(std::string key, std::shared_ptr<flight> f)
+    {
+      upstream_answer answer;
+      std::exception_ptr error;
+
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        ++stats_.upstream_queries;
+      }
+
+      try
+      {
+        answer = co_await upstream_(key);
+
+        if (answer.ips.empty())
+          throw std::system_error(std::make_error_code(std::errc::address_not_available), key);
+      }
+      catch (...)
+      {
+        error = std::current_exception();
+      }
+
+      std::vector<std::coroutine_handle<>> waiters;
+
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        const auto now = clock::now();
+
+        auto ips = error ? nullptr : std::make_shared<const std::vector<std::string>>(std::move(answer.ips));
+        store_locked(key, ips, error, answer.ttl, now);
+
+        f->ips = std::move(ips);
+        f->error = error;
+        f->done = true;
+        waiters.swap(f->waiters);
+        inflight_.erase(key);
+      }
+
+      for (auto h : waiters)
+        ctx_.post(h);
+    }
+
+    void store_locked(const std::string &key,
+                      std::shared_ptr<const std::vector<std::string>> ips,
+                      std::exception_ptr error,
+                      std::optional<std::chrono::seconds> ttl,
+                      clock::time_point now)
+    {
+      auto it = entries_.find(key);
+
+      if (it != entries_.end())
+      {
+        // Pinned answers win; a failed refresh keeps the stale answer.
+        if (it->second.pinned || (error && it->second.ips && now < it->second.stale_until))
+          return;
+      }
+      else
+      {
+        if (entries_.size() >= options_.max_entries)
+          evict_locked(now);
+
+        it = entries_.emplace(key, entry{}).first;
+      }
+
+      entry &e = it->second;
+      e.ips = std::move(ips);
+      e.error = error;
+
+      if (error)
+      {
+        e.expires = now + options_.negative_ttl;
+        e.stale_until = e.expires;
+        return;
+      }
+
+      const auto lifetime = std::clamp(ttl.value_or(options_.default_ttl), options_.min_ttl, options_.max_ttl);
+      e.expires = now + lifetime;
+      e.stale_until = e.expires + options_.stale_ttl;
+    }
+
+    // Drops dead entries; if none, the one closest to expiry.
+    void evict_locked(clock::time_point now)
+    {
+      const auto before = entries_.size();
+
+      std::erase_if(entries_, [now](const auto &kv)
+                    { return !kv.second.pinned && kv.second.stale_until <= now; });
+
+      if (entries_.size() < before)
+        return;
+
+      auto victim = entries_.end();
+
+      for (auto it = entries_.begin(); it != entries_.end(); ++it)
+      {
+        if (!it->second.pinned && !inflight_.contains(it->first) &&
+            (victim == entries_.end() || it->second.expires < victim->second.expires))
+          victim = it;
+      }
+
+      if (victim != entries_.end())
+        entries_.erase(victim);
+    }
+
+    io_context &ctx_;
+    upstream_fn upstream_;
+    dns_cache_options options_;
+
+    mutable std::mutex mutex_;
+    std::unordered_map<std::string, entry> entries_;
+    std::unordered_map<std::string, std::shared_ptr<flight>> inflight_;
+    dns_cache_stats stats_;
+  };
+} // namespace dnscache
+
+// Upstream used by the demo: slow, counts queries, knows two names.
+static task<dnscache::upstream_answer> fake_upstream(io_context &ctx, std::string host)
+{
+  co_await ctx.timers().sleep_for(std::chrono::milliseconds(50));
+
+  if (host == "api.internal")
+    co_return dnscache::upstream_answer{{"10.0.0.7", "10.0.0.8"}, std::chrono::seconds(1)};
+
+  throw std::system_error(std::make_error_code(std::errc::host_unreachable), host);
+}
+
+static void print_stats(const dnscache::caching_resolver &dns)
+{
+  const auto s = dns.stats();
+  vix::console.info("[async] hits =", s.hits, "stale =", s.stale_hits, "negative =", s.negative_hits,
+                    "misses =", s.misses, "coalesced =", s.coalesced, "upstream =", s.upstream_queries);
+}
+
+static task<void> lookup(dnscache::caching_resolver &dns, std::atomic<int> &left)
+{
+  auto addresses = co_await dns.async_resolve("API.internal.", 443);
+  (void)addresses;
+  left.fetch_sub(1);
+}
+
+static task<void> app(io_context &ctx, dnscache::caching_resolver &dns)
+{
+  // 100 concurrent lookups for one host share a single upstream query.
+  std::atomic<int> left{100};
+  for (int i = 0; i < 100; ++i)
+    vix::async::core::spawn_detached(ctx, lookup(dns, left));
+
+  while (left.load() > 0)
+    co_await ctx.timers().sleep_for(std::chrono::milliseconds(5));
+
+  print_stats(dns);
+
+  // Fresh hit.
+  auto addresses = co_await dns.async_resolve("api.internal", 80);
+  vix::console.info("[async] api.internal ->", addresses.front().ip, addresses.front().port);
+
+  // Expired but within stale_ttl: served at once, refreshed in background.
+  co_await ctx.timers().sleep_for(std::chrono::milliseconds(1100));
+  addresses = co_await dns.async_resolve("api.internal", 80);
+  co_await ctx.timers().sleep_for(std::chrono::milliseconds(100));
+  print_stats(dns);
+
+  // Failures are cached for negative_ttl.
+  for (int i = 0; i < 2; ++i)
+  {
+    try
+    {
+      co_await dns.async_resolve("missing.internal", 80);
+    }
+    catch (const std::system_error &e)
+    {
+      vix::console.warn("[async] missing.internal:", e.code().message());
+    }
+  }
+
+  // Hosts file overrides never reach the upstream.
+  const char *hosts = "dns_cache_hosts.txt";
+  {
+    std::ofstream out(hosts);
+    out << "# test overrides\n"
+        << "127.0.0.1   db.test cache.test\n"
+        << "::1         db.test\n";
+  }
+
+  vix::console.info("[async] pinned names =", dns.load_hosts_file(hosts));
+  std::remove(hosts);
+
+  addresses = co_await dns.async_resolve("db.test", 5432);
+  for (const auto &a : addresses)
+    vix::console.info("[async] db.test ->", a.ip, a.port);
+
+  print_stats(dns);
+
+  ctx.stop();
+  co_return;
+}
+
+int main()
+{
+  io_context ctx;
+
+  dnscache::dns_cache_options options;
+  options.min_ttl = std::chrono::seconds(1);
+  options.stale_ttl = std::chrono::seconds(5);
+
+  // In an application: dnscache::from_resolver(ctx).
+  dnscache::caching_resolver dns(
+      ctx,
+      [&ctx](std::string host)
+      { return fake_upstream(ctx, std::move(host)); },
+      options);
+
+  auto t = app(ctx, dns);
+  ctx.post(t.handle());
+
+  ctx.run();
+  return 0;
+}
@@ -0,0 +1,647 @@
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <coroutine>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <span>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/udp.h>
+#include <poll.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <vix/console.hpp>
+
+#include <vix/async/core/io_context.hpp>
+#include <vix/async/core/task.hpp>
+
+#include <vix/async/net/udp.hpp>
+
+using vix::async::core::io_context;
+using vix::async::core::task;
+using vix::async::net::udp_endpoint;
+
+// Batched UDP I/O for high packet rates.
+//
+// udp_socket::async_send_to and async_recv_from move one datagram per
+// syscall. At a few hundred thousand packets per second the syscall cost
+// dominates. batch_socket moves many datagrams per syscall:
+//
+//  - recv_batch fills a span of recv_slot buffers with one recvmmsg
+//  - send_batch sends a span of send_item with one sendmmsg
+//  - send_gso hands the kernel one buffer that it splits into equal
+//    segments (UDP GSO); enable_gro lets the kernel coalesce received
+//    datagrams of one flow into a single slot (UDP GRO)
+//
+// The try_* calls never block. async_recv_batch and async_send_batch wait
+// for readiness with a small epoll thread and resume on the io_context.
+//
+// Linux only; GSO needs 4.18+, GRO needs 5.0+.
+namespace udpbatch
+{
+  inline std::system_error last_error(const char *what)
+  {
+    return std::system_error(errno, std::system_category(), what);
+  }
+
+  // Resolved socket address. Build it once per peer, not per packet.
+  struct peer_address
+  {
+    sockaddr_storage storage{};
+    socklen_t length{0};
+
+    static peer_address from(const udp_endpoint &ep)
+    {
+      peer_address out;
+
+      auto *v4 = reinterpret_cast<sockaddr_in *>(&out.storage);
+      if (::inet_pton(AF_INET, ep.host.c_str(), &v4->sin_addr) == 1)
+      {
+        v4->sin_family = AF_INET;
+        v4->sin_port = htons(ep.port);
+        out.length = sizeof(sockaddr_in);
+        return out;
+      }
+
+      auto *v6 = reinterpret_cast<sockaddr_in6 *>(&out.storage);
+      if (::inet_pton(AF_INET6, ep.host.c_str(), &v6->sin6_addr) == 1)
+      {
+        v6->sin6_family = AF_INET6;
+        v6->sin6_port = htons(ep.port);
+        out.length = sizeof(sockaddr_in6);
+        return out;
+      }
+
+      throw std::system_error(std::make_error_code(std::errc::invalid_argument), ep.host);
+    }
+
+    udp_endpoint endpoint() const
+    {
+      char text[INET6_ADDRSTRLEN] = {};
+
+      if (storage.ss_family == AF_INET6)
+      {
+        const auto *v6 = reinterpret_cast<const sockaddr_in6 *>(&storage);
+        ::inet_ntop(AF_INET6, &v6->sin6_addr, text, sizeof(text));
+        return {text, ntohs(v6->sin6_port)};
+      }
+
+      const auto *v4 = reinterpret_cast<const sockaddr_in *>(&storage);
+      ::inet_ntop(AF_INET, &v4->sin_addr, text, sizeof(text));
+      return {text, ntohs(v4->sin_port)};
+    }
+  };
+
+  struct recv_slot
+  {
+    std::span<std::byte> buffer;
+
+    // Filled by recv_batch.
+    std::size_t bytes{0};
+    std::uint16_t segment_size{0}; // non-zero when GRO merged datagrams
+    peer_address from;
+
+    std::size_t datagram_count() const noexcept
+    {
+      if (segment_size == 0 || bytes == 0)
+        return 1;
+
+      return (bytes + segment_size - 1) / segment_size;
+    }
+  };
+
+  struct send_item
+  {
+    std::span<const std::byte> buffer;
+    const peer_address *to{nullptr};
+  };
+
+  class batch_socket
+  {
+  public:
+    static constexpr std::size_t max_batch = 256;
+
+    explicit batch_socket(const udp_endpoint &local)
+    {
+      const peer_address addr = peer_address::from(local);
+
+      fd_ = ::socket(addr.storage.ss_family, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+      if (fd_ < 0)
+        throw last_error("socket");
+
+      if (::bind(fd_, reinterpret_cast<const sockaddr *>(&addr.storage), addr.length) != 0)
+      {
+        const auto error = last_error("bind");
+        ::close(fd_);
+        throw error;
+      }
+
+      msgs_.resize(max_batch);
+      iovs_.resize(max_batch);
+      controls_.resize(max_batch);
+    }
+
+    batch_socket(const batch_socket &) = delete;
+    batch_socket &operator=(const batch_socket &) = delete;
+
+    ~batch_socket()
+    {
+      if (fd_ >= 0)
+        ::close(fd_);
+    }
+
+    int native_handle() const noexcept { return fd_; }
+
+    udp_endpoint local_endpoint() const
+    {
+      peer_address addr;
+      addr.length = sizeof(addr.storage);
+      ::getsockname(fd_, reinterpret_cast<sockaddr *>(&addr.storage), &addr.length);
+      return addr.endpoint();
+    }
+
+    void set_buffer_sizes(int bytes)
+    {
+      ::setsockopt(fd_, SOL_SOCKET, SO_RCVBUF, &bytes, sizeof(bytes));
+      ::setsockopt(fd_, SOL_SOCKET, SO_SNDBUF, &bytes, sizeof(bytes));
+    }
+
+    bool enable_gro()
+    {
+      const int on = 1;
+      gro_ = ::setsockopt(fd_, IPPROTO_UDP, UDP_GRO, &on, sizeof(on)) == 0;
+      return gro_;
+    }
+
+    bool gso_supported() const
+    {
+      int size = 0;
+      socklen_t len = sizeof(size);
+      return ::getsockopt(fd_, IPPROTO_UDP, UDP_SEGMENT, &size, &len) == 0;
+    }
+
+    // Returns the number of slots filled; 0 when nothing is queued.
+    std::size_t try_recv_batch(std::span<recv_slot> slots)
+    {
+      const std::size_t count = std::min(slots.size(), max_batch);
+
+      for (std::size_t i = 0; i < count; ++i)
+      {
+        iovs_[i] = {slots[i].buffer.data(), slots[i].buffer.size()};
+
+        msghdr &h = msgs_[i].msg_hdr;
+        h = {};
+        h.msg_name = &slots[i].from.storage;
+        h.msg_namelen = sizeof(sockaddr_storage);
+        h.msg_iov = &iovs_[i];
+        h.msg_iovlen = 1;
+
+        if (gro_)
+        {
+          h.msg_control = controls_[i].data;
+          h.msg_controllen = sizeof(controls_[i].data);
+        }
+      }
+
+      const int n = ::recvmmsg(fd_, msgs_.data(), static_cast<unsigned>(count), MSG_DONTWAIT, nullptr);
+
+      if (n < 0)
+      {
+        if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)
+          return 0;
+
+        throw last_error("recvmmsg");
+      }
+
+      for (int i = 0; i < n; ++i)
+      {
+        recv_slot &slot = slots[static_cast<std::size_t>(i)];
+        slot.bytes = msgs_[static_cast<std::size_t>(i)].msg_len;
+        slot.from.length = msgs_[static_cast<std::size_t>(i)].msg_hdr.msg_namelen;
+        slot.segment_size = gro_ ? gro_segment(msgs_[static_cast<std::size_t>(i)].msg_hdr) : 0;
+      }
+
+      return static_cast<std::size_t>(n);
+    }
+
+    // Returns the number of items sent; fewer than requested when the
+    // socket buffer fills up.
+    std::size_t try_send_batch(std::span<const send_item> items)
+    {
+      std::size_t sent = 0;
+
+      while (sent < items.size())
+      {
+        const std::size_t count = std::min(items.size() - sent, max_batch);
+
+        for (std::size_t i = 0; i < count; ++i)
+        {
+          const send_item &item = items[sent + i];
+          iovs_[i] = {const_cast<std::byte *>(item.buffer.data()), item.buffer.size()};
+
+          msghdr &h = msgs_[i].msg_hdr;
+          h = {};
+          h.msg_name = const_cast<sockaddr_storage *>(&item.to->storage);
+          h.msg_namelen = item.to->length;
+          h.msg_iov = &iovs_[i];
+          h.msg_iovlen = 1;
+        }
+
+        const int n = ::sendmmsg(fd_, msgs_.data(), static_cast<unsigned>(count), MSG_DONTWAIT);
+
+        if (n < 0)
+        {
+          if (errno == EAGAIN || errno == EWOULDBLOCK || errno == ENOBUFS || errno == EINTR)
+            break;
+
+          throw last_error("sendmmsg");
+        }
+
+        sent += static_cast<std::size_t>(n);
+
+        if (static_cast<std::size_t>(n) < count)
+          break;
+      }
+
+      return sent;
+    }
+
+    // Sends `payload` as datagrams of `segment_size` bytes (the last one
+    // may be shorter) with one syscall. Returns false on EAGAIN.
+    bool try_send_gso(std::span<const std::byte> payload, std::uint16_t segment_size, const peer_address &to)
+    {
+      iovec iov{const_cast<std::byte *>(payload.data()), payload.size()};
+
+      control_block control{};
+      msghdr h{};
+      h.msg_name = const_cast<sockaddr_storage *>(&to.storage);
+      h.msg_namelen = to.length;
+      h.msg_iov = &iov;
+      h.msg_iovlen = 1;
+      h.msg_control = control.data;
+      h.msg_controllen = CMSG_SPACE(sizeof(std::uint16_t));
+
+      cmsghdr *cm = CMSG_FIRSTHDR(&h);
+      cm->cmsg_level = IPPROTO_UDP;
+      cm->cmsg_type = UDP_SEGMENT;
+      cm->cmsg_len = CMSG_LEN(sizeof(std::uint16_t));
+      std::memcpy(CMSG_DATA(cm), &segment_size, sizeof(segment_size));
+
+      if (::sendmsg(fd_, &h, MSG_DONTWAIT) < 0)
+      {
+        if (errno == EAGAIN || errno == EWOULDBLOCK || errno == ENOBUFS || errno == EINTR)
+          return false;
+
+        throw last_error("sendmsg(UDP_SEGMENT)");
+      }
+
+      return true;
+    }
+
+  private:
+    struct control_block
+    {
+      alignas(cmsghdr) char data[CMSG_SPACE(sizeof(int))];
+    };
+
+    static std::uint16_t gro_segment(msghdr &h) noexcept
+    {
+      for (cmsghdr *cm = CMSG_FIRSTHDR(&h); cm; cm = CMSG_NXTHDR(&h, cm))
+      {
+        if (cm->cmsg_level == IPPROTO_UDP && cm->cmsg_type == UDP_GRO)
+        {
+          int size = 0;
+          std::memcpy(&size, CMSG_DATA(cm), sizeof(size));
+          return static_cast<std::uint16_t>(size);
+        }
+      }
+
+      return 0;
+    }
+
+    int fd_{-1};
+    bool gro_{false};
+
+    // Reused across calls so a batch does not allocate.
+    std::vector<mmsghdr> msgs_;
+    std::vector<iovec> iovs_;
+    std::vector<control_block> controls_;
+  };
+
+  // One epoll thread that resumes coroutines on the io_context when their
+  // socket becomes readable or writable. One waiter per fd at a time.
+  class readiness
+  {
+  public:
+    explicit readiness(io_context &ctx)
+        : ctx_(ctx)
+    {
+      epfd_ = ::epoll_create1(EPOLL_CLOEXEC);
+      wakefd_ = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+
+      if (epfd_ < 0 || wakefd_ < 0)
+        throw last_error("epoll");
+
+      epoll_event ev{};
+      ev.events = EPOLLIN;
+      ev.data.ptr = nullptr;
+      ::epoll_ctl(epfd_, EPOLL_CTL_ADD, wakefd_, &ev);
+
+      thread_ = std::thread([this]()
+                            { loop(); });
+    }
+
+    ~readiness()
+    {
+      stopping_.store(true, std::memory_order_release);
+
+      const std::uint64_t one = 1;
+      (void)::write(wakefd_, &one, sizeof(one));
+
+      thread_.join();
+      ::close(wakefd_);
+      ::close(epfd_);
+    }
+
+    struct wait_op
+    {
+      readiness *self;
+      int fd;
+      std::uint32_t events;
+      std::coroutine_handle<> waiter;
+
+      bool await_ready() const noexcept { return false; }
+
+      void await_suspend(std::coroutine_handle<> h)
+      {
+        waiter = h;
+
+        epoll_event ev{};
+        ev.events = events | EPOLLONESHOT;
+        ev.data.ptr = this;
+
+        if (::epoll_ctl(self->epfd_, EPOLL_CTL_MOD, fd, &ev) != 0 &&
+            ::epoll_ctl(self->epfd_, EPOLL_CTL_ADD, fd, &ev) != 0)
+          throw last_error("epoll_ctl");
+      }
+
+      void await_resume() const noexcept {}
+    };
+
+    wait_op readable(int fd) { return wait_op{this, fd, EPOLLIN, {}}; }
+    wait_op writable(int fd) { return wait_op{this, fd, EPOLLOUT, {}}; }
+
+  private:
+    void loop()
+    {
+      epoll_event events[64];
+
+      while (!stopping_.load(std::memory_order_acquire))
+      {
+        const int n = ::epoll_wait(epfd_, events, 64, -1);
+
+        for (int i = 0; i < n; ++i)
+        {
+          if (auto *op = static_cast<wait_op *>(events[i].data.ptr))
+            ctx_.post(op->waiter);
+        }
+      }
+    }
+
+    io_context &ctx_;
+    int epfd_{-1};
+    int wakefd_{-1};
+    std::atomic<bool> stopping_{false};
+    std::thread thread_;
+  };
+
+  inline task<std::size_t> async_recv_batch(readiness &r, batch_socket &socket, std::span<recv_slot> slots)
+  {
+    for (;;)
+    {
+      if (const std::size_t n = socket.try_recv_batch(slots); n != 0)
+        co_return n;
+
+      co_await r.readable(socket.native_handle());
+    }
+  }
+
+  inline task<void> async_send_batch(readiness &r, batch_socket &socket, std::span<const send_item> items)
+  {
+    while (!items.empty())
+    {
+      items = items.subspan(socket.try_send_batch(items));
+
+      if (!items.empty())
+        co_await r.writable(socket.native_handle());
+    }
+  }
+} // namespace udpbatch
+
+// Packets per second over loopback: one sender thread, one receiver
+// thread, fixed payload size.
+namespace bench
+{
+  enum class mode
+  {
+    single,
+    batched,
+    gso,
+  };
+
+  struct result
+  {
+    double sent_pps{0};
+    double received_pps{0};
+  };
+
+  static bool wait_fd(int fd, short events)
+  {
+    pollfd p{fd, events, 0};
+    return ::poll(&p, 1, 50) > 0;
+  }
+
+  static result run(mode m, std::size_t payload, std::chrono::milliseconds duration)
+  {
+    constexpr std::size_t batch = 64;
+
+    udpbatch::batch_socket rx({"127.0.0.1", 0});
+    udpbatch::batch_socket tx({"127.0.0.1", 0});
+    rx.set_buffer_sizes(8 << 20);
+    tx.set_buffer_sizes(8 << 20);
+
+    if (m == mode::gso)
+      rx.enable_gro();
+
+    const udpbatch::peer_address to = udpbatch::peer_address::from(rx.local_endpoint());
+
+    std::atomic<bool> sending{true};
+    std::atomic<std::uint64_t> received{0};
+    std::uint64_t sent = 0;
+
+    std::thread receiver([&]()
+                         {
+      std::vector<std::byte> storage(batch * 65536);
+      std::vector<udpbatch::recv_slot> slots(batch);
+
+      for (std::size_t i = 0; i < batch; ++i)
+        slots[i].buffer = std::span<std::byte>(storage.data() + i * 65536, 65536);
+
+      const int fd = rx.native_handle();
+      std::uint64_t count = 0;
+
+      for (;;)
+      {
+        std::size_t n = 0;
+
+        if (m == mode::single)
+        {
+          n = ::recv(fd, storage.data(), 65536, MSG_DONTWAIT) >= 0 ? 1 : 0;
+          count += n;
+        }
+        else
+        {
+          n = rx.try_recv_batch(slots);
+          for (std::size_t i = 0; i < n; ++i)
+            count += slots[i].datagram_count();
+        }
+
+        if (n == 0 && !wait_fd(fd, POLLIN) && !sending.load(std::memory_order_acquire))
+          break;
+      }
+
+      received.store(count, std::memory_order_release); });
+
+    const std::vector<std::byte> data(payload * batch, std::byte{0x5a});
+    std::vector<udpbatch::send_item> items(batch);
+
+    for (std::size_t i = 0; i < batch; ++i)
+      items[i] = {std::span<const std::byte>(data.data() + i * payload, payload), &to};
+
+    const int fd = tx.native_handle();
+    const auto start = std::chrono::steady_clock::now();
+    const auto end = start + duration;
+
+    while (std::chrono::steady_clock::now() < end)
+    {
+      std::size_t n = 0;
+
+      switch (m)
+      {
+      case mode::single:
+        n = ::sendto(fd, data.data(), payload, MSG_DONTWAIT,
+                     reinterpret_cast<const sockaddr *>(&to.storage), to.length) >= 0
+                ? 1
+                : 0;
+        break;
+      case mode::batched:
+        n = tx.try_send_batch(items);
+        break;
+      case mode::gso:
+        n = tx.try_send_gso(data, static_cast<std::uint16_t>(payload), to) ? batch : 0;
+        break;
+      }
+
+      sent += n;
+
+      if (n == 0)
+        wait_fd(fd, POLLOUT);
+    }
+
+    const double seconds =
+        std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    sending.store(false, std::memory_order_release);
+    receiver.join();
+
+    return {static_cast<double>(sent) / seconds,
+            static_cast<double>(received.load(std::memory_order_acquire)) / seconds};
+  }
+} // namespace bench
+
+static task<void> echo_demo(io_context &ctx, udpbatch::readiness &r)
+{
+  udpbatch::batch_socket server({"127.0.0.1", 0});
+  udpbatch::batch_socket client({"127.0.0.1", 0});
+
+  const auto server_addr = udpbatch::peer_address::from(server.local_endpoint());
+
+  std::vector<std::string> messages;
+  for (int i = 0; i < 8; ++i)
+    messages.push_back("ping " + std::to_string(i));
+
+  std::vector<udpbatch::send_item> out;
+  for (const auto &m : messages)
+    out.push_back({std::as_bytes(std::span(m.data(), m.size())), &server_addr});
+
+  co_await udpbatch::async_send_batch(r, client, out);
+
+  std::vector<std::byte> storage(8 * 2048);
+  std::vector<udpbatch::recv_slot> slots(8);
+  for (std::size_t i = 0; i < slots.size(); ++i)
+    slots[i].buffer = std::span<std::byte>(storage.data() + i * 2048, 2048);
+
+  std::size_t total = 0;
+  while (total < messages.size())
+  {
+    const std::size_t n = co_await udpbatch::async_recv_batch(r, server, std::span(slots).subspan(total));
+    total += n;
+  }
+
+  const auto from = slots[0].from.endpoint();
+  vix::console.info("[async] batch received", total, "datagrams from", from.host, from.port);
+
+  ctx.stop();
+  co_return;
+}
+
+int main()
+{
+  {
+    io_context ctx;
+    udpbatch::readiness r(ctx);
+
+    auto t = echo_demo(ctx, r);
+    ctx.post(t.handle());
+
+    ctx.run();
+  }
+
+  constexpr std::size_t payload = 256;
+  const auto duration = std::chrono::milliseconds(400);
+
+  const auto single = bench::run(bench::mode::single, payload, duration);
+  vix::console.info("[async] sendto/recv:      sent", static_cast<std::uint64_t>(single.sent_pps),
+                    "pps, received", static_cast<std::uint64_t>(single.received_pps), "pps");
+
+  const auto batched = bench::run(bench::mode::batched, payload, duration);
+  vix::console.info("[async] sendmmsg/recvmmsg: sent", static_cast<std::uint64_t>(batched.sent_pps),
+                    "pps, received", static_cast<std::uint64_t>(batched.received_pps), "pps");
+
+  udpbatch::batch_socket probe({"127.0.0.1", 0});
+  if (probe.gso_supported())
+  {
+    const auto gso = bench::run(bench::mode::gso, payload, duration);
+    vix::console.info("[async] GSO/GRO:          sent", static_cast<std::uint64_t>(gso.sent_pps),
+                      "pps, received", static_cast<std::uint64_t>(gso.received_pps), "pps");
+  }
+  else
+  {
+    vix::console.warn("[async] UDP GSO not supported by this kernel");
+  }
+
+  return 0;
+}
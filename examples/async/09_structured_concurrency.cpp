@@ -0,0 +1,613 @@
+#include <algorithm>
+#include <chrono>
+#include <coroutine>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <vix/console.hpp>
+
+#include <vix/async.hpp>
+
+using vix::async::core::cancel_source;
+using vix::async::core::cancel_token;
+using vix::async::core::io_context;
+using vix::async::core::task;
+
+// Structured concurrency on top of io_context.
+//
+// when_all and when_any take a fixed set of tasks. Fan-out of variable
+// size needs three more pieces:
+//
+//  - async_scope: spawn any number of child tasks, then join them. The
+//    first failure cancels the siblings and is rethrown by join();
+//    cancelling a scope also cancels scopes nested in it.
+//  - when_all_bounded: run a vector of tasks with at most N in flight and
+//    collect the results in order.
+//  - async_channel<T>: bounded multi-producer, multi-consumer queue.
+//    send() suspends while the channel is full, receive() while it is
+//    empty.
+//
+// Waiters are resumed through ctx.post(), so a send never runs the
+// receiver inline on the sender's stack.
+namespace structured
+{
+  class async_scope
+  {
+  public:
+    explicit async_scope(io_context &ctx)
+        : ctx_(ctx),
+          state_(std::make_shared<state>())
+    {
+    }
+
+    // Nested scope: cancelled when the parent is.
+    async_scope(io_context &ctx, async_scope &parent)
+        : async_scope(ctx)
+    {
+      parent.state_->add_child(state_);
+
+      if (parent.is_cancelled())
+        state_->cancel();
+    }
+
+    async_scope(const async_scope &) = delete;
+    async_scope &operator=(const async_scope &) = delete;
+
+    // Children own the shared state, so an unjoined scope only cancels
+    // them; it does not wait.
+    ~async_scope()
+    {
+      state_->cancel();
+    }
+
+    // Starts `child` on the io_context. Pass tasks created by functions;
+    // a capturing lambda coroutine would outlive its captures.
+    void spawn(task<void> child)
+    {
+      {
+        std::lock_guard<std::mutex> lock(state_->mutex);
+        ++state_->active;
+      }
+
+      vix::async::core::spawn_detached(ctx_, run_child(state_, ctx_, std::move(child)));
+    }
+
+    cancel_token token() const { return state_->source.token(); }
+    bool is_cancelled() const { return state_->source.is_cancelled(); }
+    void request_cancel() { state_->cancel(); }
+
+  private:
+    struct state
+    {
+      std::mutex mutex;
+      std::size_t active{0};
+      std::exception_ptr error;
+      std::coroutine_handle<> joiner;
+      cancel_source source;
+      std::vector<std::weak_ptr<state>> children;
+      std::size_t prune_at{16};
+
+      // A long-lived scope may nest one per request. Expired entries are
+      // dropped whenever the list doubles, so it stays proportional to the
+      // live nested scopes at O(1) amortized cost.
+      void add_child(std::weak_ptr<state> child)
+      {
+        std::lock_guard<std::mutex> lock(mutex);
+
+        if (children.size() >= prune_at)
+        {
+          std::erase_if(children, [](const std::weak_ptr<state> &weak)
+                        { return weak.expired(); });
+          prune_at = std::max<std::size_t>(16, children.size() * 2);
+        }
+
+        children.push_back(std::move(child));
+      }
+
+      void cancel()
+      {
+        source.request_cancel();
+
+        std::vector<std::weak_ptr<state>> nested;
+        {
+          std::lock_guard<std::mutex> lock(mutex);
+          nested = children;
+        }
+
+        for (auto &weak : nested)
+        {
+          if (auto child = weak.lock())
+            child->cancel();
+        }
+      }
+    };
+
+    static task<void> run_child(std::shared_ptr<state> s, io_context &ctx, task<void> child)
+    {
+      try
+      {
+        co_await std::move(child);
+      }
+      catch (...)
+      {
+        bool first = false;
+        {
+          std::lock_guard<std::mutex> lock(s->mutex);
+          if (!s->error)
+          {
+            s->error = std::current_exception();
+            first = true;
+          }
+        }
+
+        if (first)
+          s->cancel();
+      }
+
+      std::coroutine_handle<> joiner;
+      {
+        std::lock_guard<std::mutex> lock(s->mutex);
+        if (--s->active == 0)
+          joiner = std::exchange(s->joiner, {});
+      }
+
+      if (joiner)
+        ctx.post(joiner);
+    }
+
+    struct join_op
+    {
+      state *s;
+
+      bool await_ready() const noexcept { return false; }
+
+      bool await_suspend(std::coroutine_handle<> h)
+      {
+        std::lock_guard<std::mutex> lock(s->mutex);
+
+        if (s->active == 0)
+          return false;
+
+        s->joiner = h;
+        return true;
+      }
+
+      void await_resume() const
+      {
+        if (s->error)
+          std::rethrow_exception(s->error);
+      }
+    };
+
+  public:
+    // Waits for every child; rethrows the first failure. One joiner at a
+    // time.
+    join_op join() { return join_op{state_.get()}; }
+
+  private:
+    io_context &ctx_;
+    std::shared_ptr<state> state_;
+  };
+
+  namespace detail
+  {
+    template <class T>
+    struct bounded_run
+    {
+      using slot_type = std::conditional_t<std::is_void_v<T>, bool, std::optional<T>>;
+
+      std::vector<task<T>> tasks;
+      std::vector<slot_type> results;
+      std::size_t next{0};
+      std::mutex mutex;
+    };
+
+    template <class T>
+    task<void> bounded_worker(std::shared_ptr<bounded_run<T>> run, cancel_token token)
+    {
+      for (;;)
+      {
+        std::size_t index = 0;
+
+        {
+          std::lock_guard<std::mutex> lock(run->mutex);
+
+          if (token.is_cancelled() || run->next == run->tasks.size())
+            co_return;
+
+          index = run->next++;
+        }
+
+        if constexpr (std::is_void_v<T>)
+        {
+          co_await std::move(run->tasks[index]);
+          run->results[index] = true;
+        }
+        else
+        {
+          run->results[index] = co_await std::move(run->tasks[index]);
+        }
+      }
+    }
+
+    template <class T>
+    std::shared_ptr<bounded_run<T>> start_bounded(async_scope &scope, std::vector<task<T>> tasks,
+                                                  std::size_t max_concurrency)
+    {
+      auto run = std::make_shared<bounded_run<T>>();
+      run->results.resize(tasks.size());
+      run->tasks = std::move(tasks);
+
+      const std::size_t workers = std::min(std::max<std::size_t>(1, max_concurrency), run->tasks.size());
+
+      for (std::size_t i = 0; i < workers; ++i)
+        scope.spawn(bounded_worker<T>(run, scope.token()));
+
+      return run;
+    }
+  } // namespace detail
+
+  // Runs `tasks` with at most `max_concurrency` in flight. Tasks are lazy,
+  // so the ones still waiting have not started. Results keep input order.
+  // On failure no new task starts; the first exception is rethrown once
+  // the running ones finish.
+  template <class T>
+  task<std::vector<T>> when_all_bounded(io_context &ctx, std::vector<task<T>> tasks, std::size_t max_concurrency)
+  {
+    async_scope scope(ctx);
+    auto run = detail::start_bounded<T>(scope, std::move(tasks), max_concurrency);
+
+    co_await scope.join();
+
+    std::vector<T> out;
+    out.reserve(run->results.size());
+
+    for (auto &slot : run->results)
+      out.push_back(std::move(*slot));
+
+    co_return out;
+  }
+
+  inline task<void> when_all_bounded(io_context &ctx, std::vector<task<void>> tasks, std::size_t max_concurrency)
+  {
+    async_scope scope(ctx);
+    auto run = detail::start_bounded<void>(scope, std::move(tasks), max_concurrency);
+
+    co_await scope.join();
+  }
+
+  template <class T>
+  class async_channel
+  {
+  public:
+    async_channel(io_context &ctx, std::size_t capacity)
+        : ctx_(ctx),
+          capacity_(capacity)
+    {
+    }
+
+    async_channel(const async_channel &) = delete;
+    async_channel &operator=(const async_channel &) = delete;
+
+    class send_op
+    {
+    public:
+      bool await_ready() const noexcept { return false; }
+
+      bool await_suspend(std::coroutine_handle<> h)
+      {
+        std::lock_guard<std::mutex> lock(ch_->mutex_);
+
+        if (ch_->closed_)
+        {
+          rejected_ = true;
+          return false;
+        }
+
+        if (!ch_->receivers_.empty())
+        {
+          receive_op *r = ch_->receivers_.front();
+          ch_->receivers_.pop_front();
+          r->slot_ = std::move(value_);
+          ch_->ctx_.post(r->waiter_);
+          return false;
+        }
+
+        if (ch_->buffer_.size() < ch_->capacity_)
+        {
+          ch_->buffer_.push_back(std::move(value_));
+          return false;
+        }
+
+        waiter_ = h;
+        ch_->senders_.push_back(this);
+        return true;
+      }
+
+      // Throws when the channel was closed before the value was taken.
+      void await_resume() const
+      {
+        if (rejected_)
+          throw std::system_error(std::make_error_code(std::errc::broken_pipe), "channel closed");
+      }
+
+    private:
+      friend class async_channel;
+
+      send_op(async_channel *ch, T value)
+          : ch_(ch),
+            value_(std::move(value))
+      {
+      }
+
+      async_channel *ch_;
+      T value_;
+      std::coroutine_handle<> waiter_;
+      bool rejected_{false};
+    };
+
+    class receive_op
+    {
+    public:
+      bool await_ready() const noexcept { return false; }
+
+      bool await_suspend(std::coroutine_handle<> h)
+      {
+        std::lock_guard<std::mutex> lock(ch_->mutex_);
+
+        if (!ch_->buffer_.empty())
+        {
+          slot_ = std::move(ch_->buffer_.front());
+          ch_->buffer_.pop_front();
+
+          // A slot opened up: move one blocked sender's value in.
+          if (!ch_->senders_.empty())
+          {
+            send_op *s = ch_->senders_.front();
+            ch_->senders_.pop_front();
+            ch_->buffer_.push_back(std::move(s->value_));
+            ch_->ctx_.post(s->waiter_);
+          }
+
+          return false;
+        }
+
+        // Unbuffered channel: take straight from a blocked sender.
+        if (!ch_->senders_.empty())
+        {
+          send_op *s = ch_->senders_.front();
+          ch_->senders_.pop_front();
+          slot_ = std::move(s->value_);
+          ch_->ctx_.post(s->waiter_);
+          return false;
+        }
+
+        if (ch_->closed_)
+          return false;
+
+        waiter_ = h;
+        ch_->receivers_.push_back(this);
+        return true;
+      }
+
+      // std::nullopt once the channel is closed and drained.
+      std::optional<T> await_resume() { return std::move(slot_); }
+
+    private:
+      friend class async_channel;
+
+      explicit receive_op(async_channel *ch)
+          : ch_(ch)
+      {
+      }
+
+      async_channel *ch_;
+      std::optional<T> slot_;
+      std::coroutine_handle<> waiter_;
+    };
+
+    send_op send(T value) { return send_op(this, std::move(value)); }
+    receive_op receive() { return receive_op(this); }
+
+    bool try_send(T &value)
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+
+      if (closed_)
+        return false;
+
+      if (!receivers_.empty())
+      {
+        receive_op *r = receivers_.front();
+        receivers_.pop_front();
+        r->slot_ = std::move(value);
+        ctx_.post(r->waiter_);
+        return true;
+      }
+
+      if (buffer_.size() >= capacity_)
+        return false;
+
+      buffer_.push_back(std::move(value));
+      return true;
+    }
+
+    // Values already buffered can still be received; blocked senders get
+    // an error and blocked receivers get std::nullopt.
+    void close()
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+
+      if (closed_)
+        return;
+
+      closed_ = true;
+
+      for (send_op *s : senders_)
+      {
+        s->rejected_ = true;
+        ctx_.post(s->waiter_);
+      }
+
+      for (receive_op *r : receivers_)
+        ctx_.post(r->waiter_);
+
+      senders_.clear();
+      receivers_.clear();
+    }
+
+    std::size_t size() const
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      return buffer_.size();
+    }
+
+  private:
+    io_context &ctx_;
+    const std::size_t capacity_;
+
+    mutable std::mutex mutex_;
+    std::deque<T> buffer_;
+    std::deque<send_op *> senders_;
+    std::deque<receive_op *> receivers_;
+    bool closed_{false};
+  };
+} // namespace structured
+
+struct fanout_stats
+{
+  int in_flight{0};
+  int peak{0};
+};
+
+static task<std::string> call_upstream(io_context &ctx, fanout_stats &stats, int id)
+{
+  stats.peak = std::max(stats.peak, ++stats.in_flight);
+  co_await ctx.timers().sleep_for(std::chrono::milliseconds(2 + id % 7));
+  --stats.in_flight;
+
+  co_return "upstream-" + std::to_string(id);
+}
+
+static task<void> produce(structured::async_channel<int> &ch, int first, int count)
+{
+  for (int i = first; i < first + count; ++i)
+    co_await ch.send(i);
+}
+
+static task<void> consume(structured::async_channel<int> &ch, long &sum, std::size_t &peak_buffered)
+{
+  while (auto value = co_await ch.receive())
+  {
+    sum += *value;
+    peak_buffered = std::max(peak_buffered, ch.size());
+  }
+}
+
+static task<void> slow_child(io_context &ctx, cancel_token token, int &cancelled)
+{
+  try
+  {
+    for (int i = 0; i < 50; ++i)
+      co_await ctx.timers().sleep_for(std::chrono::milliseconds(20), token);
+  }
+  catch (const std::system_error &)
+  {
+    ++cancelled;
+    throw;
+  }
+}
+
+static task<void> failing_child(io_context &ctx)
+{
+  co_await ctx.timers().sleep_for(std::chrono::milliseconds(20));
+  throw std::runtime_error("upstream 3 failed");
+}
+
+static task<void> app(io_context &ctx)
+{
+  // Scatter-gather: 200 upstream calls, at most 16 in flight.
+  {
+    fanout_stats stats;
+    std::vector<task<std::string>> calls;
+
+    for (int i = 0; i < 200; ++i)
+      calls.push_back(call_upstream(ctx, stats, i));
+
+    auto replies = co_await structured::when_all_bounded(ctx, std::move(calls), 16);
+
+    vix::console.info("[async] fan-out replies =", replies.size(), "peak in flight =", stats.peak,
+                      "last =", replies.back());
+  }
+
+  // Pipeline: 3 producers, 2 consumers, capacity 4.
+  {
+    structured::async_channel<int> ch(ctx, 4);
+    long sum_a = 0;
+    long sum_b = 0;
+    std::size_t peak_a = 0;
+    std::size_t peak_b = 0;
+
+    structured::async_scope consumers(ctx);
+    consumers.spawn(consume(ch, sum_a, peak_a));
+    consumers.spawn(consume(ch, sum_b, peak_b));
+
+    structured::async_scope producers(ctx);
+    for (int p = 0; p < 3; ++p)
+      producers.spawn(produce(ch, p * 1000, 500));
+
+    co_await producers.join();
+    ch.close();
+    co_await consumers.join();
+
+    vix::console.info("[async] channel sum =", sum_a + sum_b, "peak buffered =", std::max(peak_a, peak_b));
+  }
+
+  // Failure propagation: one child fails, the others are cancelled.
+  {
+    int cancelled = 0;
+    const auto start = std::chrono::steady_clock::now();
+
+    structured::async_scope scope(ctx);
+    for (int i = 0; i < 3; ++i)
+      scope.spawn(slow_child(ctx, scope.token(), cancelled));
+    scope.spawn(failing_child(ctx));
+
+    try
+    {
+      co_await scope.join();
+    }
+    catch (const std::exception &e)
+    {
+      const auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+          std::chrono::steady_clock::now() - start);
+
+      vix::console.warn("[async] scope failed:", e.what(), "cancelled siblings =", cancelled,
+                        "after", ms.count(), "ms");
+    }
+  }
+
+  ctx.stop();
+  co_return;
+}
+
+int main()
+{
+  io_context ctx;
+
+  auto t = app(ctx);
+  ctx.post(t.handle());
+
+  ctx.run();
+  return 0;
+}
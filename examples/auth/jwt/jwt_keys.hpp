@@ -0,0 +1,910 @@
+/**
+ *
+ *  @file jwt_keys.hpp
+ *  @author Gaspard Kirira
+ *
+ *  Copyright 2025, Gaspard Kirira.
+ *  All rights reserved.
+ *  https://github.com/vixcpp/vix
+ *
+ *  Use of this source code is governed by a MIT license
+ *  that can be found in the License file.
+ *
+ *  Vix.cpp
+ *
+ */
+#ifndef VIX_EXAMPLES_AUTH_JWT_KEYS_HPP
+#define VIX_EXAMPLES_AUTH_JWT_KEYS_HPP
+
+// JWT signing keys prepared once, verified many times.
+//
+// A JwtKey does all per-key work at load time:
+//   - HMAC secrets are turned into keyed EVP_MAC contexts. The inner and
+//     outer pad states are computed once and never again per token.
+//   - RSA and EC public keys are parsed into EVP_PKEY once, from a JWK or
+//     a PEM SubjectPublicKeyInfo.
+//   - Digests are fetched once instead of per call.
+// Each thread keeps its own working copy of those contexts, so verify()
+// takes no lock and sets nothing up after a thread's first call.
+//
+// A key only accepts the algorithms of its own family (HS*, RS*/PS* or
+// ES* on the matching curve). "none" is never accepted, so a token cannot
+// pick a weaker algorithm than the key was issued for.
+//
+// JwksSource holds the current KeySet behind an atomic shared_ptr. A
+// background thread refetches the JWKS document. A token with an unknown
+// kid asks for an early refetch, so rotated keys are picked up within
+// min_refresh_interval.
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <nlohmann/json.hpp>
+#include <openssl/bio.h>
+#include <openssl/bn.h>
+#include <openssl/core_names.h>
+#include <openssl/crypto.h>
+#include <openssl/ec.h>
+#include <openssl/evp.h>
+#include <openssl/param_build.h>
+#include <openssl/pem.h>
+#include <openssl/rsa.h>
+
+namespace vix_examples::auth
+{
+  enum class JwtAlg
+  {
+    unsupported,
+    HS256,
+    HS384,
+    HS512,
+    RS256,
+    RS384,
+    RS512,
+    PS256,
+    PS384,
+    PS512,
+    ES256,
+    ES384,
+    ES512,
+  };
+
+  enum class KeyFamily
+  {
+    hmac,
+    rsa,
+    ec,
+  };
+
+  inline JwtAlg parse_alg(std::string_view name) noexcept
+  {
+    static constexpr std::pair<std::string_view, JwtAlg> names[] = {
+        {"HS256", JwtAlg::HS256}, {"HS384", JwtAlg::HS384}, {"HS512", JwtAlg::HS512},
+        {"RS256", JwtAlg::RS256}, {"RS384", JwtAlg::RS384}, {"RS512", JwtAlg::RS512},
+        {"PS256", JwtAlg::PS256}, {"PS384", JwtAlg::PS384}, {"PS512", JwtAlg::PS512},
+        {"ES256", JwtAlg::ES256}, {"ES384", JwtAlg::ES384}, {"ES512", JwtAlg::ES512},
+    };
+    for (const auto &[text, alg] : names)
+    {
+      if (text == name)
+      {
+        return alg;
+      }
+    }
+    return JwtAlg::unsupported;
+  }
+
+  inline std::optional<KeyFamily> family_of(JwtAlg alg) noexcept
+  {
+    switch (alg)
+    {
+    case JwtAlg::HS256:
+    case JwtAlg::HS384:
+    case JwtAlg::HS512:
+      return KeyFamily::hmac;
+    case JwtAlg::RS256:
+    case JwtAlg::RS384:
+    case JwtAlg::RS512:
+    case JwtAlg::PS256:
+    case JwtAlg::PS384:
+    case JwtAlg::PS512:
+      return KeyFamily::rsa;
+    case JwtAlg::ES256:
+    case JwtAlg::ES384:
+    case JwtAlg::ES512:
+      return KeyFamily::ec;
+    case JwtAlg::unsupported:
+      break;
+    }
+    return std::nullopt;
+  }
+
+  // RFC 4648 base64url without padding, as JWS uses it. Returns nullopt on
+  // any character outside the alphabet.
+  inline std::optional<std::string> base64url_decode(std::string_view in)
+  {
+    static constexpr auto table = []
+    {
+      std::array<std::int8_t, 256> t{};
+      t.fill(-1);
+      constexpr std::string_view alphabet = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789-_";
+      for (std::size_t i = 0; i < alphabet.size(); ++i)
+      {
+        t[static_cast<unsigned char>(alphabet[i])] = static_cast<std::int8_t>(i);
+      }
+      return t;
+    }();
+
+    while (!in.empty() && in.back() == '=')
+    {
+      in.remove_suffix(1);
+    }
+    if (in.size() % 4 == 1)
+    {
+      return std::nullopt;
+    }
+
+    std::string out;
+    out.reserve(in.size() * 3 / 4);
+    std::uint32_t bits = 0;
+    int count = 0;
+    for (const char c : in)
+    {
+      const std::int8_t v = table[static_cast<unsigned char>(c)];
+      if (v < 0)
+      {
+        return std::nullopt;
+      }
+      bits = (bits << 6) | static_cast<std::uint32_t>(v);
+      count += 6;
+      if (count >= 8)
+      {
+        count -= 8;
+        out.push_back(static_cast<char>((bits >> count) & 0xFF));
+      }
+    }
+    return out;
+  }
+
+  namespace detail
+  {
+    struct MacDeleter
+    {
+      void operator()(EVP_MAC_CTX *ctx) const noexcept { EVP_MAC_CTX_free(ctx); }
+    };
+    struct PkeyDeleter
+    {
+      void operator()(EVP_PKEY *key) const noexcept { EVP_PKEY_free(key); }
+    };
+    struct PkeyCtxDeleter
+    {
+      void operator()(EVP_PKEY_CTX *ctx) const noexcept { EVP_PKEY_CTX_free(ctx); }
+    };
+
+    using MacCtxPtr = std::unique_ptr<EVP_MAC_CTX, MacDeleter>;
+    using PkeyPtr = std::unique_ptr<EVP_PKEY, PkeyDeleter>;
+    using PkeyCtxPtr = std::unique_ptr<EVP_PKEY_CTX, PkeyCtxDeleter>;
+
+    // Fetched once per process. Implicit fetches (EVP_sha256() and
+    // friends) look the provider up again on every init.
+    inline const EVP_MD *digest_for(JwtAlg alg)
+    {
+      static EVP_MD *const sha256 = EVP_MD_fetch(nullptr, "SHA256", nullptr);
+      static EVP_MD *const sha384 = EVP_MD_fetch(nullptr, "SHA384", nullptr);
+      static EVP_MD *const sha512 = EVP_MD_fetch(nullptr, "SHA512", nullptr);
+      switch (alg)
+      {
+      case JwtAlg::HS256:
+      case JwtAlg::RS256:
+      case JwtAlg::PS256:
+      case JwtAlg::ES256:
+        return sha256;
+      case JwtAlg::HS384:
+      case JwtAlg::RS384:
+      case JwtAlg::PS384:
+      case JwtAlg::ES384:
+        return sha384;
+      case JwtAlg::HS512:
+      case JwtAlg::RS512:
+      case JwtAlg::PS512:
+      case JwtAlg::ES512:
+        return sha512;
+      case JwtAlg::unsupported:
+        break;
+      }
+      return nullptr;
+    }
+
+    inline EVP_MAC *hmac_algorithm()
+    {
+      static EVP_MAC *const mac = EVP_MAC_fetch(nullptr, "HMAC", nullptr);
+      return mac;
+    }
+
+    inline std::size_t hash_index(JwtAlg alg) noexcept
+    {
+      const EVP_MD *md = digest_for(alg);
+      const int size = md != nullptr ? EVP_MD_get_size(md) : 0;
+      return size == 48 ? 1 : size == 64 ? 2 : 0;
+    }
+
+    // Per-thread working contexts, keyed by key id and algorithm. Ids are
+    // never reused, so an entry of a dropped key is just never hit again;
+    // the map is cleared when it grows past a bound.
+    struct ThreadContexts
+    {
+      static constexpr std::size_t kMaxEntries = 256;
+
+      std::unordered_map<std::uint64_t, MacCtxPtr> mac;
+      std::unordered_map<std::uint64_t, PkeyCtxPtr> pkey;
+
+      static ThreadContexts &local()
+      {
+        thread_local ThreadContexts contexts;
+        return contexts;
+      }
+
+      template <class Map>
+      static void bound(Map &map)
+      {
+        if (map.size() >= kMaxEntries)
+        {
+          map.clear();
+        }
+      }
+    };
+
+    // JWS ECDSA signatures are raw r || s; OpenSSL verifies DER.
+    inline std::string ecdsa_raw_to_der(std::string_view raw)
+    {
+      const std::size_t half = raw.size() / 2;
+      const auto *bytes = reinterpret_cast<const unsigned char *>(raw.data());
+      ECDSA_SIG *sig = ECDSA_SIG_new();
+      BIGNUM *r = BN_bin2bn(bytes, static_cast<int>(half), nullptr);
+      BIGNUM *s = BN_bin2bn(bytes + half, static_cast<int>(half), nullptr);
+      if (sig == nullptr || r == nullptr || s == nullptr || ECDSA_SIG_set0(sig, r, s) != 1)
+      {
+        BN_free(r);
+        BN_free(s);
+        ECDSA_SIG_free(sig);
+        return {};
+      }
+
+      std::string der;
+      const int size = i2d_ECDSA_SIG(sig, nullptr);
+      if (size > 0)
+      {
+        der.resize(static_cast<std::size_t>(size));
+        auto *out = reinterpret_cast<unsigned char *>(der.data());
+        i2d_ECDSA_SIG(sig, &out);
+      }
+      ECDSA_SIG_free(sig);
+      return der;
+    }
+
+    inline bool read_bn(const nlohmann::json &jwk, const char *name, std::string &out)
+    {
+      const auto it = jwk.find(name);
+      if (it == jwk.end() || !it->is_string())
+      {
+        return false;
+      }
+      auto decoded = base64url_decode(it->get_ref<const std::string &>());
+      if (!decoded || decoded->empty())
+      {
+        return false;
+      }
+      out = std::move(*decoded);
+      return true;
+    }
+  } // namespace detail
+
+  // One verification key. Immutable and shareable across threads.
+  class JwtKey
+  {
+  public:
+    // `only` pins the key to one algorithm (the JWK "alg"); unsupported
+    // means any algorithm of the key's family.
+    static std::shared_ptr<const JwtKey> hmac(std::string_view secret, std::string kid = {},
+                                              JwtAlg only = JwtAlg::unsupported)
+    {
+      if (secret.empty() || (only != JwtAlg::unsupported && family_of(only) != KeyFamily::hmac))
+      {
+        return nullptr;
+      }
+
+      std::shared_ptr<JwtKey> key(new JwtKey(KeyFamily::hmac, std::move(kid), only));
+      for (const JwtAlg alg : {JwtAlg::HS256, JwtAlg::HS384, JwtAlg::HS512})
+      {
+        if (!key->accepts(alg))
+        {
+          continue;
+        }
+        detail::MacCtxPtr ctx(EVP_MAC_CTX_new(detail::hmac_algorithm()));
+        const OSSL_PARAM params[] = {
+            OSSL_PARAM_construct_utf8_string(OSSL_MAC_PARAM_DIGEST,
+                                             const_cast<char *>(EVP_MD_get0_name(detail::digest_for(alg))), 0),
+            OSSL_PARAM_construct_end(),
+        };
+        if (!ctx || EVP_MAC_init(ctx.get(), reinterpret_cast<const unsigned char *>(secret.data()),
+                                 secret.size(), params) != 1)
+        {
+          return nullptr;
+        }
+        key->mac_[detail::hash_index(alg)] = std::move(ctx);
+      }
+      return key;
+    }
+
+    // A PEM "PUBLIC KEY" (SubjectPublicKeyInfo) holding an RSA or EC key.
+    static std::shared_ptr<const JwtKey> from_pem(std::string_view pem, std::string kid = {},
+                                                  JwtAlg only = JwtAlg::unsupported)
+    {
+      BIO *bio = BIO_new_mem_buf(pem.data(), static_cast<int>(pem.size()));
+      detail::PkeyPtr pkey(bio != nullptr ? PEM_read_bio_PUBKEY(bio, nullptr, nullptr, nullptr) : nullptr);
+      BIO_free(bio);
+      return from_pkey(std::move(pkey), std::move(kid), only);
+    }
+
+    // A JWK object: kty "oct" (k), "RSA" (n, e) or "EC" (crv, x, y).
+    // Keys marked for another use than "sig" are rejected.
+    static std::shared_ptr<const JwtKey> from_jwk(const nlohmann::json &jwk, std::string *error = nullptr)
+    {
+      const auto fail = [error](std::string message) -> std::shared_ptr<const JwtKey>
+      {
+        if (error != nullptr)
+        {
+          *error = std::move(message);
+        }
+        return nullptr;
+      };
+
+      if (!jwk.is_object() || !jwk.contains("kty") || !jwk["kty"].is_string())
+      {
+        return fail("missing kty");
+      }
+      if (jwk.contains("use") && jwk["use"] != "sig")
+      {
+        return fail("use is not sig");
+      }
+
+      const std::string kid = jwk.value("kid", std::string{});
+      JwtAlg only = JwtAlg::unsupported;
+      if (jwk.contains("alg"))
+      {
+        only = jwk["alg"].is_string() ? parse_alg(jwk["alg"].get<std::string>()) : JwtAlg::unsupported;
+        if (only == JwtAlg::unsupported)
+        {
+          return fail("unsupported alg");
+        }
+      }
+
+      const std::string kty = jwk["kty"].get<std::string>();
+      std::shared_ptr<const JwtKey> key;
+      if (kty == "oct")
+      {
+        std::string k;
+        if (!detail::read_bn(jwk, "k", k))
+        {
+          return fail("oct key without k");
+        }
+        key = hmac(k, kid, only);
+        OPENSSL_cleanse(k.data(), k.size());
+      }
+      else if (kty == "RSA")
+      {
+        key = from_pkey(rsa_from_jwk(jwk), kid, only);
+      }
+      else if (kty == "EC")
+      {
+        key = from_pkey(ec_from_jwk(jwk), kid, only);
+      }
+      else
+      {
+        return fail("unsupported kty " + kty);
+      }
+      return key ? key : fail("invalid " + kty + " key");
+    }
+
+    [[nodiscard]] bool accepts(JwtAlg alg) const noexcept
+    {
+      if (family_of(alg) != family_ || (only_ != JwtAlg::unsupported && alg != only_))
+      {
+        return false;
+      }
+      if (family_ == KeyFamily::ec)
+      {
+        return alg == curve_alg_;
+      }
+      return true;
+    }
+
+    // Checks `signature` (already base64url-decoded) over the JWS signing
+    // input "<header>.<payload>".
+    [[nodiscard]] bool verify(JwtAlg alg, std::string_view signing_input, std::string_view signature) const
+    {
+      if (!accepts(alg))
+      {
+        return false;
+      }
+      return family_ == KeyFamily::hmac ? verify_hmac(alg, signing_input, signature)
+                                        : verify_pkey(alg, signing_input, signature);
+    }
+
+    [[nodiscard]] const std::string &kid() const noexcept { return kid_; }
+    [[nodiscard]] KeyFamily family() const noexcept { return family_; }
+    [[nodiscard]] std::uint64_t id() const noexcept { return id_; }
+
+  private:
+    JwtKey(KeyFamily family, std::string kid, JwtAlg only)
+        : family_(family), kid_(std::move(kid)), only_(only), id_(next_id())
+    {
+    }
+
+    static std::uint64_t next_id() noexcept
+    {
+      static std::atomic<std::uint64_t> counter{0};
+      return counter.fetch_add(1, std::memory_order_relaxed) + 1;
+    }
+
+    static std::shared_ptr<const JwtKey> from_pkey(detail::PkeyPtr pkey, std::string kid, JwtAlg only)
+    {
+      if (!pkey)
+      {
+        return nullptr;
+      }
+
+      const int type = EVP_PKEY_get_base_id(pkey.get());
+      if (type == EVP_PKEY_RSA)
+      {
+        // RFC 7518 3.3: RSA keys of at least 2048 bits.
+        if (EVP_PKEY_get_bits(pkey.get()) < 2048 || (only != JwtAlg::unsupported && family_of(only) != KeyFamily::rsa))
+        {
+          return nullptr;
+        }
+        std::shared_ptr<JwtKey> key(new JwtKey(KeyFamily::rsa, std::move(kid), only));
+        key->pkey_ = std::move(pkey);
+        return key;
+      }
+
+      if (type == EVP_PKEY_EC)
+      {
+        char group[64] = {};
+        std::size_t length = 0;
+        if (EVP_PKEY_get_utf8_string_param(pkey.get(), OSSL_PKEY_PARAM_GROUP_NAME, group, sizeof(group), &length) != 1)
+        {
+          return nullptr;
+        }
+        const std::string_view name(group, length);
+        const JwtAlg curve = name == "prime256v1" ? JwtAlg::ES256
+                             : name == "secp384r1" ? JwtAlg::ES384
+                             : name == "secp521r1" ? JwtAlg::ES512
+                                                   : JwtAlg::unsupported;
+        if (curve == JwtAlg::unsupported || (only != JwtAlg::unsupported && only != curve))
+        {
+          return nullptr;
+        }
+        std::shared_ptr<JwtKey> key(new JwtKey(KeyFamily::ec, std::move(kid), only));
+        key->curve_alg_ = curve;
+        key->coordinate_size_ = curve == JwtAlg::ES256 ? 32 : curve == JwtAlg::ES384 ? 48 : 66;
+        key->pkey_ = std::move(pkey);
+        return key;
+      }
+      return nullptr;
+    }
+
+    static detail::PkeyPtr pkey_from_params(const char *type, OSSL_PARAM_BLD *builder)
+    {
+      OSSL_PARAM *params = OSSL_PARAM_BLD_to_param(builder);
+      detail::PkeyCtxPtr ctx(EVP_PKEY_CTX_new_from_name(nullptr, type, nullptr));
+      EVP_PKEY *pkey = nullptr;
+      if (params == nullptr || !ctx || EVP_PKEY_fromdata_init(ctx.get()) != 1 ||
+          EVP_PKEY_fromdata(ctx.get(), &pkey, EVP_PKEY_PUBLIC_KEY, params) != 1)
+      {
+        pkey = nullptr;
+      }
+      OSSL_PARAM_free(params);
+      return detail::PkeyPtr(pkey);
+    }
+
+    static detail::PkeyPtr rsa_from_jwk(const nlohmann::json &jwk)
+    {
+      std::string n;
+      std::string e;
+      if (!detail::read_bn(jwk, "n", n) || !detail::read_bn(jwk, "e", e))
+      {
+        return nullptr;
+      }
+
+      BIGNUM *bn_n = BN_bin2bn(reinterpret_cast<const unsigned char *>(n.data()), static_cast<int>(n.size()), nullptr);
+      BIGNUM *bn_e = BN_bin2bn(reinterpret_cast<const unsigned char *>(e.data()), static_cast<int>(e.size()), nullptr);
+      OSSL_PARAM_BLD *builder = OSSL_PARAM_BLD_new();
+      detail::PkeyPtr pkey;
+      if (bn_n != nullptr && bn_e != nullptr && builder != nullptr &&
+          OSSL_PARAM_BLD_push_BN(builder, OSSL_PKEY_PARAM_RSA_N, bn_n) == 1 &&
+          OSSL_PARAM_BLD_push_BN(builder, OSSL_PKEY_PARAM_RSA_E, bn_e) == 1)
+      {
+        pkey = pkey_from_params("RSA", builder);
+      }
+      OSSL_PARAM_BLD_free(builder);
+      BN_free(bn_n);
+      BN_free(bn_e);
+      return pkey;
+    }
+
+    static detail::PkeyPtr ec_from_jwk(const nlohmann::json &jwk)
+    {
+      const std::string crv = jwk.value("crv", std::string{});
+      const char *group = crv == "P-256" ? "prime256v1" : crv == "P-384" ? "secp384r1" : crv == "P-521" ? "secp521r1" : nullptr;
+      const std::size_t size = crv == "P-256" ? 32 : crv == "P-384" ? 48 : 66;
+
+      std::string x;
+      std::string y;
+      if (group == nullptr || !detail::read_bn(jwk, "x", x) || !detail::read_bn(jwk, "y", y) ||
+          x.size() != size || y.size() != size)
+      {
+        return nullptr;
+      }
+
+      const std::string point = '\x04' + x + y; // uncompressed SEC1 point
+      OSSL_PARAM_BLD *builder = OSSL_PARAM_BLD_new();
+      detail::PkeyPtr pkey;
+      if (builder != nullptr &&
+          OSSL_PARAM_BLD_push_utf8_string(builder, OSSL_PKEY_PARAM_GROUP_NAME, group, 0) == 1 &&
+          OSSL_PARAM_BLD_push_octet_string(builder, OSSL_PKEY_PARAM_PUB_KEY, point.data(), point.size()) == 1)
+      {
+        pkey = pkey_from_params("EC", builder);
+      }
+      OSSL_PARAM_BLD_free(builder);
+      return pkey;
+    }
+
+    static std::uint64_t context_slot(std::uint64_t id, JwtAlg alg) noexcept
+    {
+      return (id << 4) | static_cast<std::uint64_t>(alg);
+    }
+
+    bool verify_hmac(JwtAlg alg, std::string_view input, std::string_view signature) const
+    {
+      EVP_MAC_CTX *keyed = mac_[detail::hash_index(alg)].get();
+      if (keyed == nullptr)
+      {
+        return false;
+      }
+
+      auto &contexts = detail::ThreadContexts::local();
+      auto it = contexts.mac.find(context_slot(id_, alg));
+      if (it == contexts.mac.end())
+      {
+        detail::ThreadContexts::bound(contexts.mac);
+        detail::MacCtxPtr copy(EVP_MAC_CTX_dup(keyed));
+        if (!copy)
+        {
+          return false;
+        }
+        it = contexts.mac.emplace(context_slot(id_, alg), std::move(copy)).first;
+      }
+
+      // A null key restarts from the stored pad states.
+      EVP_MAC_CTX *ctx = it->second.get();
+      unsigned char mac[EVP_MAX_MD_SIZE];
+      std::size_t length = 0;
+      if (EVP_MAC_init(ctx, nullptr, 0, nullptr) != 1 ||
+          EVP_MAC_update(ctx, reinterpret_cast<const unsigned char *>(input.data()), input.size()) != 1 ||
+          EVP_MAC_final(ctx, mac, &length, sizeof(mac)) != 1)
+      {
+        return false;
+      }
+      return length == signature.size() && CRYPTO_memcmp(mac, signature.data(), length) == 0;
+    }
+
+    bool verify_pkey(JwtAlg alg, std::string_view input, std::string_view signature) const
+    {
+      const EVP_MD *md = detail::digest_for(alg);
+      unsigned char digest[EVP_MAX_MD_SIZE];
+      unsigned int digestLength = 0;
+      if (EVP_Digest(input.data(), input.size(), digest, &digestLength, md, nullptr) != 1)
+      {
+        return false;
+      }
+
+      std::string der;
+      if (family_ == KeyFamily::ec)
+      {
+        if (signature.size() != 2 * coordinate_size_)
+        {
+          return false;
+        }
+        der = detail::ecdsa_raw_to_der(signature);
+        signature = der;
+      }
+
+      auto &contexts = detail::ThreadContexts::local();
+      auto it = contexts.pkey.find(context_slot(id_, alg));
+      if (it == contexts.pkey.end())
+      {
+        detail::ThreadContexts::bound(contexts.pkey);
+        detail::PkeyCtxPtr ctx(EVP_PKEY_CTX_new_from_pkey(nullptr, pkey_.get(), nullptr));
+        if (!ctx || EVP_PKEY_verify_init(ctx.get()) != 1 || EVP_PKEY_CTX_set_signature_md(ctx.get(), md) != 1)
+        {
+          return false;
+        }
+        if (family_ == KeyFamily::rsa)
+        {
+          const bool pss = alg == JwtAlg::PS256 || alg == JwtAlg::PS384 || alg == JwtAlg::PS512;
+          if (EVP_PKEY_CTX_set_rsa_padding(ctx.get(), pss ? RSA_PKCS1_PSS_PADDING : RSA_PKCS1_PADDING) != 1 ||
+              (pss && EVP_PKEY_CTX_set_rsa_pss_saltlen(ctx.get(), RSA_PSS_SALTLEN_DIGEST) != 1))
+          {
+            return false;
+          }
+        }
+        it = contexts.pkey.emplace(context_slot(id_, alg), std::move(ctx)).first;
+      }
+
+      return EVP_PKEY_verify(it->second.get(), reinterpret_cast<const unsigned char *>(signature.data()),
+                             signature.size(), digest, digestLength) == 1;
+    }
+
+    KeyFamily family_;
+    std::string kid_;
+    JwtAlg only_;
+    std::uint64_t id_;
+    std::array<detail::MacCtxPtr, 3> mac_{}; // HS256, HS384, HS512
+    detail::PkeyPtr pkey_;
+    JwtAlg curve_alg_{JwtAlg::unsupported};
+    std::size_t coordinate_size_{0};
+  };
+
+  // An immutable set of keys. `generation` changes whenever the content
+  // does, so verified results can be tied to the set that produced them.
+  class KeySet
+  {
+  public:
+    KeySet() = default;
+
+    // Null keys (a failed JwtKey factory) are dropped.
+    explicit KeySet(std::vector<std::shared_ptr<const JwtKey>> keys, std::uint64_t generation = 0)
+        : keys_(std::move(keys)), generation_(generation)
+    {
+      std::erase(keys_, nullptr);
+    }
+
+    // Parses a JWKS document ({"keys": [...]}). Keys that fail to load are
+    // skipped and reported in `errors`.
+    static std::shared_ptr<const KeySet> from_jwks(std::string_view document, std::uint64_t generation = 0,
+                                                   std::vector<std::string> *errors = nullptr)
+    {
+      const auto json = nlohmann::json::parse(document, nullptr, false);
+      if (json.is_discarded() || !json.contains("keys") || !json["keys"].is_array())
+      {
+        if (errors != nullptr)
+        {
+          errors->push_back("not a JWKS document");
+        }
+        return nullptr;
+      }
+
+      std::vector<std::shared_ptr<const JwtKey>> keys;
+      for (const auto &jwk : json["keys"])
+      {
+        std::string error;
+        if (auto key = JwtKey::from_jwk(jwk, &error))
+        {
+          keys.push_back(std::move(key));
+        }
+        else if (errors != nullptr)
+        {
+          errors->push_back(jwk.value("kid", std::string("(no kid)")) + ": " + error);
+        }
+      }
+      return std::make_shared<const KeySet>(std::move(keys), generation);
+    }
+
+    // The key a token names with `kid`. Without a kid, the first key that
+    // accepts the algorithm.
+    [[nodiscard]] const JwtKey *find(std::string_view kid, JwtAlg alg) const noexcept
+    {
+      for (const auto &key : keys_)
+      {
+        if ((kid.empty() || key->kid() == kid) && key->accepts(alg))
+        {
+          return key.get();
+        }
+      }
+      return nullptr;
+    }
+
+    [[nodiscard]] std::size_t size() const noexcept { return keys_.size(); }
+    [[nodiscard]] std::uint64_t generation() const noexcept { return generation_; }
+
+  private:
+    std::vector<std::shared_ptr<const JwtKey>> keys_;
+    std::uint64_t generation_{0};
+  };
+
+  // The current KeySet, fixed or refreshed from a JWKS endpoint.
+  class JwksSource
+  {
+  public:
+    // Returns the JWKS document, or nullopt when the fetch failed.
+    using Fetch = std::function<std::optional<std::string>()>;
+
+    struct RefreshResult
+    {
+      bool fetched{false};
+      bool changed{false};
+      std::size_t keys{0};
+      std::vector<std::string> errors;
+    };
+
+    explicit JwksSource(std::shared_ptr<const KeySet> keys)
+        : current_(std::move(keys))
+    {
+    }
+
+    explicit JwksSource(Fetch fetch, std::chrono::seconds min_refresh_interval = std::chrono::seconds(30))
+        : current_(std::make_shared<const KeySet>()),
+          fetch_(std::move(fetch)),
+          min_refresh_interval_(min_refresh_interval)
+    {
+    }
+
+    JwksSource(const JwksSource &) = delete;
+    JwksSource &operator=(const JwksSource &) = delete;
+
+    ~JwksSource()
+    {
+      stop();
+    }
+
+    [[nodiscard]] std::shared_ptr<const KeySet> current() const
+    {
+      return current_.load(std::memory_order_acquire);
+    }
+
+    // Fetches now, on the calling thread. An unchanged document keeps the
+    // current set (and its generation). A failed fetch or a document with
+    // no usable key keeps the last good set.
+    RefreshResult refresh()
+    {
+      RefreshResult result;
+      if (!fetch_)
+      {
+        return result;
+      }
+
+      std::lock_guard<std::mutex> lock(refresh_mutex_);
+      const auto document = fetch_();
+      if (!document)
+      {
+        result.errors.push_back("fetch failed");
+        return result;
+      }
+      result.fetched = true;
+
+      if (*document == document_)
+      {
+        result.keys = current()->size();
+        return result;
+      }
+
+      auto next = KeySet::from_jwks(*document, generation_ + 1, &result.errors);
+      if (!next || next->size() == 0)
+      {
+        result.errors.push_back("no usable key, keeping the previous set");
+        return result;
+      }
+
+      ++generation_;
+      document_ = *document;
+      result.changed = true;
+      result.keys = next->size();
+      current_.store(std::move(next), std::memory_order_release);
+      return result;
+    }
+
+    // Refreshes every `interval` on a background thread, and earlier when
+    // request_refresh() asks for it. The first fetch happens right away
+    // if no key is loaded yet.
+    void start(std::chrono::seconds interval = std::chrono::minutes(10),
+               std::function<void(const RefreshResult &)> on_refresh = {})
+    {
+      stop();
+      stopping_ = false;
+      wanted_ = current()->size() == 0;
+
+      worker_ = std::thread([this, interval, on_refresh = std::move(on_refresh)]
+                            {
+                              std::unique_lock<std::mutex> lock(mutex_);
+                              while (!stopping_)
+                              {
+                                wake_.wait_for(lock, interval, [this] { return stopping_ || wanted_; });
+                                if (stopping_)
+                                {
+                                  break;
+                                }
+                                wanted_ = false;
+
+                                lock.unlock();
+                                const auto result = refresh();
+                                if (on_refresh)
+                                {
+                                  on_refresh(result);
+                                }
+                                lock.lock();
+                              } });
+    }
+
+    void stop()
+    {
+      if (!worker_.joinable())
+      {
+        return;
+      }
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+      }
+      wake_.notify_all();
+      worker_.join();
+    }
+
+    // Called on a kid miss. Never fetches on the request thread, and at
+    // most once per min_refresh_interval, so unknown kids cannot be used
+    // to hammer the JWKS endpoint.
+    void request_refresh()
+    {
+      if (!worker_.joinable())
+      {
+        return;
+      }
+
+      const auto now = std::chrono::steady_clock::now().time_since_epoch().count();
+      const auto spacing = std::chrono::duration_cast<std::chrono::steady_clock::duration>(min_refresh_interval_).count();
+      auto last = last_request_.load(std::memory_order_relaxed);
+      if (now - last < spacing || !last_request_.compare_exchange_strong(last, now, std::memory_order_relaxed))
+      {
+        return;
+      }
+
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        wanted_ = true;
+      }
+      wake_.notify_all();
+    }
+
+  private:
+    std::atomic<std::shared_ptr<const KeySet>> current_;
+    Fetch fetch_;
+    std::chrono::seconds min_refresh_interval_{30};
+
+    std::mutex refresh_mutex_;
+    std::string document_;
+    std::uint64_t generation_{0};
+    std::atomic<std::chrono::steady_clock::rep> last_request_{std::numeric_limits<std::chrono::steady_clock::rep>::min() / 2};
+
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    bool stopping_{false};
+    bool wanted_{false};
+    std::thread worker_;
+  };
+} // namespace vix_examples::auth
+
+#endif // VIX_EXAMPLES_AUTH_JWT_KEYS_HPP
@@ -0,0 +1,237 @@
+/**
+ *
+ *  @file  jwt_verify_bench.cpp — JWT verification: per request vs precomputed vs cached (Vix.cpp)
+ *  @author Gaspard Kirira
+ *
+ *  Copyright 2025, Gaspard Kirira.  All rights reserved.
+ *  https://github.com/vixcpp/vix
+ *  Use of this source code is governed by a MIT license
+ *  that can be found in the License file.
+ *
+ *  Vix.cpp
+ *
+ */
+// ----------------------------------------------------------------------------
+// Build:
+//   g++ -std=c++20 -O2 jwt_verify_bench.cpp -lcrypto && ./a.out
+//
+// Knobs (environment):
+//   VIX_JWT_BENCH_ITERATIONS  HS256 verifications per variant (default 200000);
+//                             RS256 and ES256 run a tenth of that
+//
+// For each algorithm, verifies the same token over and over:
+//   per request   what a plain middleware does on every call: implicit
+//                 digest fetch, key setup, signature check, then parse the
+//                 header and the claims JSON
+//   precomputed   JwtVerifier without a cache: keys prepared once, per-
+//                 thread contexts, but still a signature check and a JSON
+//                 parse per request
+//   cached        JwtVerifier with JwtClaimsCache: a repeated token is one
+//                 lookup
+// ============================================================================
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <string>
+
+#include <openssl/hmac.h>
+
+#include "jwt_verify_cache.hpp"
+
+using namespace vix_examples::auth;
+
+static std::size_t env_size(const char *name, std::size_t fallback)
+{
+  const char *value = std::getenv(name);
+  if (value == nullptr || *value == '\0')
+  {
+    return fallback;
+  }
+  return static_cast<std::size_t>(std::strtoull(value, nullptr, 10));
+}
+
+static std::string base64url(std::string_view in)
+{
+  static constexpr char alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789-_";
+  std::string out;
+  std::uint32_t bits = 0;
+  int count = 0;
+  for (const unsigned char c : in)
+  {
+    bits = (bits << 8) | c;
+    count += 8;
+    while (count >= 6)
+    {
+      count -= 6;
+      out += alphabet[(bits >> count) & 63];
+    }
+  }
+  if (count > 0)
+  {
+    out += alphabet[(bits << (6 - count)) & 63];
+  }
+  return out;
+}
+
+static std::string big_endian(const BIGNUM *bn, int size)
+{
+  std::string out(static_cast<std::size_t>(size), '\0');
+  BN_bn2binpad(bn, reinterpret_cast<unsigned char *>(out.data()), size);
+  return out;
+}
+
+static std::string sign_hs256(std::string_view input, std::string_view secret)
+{
+  unsigned char mac[EVP_MAX_MD_SIZE];
+  unsigned int length = 0;
+  HMAC(EVP_sha256(), secret.data(), static_cast<int>(secret.size()),
+       reinterpret_cast<const unsigned char *>(input.data()), input.size(), mac, &length);
+  return std::string(reinterpret_cast<char *>(mac), length);
+}
+
+static std::string sign_pkey(EVP_PKEY *key, std::string_view input, bool ecdsa)
+{
+  EVP_MD_CTX *ctx = EVP_MD_CTX_new();
+  EVP_DigestSignInit(ctx, nullptr, EVP_sha256(), nullptr, key);
+  std::size_t length = 0;
+  EVP_DigestSign(ctx, nullptr, &length, reinterpret_cast<const unsigned char *>(input.data()), input.size());
+  std::string sig(length, '\0');
+  EVP_DigestSign(ctx, reinterpret_cast<unsigned char *>(sig.data()), &length,
+                 reinterpret_cast<const unsigned char *>(input.data()), input.size());
+  sig.resize(length);
+  EVP_MD_CTX_free(ctx);
+
+  if (!ecdsa)
+  {
+    return sig;
+  }
+  const auto *der = reinterpret_cast<const unsigned char *>(sig.data());
+  ECDSA_SIG *parsed = d2i_ECDSA_SIG(nullptr, &der, static_cast<long>(sig.size()));
+  std::string raw = big_endian(ECDSA_SIG_get0_r(parsed), 32) + big_endian(ECDSA_SIG_get0_s(parsed), 32);
+  ECDSA_SIG_free(parsed);
+  return raw;
+}
+
+static std::string make_token(const std::string &alg, const std::string &kid, EVP_PKEY *key, std::string_view secret)
+{
+  const auto exp = detail::unix_now() + 3600;
+  const std::string input =
+      base64url(R"({"alg":")" + alg + R"(","typ":"JWT","kid":")" + kid + R"("})") + "." +
+      base64url(R"({"sub":"user123","roles":["admin","editor"],"perms":["products:write","orders:read"],)"
+                R"("iss":"https://auth.example.com","aud":"api","exp":)" +
+                std::to_string(exp) + "}");
+  const std::string sig = alg == "HS256" ? sign_hs256(input, secret) : sign_pkey(key, input, alg == "ES256");
+  return input + "." + base64url(sig);
+}
+
+// The per-request path: nothing is kept between calls.
+static bool verify_per_request(const std::string &token, std::string_view secret, EVP_PKEY *key)
+{
+  const auto first = token.find('.');
+  const auto second = token.find('.', first + 1);
+  const auto header = nlohmann::json::parse(*base64url_decode(std::string_view(token).substr(0, first)));
+  const std::string alg = header["alg"].get<std::string>();
+  const std::string_view input = std::string_view(token).substr(0, second);
+  const auto sig = base64url_decode(std::string_view(token).substr(second + 1));
+
+  bool ok = false;
+  if (alg == "HS256")
+  {
+    ok = sign_hs256(input, secret) == *sig;
+  }
+  else
+  {
+    const std::string der = alg == "ES256" ? detail::ecdsa_raw_to_der(*sig) : *sig;
+    EVP_MD_CTX *ctx = EVP_MD_CTX_new();
+    ok = EVP_DigestVerifyInit(ctx, nullptr, EVP_sha256(), nullptr, key) == 1 &&
+         EVP_DigestVerify(ctx, reinterpret_cast<const unsigned char *>(der.data()), der.size(),
+                          reinterpret_cast<const unsigned char *>(input.data()), input.size()) == 1;
+    EVP_MD_CTX_free(ctx);
+  }
+
+  const auto payload = nlohmann::json::parse(*base64url_decode(std::string_view(token).substr(first + 1, second - first - 1)));
+  return ok && payload["sub"].is_string() && payload["exp"].get<std::int64_t>() > detail::unix_now();
+}
+
+template <class F>
+static double us_per_call(std::size_t n, F &&fn)
+{
+  std::size_t ok = 0;
+  const auto start = std::chrono::steady_clock::now();
+  for (std::size_t i = 0; i < n; ++i)
+  {
+    ok += fn() ? 1 : 0;
+  }
+  const std::chrono::duration<double, std::micro> elapsed = std::chrono::steady_clock::now() - start;
+  if (ok != n)
+  {
+    std::cerr << "verification failed " << n - ok << " times\n";
+    std::exit(1);
+  }
+  return elapsed.count() / static_cast<double>(n);
+}
+
+int main()
+{
+  const std::size_t iterations = env_size("VIX_JWT_BENCH_ITERATIONS", 200'000);
+  const std::string secret = "a-long-enough-hs256-secret-for-the-bench";
+
+  EVP_PKEY *rsa = EVP_PKEY_Q_keygen(nullptr, nullptr, "RSA", static_cast<std::size_t>(2048));
+  EVP_PKEY *ec = EVP_PKEY_Q_keygen(nullptr, nullptr, "EC", "P-256");
+
+  BIGNUM *n = nullptr, *e = nullptr, *x = nullptr, *y = nullptr;
+  EVP_PKEY_get_bn_param(rsa, OSSL_PKEY_PARAM_RSA_N, &n);
+  EVP_PKEY_get_bn_param(rsa, OSSL_PKEY_PARAM_RSA_E, &e);
+  EVP_PKEY_get_bn_param(ec, OSSL_PKEY_PARAM_EC_PUB_X, &x);
+  EVP_PKEY_get_bn_param(ec, OSSL_PKEY_PARAM_EC_PUB_Y, &y);
+  const nlohmann::json jwks = {
+      {"keys",
+       {{{"kty", "oct"}, {"kid", "hs"}, {"k", base64url(secret)}},
+        {{"kty", "RSA"}, {"kid", "rs"}, {"n", base64url(big_endian(n, BN_num_bytes(n)))}, {"e", base64url(big_endian(e, BN_num_bytes(e)))}},
+        {{"kty", "EC"}, {"kid", "es"}, {"crv", "P-256"}, {"x", base64url(big_endian(x, 32))}, {"y", base64url(big_endian(y, 32))}}}}};
+  BN_free(n);
+  BN_free(e);
+  BN_free(x);
+  BN_free(y);
+
+  auto keys = std::make_shared<JwksSource>(KeySet::from_jwks(jwks.dump()));
+  JwtVerifyOptions options;
+  options.issuer = "https://auth.example.com";
+  options.audience = "api";
+  const JwtVerifier precomputed(keys, options, nullptr);
+  const JwtVerifier cached(keys, options);
+
+  std::cout << "verifications per variant: HS256 " << iterations << ", RS256/ES256 " << iterations / 10 << "\n\n"
+            << "alg      per request   precomputed   cached    (us per verification)\n";
+
+  struct Case
+  {
+    const char *alg;
+    const char *kid;
+    EVP_PKEY *key;
+    std::size_t n;
+  };
+  for (const Case &c : {Case{"HS256", "hs", nullptr, iterations}, Case{"RS256", "rs", rsa, iterations / 10},
+                        Case{"ES256", "es", ec, iterations / 10}})
+  {
+    const std::string token = make_token(c.alg, c.kid, c.key, secret);
+    const double plain = us_per_call(c.n, [&]
+                                     { return verify_per_request(token, secret, c.key); });
+    const double prepared = us_per_call(c.n, [&]
+                                        { return static_cast<bool>(precomputed.verify(token)); });
+    const double hit = us_per_call(c.n, [&]
+                                   { return static_cast<bool>(cached.verify(token)); });
+
+    std::cout << std::left << std::setw(9) << c.alg << std::right << std::fixed << std::setprecision(2)
+              << std::setw(11) << plain << std::setw(14) << prepared << std::setw(9) << hit << "\n";
+  }
+
+  const auto stats = cached.cache()->stats();
+  std::cout << "\ncache: " << stats.hits << " hits, " << stats.misses << " misses, "
+            << cached.cache()->size() << " entries\n";
+
+  EVP_PKEY_free(rsa);
+  EVP_PKEY_free(ec);
+  return 0;
+}
@@ -0,0 +1,550 @@
+/**
+ *
+ *  @file jwt_verify_cache.hpp
+ *  @author Gaspard Kirira
+ *
+ *  Copyright 2025, Gaspard Kirira.
+ *  All rights reserved.
+ *  https://github.com/vixcpp/vix
+ *
+ *  Use of this source code is governed by a MIT license
+ *  that can be found in the License file.
+ *
+ *  Vix.cpp
+ *
+ */
+#ifndef VIX_EXAMPLES_AUTH_JWT_VERIFY_CACHE_HPP
+#define VIX_EXAMPLES_AUTH_JWT_VERIFY_CACHE_HPP
+
+// JWT verification that is paid once per token, not once per request.
+//
+// Clients send the same token for its whole lifetime, often an hour. The
+// first request verifies the signature and parses the claims as usual.
+// The result goes into JwtClaimsCache. Later requests with the same token
+// cost one hash lookup and a shared_ptr copy.
+//
+// A cached entry is only valid while all of these hold:
+//   - now is before exp (plus leeway), when exp is verified;
+//   - the entry is younger than max_ttl;
+//   - the KeySet generation it was verified with is still current. When
+//     the JWKS content changes, every entry is verified again once;
+//   - it was stored by the same JwtVerifier. Verifiers differ in keys and
+//     options, so a cache shared between them never lets one verifier's
+//     checks stand in for another's.
+//
+// The cache key is the whole token, not a digest of it. A hash collision
+// can then only cost a failed comparison, never a wrong identity. Only
+// tokens that verified are inserted, so invalid tokens cannot fill the
+// cache or push good entries out.
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <nlohmann/json.hpp>
+#include <vix.hpp>
+
+#include "jwt_keys.hpp"
+
+namespace vix_examples::auth
+{
+  struct JwtVerifyOptions
+  {
+    bool verify_exp{true};
+    bool require_exp{false};
+    std::chrono::seconds leeway{30};
+    std::string issuer;   // checked when not empty
+    std::string audience; // checked when not empty
+    std::string roles_key{"roles"};
+    std::string perms_key{"perms"};
+  };
+
+  // Claims of a verified token. Shared by every request that carries it,
+  // so it is never modified after verification.
+  struct VerifiedClaims
+  {
+    std::string subject;
+    std::vector<std::string> roles;
+    std::vector<std::string> perms;
+    std::optional<std::int64_t> exp;
+    nlohmann::json payload;
+  };
+
+  // Request state set by cached_jwt().
+  struct JwtIdentity
+  {
+    std::shared_ptr<const VerifiedClaims> claims;
+    bool from_cache{false};
+
+    [[nodiscard]] const std::string &subject() const { return claims->subject; }
+    [[nodiscard]] const std::vector<std::string> &roles() const { return claims->roles; }
+    [[nodiscard]] const std::vector<std::string> &perms() const { return claims->perms; }
+  };
+
+  enum class JwtError
+  {
+    none,
+    missing_token,
+    malformed,
+    unsupported_alg,
+    unknown_key,
+    invalid_signature,
+    missing_exp,
+    expired,
+    not_yet_valid,
+    invalid_issuer,
+    invalid_audience,
+  };
+
+  inline const char *to_string(JwtError error) noexcept
+  {
+    switch (error)
+    {
+    case JwtError::none:
+      return "none";
+    case JwtError::missing_token:
+      return "missing_token";
+    case JwtError::malformed:
+      return "malformed_token";
+    case JwtError::unsupported_alg:
+      return "unsupported_alg";
+    case JwtError::unknown_key:
+      return "unknown_key";
+    case JwtError::invalid_signature:
+      return "invalid_signature";
+    case JwtError::missing_exp:
+      return "missing_exp";
+    case JwtError::expired:
+      return "token_expired";
+    case JwtError::not_yet_valid:
+      return "token_not_yet_valid";
+    case JwtError::invalid_issuer:
+      return "invalid_issuer";
+    case JwtError::invalid_audience:
+      return "invalid_audience";
+    }
+    return "invalid_token";
+  }
+
+  struct JwtResult
+  {
+    std::shared_ptr<const VerifiedClaims> claims;
+    JwtError error{JwtError::none};
+    bool from_cache{false};
+
+    explicit operator bool() const noexcept { return error == JwtError::none; }
+  };
+
+  // Bounded map from token to verified claims, split into shards that each
+  // take a shared lock on lookup. Eviction is FIFO. Tokens expire on their
+  // own, so recency tracking would cost a write lock per hit for little
+  // gain.
+  class JwtClaimsCache
+  {
+  public:
+    struct Stats
+    {
+      std::uint64_t hits{0};
+      std::uint64_t misses{0};
+      std::uint64_t inserts{0};
+      std::uint64_t evictions{0};
+    };
+
+    explicit JwtClaimsCache(std::size_t capacity = 10'000,
+                            std::chrono::seconds max_ttl = std::chrono::hours(1),
+                            std::size_t shards = 16)
+        : shards_(std::max<std::size_t>(shards, 1)),
+          per_shard_(std::max<std::size_t>(capacity / std::max<std::size_t>(shards, 1), 1)),
+          max_ttl_(max_ttl.count())
+    {
+    }
+
+    // `now` is seconds since the epoch. `verifier` identifies the JwtVerifier
+    // whose keys and options accepted the token.
+    [[nodiscard]] std::shared_ptr<const VerifiedClaims> find(std::string_view token, std::int64_t now,
+                                                             std::uint64_t verifier, std::uint64_t generation) const
+    {
+      const std::size_t hash = std::hash<std::string_view>{}(token);
+      const Shard &shard = shards_[hash % shards_.size()];
+      {
+        std::shared_lock<std::shared_mutex> lock(shard.mutex);
+        const auto it = shard.entries.find(token);
+        if (it != shard.entries.end() && now < it->second.expires_at && it->second.verifier == verifier &&
+            it->second.generation == generation)
+        {
+          hits_.fetch_add(1, std::memory_order_relaxed);
+          return it->second.claims;
+        }
+      }
+      misses_.fetch_add(1, std::memory_order_relaxed);
+      return nullptr;
+    }
+
+    // `valid_until` is when the token itself stops being valid (exp plus
+    // leeway), or nullopt when exp is not checked.
+    void insert(std::string_view token, std::shared_ptr<const VerifiedClaims> claims, std::int64_t now,
+                std::optional<std::int64_t> valid_until, std::uint64_t verifier, std::uint64_t generation)
+    {
+      const std::int64_t expires_at = std::min(now + max_ttl_, valid_until.value_or(now + max_ttl_));
+      if (expires_at <= now)
+      {
+        return;
+      }
+
+      const std::size_t hash = std::hash<std::string_view>{}(token);
+      Shard &shard = shards_[hash % shards_.size()];
+      std::unique_lock<std::shared_mutex> lock(shard.mutex);
+
+      if (const auto it = shard.entries.find(token); it != shard.entries.end())
+      {
+        it->second = Entry{std::move(claims), expires_at, verifier, generation};
+        return;
+      }
+
+      while (shard.entries.size() >= per_shard_ && !shard.order.empty())
+      {
+        shard.entries.erase(shard.entries.find(shard.order.front()));
+        shard.order.pop_front();
+        evictions_.fetch_add(1, std::memory_order_relaxed);
+      }
+
+      // Node keys do not move on rehash, so `order` can view them.
+      const auto it = shard.entries.emplace(std::string(token), Entry{std::move(claims), expires_at, verifier, generation}).first;
+      shard.order.push_back(it->first);
+      inserts_.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void clear()
+    {
+      for (Shard &shard : shards_)
+      {
+        std::unique_lock<std::shared_mutex> lock(shard.mutex);
+        shard.order.clear();
+        shard.entries.clear();
+      }
+    }
+
+    [[nodiscard]] std::size_t size() const
+    {
+      std::size_t total = 0;
+      for (const Shard &shard : shards_)
+      {
+        std::shared_lock<std::shared_mutex> lock(shard.mutex);
+        total += shard.entries.size();
+      }
+      return total;
+    }
+
+    [[nodiscard]] Stats stats() const noexcept
+    {
+      return Stats{hits_.load(std::memory_order_relaxed), misses_.load(std::memory_order_relaxed),
+                   inserts_.load(std::memory_order_relaxed), evictions_.load(std::memory_order_relaxed)};
+    }
+
+  private:
+    struct Entry
+    {
+      std::shared_ptr<const VerifiedClaims> claims;
+      std::int64_t expires_at{0};
+      std::uint64_t verifier{0};
+      std::uint64_t generation{0};
+    };
+
+    struct TokenHash
+    {
+      using is_transparent = void;
+      std::size_t operator()(std::string_view token) const noexcept { return std::hash<std::string_view>{}(token); }
+    };
+
+    struct Shard
+    {
+      mutable std::shared_mutex mutex;
+      std::unordered_map<std::string, Entry, TokenHash, std::equal_to<>> entries;
+      std::deque<std::string_view> order;
+    };
+
+    std::vector<Shard> shards_;
+    std::size_t per_shard_;
+    std::int64_t max_ttl_;
+
+    mutable std::atomic<std::uint64_t> hits_{0};
+    mutable std::atomic<std::uint64_t> misses_{0};
+    std::atomic<std::uint64_t> inserts_{0};
+    std::atomic<std::uint64_t> evictions_{0};
+  };
+
+  namespace detail
+  {
+    // Dates far outside any real clock are clamped, so a huge exp still
+    // means "never expires" and adding leeway or max_ttl cannot overflow.
+    inline std::optional<std::int64_t> numeric_date(const nlohmann::json &payload, const char *name)
+    {
+      constexpr std::int64_t limit = std::int64_t{1} << 62;
+      const auto it = payload.find(name);
+      if (it == payload.end() || !it->is_number())
+      {
+        return std::nullopt;
+      }
+      if (it->is_number_unsigned())
+      {
+        return static_cast<std::int64_t>(std::min<std::uint64_t>(it->get<std::uint64_t>(), limit));
+      }
+      if (it->is_number_integer())
+      {
+        return std::clamp<std::int64_t>(it->get<std::int64_t>(), -limit, limit);
+      }
+      const double value = it->get<double>();
+      if (std::isnan(value))
+      {
+        return std::nullopt;
+      }
+      return static_cast<std::int64_t>(
+          std::clamp(value, -static_cast<double>(limit), static_cast<double>(limit)));
+    }
+
+    // A claim that may be one string or an array of strings.
+    inline std::vector<std::string> string_list(const nlohmann::json &payload, const std::string &name)
+    {
+      std::vector<std::string> out;
+      const auto it = payload.find(name);
+      if (it == payload.end())
+      {
+        return out;
+      }
+      if (it->is_string())
+      {
+        out.push_back(it->get<std::string>());
+      }
+      else if (it->is_array())
+      {
+        for (const auto &item : *it)
+        {
+          if (item.is_string())
+          {
+            out.push_back(item.get<std::string>());
+          }
+        }
+      }
+      return out;
+    }
+
+    inline std::int64_t unix_now() noexcept
+    {
+      return std::chrono::duration_cast<std::chrono::seconds>(
+                 std::chrono::system_clock::now().time_since_epoch())
+          .count();
+    }
+  } // namespace detail
+
+  // Verifies compact JWS tokens against a JwksSource, through the cache.
+  class JwtVerifier
+  {
+  public:
+    explicit JwtVerifier(std::shared_ptr<JwksSource> keys,
+                         JwtVerifyOptions options = {},
+                         std::shared_ptr<JwtClaimsCache> cache = std::make_shared<JwtClaimsCache>())
+        : keys_(std::move(keys)), options_(std::move(options)), cache_(std::move(cache)),
+          id_(next_id().fetch_add(1, std::memory_order_relaxed))
+    {
+    }
+
+    [[nodiscard]] JwtResult verify(std::string_view token) const
+    {
+      return verify(token, detail::unix_now());
+    }
+
+    [[nodiscard]] JwtResult verify(std::string_view token, std::int64_t now) const
+    {
+      const auto keys = keys_->current(); // stays valid across a refresh
+      if (cache_)
+      {
+        if (auto claims = cache_->find(token, now, id_, keys->generation()))
+        {
+          return JwtResult{std::move(claims), JwtError::none, true};
+        }
+      }
+
+      std::optional<std::int64_t> valid_until;
+      JwtResult result = verify_uncached(token, now, *keys, valid_until);
+      if (result && cache_)
+      {
+        cache_->insert(token, result.claims, now, valid_until, id_, keys->generation());
+      }
+      return result;
+    }
+
+    [[nodiscard]] const std::shared_ptr<JwtClaimsCache> &cache() const noexcept { return cache_; }
+    [[nodiscard]] const std::shared_ptr<JwksSource> &keys() const noexcept { return keys_; }
+
+  private:
+    // Never reused within a process, unlike KeySet generations, which
+    // restart for every JwksSource. Copies share it along with the same
+    // keys and options.
+    static std::atomic<std::uint64_t> &next_id() noexcept
+    {
+      static std::atomic<std::uint64_t> id{1};
+      return id;
+    }
+
+    JwtResult verify_uncached(std::string_view token, std::int64_t now, const KeySet &keys,
+                              std::optional<std::int64_t> &valid_until) const
+    {
+      const auto fail = [](JwtError error)
+      { return JwtResult{nullptr, error, false}; };
+
+      const auto first = token.find('.');
+      const auto second = first == std::string_view::npos ? first : token.find('.', first + 1);
+      if (second == std::string_view::npos || token.find('.', second + 1) != std::string_view::npos)
+      {
+        return fail(JwtError::malformed);
+      }
+
+      const auto headerText = base64url_decode(token.substr(0, first));
+      const auto signature = base64url_decode(token.substr(second + 1));
+      if (!headerText || !signature)
+      {
+        return fail(JwtError::malformed);
+      }
+
+      const auto header = nlohmann::json::parse(*headerText, nullptr, false);
+      if (header.is_discarded() || !header.is_object() || !header.contains("alg") || !header["alg"].is_string())
+      {
+        return fail(JwtError::malformed);
+      }
+
+      // No header extension is understood, so none can be required.
+      const JwtAlg alg = parse_alg(header["alg"].get<std::string>());
+      if (alg == JwtAlg::unsupported || header.contains("crit"))
+      {
+        return fail(JwtError::unsupported_alg);
+      }
+
+      const auto kidIt = header.find("kid");
+      const std::string kid = kidIt != header.end() && kidIt->is_string() ? kidIt->get<std::string>() : std::string{};
+      const JwtKey *key = keys.find(kid, alg);
+      if (key == nullptr)
+      {
+        keys_->request_refresh();
+        return fail(JwtError::unknown_key);
+      }
+
+      if (!key->verify(alg, token.substr(0, second), *signature))
+      {
+        return fail(JwtError::invalid_signature);
+      }
+
+      // The payload is only parsed once the signature holds.
+      const auto payloadText = base64url_decode(token.substr(first + 1, second - first - 1));
+      if (!payloadText)
+      {
+        return fail(JwtError::malformed);
+      }
+      auto payload = nlohmann::json::parse(*payloadText, nullptr, false);
+      if (payload.is_discarded() || !payload.is_object())
+      {
+        return fail(JwtError::malformed);
+      }
+
+      const std::int64_t leeway = options_.leeway.count();
+      const auto exp = detail::numeric_date(payload, "exp");
+      if (options_.verify_exp)
+      {
+        if (!exp && options_.require_exp)
+        {
+          return fail(JwtError::missing_exp);
+        }
+        if (exp && now >= *exp + leeway)
+        {
+          return fail(JwtError::expired);
+        }
+        valid_until = exp ? std::optional<std::int64_t>(*exp + leeway) : std::nullopt;
+      }
+
+      if (const auto nbf = detail::numeric_date(payload, "nbf"); nbf && now + leeway < *nbf)
+      {
+        return fail(JwtError::not_yet_valid);
+      }
+
+      if (!options_.issuer.empty() && payload.value("iss", std::string{}) != options_.issuer)
+      {
+        return fail(JwtError::invalid_issuer);
+      }
+
+      if (!options_.audience.empty())
+      {
+        const auto audiences = detail::string_list(payload, "aud");
+        if (std::find(audiences.begin(), audiences.end(), options_.audience) == audiences.end())
+        {
+          return fail(JwtError::invalid_audience);
+        }
+      }
+
+      auto claims = std::make_shared<VerifiedClaims>();
+      claims->subject = payload.value("sub", std::string{});
+      claims->roles = detail::string_list(payload, options_.roles_key);
+      claims->perms = detail::string_list(payload, options_.perms_key);
+      claims->exp = exp;
+      claims->payload = std::move(payload);
+      return JwtResult{std::move(claims), JwtError::none, false};
+    }
+
+    std::shared_ptr<JwksSource> keys_;
+    JwtVerifyOptions options_;
+    std::shared_ptr<JwtClaimsCache> cache_;
+    std::uint64_t id_;
+  };
+
+  // Middleware for app.use(prefix, ...): reads "Authorization: Bearer
+  // <token>", verifies it and stores JwtIdentity. Answers 401 with the
+  // JwtError code otherwise.
+  inline std::function<void(vix::Request &, vix::Response &, vix::App::Next)>
+  cached_jwt(std::shared_ptr<const JwtVerifier> verifier)
+  {
+    return [verifier = std::move(verifier)](vix::Request &req, vix::Response &res, vix::App::Next next)
+    {
+      const std::string header = req.header("authorization");
+      const bool bearer = header.size() > 7 &&
+                          std::equal(header.begin(), header.begin() + 7, "bearer ", [](char a, char b)
+                                     { return static_cast<char>(std::tolower(static_cast<unsigned char>(a))) == b; });
+
+      const JwtResult result = bearer ? verifier->verify(std::string_view(header).substr(7))
+                                      : JwtResult{nullptr, JwtError::missing_token, false};
+      if (!result)
+      {
+        res.res.set_header("WWW-Authenticate", result.error == JwtError::missing_token
+                                                   ? "Bearer"
+                                                   : "Bearer error=\"invalid_token\"");
+        res.status(401).json({"ok", false, "error", to_string(result.error)});
+        return;
+      }
+
+      req.state().set(JwtIdentity{result.claims, result.from_cache});
+      next();
+    };
+  }
+
+  // HS256/384/512 with one shared secret, verified through a default cache.
+  inline std::function<void(vix::Request &, vix::Response &, vix::App::Next)>
+  cached_jwt(std::string_view secret, JwtVerifyOptions options = {})
+  {
+    auto keys = std::make_shared<JwksSource>(
+        std::make_shared<const KeySet>(std::vector<std::shared_ptr<const JwtKey>>{JwtKey::hmac(secret)}));
+    return cached_jwt(std::make_shared<const JwtVerifier>(std::move(keys), std::move(options)));
+  }
+} // namespace vix_examples::auth
+
+#endif // VIX_EXAMPLES_AUTH_JWT_VERIFY_CACHE_HPP
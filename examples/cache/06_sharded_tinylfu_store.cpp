@@ -0,0 +1,324 @@
+/**
+ *
+ *  @file 06_sharded_tinylfu_store.cpp
+ *  @author Gaspard Kirira
+ *
+ *  Copyright 2025, Gaspard Kirira.
+ *  All rights reserved.
+ *  https://github.com/vixcpp/vix
+ *
+ *  Use of this source code is governed by a MIT license
+ *  that can be found in the License file.
+ *
+ *  Vix.cpp
+ *
+ */
+// Run:
+//   vix run examples/cache/06_sharded_tinylfu_store.cpp
+//
+// Benchmark knobs (environment):
+//   VIX_CACHE_BENCH_OPS          total operations per run (default 400000)
+//   VIX_CACHE_BENCH_MAX_THREADS  highest thread count (default 64)
+//   VIX_CACHE_BENCH_MAX_BODY     largest body in bytes (default 2 MiB)
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <vix/cache/Cache.hpp>
+#include <vix/cache/CacheContext.hpp>
+#include <vix/cache/CacheEntry.hpp>
+#include <vix/cache/CachePolicy.hpp>
+#include <vix/cache/LruMemoryStore.hpp>
+
+#include "sharded_tinylfu_store.hpp"
+
+using vix_examples::cache::ShardedTinyLfuStore;
+
+static std::int64_t now_ms()
+{
+  using namespace std::chrono;
+  return duration_cast<milliseconds>(
+             steady_clock::now().time_since_epoch())
+      .count();
+}
+
+static std::size_t env_size(const char *name, std::size_t fallback)
+{
+  const char *value = std::getenv(name);
+  if (value == nullptr || *value == '\0')
+  {
+    return fallback;
+  }
+  return static_cast<std::size_t>(std::strtoull(value, nullptr, 10));
+}
+
+static vix::cache::CacheEntry make_entry(std::size_t bodySize, std::int64_t t)
+{
+  vix::cache::CacheEntry e;
+  e.status = 200;
+  e.body.assign(bodySize, 'x');
+  e.headers["Content-Type"] = "application/octet-stream";
+  e.created_at_ms = t;
+  return e;
+}
+
+// Hot keys are read a few times, then a one-off scan twice the cache size
+// goes through. LRU forgets the hot set; TinyLFU keeps it.
+static void scan_resistance()
+{
+  constexpr int hot = 50;
+  constexpr int scan = 200;
+
+  auto lru = std::make_shared<vix::cache::LruMemoryStore>(
+      vix::cache::LruMemoryStore::Config{.max_entries = 100});
+  auto tiny = std::make_shared<ShardedTinyLfuStore>(
+      ShardedTinyLfuStore::Config{.max_entries = 100, .max_bytes = 0, .shards = 1});
+
+  const auto t0 = now_ms();
+
+  for (vix::cache::CacheStore *store : {static_cast<vix::cache::CacheStore *>(lru.get()),
+                                        static_cast<vix::cache::CacheStore *>(tiny.get())})
+  {
+    for (int round = 0; round < 4; ++round)
+    {
+      for (int i = 0; i < hot; ++i)
+      {
+        const std::string key = "hot:" + std::to_string(i);
+        if (!store->get(key))
+        {
+          store->put(key, make_entry(256, t0));
+        }
+      }
+    }
+
+    for (int i = 0; i < scan; ++i)
+    {
+      store->put("scan:" + std::to_string(i), make_entry(256, t0));
+    }
+  }
+
+  auto survivors = [&](vix::cache::CacheStore &store)
+  {
+    int n = 0;
+    for (int i = 0; i < hot; ++i)
+    {
+      n += store.get("hot:" + std::to_string(i)) ? 1 : 0;
+    }
+    return n;
+  };
+
+  std::cout << "hot keys kept after a " << scan << "-key scan: "
+            << "LruMemoryStore=" << survivors(*lru) << "/" << hot << ", "
+            << "ShardedTinyLfuStore=" << survivors(*tiny) << "/" << hot << "\n";
+}
+
+// The byte limit holds even when bodies vary from 100 B to 2 MiB.
+static void byte_budget()
+{
+  ShardedTinyLfuStore store(ShardedTinyLfuStore::Config{
+      .max_entries = 10'000,
+      .max_bytes = 8u << 20,
+      .shards = 4});
+
+  const auto t0 = now_ms();
+  for (int i = 0; i < 64; ++i)
+  {
+    store.put("blob:" + std::to_string(i), make_entry(std::size_t{100} << (i % 15), t0));
+  }
+
+  const auto s = store.stats();
+  std::cout << "byte budget: entries=" << s.entries << " bytes=" << s.bytes
+            << " (limit " << (8u << 20) << ") oversized=" << s.oversized << "\n";
+}
+
+struct BenchResult
+{
+  double mops{0};
+  double hit_rate{0};
+};
+
+// Zipf(0.99) reads over 20k keys mixed with 20% one-off scan keys; a miss
+// fills the entry, as the HTTP cache middleware would after the handler.
+class Workload
+{
+public:
+  Workload(std::size_t keys, std::size_t maxBody)
+      : cdf_(keys),
+        sizes_(keys)
+  {
+    double sum = 0;
+    for (std::size_t i = 0; i < keys; ++i)
+    {
+      sum += 1.0 / std::pow(static_cast<double>(i + 1), 0.99);
+      cdf_[i] = sum;
+    }
+    for (auto &c : cdf_)
+    {
+      c /= sum;
+    }
+
+    // Mostly small bodies with a long tail up to maxBody.
+    std::mt19937_64 rng(42);
+    std::uniform_real_distribution<double> u(0.0, 1.0);
+    const double span = static_cast<double>(std::max<std::size_t>(maxBody, 100)) / 100.0;
+    for (auto &size : sizes_)
+    {
+      const double x = u(rng);
+      size = static_cast<std::size_t>(100.0 * std::pow(span, x * x * x));
+    }
+  }
+
+  std::size_t pick(std::mt19937_64 &rng) const
+  {
+    std::uniform_real_distribution<double> u(0.0, 1.0);
+    const auto it = std::lower_bound(cdf_.begin(), cdf_.end(), u(rng));
+    return std::min<std::size_t>(static_cast<std::size_t>(it - cdf_.begin()), cdf_.size() - 1);
+  }
+
+  std::size_t size_of(std::size_t key) const { return sizes_[key]; }
+
+private:
+  std::vector<double> cdf_;
+  std::vector<std::size_t> sizes_;
+};
+
+static BenchResult run_bench(vix::cache::CacheStore &store,
+                             const Workload &workload,
+                             std::size_t threads,
+                             std::size_t totalOps)
+{
+  const std::size_t perThread = std::max<std::size_t>(1, totalOps / threads);
+  std::vector<std::uint64_t> hits(threads * 8, 0);
+  std::vector<std::thread> pool;
+  const auto t0 = now_ms();
+
+  const auto start = std::chrono::steady_clock::now();
+
+  for (std::size_t t = 0; t < threads; ++t)
+  {
+    pool.emplace_back([&, t]()
+                      {
+                        std::mt19937_64 rng(1000 + t);
+                        std::uniform_int_distribution<int> percent(0, 99);
+                        std::uint64_t local = 0;
+
+                        for (std::size_t i = 0; i < perThread; ++i)
+                        {
+                          if (percent(rng) < 20)
+                          {
+                            const std::string key = "scan:" + std::to_string(t) + ":" + std::to_string(i);
+                            if (!store.get(key))
+                            {
+                              store.put(key, make_entry(256, t0));
+                            }
+                            continue;
+                          }
+
+                          const std::size_t k = workload.pick(rng);
+                          const std::string key = "/api/items/" + std::to_string(k);
+                          if (store.get(key))
+                          {
+                            ++local;
+                          }
+                          else
+                          {
+                            store.put(key, make_entry(workload.size_of(k), t0));
+                          }
+                        }
+
+                        // Padded slots avoid false sharing between threads.
+                        hits[t * 8] = local; });
+  }
+
+  for (auto &th : pool)
+  {
+    th.join();
+  }
+
+  const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+  std::uint64_t totalHits = 0;
+  for (std::size_t t = 0; t < threads; ++t)
+  {
+    totalHits += hits[t * 8];
+  }
+
+  const double zipfOps = static_cast<double>(perThread * threads) * 0.8;
+  return BenchResult{
+      static_cast<double>(perThread * threads) / seconds / 1e6,
+      static_cast<double>(totalHits) / zipfOps};
+}
+
+static void contention_bench()
+{
+  const std::size_t totalOps = env_size("VIX_CACHE_BENCH_OPS", 400'000);
+  const std::size_t maxThreads = env_size("VIX_CACHE_BENCH_MAX_THREADS", 64);
+  const std::size_t maxBody = env_size("VIX_CACHE_BENCH_MAX_BODY", 2u << 20);
+  const std::size_t capacity = 2'000;
+
+  const Workload workload(20'000, maxBody);
+
+  std::cout << "\ncontention benchmark: " << totalOps << " ops, 2000 entries / 64 MiB, "
+            << "Zipf(0.99) over 20000 keys + 20% scan, bodies 100 B.." << maxBody << " B\n";
+  std::cout << std::left << std::setw(9) << "threads"
+            << std::setw(26) << "LruMemoryStore Mops/s"
+            << std::setw(10) << "hit%"
+            << std::setw(30) << "ShardedTinyLfuStore Mops/s"
+            << "hit%\n";
+
+  for (std::size_t threads = 1; threads <= maxThreads; threads *= 2)
+  {
+    vix::cache::LruMemoryStore lru(vix::cache::LruMemoryStore::Config{.max_entries = capacity});
+    ShardedTinyLfuStore tiny(ShardedTinyLfuStore::Config{
+        .max_entries = capacity,
+        .max_bytes = 64u << 20});
+
+    const BenchResult a = run_bench(lru, workload, threads, totalOps);
+    const BenchResult b = run_bench(tiny, workload, threads, totalOps);
+
+    std::cout << std::left << std::setw(9) << threads
+              << std::setw(26) << std::fixed << std::setprecision(2) << a.mops
+              << std::setw(10) << std::setprecision(1) << a.hit_rate * 100
+              << std::setw(30) << std::setprecision(2) << b.mops
+              << std::setprecision(1) << b.hit_rate * 100 << "\n";
+  }
+
+  std::cout << "(LruMemoryStore has no byte limit here; it may hold far more than 64 MiB.)\n";
+}
+
+int main()
+{
+  using namespace vix::cache;
+
+  // Drop-in store for Cache: same policy, same calls.
+  auto store = std::make_shared<ShardedTinyLfuStore>(
+      ShardedTinyLfuStore::Config{.max_entries = 10'000, .max_bytes = 64u << 20});
+
+  CachePolicy policy;
+  policy.ttl_ms = 10'000;
+
+  Cache cache(policy, store);
+
+  const auto t0 = now_ms();
+  cache.put("GET:/api/users", make_entry(512, t0));
+
+  auto hit = cache.get("GET:/api/users", t0 + 1, CacheContext::Online());
+  std::cout << "cache hit: " << (hit ? "yes" : "no")
+            << " (" << store->shard_count() << " shards)\n";
+
+  scan_resistance();
+  byte_budget();
+  contention_bench();
+
+  return 0;
+}
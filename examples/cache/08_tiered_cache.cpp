@@ -0,0 +1,155 @@
+/**
+ *
+ *  @file 08_tiered_cache.cpp
+ *  @author Gaspard Kirira
+ *
+ *  Copyright 2025, Gaspard Kirira.
+ *  All rights reserved.
+ *  https://github.com/vixcpp/vix
+ *
+ *  Use of this source code is governed by a MIT license
+ *  that can be found in the License file.
+ *
+ *  Vix.cpp
+ *
+ */
+// Run:
+//   vix run examples/cache/08_tiered_cache.cpp
+
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+
+#include <vix/cache/Cache.hpp>
+#include <vix/cache/CacheContext.hpp>
+#include <vix/cache/CacheEntry.hpp>
+#include <vix/cache/CachePolicy.hpp>
+
+#include "segmented_disk_store.hpp"
+#include "sharded_tinylfu_store.hpp"
+#include "tiered_store.hpp"
+
+using vix_examples::cache::SegmentedDiskStore;
+using vix_examples::cache::ShardedTinyLfuStore;
+using vix_examples::cache::TieredStore;
+
+static std::int64_t now_ms()
+{
+  using namespace std::chrono;
+  return duration_cast<milliseconds>(
+             steady_clock::now().time_since_epoch())
+      .count();
+}
+
+static vix::cache::CacheEntry make_entry(const std::string &body, std::int64_t t)
+{
+  vix::cache::CacheEntry e;
+  e.status = 200;
+  e.headers["Content-Type"] = "application/json";
+  e.body = body;
+  e.created_at_ms = t;
+  return e;
+}
+
+static void print_stats(const char *label, const TieredStore &store)
+{
+  const auto s = store.stats();
+  std::cout << label << ": L1 hits=" << s.l1_hits << " L2 hits=" << s.l2_hits
+            << " misses=" << s.misses << " promotions=" << s.promotions
+            << std::fixed << std::setprecision(1)
+            << " | L1 ratio=" << s.l1_hit_ratio() * 100 << "%"
+            << " L2 ratio=" << s.l2_hit_ratio() * 100 << "%"
+            << " pending=" << s.pending << "\n";
+}
+
+int main()
+{
+  using namespace vix::cache;
+
+  const std::filesystem::path dir = "./vix_tiered_cache";
+  std::filesystem::remove_all(dir);
+
+  // L1: 500 entries / 4 MiB in memory. L2: up to 64 MiB on disk.
+  auto l1 = std::make_shared<ShardedTinyLfuStore>(
+      ShardedTinyLfuStore::Config{.max_entries = 500, .max_bytes = 4u << 20});
+
+  SegmentedDiskStore::Config diskConfig;
+  diskConfig.directory = dir;
+  diskConfig.segment_bytes = 4u << 20;
+  diskConfig.max_bytes = 64u << 20;
+  auto l2 = std::make_shared<SegmentedDiskStore>(diskConfig);
+
+  // L1 keeps entries for 5 s, L2 for 10 min (covers stale_if_offline_ms).
+  auto tiered = std::make_shared<TieredStore>(l1, l2, TieredStore::Config{
+                                                          .l1_ttl_ms = 5'000,
+                                                          .l2_ttl_ms = 600'000,
+                                                          .write_mode = TieredStore::WriteMode::write_back});
+
+  CachePolicy policy;
+  policy.ttl_ms = 5'000;
+  policy.allow_stale_if_offline = true;
+  policy.stale_if_offline_ms = 600'000;
+
+  Cache cache(policy, tiered);
+
+  const auto t0 = now_ms();
+
+  // 1) 5000 responses: every one reaches L2, only the hot ones stay in L1.
+  for (int i = 0; i < 5'000; ++i)
+  {
+    cache.put("GET /api/items/" + std::to_string(i),
+              make_entry(R"({"id":)" + std::to_string(i) + "}", t0));
+  }
+  tiered->flush();
+
+  // 2) Skewed reads: a hot head of 200 keys and a long tail.
+  std::mt19937 rng(7);
+  std::uniform_int_distribution<int> hot(0, 199);
+  std::uniform_int_distribution<int> tail(0, 4'999);
+  std::uniform_int_distribution<int> coin(0, 9);
+
+  for (int i = 0; i < 20'000; ++i)
+  {
+    const int id = coin(rng) < 8 ? hot(rng) : tail(rng);
+    (void)cache.get("GET /api/items/" + std::to_string(id), t0 + 1, CacheContext::Online());
+  }
+  print_stats("after skewed reads", *tiered);
+
+  // 3) An old entry lives only in L2 (past L1's 5 s), yet Offline still
+  //    finds it through Cache's normal stale rules.
+  cache.put("GET /api/profile", make_entry(R"({"name":"ada"})", t0 - 60'000));
+  tiered->flush();
+
+  const auto online = cache.get("GET /api/profile", t0, CacheContext::Online());
+  const auto offline = cache.get("GET /api/profile", t0, CacheContext::Offline());
+  std::cout << "old profile: online=" << (online ? "hit" : "miss")
+            << " offline=" << (offline ? "hit (from L2)" : "miss") << "\n";
+
+  // 4) L2 survives a restart; L1 starts cold and refills by promotion.
+  cache.erase("GET /api/items/3");
+  tiered->flush();
+  tiered.reset();
+
+  {
+    auto l1Cold = std::make_shared<ShardedTinyLfuStore>(
+        ShardedTinyLfuStore::Config{.max_entries = 500, .max_bytes = 4u << 20});
+    auto l2Again = std::make_shared<SegmentedDiskStore>(diskConfig);
+    auto store = std::make_shared<TieredStore>(l1Cold, l2Again, TieredStore::Config{.l1_ttl_ms = 5'000, .l2_ttl_ms = 600'000});
+    Cache restarted(policy, store);
+
+    const auto a = restarted.get("GET /api/items/42", t0 + 2, CacheContext::Online());
+    const auto b = restarted.get("GET /api/items/42", t0 + 3, CacheContext::Online());
+    const auto c = restarted.get("GET /api/items/3", t0 + 3, CacheContext::Online());
+    std::cout << "after restart: item 42 " << (a && b ? "hit" : "miss")
+              << ", item 3 (erased) " << (c ? "hit" : "miss") << "\n";
+    print_stats("after restart", *store);
+  }
+
+  std::filesystem::remove_all(dir);
+  return 0;
+}
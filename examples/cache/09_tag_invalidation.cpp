@@ -0,0 +1,129 @@
+/**
+ *
+ *  @file 09_tag_invalidation.cpp
+ *  @author Gaspard Kirira
+ *
+ *  Copyright 2025, Gaspard Kirira.
+ *  All rights reserved.
+ *  https://github.com/vixcpp/vix
+ *
+ *  Use of this source code is governed by a MIT license
+ *  that can be found in the License file.
+ *
+ *  Vix.cpp
+ *
+ */
+// Run:
+//   vix run examples/cache/09_tag_invalidation.cpp
+
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <string>
+
+#include <vix/cache/Cache.hpp>
+#include <vix/cache/CacheContext.hpp>
+#include <vix/cache/CacheEntry.hpp>
+#include <vix/cache/CachePolicy.hpp>
+#include <vix/cache/LruMemoryStore.hpp>
+
+#include "tag_index_store.hpp"
+
+using vix_examples::cache::kCacheTagsHeader;
+using vix_examples::cache::TaggedStore;
+
+static std::int64_t now_ms()
+{
+  using namespace std::chrono;
+  return duration_cast<milliseconds>(
+             steady_clock::now().time_since_epoch())
+      .count();
+}
+
+static vix::cache::CacheEntry make_entry(const std::string &body, std::int64_t t, const std::string &tags = {})
+{
+  vix::cache::CacheEntry e;
+  e.status = 200;
+  e.headers["Content-Type"] = "application/json";
+  if (!tags.empty())
+  {
+    e.headers[std::string(kCacheTagsHeader)] = tags;
+  }
+  e.body = body;
+  e.created_at_ms = t;
+  return e;
+}
+
+// Same shape as the HTTP cache keys: method, path, query.
+static std::string products_key(const std::string &query)
+{
+  return "GET /api/products?" + query;
+}
+
+static int count_hits(vix::cache::Cache &cache, std::int64_t t, int pages)
+{
+  int hits = 0;
+  for (int page = 1; page <= pages; ++page)
+  {
+    if (cache.get(products_key("page=" + std::to_string(page)), t, vix::cache::CacheContext::Online()))
+    {
+      ++hits;
+    }
+  }
+  return hits;
+}
+
+int main()
+{
+  using namespace vix::cache;
+
+  auto inner = std::make_shared<LruMemoryStore>(LruMemoryStore::Config{.max_entries = 10'000});
+  auto store = std::make_shared<TaggedStore>(inner);
+
+  CachePolicy policy;
+  policy.ttl_ms = 60'000;
+  Cache cache(policy, store);
+
+  const auto t0 = now_ms();
+
+  // 1) 50 query variants of the product list, all tagged "products".
+  //    Tags travel in the entry, so Cache::put indexes them.
+  for (int page = 1; page <= 50; ++page)
+  {
+    cache.put(products_key("page=" + std::to_string(page)),
+              make_entry(R"({"page":)" + std::to_string(page) + "}", t0, "products"));
+  }
+
+  // 2) Per-user responses, tagged with the user they belong to.
+  for (int id = 1; id <= 100; ++id)
+  {
+    const std::string user = "user:" + std::to_string(id);
+    store->put("GET /api/users/" + std::to_string(id), make_entry(R"({"id":)" + std::to_string(id) + "}", t0), {user});
+    store->put("GET /api/users/" + std::to_string(id) + "/orders", make_entry("[]", t0), {user, "orders"});
+  }
+
+  std::cout << "indexed keys=" << store->stats().keys << " tags=" << store->stats().tags << "\n";
+
+  // 3) PATCH /api/users/42: drop both responses for that user, nothing else.
+  const auto userDropped = store->invalidate_tag("user:42");
+  std::cout << "invalidate_tag(user:42) removed " << userDropped << ", user 41 still "
+            << (cache.get("GET /api/users/41", t0 + 1, CacheContext::Online()) ? "hit" : "miss") << "\n";
+
+  // 4) A new product: every page of the list, whatever its query.
+  std::cout << "product pages cached before: " << count_hits(cache, t0 + 1, 50) << "\n";
+  const auto productDropped = store->invalidate_prefix("GET /api/products");
+  std::cout << "invalidate_prefix(GET /api/products) removed " << productDropped
+            << ", pages cached after: " << count_hits(cache, t0 + 1, 50) << "\n";
+
+  // 5) A read that started before a write must not cache what it read.
+  const auto generation = store->generation();
+  (void)store->invalidate_tag("orders"); // the write lands while the read is in flight
+  const bool stored = store->put_if_unchanged("GET /api/users/7/orders", make_entry("[\"stale\"]", t0, "user:7,orders"), generation);
+  std::cout << "slow fill after invalidation " << (stored ? "stored" : "dropped") << "\n";
+
+  const auto s = store->stats();
+  std::cout << "stats: keys=" << s.keys << " tags=" << s.tags
+            << " invalidated=" << s.invalidated << " dropped_fills=" << s.dropped_fills << "\n";
+  return 0;
+}
@@ -0,0 +1,897 @@
+/**
+ *
+ *  @file segmented_disk_store.hpp
+ *  @author Gaspard Kirira
+ *
+ *  Copyright 2025, Gaspard Kirira.
+ *  All rights reserved.
+ *  https://github.com/vixcpp/vix
+ *
+ *  Use of this source code is governed by a MIT license
+ *  that can be found in the License file.
+ *
+ *  Vix.cpp
+ *
+ */
+#ifndef VIX_EXAMPLES_CACHE_SEGMENTED_DISK_STORE_HPP
+#define VIX_EXAMPLES_CACHE_SEGMENTED_DISK_STORE_HPP
+
+// Append-only binary CacheStore for vix::cache::Cache (POSIX).
+//
+// FileStore rewrites one JSON document on every put. This store instead
+// appends each put or erase as a record to the current segment file
+// (seg-00000001.vxc, ...) and keeps an in-memory index from key to the
+// record's location:
+//
+//   [magic][header crc][type][key len][headers len][status][body len]
+//   [created_at_ms][body crc][key][headers][body]
+//
+// - Startup scans only record headers, so untouched body pages are never
+//   read; a torn record at the tail of the last segment is truncated.
+// - Segments are mmap'ed read-only; get() copies headers and body straight
+//   from the mapping, verifying the body crc.
+// - Overwritten and erased records become garbage. Once a sealed segment
+//   is mostly garbage, a background thread copies its live records
+//   forward and deletes the file. It copies in small batches, so put()
+//   never waits for a whole segment.
+// - With max_bytes set, the oldest segments are dropped whole once the
+//   store grows past it.
+//
+// One writer at a time; readers share a lock and never block each other.
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <vix/cache/CacheEntry.hpp>
+#include <vix/cache/CacheStore.hpp>
+
+namespace vix_examples::cache
+{
+  namespace detail
+  {
+    // CRC-32 (IEEE), table driven.
+    inline std::uint32_t crc32(const void *data, std::size_t size, std::uint32_t crc = 0) noexcept
+    {
+      static const auto table = []
+      {
+        std::array<std::uint32_t, 256> t{};
+        for (std::uint32_t i = 0; i < 256; ++i)
+        {
+          std::uint32_t c = i;
+          for (int k = 0; k < 8; ++k)
+          {
+            c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+          }
+          t[i] = c;
+        }
+        return t;
+      }();
+
+      const auto *p = static_cast<const unsigned char *>(data);
+      crc = ~crc;
+      for (std::size_t i = 0; i < size; ++i)
+      {
+        crc = table[(crc ^ p[i]) & 0xFF] ^ (crc >> 8);
+      }
+      return ~crc;
+    }
+
+    template <typename T>
+    void put_raw(std::string &out, T value)
+    {
+      char bytes[sizeof(T)];
+      std::memcpy(bytes, &value, sizeof(T));
+      out.append(bytes, sizeof(T));
+    }
+
+    template <typename T>
+    T get_raw(const char *p) noexcept
+    {
+      T value;
+      std::memcpy(&value, p, sizeof(T));
+      return value;
+    }
+  } // namespace detail
+
+  class SegmentedDiskStore final : public vix::cache::CacheStore
+  {
+  public:
+    struct Config
+    {
+      std::filesystem::path directory{"./vix_cache"};
+      std::size_t segment_bytes{64u << 20};
+      double compact_garbage_ratio{0.5}; // compact a sealed segment past this
+      std::chrono::milliseconds compact_interval{std::chrono::seconds(30)}; // background pass; 0 = compact() only
+      std::uint64_t max_bytes{0};        // 0 = unbounded; oldest segments are dropped past it
+      bool sync_writes{false};           // fdatasync after every record
+      bool verify_reads{true};           // check the body crc on get()
+    };
+
+    struct Stats
+    {
+      std::size_t entries{0};
+      std::size_t segments{0};
+      std::uint64_t disk_bytes{0};
+      std::uint64_t live_bytes{0};
+      std::uint64_t compactions{0};
+      std::uint64_t corrupt_records{0};
+      std::uint64_t truncated_bytes{0};
+      std::uint64_t evicted_entries{0};
+      double open_ms{0};
+    };
+
+    SegmentedDiskStore()
+        : SegmentedDiskStore(Config{})
+    {
+    }
+
+    explicit SegmentedDiskStore(Config config)
+        : config_(std::move(config))
+    {
+      const auto start = std::chrono::steady_clock::now();
+
+      std::filesystem::create_directories(config_.directory);
+      load();
+
+      stats_.open_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+      if (config_.compact_interval.count() > 0 && config_.compact_garbage_ratio > 0 &&
+          config_.compact_garbage_ratio < 1)
+      {
+        worker_ = std::thread([this]
+                              { run_compactor(); });
+
+        // Segments already past the ratio when opened.
+        if (std::exchange(compactDue_, false))
+        {
+          wake_compactor();
+        }
+      }
+    }
+
+    SegmentedDiskStore(const SegmentedDiskStore &) = delete;
+    SegmentedDiskStore &operator=(const SegmentedDiskStore &) = delete;
+
+    void put(const std::string &key, const vix::cache::CacheEntry &entry) override
+    {
+      // Encode outside the lock; only the append and index update are serialized.
+      std::string record = encode(RecordType::put, key, &entry);
+
+      bool due = false;
+      {
+        std::unique_lock<std::shared_mutex> lock(mutex_);
+        const Location loc = append(record);
+        Location rec = loc;
+        rec.status = entry.status;
+        rec.created_at_ms = entry.created_at_ms;
+
+        auto [it, inserted] = index_.try_emplace(key, rec);
+        if (!inserted)
+        {
+          retire(it->second);
+          it->second = rec;
+        }
+        segments_.at(rec.segment).live += rec.size;
+
+        enforce_limit();
+        due = std::exchange(compactDue_, false);
+      }
+
+      if (due)
+      {
+        wake_compactor();
+      }
+    }
+
+    std::optional<vix::cache::CacheEntry> get(const std::string &key) override
+    {
+      std::shared_lock<std::shared_mutex> lock(mutex_);
+
+      const auto it = index_.find(key);
+      if (it == index_.end())
+      {
+        return std::nullopt;
+      }
+
+      const Location &loc = it->second;
+      const char *p = segments_.at(loc.segment).map + loc.offset;
+
+      const std::uint32_t keyLen = detail::get_raw<std::uint32_t>(p + 12);
+      const std::uint32_t headersLen = detail::get_raw<std::uint32_t>(p + 16);
+      const std::uint64_t bodyLen = detail::get_raw<std::uint64_t>(p + 24);
+      const char *headers = p + kHeaderSize + keyLen;
+      const char *body = headers + headersLen;
+
+      if (config_.verify_reads && detail::crc32(body, bodyLen) != detail::get_raw<std::uint32_t>(p + 40))
+      {
+        // Bit rot after startup: report a miss; the next put replaces it.
+        return std::nullopt;
+      }
+
+      vix::cache::CacheEntry entry;
+      entry.status = loc.status;
+      entry.created_at_ms = loc.created_at_ms;
+      decode_headers(headers, headersLen, entry);
+      entry.body.assign(body, bodyLen);
+      return entry;
+    }
+
+    void erase(const std::string &key) override
+    {
+      std::string record = encode(RecordType::erase, key, nullptr);
+
+      bool due = false;
+      {
+        std::unique_lock<std::shared_mutex> lock(mutex_);
+        const auto it = index_.find(key);
+        if (it == index_.end())
+        {
+          return;
+        }
+
+        // The tombstone keeps the key erased across restarts.
+        append(record);
+        retire(it->second);
+        index_.erase(it);
+        due = std::exchange(compactDue_, false);
+      }
+
+      if (due)
+      {
+        wake_compactor();
+      }
+    }
+
+    void clear() override
+    {
+      std::unique_lock<std::shared_mutex> lock(mutex_);
+
+      index_.clear();
+      for (auto &[id, segment] : segments_)
+      {
+        close_segment(segment);
+        std::filesystem::remove(path_of(id));
+      }
+      segments_.clear();
+      open_active(nextId_++);
+    }
+
+    // Compacts every sealed segment that has any garbage, on the calling
+    // thread. Readers and writers keep going between batches.
+    void compact()
+    {
+      compact_where(0.0);
+    }
+
+    [[nodiscard]] Stats stats() const
+    {
+      std::shared_lock<std::shared_mutex> lock(mutex_);
+
+      Stats out = stats_;
+      out.entries = index_.size();
+      out.segments = segments_.size();
+      for (const auto &[id, segment] : segments_)
+      {
+        out.disk_bytes += segment.size;
+        out.live_bytes += segment.live;
+      }
+      return out;
+    }
+
+    ~SegmentedDiskStore() override
+    {
+      if (worker_.joinable())
+      {
+        {
+          std::lock_guard<std::mutex> lock(workerMutex_);
+          stopping_ = true;
+        }
+        wake_.notify_all();
+        worker_.join();
+      }
+
+      for (auto &[id, segment] : segments_)
+      {
+        close_segment(segment);
+      }
+    }
+
+  private:
+    static constexpr std::uint32_t kMagic = 0x31435856; // "VXC1"
+    static constexpr std::size_t kHeaderSize = 48;
+    static constexpr std::uint64_t kCompactBatchBytes = 1u << 20; // copied per writer-lock hold
+
+    enum class RecordType : std::uint8_t
+    {
+      put = 1,
+      erase = 2,
+    };
+
+    struct Location
+    {
+      std::uint32_t segment{0};
+      std::uint64_t offset{0};
+      std::uint64_t size{0};
+      int status{0};
+      std::int64_t created_at_ms{0};
+    };
+
+    struct Segment
+    {
+      int fd{-1};
+      char *map{nullptr};
+      std::size_t mapped{0};
+      std::uint64_t size{0};
+      std::uint64_t live{0};
+    };
+
+    struct RecordView
+    {
+      RecordType type;
+      std::uint32_t keyLen;
+      std::uint32_t headersLen;
+      std::uint64_t size;
+    };
+
+    // The record starting at `p`, or nullopt when its magic, header crc or
+    // lengths do not hold within the `remaining` bytes of the segment.
+    static std::optional<RecordView> read_record(const char *p, std::uint64_t remaining) noexcept
+    {
+      if (remaining < kHeaderSize || detail::get_raw<std::uint32_t>(p) != kMagic)
+      {
+        return std::nullopt;
+      }
+
+      const std::uint32_t keyLen = detail::get_raw<std::uint32_t>(p + 12);
+      const std::uint32_t headersLen = detail::get_raw<std::uint32_t>(p + 16);
+      const std::uint64_t bodyLen = detail::get_raw<std::uint64_t>(p + 24);
+      const std::uint64_t prefix = kHeaderSize + std::uint64_t{keyLen} + headersLen;
+
+      if (prefix > remaining || bodyLen > remaining - prefix ||
+          detail::crc32(p + 8, prefix - 8) != detail::get_raw<std::uint32_t>(p + 4))
+      {
+        return std::nullopt;
+      }
+
+      return RecordView{static_cast<RecordType>(detail::get_raw<std::uint8_t>(p + 8)), keyLen, headersLen,
+                        prefix + bodyLen};
+    }
+
+    static std::string encode(RecordType type, const std::string &key, const vix::cache::CacheEntry *entry)
+    {
+      std::string headers;
+      if (entry != nullptr)
+      {
+        detail::put_raw<std::uint32_t>(headers, static_cast<std::uint32_t>(entry->headers.size()));
+        for (const auto &[name, value] : entry->headers)
+        {
+          detail::put_raw<std::uint32_t>(headers, static_cast<std::uint32_t>(name.size()));
+          headers += name;
+          detail::put_raw<std::uint32_t>(headers, static_cast<std::uint32_t>(value.size()));
+          headers += value;
+        }
+      }
+
+      const std::string_view body = entry != nullptr ? std::string_view(entry->body) : std::string_view();
+
+      std::string out;
+      out.reserve(kHeaderSize + key.size() + headers.size() + body.size());
+      detail::put_raw<std::uint32_t>(out, kMagic);
+      detail::put_raw<std::uint32_t>(out, 0); // header crc, filled below
+      detail::put_raw<std::uint8_t>(out, static_cast<std::uint8_t>(type));
+      out.append(3, '\0');
+      detail::put_raw<std::uint32_t>(out, static_cast<std::uint32_t>(key.size()));
+      detail::put_raw<std::uint32_t>(out, static_cast<std::uint32_t>(headers.size()));
+      detail::put_raw<std::int32_t>(out, entry != nullptr ? entry->status : 0);
+      detail::put_raw<std::uint64_t>(out, body.size());
+      detail::put_raw<std::int64_t>(out, entry != nullptr ? entry->created_at_ms : 0);
+      detail::put_raw<std::uint32_t>(out, detail::crc32(body.data(), body.size()));
+      detail::put_raw<std::uint32_t>(out, 0);
+      out += key;
+      out += headers;
+
+      const std::uint32_t crc = detail::crc32(out.data() + 8, out.size() - 8);
+      std::memcpy(out.data() + 4, &crc, sizeof(crc));
+
+      out.append(body);
+      return out;
+    }
+
+    static void decode_headers(const char *p, std::size_t size, vix::cache::CacheEntry &entry)
+    {
+      if (size < 4)
+      {
+        return;
+      }
+
+      const char *end = p + size;
+      std::uint32_t count = detail::get_raw<std::uint32_t>(p);
+      p += 4;
+
+      while (count-- > 0 && p + 4 <= end)
+      {
+        const std::uint32_t nameLen = detail::get_raw<std::uint32_t>(p);
+        std::string name(p + 4, nameLen);
+        p += 4 + nameLen;
+        const std::uint32_t valueLen = detail::get_raw<std::uint32_t>(p);
+        entry.headers[std::move(name)] = std::string(p + 4, valueLen);
+        p += 4 + valueLen;
+      }
+    }
+
+    std::filesystem::path path_of(std::uint32_t id) const
+    {
+      char name[32];
+      std::snprintf(name, sizeof(name), "seg-%08u.vxc", id);
+      return config_.directory / name;
+    }
+
+    static void close_segment(Segment &segment) noexcept
+    {
+      if (segment.map != nullptr)
+      {
+        ::munmap(segment.map, segment.mapped);
+      }
+      if (segment.fd >= 0)
+      {
+        ::close(segment.fd);
+      }
+      segment = {};
+    }
+
+    // Maps at least `length` bytes. Pages past EOF are never touched:
+    // every read stays below Segment::size.
+    static void map_segment(Segment &segment, std::size_t length)
+    {
+      if (segment.map != nullptr)
+      {
+        ::munmap(segment.map, segment.mapped);
+        segment.map = nullptr;
+      }
+
+      length = std::max<std::size_t>(length, 1);
+      void *p = ::mmap(nullptr, length, PROT_READ, MAP_SHARED, segment.fd, 0);
+      if (p == MAP_FAILED)
+      {
+        throw std::system_error(errno, std::generic_category(), "mmap");
+      }
+      segment.map = static_cast<char *>(p);
+      segment.mapped = length;
+    }
+
+    void open_active(std::uint32_t id)
+    {
+      Segment segment;
+      segment.fd = ::open(path_of(id).c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+      if (segment.fd < 0)
+      {
+        throw std::system_error(errno, std::generic_category(), "open " + path_of(id).string());
+      }
+
+      struct stat st{};
+      ::fstat(segment.fd, &st);
+      segment.size = static_cast<std::uint64_t>(st.st_size);
+      map_segment(segment, std::max<std::size_t>(config_.segment_bytes, segment.size));
+
+      segments_[id] = segment;
+      active_ = id;
+    }
+
+    // Appends one record, rolling to a new segment when the active one is
+    // full. A record bigger than segment_bytes gets a segment of its own.
+    Location append(const std::string &record)
+    {
+      Segment *segment = &segments_.at(active_);
+
+      if (segment->size > 0 && segment->size + record.size() > config_.segment_bytes)
+      {
+        seal_active();
+        open_active(nextId_++);
+        segment = &segments_.at(active_);
+      }
+
+      if (segment->size + record.size() > segment->mapped)
+      {
+        map_segment(*segment, segment->size + record.size());
+      }
+
+      std::size_t written = 0;
+      while (written < record.size())
+      {
+        const ssize_t n = ::pwrite(segment->fd, record.data() + written, record.size() - written,
+                                   static_cast<off_t>(segment->size + written));
+        if (n < 0)
+        {
+          if (errno == EINTR)
+          {
+            continue;
+          }
+          // Drop the partial record so the segment stays parseable.
+          const int err = errno;
+          (void)::ftruncate(segment->fd, static_cast<off_t>(segment->size));
+          throw std::system_error(err, std::generic_category(), "pwrite");
+        }
+        written += static_cast<std::size_t>(n);
+      }
+
+      if (config_.sync_writes)
+      {
+        ::fdatasync(segment->fd);
+      }
+
+      Location loc;
+      loc.segment = active_;
+      loc.offset = segment->size;
+      loc.size = record.size();
+      segment->size += record.size();
+      return loc;
+    }
+
+    // Sealed segments are remapped to their final size.
+    void seal_active()
+    {
+      Segment &segment = segments_.at(active_);
+      map_segment(segment, segment.size);
+      compactDue_ = compactDue_ || garbage_of(segment) > config_.compact_garbage_ratio;
+    }
+
+    void retire(const Location &loc)
+    {
+      Segment &segment = segments_.at(loc.segment);
+      segment.live -= loc.size;
+      if (loc.segment != active_ && garbage_of(segment) > config_.compact_garbage_ratio)
+      {
+        compactDue_ = true;
+      }
+    }
+
+    static double garbage_of(const Segment &segment) noexcept
+    {
+      return segment.size == 0 ? 0.0 : 1.0 - static_cast<double>(segment.live) / static_cast<double>(segment.size);
+    }
+
+    void wake_compactor()
+    {
+      {
+        std::lock_guard<std::mutex> lock(workerMutex_);
+        wakeRequested_ = true;
+      }
+      wake_.notify_one();
+    }
+
+    // One pass per compact_interval, or sooner once a write pushed a
+    // sealed segment past compact_garbage_ratio.
+    void run_compactor()
+    {
+      std::unique_lock<std::mutex> lock(workerMutex_);
+
+      for (;;)
+      {
+        wake_.wait_for(lock, config_.compact_interval, [this]
+                       { return stopping_ || wakeRequested_; });
+        if (stopping_)
+        {
+          return;
+        }
+        wakeRequested_ = false;
+        lock.unlock();
+
+        try
+        {
+          compact_where(config_.compact_garbage_ratio);
+        }
+        catch (...)
+        {
+          // Disk full or similar: the segment stays, the next pass retries.
+        }
+
+        lock.lock();
+      }
+    }
+
+    // Index entries still pointing into a segment whose records can no
+    // longer be walked.
+    void forget_segment(std::uint32_t id)
+    {
+      for (auto it = index_.begin(); it != index_.end();)
+      {
+        if (it->second.segment == id)
+        {
+          it = index_.erase(it);
+          ++stats_.evicted_entries;
+        }
+        else
+        {
+          ++it;
+        }
+      }
+    }
+
+    // Size bound: drop whole segments, oldest first. Cheaper than per-key
+    // eviction and matches the append order (roughly FIFO by write time).
+    void enforce_limit()
+    {
+      if (config_.max_bytes == 0)
+      {
+        return;
+      }
+
+      std::uint64_t total = 0;
+      for (const auto &[id, segment] : segments_)
+      {
+        total += segment.size;
+      }
+
+      while (total > config_.max_bytes && segments_.size() > 1)
+      {
+        const std::uint32_t id = segments_.begin()->first;
+        if (id == active_)
+        {
+          break;
+        }
+        total -= segments_.begin()->second.size;
+        drop_segment(id);
+      }
+    }
+
+    void drop_segment(std::uint32_t id)
+    {
+      const Segment &segment = segments_.at(id);
+
+      for (std::uint64_t offset = 0; offset < segment.size;)
+      {
+        const char *p = segment.map + offset;
+        const auto record = read_record(p, segment.size - offset);
+        if (!record)
+        {
+          ++stats_.corrupt_records;
+          forget_segment(id);
+          break;
+        }
+
+        const std::string key(p + kHeaderSize, record->keyLen);
+        if (const auto it = index_.find(key); it != index_.end() && it->second.segment == id)
+        {
+          index_.erase(it);
+          ++stats_.evicted_entries;
+        }
+
+        offset += record->size;
+      }
+
+      close_segment(segments_.at(id));
+      segments_.erase(id);
+      std::filesystem::remove(path_of(id));
+    }
+
+    // One compaction at a time (background pass or compact()).
+    void compact_where(double ratio)
+    {
+      std::lock_guard<std::mutex> compacting(compactMutex_);
+
+      std::vector<std::uint32_t> victims;
+      {
+        std::shared_lock<std::shared_mutex> lock(mutex_);
+        for (const auto &[id, segment] : segments_)
+        {
+          if (id != active_ && segment.size > 0 && garbage_of(segment) > ratio)
+          {
+            victims.push_back(id);
+          }
+        }
+      }
+
+      for (const std::uint32_t id : victims)
+      {
+        compact_segment(id);
+      }
+    }
+
+    // Copies live records (and still-needed tombstones) forward, then
+    // deletes the segment. The writer lock is released every
+    // kCompactBatchBytes copied, so puts and gets interleave with the copy.
+    void compact_segment(std::uint32_t id)
+    {
+      std::uint64_t offset = 0;
+
+      for (;;)
+      {
+        std::unique_lock<std::shared_mutex> lock(mutex_);
+
+        // enforce_limit() or clear() may have removed it between batches.
+        const auto found = segments_.find(id);
+        if (found == segments_.end())
+        {
+          return;
+        }
+
+        // Sealed: never remapped, so `segment` stays valid across append().
+        const Segment &segment = found->second;
+        const bool oldest = segments_.begin()->first == id;
+        std::uint64_t copied = 0;
+
+        while (offset < segment.size && copied < kCompactBatchBytes)
+        {
+          const char *p = segment.map + offset;
+          const auto record = read_record(p, segment.size - offset);
+          if (!record)
+          {
+            // Damaged after load: what is past here cannot be located.
+            ++stats_.corrupt_records;
+            forget_segment(id);
+            offset = segment.size;
+            break;
+          }
+
+          const std::string key(p + kHeaderSize, record->keyLen);
+          const auto it = index_.find(key);
+          if (record->type == RecordType::put && it != index_.end() && it->second.segment == id &&
+              it->second.offset == offset)
+          {
+            Location loc = append(std::string(p, record->size));
+            loc.status = it->second.status;
+            loc.created_at_ms = it->second.created_at_ms;
+            it->second = loc;
+            segments_.at(loc.segment).live += loc.size;
+            copied += record->size;
+          }
+          else if (record->type == RecordType::erase && !oldest && it == index_.end())
+          {
+            // An older segment may still hold a put for this key.
+            append(std::string(p, record->size));
+            copied += record->size;
+          }
+
+          offset += record->size;
+        }
+
+        if (offset < segment.size && copied >= kCompactBatchBytes)
+        {
+          continue; // unlock, let waiting writers in
+        }
+
+        close_segment(segments_.at(id));
+        segments_.erase(id);
+        std::filesystem::remove(path_of(id));
+        ++stats_.compactions;
+        return;
+      }
+    }
+
+    // Rebuilds the index from record headers, oldest segment first.
+    void load()
+    {
+      std::vector<std::uint32_t> ids;
+      for (const auto &file : std::filesystem::directory_iterator(config_.directory))
+      {
+        unsigned id = 0;
+        const std::string name = file.path().filename().string();
+        if (std::sscanf(name.c_str(), "seg-%08u.vxc", &id) == 1 && name.size() == 16)
+        {
+          ids.push_back(id);
+        }
+      }
+      std::sort(ids.begin(), ids.end());
+
+      for (std::size_t i = 0; i < ids.size(); ++i)
+      {
+        const std::uint32_t id = ids[i];
+        const bool last = i + 1 == ids.size();
+        open_active(id);
+        scan_segment(id, last);
+        if (!last)
+        {
+          seal_active();
+        }
+        nextId_ = id + 1;
+      }
+
+      if (ids.empty() || segments_.at(active_).size >= config_.segment_bytes)
+      {
+        if (!ids.empty())
+        {
+          seal_active();
+        }
+        open_active(nextId_++);
+      }
+    }
+
+    void scan_segment(std::uint32_t id, bool last)
+    {
+      Segment &segment = segments_.at(id);
+      const char *base = segment.map;
+      std::uint64_t offset = 0;
+
+      while (offset < segment.size)
+      {
+        const char *p = base + offset;
+        const std::uint64_t remaining = segment.size - offset;
+        const auto record = read_record(p, remaining);
+
+        if (!record)
+        {
+          ++stats_.corrupt_records;
+          if (last)
+          {
+            // Torn write at the tail: cut it off and keep appending.
+            stats_.truncated_bytes += remaining;
+            if (::ftruncate(segment.fd, static_cast<off_t>(offset)) != 0)
+            {
+              throw std::system_error(errno, std::generic_category(), "ftruncate");
+            }
+          }
+          // A damaged sealed segment is only read up to the damage: its
+          // size becomes the valid length, which bounds every later walk.
+          segment.size = offset;
+          break;
+        }
+
+        const std::uint64_t recordSize = record->size;
+        std::string key(p + kHeaderSize, record->keyLen);
+        const RecordType type = record->type;
+
+        if (auto it = index_.find(key); it != index_.end())
+        {
+          retire(it->second);
+          index_.erase(it);
+        }
+
+        if (type == RecordType::put)
+        {
+          Location loc;
+          loc.segment = id;
+          loc.offset = offset;
+          loc.size = recordSize;
+          loc.status = detail::get_raw<std::int32_t>(p + 20);
+          loc.created_at_ms = detail::get_raw<std::int64_t>(p + 32);
+          index_.emplace(std::move(key), loc);
+          segment.live += recordSize;
+        }
+
+        offset += recordSize;
+      }
+    }
+
+    Config config_;
+    mutable std::shared_mutex mutex_;
+    std::unordered_map<std::string, Location> index_;
+    std::map<std::uint32_t, Segment> segments_;
+    std::uint32_t active_{0};
+    std::uint32_t nextId_{1};
+    Stats stats_;
+    bool compactDue_{false}; // guarded by mutex_
+
+    std::mutex compactMutex_;
+    std::mutex workerMutex_;
+    std::condition_variable wake_;
+    bool wakeRequested_{false};
+    bool stopping_{false};
+    std::thread worker_;
+  };
+} // namespace vix_examples::cache
+
+#endif // VIX_EXAMPLES_CACHE_SEGMENTED_DISK_STORE_HPP
@@ -0,0 +1,576 @@
+/**
+ *
+ *  @file sharded_tinylfu_store.hpp
+ *  @author Gaspard Kirira
+ *
+ *  Copyright 2025, Gaspard Kirira.
+ *  All rights reserved.
+ *  https://github.com/vixcpp/vix
+ *
+ *  Use of this source code is governed by a MIT license
+ *  that can be found in the License file.
+ *
+ *  Vix.cpp
+ *
+ */
+#ifndef VIX_EXAMPLES_CACHE_SHARDED_TINYLFU_STORE_HPP
+#define VIX_EXAMPLES_CACHE_SHARDED_TINYLFU_STORE_HPP
+
+// Concurrent CacheStore for vix::cache::Cache.
+//
+// Keys are hashed to one of N shards, each with its own mutex, so threads
+// touching different keys rarely wait on each other. Inside a shard the
+// eviction policy is W-TinyLFU:
+//
+//   put -> window LRU (1%) -> admission -> probation LRU -> protected LRU (80%)
+//
+// An entry leaving the window is only admitted to the main area if a
+// count-min sketch says it has been requested more often than the entry
+// it would evict, so a one-off scan cannot push out the hot set. A hit in
+// probation promotes to protected.
+//
+// Both max_entries and max_bytes are enforced per shard (limit / shards);
+// an entry's size is its key, body and headers plus a fixed overhead.
+// Entries bigger than a shard's main area are not cached, so the default
+// shard count is lowered until that area holds max_entry_bytes. get() copies
+// the entry outside the shard lock; find() returns the shared entry
+// without copying.
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include <vix/cache/CacheEntry.hpp>
+#include <vix/cache/CacheStore.hpp>
+
+namespace vix_examples::cache
+{
+  // 4-bit count-min sketch (4 rows) with periodic halving, so old
+  // popularity fades.
+  class FrequencySketch
+  {
+  public:
+    explicit FrequencySketch(std::size_t capacity)
+    {
+      const std::size_t words = std::bit_ceil(std::max<std::size_t>(capacity, 64)) / 4;
+      table_.assign(words, 0);
+      mask_ = words * 16 - 1;
+      sampleSize_ = std::max<std::size_t>(capacity, 64) * 10;
+    }
+
+    void increment(std::uint64_t hash) noexcept
+    {
+      bool added = false;
+
+      for (std::size_t i = 0; i < 4; ++i)
+      {
+        const std::size_t slot = index(hash, i);
+        std::uint64_t &word = table_[slot >> 4];
+        const unsigned shift = static_cast<unsigned>(slot & 15) << 2;
+
+        if (((word >> shift) & 0xF) != 0xF)
+        {
+          word += std::uint64_t{1} << shift;
+          added = true;
+        }
+      }
+
+      if (added && ++additions_ >= sampleSize_)
+      {
+        reset();
+      }
+    }
+
+    [[nodiscard]] unsigned frequency(std::uint64_t hash) const noexcept
+    {
+      unsigned out = 0xF;
+
+      for (std::size_t i = 0; i < 4; ++i)
+      {
+        const std::size_t slot = index(hash, i);
+        const unsigned shift = static_cast<unsigned>(slot & 15) << 2;
+        out = std::min(out, static_cast<unsigned>((table_[slot >> 4] >> shift) & 0xF));
+      }
+
+      return out;
+    }
+
+  private:
+    std::size_t index(std::uint64_t hash, std::size_t row) const noexcept
+    {
+      static constexpr std::array<std::uint64_t, 4> seeds = {
+          0xc3a5c85c97cb3127ULL, 0xb492b66fbe98f273ULL, 0x9ae16a3b2f90404fULL, 0xcbf29ce484222325ULL};
+
+      std::uint64_t h = (hash + seeds[row]) * seeds[row];
+      h ^= h >> 32;
+      return static_cast<std::size_t>(h) & mask_;
+    }
+
+    void reset() noexcept
+    {
+      for (auto &word : table_)
+      {
+        word = (word >> 1) & 0x7777777777777777ULL;
+      }
+      additions_ /= 2;
+    }
+
+    std::vector<std::uint64_t> table_;
+    std::size_t mask_{0};
+    std::size_t sampleSize_{0};
+    std::size_t additions_{0};
+  };
+
+  class ShardedTinyLfuStore final : public vix::cache::CacheStore
+  {
+  public:
+    struct Config
+    {
+      std::size_t max_entries{100'000}; // 0 = no entry limit
+      std::size_t max_bytes{256u << 20}; // 0 = no byte limit
+      std::size_t shards{0};             // 0 = 4 x hardware threads (power of two), see max_entry_bytes
+      std::size_t max_entry_bytes{4u << 20}; // with shards = 0, fewer shards until one can hold this
+      double window_ratio{0.01};
+      double protected_ratio{0.80};
+    };
+
+    struct Stats
+    {
+      std::uint64_t hits{0};
+      std::uint64_t misses{0};
+      std::uint64_t evictions{0};
+      std::uint64_t rejected{0};  // lost the admission contest
+      std::uint64_t oversized{0}; // larger than a shard's main area
+      std::size_t entries{0};
+      std::size_t bytes{0};
+    };
+
+    ShardedTinyLfuStore()
+        : ShardedTinyLfuStore(Config{})
+    {
+    }
+
+    explicit ShardedTinyLfuStore(Config config)
+        : config_(config)
+    {
+      std::size_t shards = config_.shards;
+      if (shards == 0)
+      {
+        // Each shard gets max_bytes / shards; on a many-core machine that
+        // share can drop below a single large body.
+        shards = std::bit_ceil(4 * std::max<std::size_t>(1, std::thread::hardware_concurrency()));
+        while (shards > 1 && config_.max_bytes != 0 &&
+               static_cast<double>(config_.max_bytes / shards) * (1.0 - config_.window_ratio) <
+                   static_cast<double>(config_.max_entry_bytes))
+        {
+          shards /= 2;
+        }
+      }
+      shards = std::bit_ceil(shards);
+      shardBits_ = static_cast<unsigned>(std::countr_zero(shards));
+
+      Limits limits;
+      limits.entries = config_.max_entries == 0 ? SIZE_MAX : std::max<std::size_t>(1, (config_.max_entries + shards - 1) / shards);
+      limits.bytes = config_.max_bytes == 0 ? SIZE_MAX : std::max<std::size_t>(1, config_.max_bytes / shards);
+
+      limits.window_entries = scaled(limits.entries, config_.window_ratio);
+      limits.window_bytes = scaled(limits.bytes, config_.window_ratio);
+      limits.main_entries = limits.entries == SIZE_MAX ? SIZE_MAX : std::max<std::size_t>(1, limits.entries - limits.window_entries);
+      limits.main_bytes = limits.bytes == SIZE_MAX ? SIZE_MAX : std::max<std::size_t>(1, limits.bytes - limits.window_bytes);
+      limits.protected_entries = scaled(limits.main_entries, config_.protected_ratio);
+      limits.protected_bytes = scaled(limits.main_bytes, config_.protected_ratio);
+
+      // The sketch needs roughly one counter group per cached entry.
+      const std::size_t sketchCapacity = limits.entries != SIZE_MAX ? limits.entries
+                                         : limits.bytes != SIZE_MAX ? std::max<std::size_t>(64, limits.bytes / 1024)
+                                                                    : 4096;
+
+      shards_.reserve(shards);
+      for (std::size_t i = 0; i < shards; ++i)
+      {
+        shards_.push_back(std::make_unique<Shard>(limits, sketchCapacity));
+      }
+    }
+
+    void put(const std::string &key, const vix::cache::CacheEntry &entry) override
+    {
+      auto shared = std::make_shared<const vix::cache::CacheEntry>(entry);
+      const std::size_t bytes = size_of(key, entry);
+      const std::uint64_t hash = hash_of(key);
+      Shard &shard = shard_for(hash);
+
+      std::lock_guard<std::mutex> lock(shard.mutex);
+      shard.sketch.increment(hash);
+
+      if (bytes > shard.limits.main_bytes)
+      {
+        ++shard.stats.oversized;
+        shard.remove(key);
+        return;
+      }
+
+      if (auto it = shard.index.find(key); it != shard.index.end())
+      {
+        Node &node = *it->second;
+        shard.account(node.segment, -static_cast<std::ptrdiff_t>(node.bytes), 0);
+        node.entry = std::move(shared);
+        node.bytes = bytes;
+        shard.account(node.segment, static_cast<std::ptrdiff_t>(bytes), 0);
+        shard.touch(it->second);
+
+        // Growing in place bypasses admission; keep main within its limits.
+        if (node.segment != Segment::window)
+        {
+          shard.trim_main(it->second);
+        }
+      }
+      else
+      {
+        shard.window.push_front(Node{key, hash, std::move(shared), bytes, Segment::window});
+        shard.index.emplace(shard.window.front().key, shard.window.begin());
+        shard.account(Segment::window, static_cast<std::ptrdiff_t>(bytes), 1);
+      }
+
+      shard.rebalance();
+    }
+
+    std::optional<vix::cache::CacheEntry> get(const std::string &key) override
+    {
+      auto entry = find(key);
+      if (!entry)
+      {
+        return std::nullopt;
+      }
+      return *entry;
+    }
+
+    // Shared, immutable entry; no body copy.
+    std::shared_ptr<const vix::cache::CacheEntry> find(std::string_view key)
+    {
+      const std::uint64_t hash = hash_of(key);
+      Shard &shard = shard_for(hash);
+
+      std::lock_guard<std::mutex> lock(shard.mutex);
+      shard.sketch.increment(hash);
+
+      const auto it = shard.index.find(key);
+      if (it == shard.index.end())
+      {
+        ++shard.stats.misses;
+        return nullptr;
+      }
+
+      ++shard.stats.hits;
+      shard.touch(it->second);
+      return it->second->entry;
+    }
+
+    void erase(const std::string &key) override
+    {
+      Shard &shard = shard_for(hash_of(key));
+      std::lock_guard<std::mutex> lock(shard.mutex);
+      shard.remove(key);
+    }
+
+    void clear() override
+    {
+      for (auto &shard : shards_)
+      {
+        std::lock_guard<std::mutex> lock(shard->mutex);
+        shard->index.clear();
+        shard->window.clear();
+        shard->probation.clear();
+        shard->protect.clear();
+        shard->usage = {};
+      }
+    }
+
+    [[nodiscard]] Stats stats() const
+    {
+      Stats out;
+
+      for (const auto &shard : shards_)
+      {
+        std::lock_guard<std::mutex> lock(shard->mutex);
+        out.hits += shard->stats.hits;
+        out.misses += shard->stats.misses;
+        out.evictions += shard->stats.evictions;
+        out.rejected += shard->stats.rejected;
+        out.oversized += shard->stats.oversized;
+        out.entries += shard->index.size();
+        for (const auto &segment : shard->usage)
+        {
+          out.bytes += segment.bytes;
+        }
+      }
+
+      return out;
+    }
+
+    [[nodiscard]] std::size_t shard_count() const noexcept { return shards_.size(); }
+
+  private:
+    enum class Segment : std::uint8_t
+    {
+      window,
+      probation,
+      protect,
+    };
+
+    struct Node
+    {
+      std::string key;
+      std::uint64_t hash;
+      std::shared_ptr<const vix::cache::CacheEntry> entry;
+      std::size_t bytes;
+      Segment segment;
+    };
+
+    using List = std::list<Node>;
+
+    struct Limits
+    {
+      std::size_t entries{0};
+      std::size_t bytes{0};
+      std::size_t window_entries{0};
+      std::size_t window_bytes{0};
+      std::size_t main_entries{0};
+      std::size_t main_bytes{0};
+      std::size_t protected_entries{0};
+      std::size_t protected_bytes{0};
+    };
+
+    struct Usage
+    {
+      std::size_t entries{0};
+      std::size_t bytes{0};
+    };
+
+    struct alignas(64) Shard
+    {
+      Shard(const Limits &l, std::size_t sketchCapacity)
+          : limits(l),
+            sketch(sketchCapacity)
+      {
+      }
+
+      List &list(Segment segment) noexcept
+      {
+        return segment == Segment::window ? window : segment == Segment::probation ? probation
+                                                                                   : protect;
+      }
+
+      void account(Segment segment, std::ptrdiff_t bytes, std::ptrdiff_t entries) noexcept
+      {
+        Usage &u = usage[static_cast<std::size_t>(segment)];
+        u.bytes = static_cast<std::size_t>(static_cast<std::ptrdiff_t>(u.bytes) + bytes);
+        u.entries = static_cast<std::size_t>(static_cast<std::ptrdiff_t>(u.entries) + entries);
+      }
+
+      void move(List::iterator it, Segment to)
+      {
+        account(it->segment, -static_cast<std::ptrdiff_t>(it->bytes), -1);
+        List &from = list(it->segment);
+        it->segment = to;
+        list(to).splice(list(to).begin(), from, it);
+        account(to, static_cast<std::ptrdiff_t>(it->bytes), 1);
+      }
+
+      // Hit: refresh recency; probation hits graduate to protected.
+      void touch(List::iterator it)
+      {
+        if (it->segment == Segment::probation)
+        {
+          move(it, Segment::protect);
+          demote_protected();
+          return;
+        }
+
+        List &l = list(it->segment);
+        l.splice(l.begin(), l, it);
+      }
+
+      void drop(List::iterator it)
+      {
+        account(it->segment, -static_cast<std::ptrdiff_t>(it->bytes), -1);
+        index.erase(std::string_view(it->key));
+        list(it->segment).erase(it);
+      }
+
+      void remove(std::string_view key)
+      {
+        if (const auto it = index.find(key); it != index.end())
+        {
+          drop(it->second);
+        }
+      }
+
+      Usage main_usage() const noexcept
+      {
+        const Usage &p = usage[static_cast<std::size_t>(Segment::probation)];
+        const Usage &q = usage[static_cast<std::size_t>(Segment::protect)];
+        return {p.entries + q.entries, p.bytes + q.bytes};
+      }
+
+      static bool over(const Usage &u, std::size_t entries, std::size_t bytes) noexcept
+      {
+        return u.entries > entries || u.bytes > bytes;
+      }
+
+      void demote_protected()
+      {
+        while (over(usage[static_cast<std::size_t>(Segment::protect)], limits.protected_entries, limits.protected_bytes) &&
+               !protect.empty())
+        {
+          move(std::prev(protect.end()), Segment::probation);
+        }
+      }
+
+      // Evicts from the cold end of probation, then protected, until main
+      // fits; `keep` (an entry just updated in place) is never chosen.
+      void trim_main(List::iterator keep)
+      {
+        const auto coldest = [&](List &l)
+        {
+          auto it = l.end();
+          while (it != l.begin())
+          {
+            if (--it != keep)
+            {
+              return it;
+            }
+          }
+          return l.end();
+        };
+
+        while (over(main_usage(), limits.main_entries, limits.main_bytes))
+        {
+          auto victim = coldest(probation);
+          if (victim == probation.end())
+          {
+            victim = coldest(protect);
+            if (victim == protect.end())
+            {
+              return;
+            }
+          }
+
+          drop(victim);
+          ++stats.evictions;
+        }
+      }
+
+      // Moves window overflow into main through the TinyLFU filter.
+      void rebalance()
+      {
+        while (over(usage[static_cast<std::size_t>(Segment::window)], limits.window_entries, limits.window_bytes) &&
+               !window.empty())
+        {
+          const auto candidate = std::prev(window.end());
+          move(candidate, Segment::probation);
+          admit(candidate);
+        }
+
+        demote_protected();
+      }
+
+      // `candidate` sits at the head of probation; evict until main fits,
+      // each time keeping the more frequent of candidate and victim.
+      void admit(List::iterator candidate)
+      {
+        const unsigned candidateFreq = sketch.frequency(candidate->hash);
+
+        while (over(main_usage(), limits.main_entries, limits.main_bytes))
+        {
+          List::iterator victim;
+          if (probation.size() > 1)
+          {
+            victim = std::prev(probation.end());
+          }
+          else if (!protect.empty())
+          {
+            victim = std::prev(protect.end());
+          }
+          else
+          {
+            victim = candidate;
+          }
+
+          if (victim != candidate && candidateFreq > sketch.frequency(victim->hash))
+          {
+            drop(victim);
+            ++stats.evictions;
+            continue;
+          }
+
+          drop(candidate);
+          ++stats.rejected;
+          return;
+        }
+      }
+
+      mutable std::mutex mutex;
+      Limits limits;
+      FrequencySketch sketch;
+      std::unordered_map<std::string_view, List::iterator> index;
+      List window;
+      List probation;
+      List protect;
+      std::array<Usage, 3> usage{};
+      Stats stats;
+    };
+
+    static std::size_t scaled(std::size_t limit, double ratio) noexcept
+    {
+      if (limit == SIZE_MAX)
+      {
+        return SIZE_MAX;
+      }
+      return std::max<std::size_t>(1, static_cast<std::size_t>(static_cast<double>(limit) * ratio));
+    }
+
+    static std::uint64_t hash_of(std::string_view key) noexcept
+    {
+      // Spread std::hash so both the shard bits and the sketch rows vary.
+      std::uint64_t h = std::hash<std::string_view>{}(key);
+      h ^= h >> 33;
+      h *= 0xff51afd7ed558ccdULL;
+      h ^= h >> 33;
+      return h;
+    }
+
+    static std::size_t size_of(const std::string &key, const vix::cache::CacheEntry &entry) noexcept
+    {
+      std::size_t bytes = sizeof(Node) + sizeof(vix::cache::CacheEntry) + 64 + key.size() + entry.body.size();
+      for (const auto &[name, value] : entry.headers)
+      {
+        bytes += name.size() + value.size() + 32;
+      }
+      return bytes;
+    }
+
+    Shard &shard_for(std::uint64_t hash) noexcept
+    {
+      return *shards_[shardBits_ == 0 ? 0 : static_cast<std::size_t>(hash >> (64 - shardBits_))];
+    }
+
+    Config config_;
+    unsigned shardBits_{0};
+    std::vector<std::unique_ptr<Shard>> shards_;
+  };
+} // namespace vix_examples::cache
+
+#endif // VIX_EXAMPLES_CACHE_SHARDED_TINYLFU_STORE_HPP
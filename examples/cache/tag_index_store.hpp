@@ -0,0 +1,389 @@
+/**
+ *
+ *  @file tag_index_store.hpp
+ *  @author Gaspard Kirira
+ *
+ *  Copyright 2025, Gaspard Kirira.
+ *  All rights reserved.
+ *  https://github.com/vixcpp/vix
+ *
+ *  Use of this source code is governed by a MIT license
+ *  that can be found in the License file.
+ *
+ *  Vix.cpp
+ *
+ */
+#ifndef VIX_EXAMPLES_CACHE_TAG_INDEX_STORE_HPP
+#define VIX_EXAMPLES_CACHE_TAG_INDEX_STORE_HPP
+
+// CacheStore decorator with a secondary index for invalidation.
+//
+//   store->put(key, entry, {"user:42", "products"});
+//   store->invalidate_tag("user:42");               // every entry tagged user:42
+//   store->invalidate_prefix("GET /api/products");  // every key starting with it
+//
+// Keys live in an ordered set, so a prefix is one range scan; tags map to
+// their key sets. Both cost O(log n + matches), never a full scan.
+//
+// Tags can also travel inside the entry, in the `x-vix-cache-tags`
+// header (comma separated), so plain put(key, entry) through
+// vix::cache::Cache indexes them too.
+//
+// The wrapped store may evict on its own; keys it dropped are forgotten
+// lazily on the next get() miss, and invalidating them is a no-op. The
+// index also holds at most max_keys keys: past that, the oldest indexed
+// key is dropped from both the index and the store. Size it at or above
+// the wrapped store's capacity, so what goes first is usually a key the
+// store already evicted.
+//
+// put() indexes the key under the lock but stores the entry outside it.
+// If an invalidation, erase() or newer put touches the key meanwhile,
+// the stored copy is erased again, so stale data never outlives it.
+//
+// generation() changes on every invalidation. A fill that read its data
+// before an invalidation passes the generation it saw to
+// put_if_unchanged() and is dropped instead of caching stale data.
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include <vix/cache/CacheEntry.hpp>
+#include <vix/cache/CacheStore.hpp>
+
+namespace vix_examples::cache
+{
+  inline constexpr std::string_view kCacheTagsHeader = "x-vix-cache-tags";
+
+  class TaggedStore final : public vix::cache::CacheStore
+  {
+  public:
+    struct Stats
+    {
+      std::size_t keys{0};
+      std::size_t tags{0};
+      std::uint64_t invalidated{0};
+      std::uint64_t dropped_fills{0};
+      std::uint64_t evicted{0}; // dropped to stay within max_keys
+    };
+
+    explicit TaggedStore(std::shared_ptr<vix::cache::CacheStore> inner, std::size_t max_keys = 100'000)
+        : inner_(std::move(inner)),
+          maxKeys_(max_keys)
+    {
+    }
+
+    void put(const std::string &key, const vix::cache::CacheEntry &entry) override
+    {
+      put_indexed(key, entry, tags_from(entry), nullptr);
+    }
+
+    void put(const std::string &key, const vix::cache::CacheEntry &entry, std::vector<std::string> tags)
+    {
+      for (auto &tag : tags_from(entry))
+      {
+        tags.push_back(std::move(tag));
+      }
+
+      put_indexed(key, entry, std::move(tags), nullptr);
+    }
+
+    // Stores only if nothing was invalidated since `generation`.
+    bool put_if_unchanged(const std::string &key, const vix::cache::CacheEntry &entry, std::uint64_t generation)
+    {
+      return put_indexed(key, entry, tags_from(entry), &generation);
+    }
+
+    std::optional<vix::cache::CacheEntry> get(const std::string &key) override
+    {
+      auto entry = inner_->get(key);
+      if (!entry)
+      {
+        // Recheck under the lock: a put may have landed since the miss.
+        // One still in flight (not stored yet) is left alone.
+        std::lock_guard<std::mutex> lock(mutex_);
+        const auto it = keys_.find(key);
+        if (it != keys_.end() && it->second.stored && !inner_->get(key))
+        {
+          forget(key);
+        }
+      }
+      return entry;
+    }
+
+    void erase(const std::string &key) override
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      inner_->erase(key);
+      forget(key);
+    }
+
+    void clear() override
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      inner_->clear();
+      keys_.clear();
+      keyTags_.clear();
+      tagKeys_.clear();
+      order_.clear();
+      ++generation_;
+    }
+
+    // Returns how many entries were removed.
+    std::size_t invalidate_tag(std::string_view tag)
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      ++generation_;
+
+      const auto it = tagKeys_.find(std::string(tag));
+      if (it == tagKeys_.end())
+      {
+        return 0;
+      }
+
+      const std::vector<std::string> keys(it->second.begin(), it->second.end());
+      for (const auto &key : keys)
+      {
+        inner_->erase(key);
+        forget(key);
+      }
+      invalidated_ += keys.size();
+      return keys.size();
+    }
+
+    std::size_t invalidate_prefix(std::string_view prefix)
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      ++generation_;
+
+      std::vector<std::string> keys;
+      for (auto it = keys_.lower_bound(prefix); it != keys_.end() && it->first.compare(0, prefix.size(), prefix) == 0; ++it)
+      {
+        keys.push_back(it->first);
+      }
+
+      for (const auto &key : keys)
+      {
+        inner_->erase(key);
+        forget(key);
+      }
+      invalidated_ += keys.size();
+      return keys.size();
+    }
+
+    [[nodiscard]] std::uint64_t generation() const
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      return generation_;
+    }
+
+    [[nodiscard]] std::vector<std::string> keys_for_tag(std::string_view tag) const
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      const auto it = tagKeys_.find(std::string(tag));
+      if (it == tagKeys_.end())
+      {
+        return {};
+      }
+      return {it->second.begin(), it->second.end()};
+    }
+
+    [[nodiscard]] Stats stats() const
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      return Stats{keys_.size(), tagKeys_.size(), invalidated_, droppedFills_, evicted_};
+    }
+
+    // Comma or space separated tags from the entry's x-vix-cache-tags header.
+    static std::vector<std::string> tags_from(const vix::cache::CacheEntry &entry)
+    {
+      std::vector<std::string> out;
+
+      const auto it = entry.headers.find(std::string(kCacheTagsHeader));
+      if (it == entry.headers.end())
+      {
+        return out;
+      }
+
+      const std::string &value = it->second;
+      std::size_t start = 0;
+      while (start < value.size())
+      {
+        const std::size_t end = value.find_first_of(", ", start);
+        const std::size_t stop = end == std::string::npos ? value.size() : end;
+        if (stop > start)
+        {
+          out.emplace_back(value, start, stop - start);
+        }
+        start = stop + 1;
+      }
+      return out;
+    }
+
+  private:
+    struct KeyState
+    {
+      std::uint64_t version{0}; // which put indexed the key last
+      bool stored{false};       // that put's entry reached the store
+    };
+
+    // Indexed first, so an invalidation that starts during the store
+    // already sees the key. Afterwards, a key that was forgotten or
+    // re-indexed meanwhile may hold an entry the invalidation missed, and
+    // is erased from the store.
+    bool put_indexed(const std::string &key, const vix::cache::CacheEntry &entry, std::vector<std::string> tags,
+                     const std::uint64_t *generation)
+    {
+      std::uint64_t version = 0;
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (generation != nullptr && *generation != generation_)
+        {
+          ++droppedFills_;
+          return false;
+        }
+        version = index(key, std::move(tags));
+      }
+
+      try
+      {
+        inner_->put(key, entry);
+      }
+      catch (...)
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (const auto it = keys_.find(key); it != keys_.end() && it->second.version == version)
+        {
+          forget(key);
+        }
+        throw;
+      }
+
+      std::vector<std::string> evicted;
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        const auto it = keys_.find(key);
+        if (it == keys_.end() || it->second.version != version)
+        {
+          inner_->erase(key);
+          return true;
+        }
+
+        it->second.stored = true;
+        evicted = trim();
+      }
+
+      for (const auto &old : evicted)
+      {
+        inner_->erase(old);
+      }
+      return true;
+    }
+
+    std::uint64_t index(const std::string &key, std::vector<std::string> tags)
+    {
+      forget(key);
+
+      const std::uint64_t version = ++nextVersion_;
+      keys_.emplace(key, KeyState{version, false});
+      order_.emplace_back(key, version);
+
+      std::unordered_set<std::string> unique(tags.begin(), tags.end());
+      for (const auto &tag : unique)
+      {
+        tagKeys_[tag].insert(key);
+      }
+      if (!unique.empty())
+      {
+        keyTags_[key].assign(unique.begin(), unique.end());
+      }
+
+      return version;
+    }
+
+    // Forgets the oldest indexed keys past max_keys and returns them, to
+    // be erased from the store once the lock is released. order_ also
+    // holds records of keys re-put or forgotten since; those are skipped.
+    std::vector<std::string> trim()
+    {
+      std::vector<std::string> evicted;
+
+      while (maxKeys_ != 0 && keys_.size() > maxKeys_ && !order_.empty())
+      {
+        auto [key, version] = std::move(order_.front());
+        order_.pop_front();
+
+        const auto it = keys_.find(key);
+        if (it == keys_.end() || it->second.version != version)
+        {
+          continue;
+        }
+
+        forget(key);
+        evicted.push_back(std::move(key));
+        ++evicted_;
+      }
+
+      if (order_.size() > 2 * keys_.size() + 1024)
+      {
+        std::erase_if(order_, [this](const auto &record)
+                      {
+                        const auto it = keys_.find(record.first);
+                        return it == keys_.end() || it->second.version != record.second; });
+      }
+
+      return evicted;
+    }
+
+    void forget(const std::string &key)
+    {
+      keys_.erase(key);
+
+      const auto it = keyTags_.find(key);
+      if (it == keyTags_.end())
+      {
+        return;
+      }
+
+      for (const auto &tag : it->second)
+      {
+        const auto t = tagKeys_.find(tag);
+        if (t != tagKeys_.end())
+        {
+          t->second.erase(key);
+          if (t->second.empty())
+          {
+            tagKeys_.erase(t);
+          }
+        }
+      }
+      keyTags_.erase(it);
+    }
+
+    std::shared_ptr<vix::cache::CacheStore> inner_;
+    std::size_t maxKeys_;
+
+    mutable std::mutex mutex_;
+    std::map<std::string, KeyState, std::less<>> keys_;
+    std::deque<std::pair<std::string, std::uint64_t>> order_; // (key, version), oldest first
+    std::uint64_t nextVersion_{0};
+    std::unordered_map<std::string, std::vector<std::string>> keyTags_;
+    std::unordered_map<std::string, std::unordered_set<std::string>> tagKeys_;
+    std::uint64_t generation_{0};
+    std::uint64_t invalidated_{0};
+    std::uint64_t droppedFills_{0};
+    std::uint64_t evicted_{0};
+  };
+} // namespace vix_examples::cache
+
+#endif // VIX_EXAMPLES_CACHE_TAG_INDEX_STORE_HPP
@@ -0,0 +1,484 @@
+/**
+ *
+ *  @file tiered_store.hpp
+ *  @author Gaspard Kirira
+ *
+ *  Copyright 2025, Gaspard Kirira.
+ *  All rights reserved.
+ *  https://github.com/vixcpp/vix
+ *
+ *  Use of this source code is governed by a MIT license
+ *  that can be found in the License file.
+ *
+ *  Vix.cpp
+ *
+ */
+#ifndef VIX_EXAMPLES_CACHE_TIERED_STORE_HPP
+#define VIX_EXAMPLES_CACHE_TIERED_STORE_HPP
+
+// Two-tier CacheStore: a small, fast L1 (memory) in front of a large L2
+// (disk), behind one vix::cache::Cache.
+//
+//   get:   L1 -> pending write-backs -> L2 (hit is promoted to L1)
+//   put:   L1, then L2 now (write_through) or from a background thread
+//          (write_back)
+//   erase: both tiers
+//
+// Size limits belong to the tier stores themselves (for example
+// ShardedTinyLfuStore max_bytes and SegmentedDiskStore max_bytes). Each
+// tier also gets its own TTL, measured from CacheEntry::created_at_ms, so
+// L1 can hold only recent entries while L2 keeps older ones around for
+// CacheContext::Offline / NetworkError. Entries are passed through
+// unchanged, so Cache applies its staleness rules exactly as with a
+// single store; l2_ttl_ms should cover the longest stale window.
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <vix/cache/CacheEntry.hpp>
+#include <vix/cache/CacheStore.hpp>
+
+namespace vix_examples::cache
+{
+  class TieredStore final : public vix::cache::CacheStore
+  {
+  public:
+    enum class WriteMode
+    {
+      write_through,
+      write_back,
+    };
+
+    struct Config
+    {
+      std::int64_t l1_ttl_ms{0}; // 0 = no tier TTL
+      std::int64_t l2_ttl_ms{0};
+      WriteMode write_mode{WriteMode::write_through};
+      std::size_t max_pending{10'000}; // write_back queue; beyond it puts write through
+      std::function<std::int64_t()> clock{};  // same clock as created_at_ms; steady ms by default
+    };
+
+    struct Stats
+    {
+      std::uint64_t l1_hits{0};
+      std::uint64_t l2_hits{0};
+      std::uint64_t misses{0};
+      std::uint64_t promotions{0};
+      std::uint64_t write_backs{0};
+      std::uint64_t write_back_errors{0};
+      std::size_t pending{0};
+
+      [[nodiscard]] double l1_hit_ratio() const noexcept
+      {
+        const auto lookups = l1_hits + l2_hits + misses;
+        return lookups == 0 ? 0.0 : static_cast<double>(l1_hits) / static_cast<double>(lookups);
+      }
+
+      // Of the lookups that reached L2.
+      [[nodiscard]] double l2_hit_ratio() const noexcept
+      {
+        const auto lookups = l2_hits + misses;
+        return lookups == 0 ? 0.0 : static_cast<double>(l2_hits) / static_cast<double>(lookups);
+      }
+    };
+
+    TieredStore(std::shared_ptr<vix::cache::CacheStore> l1,
+                std::shared_ptr<vix::cache::CacheStore> l2)
+        : TieredStore(std::move(l1), std::move(l2), Config{})
+    {
+    }
+
+    TieredStore(std::shared_ptr<vix::cache::CacheStore> l1,
+                std::shared_ptr<vix::cache::CacheStore> l2,
+                Config config)
+        : l1_(std::move(l1)),
+          l2_(std::move(l2)),
+          config_(std::move(config))
+    {
+      if (!config_.clock)
+      {
+        config_.clock = []
+        {
+          using namespace std::chrono;
+          return duration_cast<milliseconds>(steady_clock::now().time_since_epoch()).count();
+        };
+      }
+
+      if (config_.write_mode == WriteMode::write_back)
+      {
+        worker_ = std::thread([this]
+                              { run_writer(); });
+      }
+    }
+
+    TieredStore(const TieredStore &) = delete;
+    TieredStore &operator=(const TieredStore &) = delete;
+
+    ~TieredStore() override
+    {
+      if (worker_.joinable())
+      {
+        {
+          std::lock_guard<std::mutex> lock(mutex_);
+          stopping_ = true;
+        }
+        wake_.notify_all();
+        worker_.join();
+      }
+    }
+
+    void put(const std::string &key, const vix::cache::CacheEntry &entry) override
+    {
+      const WriteGuard guard(stripe_for(key));
+      const std::int64_t now = config_.clock();
+
+      if (within(entry, config_.l1_ttl_ms, now))
+      {
+        l1_->put(key, entry);
+      }
+
+      write_l2(key, entry);
+    }
+
+    std::optional<vix::cache::CacheEntry> get(const std::string &key) override
+    {
+      const std::int64_t now = config_.clock();
+
+      if (auto entry = l1_->get(key))
+      {
+        if (within(*entry, config_.l1_ttl_ms, now))
+        {
+          l1Hits_.fetch_add(1, std::memory_order_relaxed);
+          return entry;
+        }
+        l1_->erase(key);
+      }
+
+      // Taken before reading the queue or L2; see Stripe.
+      const std::optional<std::uint64_t> seen = read_version(key);
+
+      // A queued write-back is newer than anything in L2.
+      if (auto pending = pending_value(key))
+      {
+        if (!*pending)
+        {
+          misses_.fetch_add(1, std::memory_order_relaxed);
+          return std::nullopt;
+        }
+        l2Hits_.fetch_add(1, std::memory_order_relaxed);
+        promote(key, **pending, now, seen);
+        return *pending;
+      }
+
+      if (auto entry = l2_->get(key))
+      {
+        if (within(*entry, config_.l2_ttl_ms, now))
+        {
+          l2Hits_.fetch_add(1, std::memory_order_relaxed);
+          promote(key, *entry, now, seen);
+          return entry;
+        }
+        l2_->erase(key);
+      }
+
+      misses_.fetch_add(1, std::memory_order_relaxed);
+      return std::nullopt;
+    }
+
+    void erase(const std::string &key) override
+    {
+      const WriteGuard guard(stripe_for(key));
+      l1_->erase(key);
+      write_l2(key, std::nullopt);
+    }
+
+    void clear() override
+    {
+      std::vector<WriteGuard> guards;
+      guards.reserve(stripes_.size());
+      for (Stripe &stripe : stripes_)
+      {
+        guards.emplace_back(stripe);
+      }
+
+      {
+        std::unique_lock<std::mutex> lock(mutex_);
+        pending_.clear();
+        order_.clear();
+        // Let an in-flight write land first, so it cannot reappear after.
+        idle_.wait(lock, [this]
+                   { return !writing_; });
+      }
+      l1_->clear();
+      l2_->clear();
+    }
+
+    // Blocks until every queued write-back has reached L2.
+    void flush()
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      idle_.wait(lock, [this]
+                 { return order_.empty() && !writing_; });
+    }
+
+    [[nodiscard]] Stats stats() const
+    {
+      Stats out;
+      out.l1_hits = l1Hits_.load(std::memory_order_relaxed);
+      out.l2_hits = l2Hits_.load(std::memory_order_relaxed);
+      out.misses = misses_.load(std::memory_order_relaxed);
+      out.promotions = promotions_.load(std::memory_order_relaxed);
+      out.write_backs = writeBacks_.load(std::memory_order_relaxed);
+      out.write_back_errors = writeBackErrors_.load(std::memory_order_relaxed);
+
+      std::lock_guard<std::mutex> lock(mutex_);
+      out.pending = pending_.size();
+      return out;
+    }
+
+  private:
+    // nullopt value = queued erase.
+    struct Pending
+    {
+      std::optional<vix::cache::CacheEntry> value;
+      std::uint64_t version{0};
+    };
+
+    // A promotion copies a value read from L2 (or the queue) into L1. A
+    // put() or erase() that lands between that read and the L1 write must
+    // win, so writers bump the version of the key's stripe and stay
+    // registered until both tiers are updated. A promotion only happens
+    // when no writer was active and the version did not move since the
+    // read. Stripes keep this bounded; a collision only skips a promotion.
+    struct Stripe
+    {
+      std::mutex mutex;
+      std::uint64_t version{0};
+      std::size_t writers{0};
+    };
+
+    class WriteGuard
+    {
+    public:
+      explicit WriteGuard(Stripe &stripe)
+          : stripe_(&stripe)
+      {
+        std::lock_guard<std::mutex> lock(stripe_->mutex);
+        ++stripe_->writers;
+        ++stripe_->version;
+      }
+
+      WriteGuard(WriteGuard &&other) noexcept
+          : stripe_(std::exchange(other.stripe_, nullptr))
+      {
+      }
+
+      WriteGuard(const WriteGuard &) = delete;
+      WriteGuard &operator=(const WriteGuard &) = delete;
+      WriteGuard &operator=(WriteGuard &&) = delete;
+
+      ~WriteGuard()
+      {
+        if (stripe_ != nullptr)
+        {
+          std::lock_guard<std::mutex> lock(stripe_->mutex);
+          --stripe_->writers;
+        }
+      }
+
+    private:
+      Stripe *stripe_;
+    };
+
+    static constexpr std::size_t stripe_count = 64;
+
+    static bool within(const vix::cache::CacheEntry &entry, std::int64_t ttl, std::int64_t now) noexcept
+    {
+      return ttl <= 0 || now - entry.created_at_ms <= ttl;
+    }
+
+    Stripe &stripe_for(const std::string &key) const noexcept
+    {
+      return stripes_[std::hash<std::string>{}(key) % stripe_count];
+    }
+
+    // nullopt while a write is in progress: nothing read now may be promoted.
+    std::optional<std::uint64_t> read_version(const std::string &key) const
+    {
+      Stripe &stripe = stripe_for(key);
+      std::lock_guard<std::mutex> lock(stripe.mutex);
+      if (stripe.writers != 0)
+      {
+        return std::nullopt;
+      }
+      return stripe.version;
+    }
+
+    void promote(const std::string &key, const vix::cache::CacheEntry &entry, std::int64_t now,
+                 std::optional<std::uint64_t> seen)
+    {
+      if (!seen || !within(entry, config_.l1_ttl_ms, now))
+      {
+        return;
+      }
+
+      Stripe &stripe = stripe_for(key);
+      std::lock_guard<std::mutex> lock(stripe.mutex);
+      if (stripe.writers == 0 && stripe.version == *seen)
+      {
+        l1_->put(key, entry);
+        promotions_.fetch_add(1, std::memory_order_relaxed);
+      }
+    }
+
+    std::optional<std::optional<vix::cache::CacheEntry>> pending_value(const std::string &key) const
+    {
+      if (config_.write_mode != WriteMode::write_back)
+      {
+        return std::nullopt;
+      }
+
+      std::lock_guard<std::mutex> lock(mutex_);
+      const auto it = pending_.find(key);
+      if (it == pending_.end())
+      {
+        return std::nullopt;
+      }
+      return it->second.value;
+    }
+
+    void write_l2(const std::string &key, std::optional<vix::cache::CacheEntry> value)
+    {
+      if (config_.write_mode == WriteMode::write_back)
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = pending_.find(key);
+        if (it != pending_.end())
+        {
+          // Coalesce: the queued write now carries the newest value.
+          it->second.value = std::move(value);
+          it->second.version = ++version_;
+          return;
+        }
+        if (pending_.size() < config_.max_pending)
+        {
+          pending_.emplace(key, Pending{std::move(value), ++version_});
+          order_.push_back(key);
+          wake_.notify_one();
+          return;
+        }
+      }
+
+      // write_through, or the write-back queue is full (backpressure).
+      if (value)
+      {
+        l2_->put(key, *value);
+      }
+      else
+      {
+        l2_->erase(key);
+      }
+    }
+
+    // Writes the oldest queued key. The entry stays visible to get() until
+    // it is in L2; a newer put for the same key during the write requeues it.
+    void run_writer()
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+
+      for (;;)
+      {
+        wake_.wait(lock, [this]
+                   { return stopping_ || !order_.empty(); });
+
+        if (order_.empty())
+        {
+          return; // stopping, nothing left to write
+        }
+
+        const std::string key = order_.front();
+        const Pending job = pending_.at(key);
+        writing_ = true;
+        lock.unlock();
+
+        try
+        {
+          if (job.value)
+          {
+            l2_->put(key, *job.value);
+          }
+          else
+          {
+            l2_->erase(key);
+          }
+          writeBacks_.fetch_add(1, std::memory_order_relaxed);
+        }
+        catch (...)
+        {
+          writeBackErrors_.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        lock.lock();
+        writing_ = false;
+
+        // clear() may have emptied the queue meanwhile.
+        if (!order_.empty() && order_.front() == key)
+        {
+          order_.pop_front();
+          const auto it = pending_.find(key);
+          if (it != pending_.end())
+          {
+            if (it->second.version == job.version)
+            {
+              pending_.erase(it);
+            }
+            else
+            {
+              order_.push_back(key);
+            }
+          }
+        }
+
+        idle_.notify_all();
+      }
+    }
+
+    std::shared_ptr<vix::cache::CacheStore> l1_;
+    std::shared_ptr<vix::cache::CacheStore> l2_;
+    Config config_;
+
+    std::atomic<std::uint64_t> l1Hits_{0};
+    std::atomic<std::uint64_t> l2Hits_{0};
+    std::atomic<std::uint64_t> misses_{0};
+    std::atomic<std::uint64_t> promotions_{0};
+    std::atomic<std::uint64_t> writeBacks_{0};
+    std::atomic<std::uint64_t> writeBackErrors_{0};
+
+    mutable std::array<Stripe, stripe_count> stripes_;
+
+    mutable std::mutex mutex_;
+    std::condition_variable wake_;
+    std::condition_variable idle_;
+    std::unordered_map<std::string, Pending> pending_;
+    std::deque<std::string> order_;
+    std::uint64_t version_{0};
+    bool writing_{false};
+    bool stopping_{false};
+    std::thread worker_;
+  };
+} // namespace vix_examples::cache
+
+#endif // VIX_EXAMPLES_CACHE_TIERED_STORE_HPP
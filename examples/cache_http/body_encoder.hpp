@@ -0,0 +1,125 @@
+/**
+ *
+ *  @file body_encoder.hpp
+ *  @author Gaspard Kirira
+ *
+ *  Copyright 2025, Gaspard Kirira.
+ *  All rights reserved.
+ *  https://github.com/vixcpp/vix
+ *
+ *  Use of this source code is governed by a MIT license
+ *  that can be found in the License file.
+ *
+ *  Vix.cpp
+ *
+ */
+#ifndef VIX_EXAMPLES_CACHE_HTTP_BODY_ENCODER_HPP
+#define VIX_EXAMPLES_CACHE_HTTP_BODY_ENCODER_HPP
+
+// One-shot Content-Encoding for bodies that are compressed once at cache
+// fill time and replayed many times.
+//
+// gzip needs zlib (VIX_EXAMPLE_WITH_ZLIB), br needs the brotli encoder
+// (VIX_EXAMPLE_WITH_BROTLI). encode() returns nullopt for anything this
+// build cannot produce.
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+
+#if defined(VIX_EXAMPLE_WITH_ZLIB)
+#include <zlib.h>
+#endif
+
+#if defined(VIX_EXAMPLE_WITH_BROTLI)
+#include <brotli/encode.h>
+#endif
+
+namespace vix_examples::cache_http
+{
+  struct EncodeOptions
+  {
+    int gzip_level{6};
+    int brotli_quality{5}; // 11 is smallest but far slower
+  };
+
+  inline bool can_encode(std::string_view encoding) noexcept
+  {
+#if defined(VIX_EXAMPLE_WITH_ZLIB)
+    if (encoding == "gzip")
+    {
+      return true;
+    }
+#endif
+#if defined(VIX_EXAMPLE_WITH_BROTLI)
+    if (encoding == "br")
+    {
+      return true;
+    }
+#endif
+    (void)encoding;
+    return false;
+  }
+
+  inline std::optional<std::string> encode(std::string_view encoding,
+                                           std::string_view input,
+                                           const EncodeOptions &options = {})
+  {
+#if defined(VIX_EXAMPLE_WITH_ZLIB)
+    if (encoding == "gzip")
+    {
+      z_stream zs{};
+      // 15 + 16: gzip wrapper.
+      if (deflateInit2(&zs, options.gzip_level, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+      {
+        return std::nullopt;
+      }
+
+      std::string out(deflateBound(&zs, static_cast<uLong>(input.size())), '\0');
+      zs.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(input.data()));
+      zs.avail_in = static_cast<uInt>(input.size());
+      zs.next_out = reinterpret_cast<Bytef *>(out.data());
+      zs.avail_out = static_cast<uInt>(out.size());
+
+      const int rc = deflate(&zs, Z_FINISH);
+      out.resize(zs.total_out);
+      deflateEnd(&zs);
+
+      if (rc != Z_STREAM_END)
+      {
+        return std::nullopt;
+      }
+      return out;
+    }
+#endif
+
+#if defined(VIX_EXAMPLE_WITH_BROTLI)
+    if (encoding == "br")
+    {
+      std::size_t size = BrotliEncoderMaxCompressedSize(input.size());
+      if (size == 0)
+      {
+        return std::nullopt;
+      }
+
+      std::string out(size, '\0');
+      if (!BrotliEncoderCompress(options.brotli_quality, BROTLI_DEFAULT_WINDOW, BROTLI_MODE_TEXT,
+                                 input.size(), reinterpret_cast<const std::uint8_t *>(input.data()),
+                                 &size, reinterpret_cast<std::uint8_t *>(out.data())))
+      {
+        return std::nullopt;
+      }
+      out.resize(size);
+      return out;
+    }
+#endif
+
+    (void)encoding;
+    (void)input;
+    (void)options;
+    return std::nullopt;
+  }
+} // namespace vix_examples::cache_http
+
+#endif // VIX_EXAMPLES_CACHE_HTTP_BODY_ENCODER_HPP
@@ -0,0 +1,943 @@
+/**
+ *
+ *  @file coalescing_http_cache.hpp
+ *  @author Gaspard Kirira
+ *
+ *  Copyright 2025, Gaspard Kirira.
+ *  All rights reserved.
+ *  https://github.com/vixcpp/vix
+ *
+ *  Use of this source code is governed by a MIT license
+ *  that can be found in the License file.
+ *
+ *  Vix.cpp
+ *
+ */
+#ifndef VIX_EXAMPLES_CACHE_HTTP_COALESCING_HTTP_CACHE_HPP
+#define VIX_EXAMPLES_CACHE_HTTP_COALESCING_HTTP_CACHE_HPP
+
+// HTTP response cache for vix::App with request coalescing and
+// stale-while-revalidate.
+//
+// Same shape as middleware::app::http_cache (GET only, bypass header,
+// vary headers, status header), plus:
+//
+// - Single-flight: when a key is missing or fully expired, the first
+//   request runs the handler; concurrent requests for the same key wait
+//   for its response instead of running the handler too
+//   (x-vix-cache-status: coalesced).
+//
+// - stale-while-revalidate: for `stale_while_revalidate_ms` after the TTL
+//   (or the handler's own `Cache-Control: max-age=N,
+//   stale-while-revalidate=M`) the stale entry is served right away
+//   (x-vix-cache-status: stale) and one refresh runs in the background.
+//   Without a `refresh` callback the first stale request refreshes inline
+//   while the others keep getting the stale copy.
+//
+// Waiting requests block their executor thread, as the handler would
+// have; `coalesce_timeout` bounds the wait.
+//
+// Work that would otherwise repeat on every hit is done once at fill
+// time: a strong ETag (If-None-Match gets a 304 straight from the cache)
+// and, with `precompress`, gzip/br copies stored as sibling entries. A hit
+// picks the variant matching Accept-Encoding and replays it as is, so
+// neither the etag() nor the compression() middleware has to run.
+//
+// Entries are indexed by tag and key prefix (../cache/tag_index_store.hpp),
+// so a write handler can drop exactly what it changed:
+//
+//   tag_response(req, "user:42");            // in the GET handler
+//   cache->invalidate_tag("user:42");         // after the write
+//   cache->invalidate_prefix("GET /api/products");
+//
+// A fill whose handler ran before an invalidation is served but not
+// stored, so a slow read cannot put pre-write data back.
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <condition_variable>
+#include <cstdlib>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include <vix.hpp>
+#include <vix/cache/CacheEntry.hpp>
+#include <vix/cache/CacheStore.hpp>
+#include <vix/cache/LruMemoryStore.hpp>
+
+#include "../cache/tag_index_store.hpp"
+#include "body_encoder.hpp"
+
+namespace vix_examples::cache_http
+{
+  // What a background refresh needs to rebuild a response.
+  struct RefreshRequest
+  {
+    std::string key;
+    std::string method;
+    std::string target;
+    std::map<std::string, std::string> vary; // vary header -> request value
+    std::vector<std::string> tags;           // tags of the stale entry, kept if refresh sets none
+  };
+
+  // Invalidation tags for the response being built; the middleware reads
+  // them from request state after the handler returns.
+  struct CacheTags
+  {
+    std::vector<std::string> tags;
+  };
+
+  inline void tag_response(vix::Request &req, std::string tag)
+  {
+    if (auto *current = req.state().try_get<CacheTags>())
+    {
+      current->tags.push_back(std::move(tag));
+      return;
+    }
+    req.state().set(CacheTags{{std::move(tag)}});
+  }
+
+  struct CoalescingCacheConfig
+  {
+    bool only_get{true};
+    std::int64_t ttl_ms{30'000};
+    std::int64_t stale_while_revalidate_ms{0};
+    bool honor_cache_control{true}; // max-age, stale-while-revalidate, no-store, private
+
+    bool allow_bypass{true};
+    std::string bypass_header{"x-vix-cache"};
+    std::string bypass_value{"bypass"};
+    std::vector<std::string> vary_headers{};
+
+    std::chrono::milliseconds coalesce_timeout{5'000};
+
+    std::shared_ptr<vix::cache::CacheStore> store{}; // wrapped in a TaggedStore unless it is one
+
+    // Background work, e.g. [&app](auto fn) { app.executor().post(std::move(fn)); }
+    std::function<void(std::function<void()>)> schedule{};
+
+    // Rebuilds an entry off the request path; nullopt keeps the stale one.
+    std::function<std::optional<vix::cache::CacheEntry>(const RefreshRequest &)> refresh{};
+
+    bool etag{true};                          // strong ETag unless the handler set one
+    std::vector<std::string> precompress{};   // e.g. {"br", "gzip"}, in preference order
+    std::size_t precompress_min_size{1024};
+    EncodeOptions encode_options{};
+
+    bool add_debug_header{true};
+    std::string debug_header{"x-vix-cache-status"};
+  };
+
+  struct CoalescingCacheMetrics
+  {
+    std::uint64_t hits{0};
+    std::uint64_t misses{0};
+    std::uint64_t coalesced{0};
+    std::uint64_t stale{0};
+    std::uint64_t bypass{0};
+    std::uint64_t refreshes{0};
+    std::uint64_t refresh_failures{0};
+    std::uint64_t coalesce_timeouts{0};
+    std::uint64_t not_modified{0};   // 304 from the cache
+    std::uint64_t encoded_hits{0};   // served a precompressed variant
+    std::uint64_t invalidated{0};    // entries removed by tag or prefix
+    std::uint64_t dropped_fills{0};  // fills that lost a race with an invalidation
+  };
+
+  class CoalescingHttpCache : public std::enable_shared_from_this<CoalescingHttpCache>
+  {
+  public:
+    static std::shared_ptr<CoalescingHttpCache> create(CoalescingCacheConfig config)
+    {
+      return std::shared_ptr<CoalescingHttpCache>(new CoalescingHttpCache(std::move(config)));
+    }
+
+    // Middleware for app.use(prefix, ...).
+    std::function<void(vix::Request &, vix::Response &, vix::App::Next)> middleware()
+    {
+      return [self = shared_from_this()](vix::Request &req, vix::Response &res, vix::App::Next next)
+      {
+        self->handle(req, res, std::move(next));
+      };
+    }
+
+    [[nodiscard]] CoalescingCacheMetrics metrics() const noexcept
+    {
+      CoalescingCacheMetrics out;
+      out.hits = counters_.hits.load(std::memory_order_relaxed);
+      out.misses = counters_.misses.load(std::memory_order_relaxed);
+      out.coalesced = counters_.coalesced.load(std::memory_order_relaxed);
+      out.stale = counters_.stale.load(std::memory_order_relaxed);
+      out.bypass = counters_.bypass.load(std::memory_order_relaxed);
+      out.refreshes = counters_.refreshes.load(std::memory_order_relaxed);
+      out.refresh_failures = counters_.refresh_failures.load(std::memory_order_relaxed);
+      out.coalesce_timeouts = counters_.coalesce_timeouts.load(std::memory_order_relaxed);
+      out.not_modified = counters_.not_modified.load(std::memory_order_relaxed);
+      out.encoded_hits = counters_.encoded_hits.load(std::memory_order_relaxed);
+
+      const auto index = index_->stats();
+      out.invalidated = index.invalidated;
+      out.dropped_fills = index.dropped_fills;
+      return out;
+    }
+
+    void erase(const std::string &key)
+    {
+      config_.store->erase(key);
+      for (const auto &encoding : config_.precompress)
+      {
+        config_.store->erase(variant_key(key, encoding));
+      }
+    }
+
+    // Both cover the precompressed variants too: they carry the same tags,
+    // and their keys extend the identity key.
+    std::size_t invalidate_tag(std::string_view tag)
+    {
+      return index_->invalidate_tag(tag);
+    }
+
+    std::size_t invalidate_prefix(std::string_view prefix)
+    {
+      return index_->invalidate_prefix(prefix);
+    }
+
+  private:
+    // Freshness bounds travel with the entry under these names and are
+    // stripped before replay.
+    static constexpr std::string_view kFreshUntil = "x-vix-cache-fresh-until";
+    static constexpr std::string_view kStaleUntil = "x-vix-cache-stale-until";
+
+    struct Counters
+    {
+      std::atomic<std::uint64_t> hits{0};
+      std::atomic<std::uint64_t> misses{0};
+      std::atomic<std::uint64_t> coalesced{0};
+      std::atomic<std::uint64_t> stale{0};
+      std::atomic<std::uint64_t> bypass{0};
+      std::atomic<std::uint64_t> refreshes{0};
+      std::atomic<std::uint64_t> refresh_failures{0};
+      std::atomic<std::uint64_t> coalesce_timeouts{0};
+      std::atomic<std::uint64_t> not_modified{0};
+      std::atomic<std::uint64_t> encoded_hits{0};
+    };
+
+    // One fill: the identity entry and its encoded copies.
+    struct Prepared
+    {
+      vix::cache::CacheEntry identity;
+      std::vector<std::pair<std::string, vix::cache::CacheEntry>> variants;
+    };
+
+    // One in-flight handler run; followers wait on it.
+    struct Flight
+    {
+      std::mutex mutex;
+      std::condition_variable cv;
+      bool done{false};
+      std::shared_ptr<const Prepared> prepared;
+    };
+
+    explicit CoalescingHttpCache(CoalescingCacheConfig config)
+        : config_(std::move(config))
+    {
+      if (!config_.store)
+      {
+        config_.store = std::make_shared<vix::cache::LruMemoryStore>(
+            vix::cache::LruMemoryStore::Config{.max_entries = 1024});
+      }
+
+      index_ = std::dynamic_pointer_cast<vix_examples::cache::TaggedStore>(config_.store);
+      if (!index_)
+      {
+        index_ = std::make_shared<vix_examples::cache::TaggedStore>(config_.store);
+        config_.store = index_;
+      }
+    }
+
+    static std::int64_t now_ms()
+    {
+      using namespace std::chrono;
+      return duration_cast<milliseconds>(system_clock::now().time_since_epoch()).count();
+    }
+
+    static std::string lower(std::string_view s)
+    {
+      std::string out(s);
+      std::transform(out.begin(), out.end(), out.begin(), [](unsigned char c)
+                     { return static_cast<char>(std::tolower(c)); });
+      return out;
+    }
+
+    static std::int64_t header_ms(const vix::cache::CacheEntry &entry, std::string_view name)
+    {
+      const auto it = entry.headers.find(std::string(name));
+      return it == entry.headers.end() ? 0 : std::stoll(it->second);
+    }
+
+    // Reads a `name=N` directive in seconds; -1 when absent.
+    static std::int64_t directive_seconds(const std::string &cacheControl, std::string_view name)
+    {
+      const std::size_t at = cacheControl.find(name);
+      if (at == std::string::npos || cacheControl.size() <= at + name.size() || cacheControl[at + name.size()] != '=')
+      {
+        return -1;
+      }
+      try
+      {
+        return std::stoll(cacheControl.substr(at + name.size() + 1));
+      }
+      catch (...)
+      {
+        return -1;
+      }
+    }
+
+    RefreshRequest describe(const vix::Request &req) const
+    {
+      RefreshRequest out;
+      out.method = req.method();
+      out.target = req.target();
+      out.key = out.method + " " + out.target;
+
+      for (const auto &name : config_.vary_headers)
+      {
+        const std::string value = req.has_header(name) ? req.header(name) : std::string();
+        out.key += '\n' + lower(name) + ':' + value;
+        out.vary.emplace(lower(name), value);
+      }
+      return out;
+    }
+
+    void set_status_header(vix::Response &res, std::string_view status) const
+    {
+      if (config_.add_debug_header)
+      {
+        res.res.set_header(config_.debug_header, std::string(status));
+      }
+    }
+
+    static std::string variant_key(const std::string &key, std::string_view encoding)
+    {
+      return key + "\nce:" + std::string(encoding);
+    }
+
+    static const std::string *find_header(const vix::cache::CacheEntry &entry, std::string_view name)
+    {
+      for (const auto &[key, value] : entry.headers)
+      {
+        if (key.size() == name.size() && lower(key) == name)
+        {
+          return &value;
+        }
+      }
+      return nullptr;
+    }
+
+    // Precompressed encodings this request accepts, in server preference.
+    std::vector<std::string> accepted_encodings(const vix::Request &req) const
+    {
+      std::vector<std::string> out;
+      if (config_.precompress.empty() || !req.has_header("accept-encoding"))
+      {
+        return out;
+      }
+
+      const std::string header = lower(req.header("accept-encoding"));
+      for (const auto &encoding : config_.precompress)
+      {
+        std::size_t at = 0;
+        while ((at = header.find(encoding, at)) != std::string::npos)
+        {
+          const std::size_t end = at + encoding.size();
+          const bool starts = at == 0 || header[at - 1] == ',' || header[at - 1] == ' ';
+          const bool ends = end == header.size() || header[end] == ',' || header[end] == ';' || header[end] == ' ';
+          if (starts && ends)
+          {
+            // "gzip;q=0" means not acceptable.
+            const std::size_t comma = header.find(',', end);
+            const std::string params = header.substr(end, comma == std::string::npos ? std::string::npos : comma - end);
+            const std::size_t q = params.find("q=");
+            if (q == std::string::npos || std::strtod(params.c_str() + q + 2, nullptr) > 0.0)
+            {
+              out.push_back(encoding);
+            }
+            break;
+          }
+          at = end;
+        }
+      }
+      return out;
+    }
+
+    static bool etag_matches(const std::string &ifNoneMatch, const std::string &etag)
+    {
+      if (ifNoneMatch.find('*') != std::string::npos)
+      {
+        return true;
+      }
+      // Weak comparison, as If-None-Match requires.
+      const std::string_view opaque = std::string_view(etag).substr(etag.rfind("W/", 0) == 0 ? 2 : 0);
+      return ifNoneMatch.find(opaque) != std::string::npos;
+    }
+
+    void replay(const vix::Request &req, vix::Response &res, const vix::cache::CacheEntry &entry, std::string_view status)
+    {
+      const std::string *etag = find_header(entry, "etag");
+      const bool notModified = etag != nullptr && req.has_header("if-none-match") &&
+                               etag_matches(req.header("if-none-match"), *etag);
+
+      res.res.set_status(notModified ? 304 : entry.status);
+      for (const auto &[name, value] : entry.headers)
+      {
+        if (name == kFreshUntil || name == kStaleUntil || name == vix_examples::cache::kCacheTagsHeader)
+        {
+          continue;
+        }
+        if (notModified && (lower(name) == "content-encoding" || lower(name) == "content-length"))
+        {
+          continue;
+        }
+        res.res.set_header(name, value);
+      }
+      res.res.set_body(notModified ? std::string() : entry.body);
+      set_status_header(res, status);
+
+      if (notModified)
+      {
+        counters_.not_modified.fetch_add(1, std::memory_order_relaxed);
+      }
+      else if (status != "miss" && find_header(entry, "content-encoding") != nullptr)
+      {
+        counters_.encoded_hits.fetch_add(1, std::memory_order_relaxed);
+      }
+    }
+
+    // Adds the ETag and builds the encoded copies of a fresh entry.
+    std::shared_ptr<const Prepared> prepare(vix::cache::CacheEntry entry) const
+    {
+      auto out = std::make_shared<Prepared>();
+
+      // The server frames the body; a stored length would be wrong for variants.
+      erase_header(entry, "content-length");
+
+      if (config_.etag && find_header(entry, "etag") == nullptr)
+      {
+        entry.headers["ETag"] = strong_etag(entry.body);
+      }
+
+      const std::string *existing = find_header(entry, "content-encoding");
+      const bool encodable = existing == nullptr || lower(*existing) == "identity";
+
+      if (encodable && entry.body.size() >= config_.precompress_min_size)
+      {
+        for (const auto &encoding : config_.precompress)
+        {
+          if (!can_encode(encoding))
+          {
+            continue;
+          }
+          auto body = encode(encoding, entry.body, config_.encode_options);
+          if (!body || body->size() >= entry.body.size())
+          {
+            continue;
+          }
+
+          vix::cache::CacheEntry variant = entry;
+          variant.body = std::move(*body);
+          variant.headers["Content-Encoding"] = encoding;
+          if (const std::string *etag = find_header(entry, "etag"); etag != nullptr && etag->size() >= 2 && etag->back() == '"')
+          {
+            // Each representation gets its own strong validator.
+            std::string tagged = etag->substr(0, etag->size() - 1) + "-" + encoding + "\"";
+            erase_header(variant, "etag");
+            variant.headers["ETag"] = std::move(tagged);
+          }
+          out->variants.emplace_back(encoding, std::move(variant));
+        }
+      }
+
+      if (!out->variants.empty())
+      {
+        add_vary_accept_encoding(entry);
+        for (auto &[encoding, variant] : out->variants)
+        {
+          add_vary_accept_encoding(variant);
+        }
+      }
+
+      out->identity = std::move(entry);
+      return out;
+    }
+
+    static void erase_header(vix::cache::CacheEntry &entry, std::string_view name)
+    {
+      for (auto it = entry.headers.begin(); it != entry.headers.end();)
+      {
+        it = lower(it->first) == name ? entry.headers.erase(it) : std::next(it);
+      }
+    }
+
+    static void add_vary_accept_encoding(vix::cache::CacheEntry &entry)
+    {
+      for (auto &[name, value] : entry.headers)
+      {
+        if (lower(name) == "vary")
+        {
+          if (lower(value).find("accept-encoding") == std::string::npos)
+          {
+            value += ", Accept-Encoding";
+          }
+          return;
+        }
+      }
+      entry.headers["Vary"] = "Accept-Encoding";
+    }
+
+    // FNV-1a over the body plus its length; strong, since the bytes are exact.
+    static std::string strong_etag(std::string_view body)
+    {
+      std::uint64_t h = 0xcbf29ce484222325ULL;
+      for (const unsigned char c : body)
+      {
+        h = (h ^ c) * 0x100000001b3ULL;
+      }
+
+      static constexpr char digits[] = "0123456789abcdef";
+      std::string out = "\"";
+      for (int shift = 60; shift >= 0; shift -= 4)
+      {
+        out += digits[(h >> shift) & 0xF];
+      }
+      out += '-' + std::to_string(body.size()) + '"';
+      return out;
+    }
+
+    // Stores the identity entry and every variant; variants this fill did
+    // not produce are dropped so no older copy outlives it. `generation` is
+    // the index generation from before the data was read: after any
+    // invalidation the fill is still answered but nothing more is stored
+    // (whatever already was got removed by that invalidation).
+    std::shared_ptr<const Prepared> fill(const std::string &key, vix::cache::CacheEntry entry, std::uint64_t generation)
+    {
+      auto prepared = prepare(std::move(entry));
+
+      for (const auto &encoding : config_.precompress)
+      {
+        const auto it = std::find_if(prepared->variants.begin(), prepared->variants.end(), [&](const auto &v)
+                                     { return v.first == encoding; });
+        if (it == prepared->variants.end())
+        {
+          config_.store->erase(variant_key(key, encoding));
+        }
+        else if (!index_->put_if_unchanged(variant_key(key, encoding), it->second, generation))
+        {
+          return prepared;
+        }
+      }
+      index_->put_if_unchanged(key, prepared->identity, generation);
+
+      return prepared;
+    }
+
+    static const vix::cache::CacheEntry &pick(const Prepared &prepared, const std::vector<std::string> &accepted)
+    {
+      for (const auto &encoding : accepted)
+      {
+        for (const auto &[name, variant] : prepared.variants)
+        {
+          if (name == encoding)
+          {
+            return variant;
+          }
+        }
+      }
+      return prepared.identity;
+    }
+
+    // Best stored variant for this request, identity last.
+    std::optional<vix::cache::CacheEntry> lookup(const std::string &key, const std::vector<std::string> &accepted) const
+    {
+      for (const auto &encoding : accepted)
+      {
+        if (auto variant = config_.store->get(variant_key(key, encoding)))
+        {
+          return variant;
+        }
+      }
+      return config_.store->get(key);
+    }
+
+    // Turns a handler response into an entry, or nullopt when it must not
+    // be cached (non-200, no-store, private). Tags come from CacheTags in
+    // request state.
+    std::optional<vix::cache::CacheEntry> capture(vix::Request &req, const vix::http::Response &raw) const
+    {
+      if (raw.status() != 200)
+      {
+        return std::nullopt;
+      }
+
+      vix::cache::CacheEntry entry;
+      entry.status = raw.status();
+      entry.body = raw.body();
+      entry.created_at_ms = now_ms();
+
+      const std::string debugHeader = lower(config_.debug_header);
+      std::string cacheControl;
+      for (const auto &[name, value] : raw.headers())
+      {
+        if (lower(name) == debugHeader)
+        {
+          continue;
+        }
+        if (lower(name) == "cache-control")
+        {
+          cacheControl = lower(value);
+        }
+        entry.headers[name] = value;
+      }
+
+      if (const auto *tags = req.state().try_get<CacheTags>(); tags && !tags->tags.empty())
+      {
+        set_tags(entry, tags->tags);
+      }
+
+      return stamp(std::move(entry), cacheControl);
+    }
+
+    static void set_tags(vix::cache::CacheEntry &entry, const std::vector<std::string> &tags)
+    {
+      std::string &value = entry.headers[std::string(vix_examples::cache::kCacheTagsHeader)];
+      for (const auto &tag : tags)
+      {
+        value += value.empty() ? tag : "," + tag;
+      }
+    }
+
+    std::optional<vix::cache::CacheEntry> stamp(vix::cache::CacheEntry entry, const std::string &cacheControl) const
+    {
+      std::int64_t ttl = config_.ttl_ms;
+      std::int64_t swr = config_.stale_while_revalidate_ms;
+
+      if (config_.honor_cache_control && !cacheControl.empty())
+      {
+        if (cacheControl.find("no-store") != std::string::npos || cacheControl.find("private") != std::string::npos)
+        {
+          return std::nullopt;
+        }
+        if (const auto s = directive_seconds(cacheControl, "s-maxage"); s >= 0)
+        {
+          ttl = s * 1000;
+        }
+        else if (const auto m = directive_seconds(cacheControl, "max-age"); m >= 0)
+        {
+          ttl = m * 1000;
+        }
+        if (const auto w = directive_seconds(cacheControl, "stale-while-revalidate"); w >= 0)
+        {
+          swr = w * 1000;
+        }
+      }
+
+      if (entry.created_at_ms == 0)
+      {
+        entry.created_at_ms = now_ms();
+      }
+      entry.headers[std::string(kFreshUntil)] = std::to_string(entry.created_at_ms + ttl);
+      entry.headers[std::string(kStaleUntil)] = std::to_string(entry.created_at_ms + ttl + swr);
+      return entry;
+    }
+
+    void handle(vix::Request &req, vix::Response &res, vix::App::Next next)
+    {
+      if (config_.only_get && req.method() != "GET")
+      {
+        next();
+        return;
+      }
+
+      if (config_.allow_bypass && req.has_header(config_.bypass_header) &&
+          req.header(config_.bypass_header) == config_.bypass_value)
+      {
+        counters_.bypass.fetch_add(1, std::memory_order_relaxed);
+        next();
+        set_status_header(res, "bypass");
+        return;
+      }
+
+      RefreshRequest request = describe(req);
+      const std::vector<std::string> accepted = accepted_encodings(req);
+      const std::int64_t now = now_ms();
+
+      if (auto entry = lookup(request.key, accepted))
+      {
+        if (now < header_ms(*entry, kFreshUntil))
+        {
+          counters_.hits.fetch_add(1, std::memory_order_relaxed);
+          replay(req, res, *entry, "hit");
+          return;
+        }
+
+        if (now < header_ms(*entry, kStaleUntil))
+        {
+          auto claim = claim_refresh(request.key);
+          if (!claim)
+          {
+            // Someone is already refreshing.
+            counters_.stale.fetch_add(1, std::memory_order_relaxed);
+            replay(req, res, *entry, "stale");
+            return;
+          }
+
+          if (config_.refresh && config_.schedule)
+          {
+            request.tags = vix_examples::cache::TaggedStore::tags_from(*entry);
+            try
+            {
+              schedule_refresh(std::move(request), std::move(claim));
+            }
+            catch (...)
+            {
+              // Executor full or shut down: still serve the stale copy.
+              counters_.refresh_failures.fetch_add(1, std::memory_order_relaxed);
+            }
+            counters_.stale.fetch_add(1, std::memory_order_relaxed);
+            replay(req, res, *entry, "stale");
+            return;
+          }
+
+          // No background loader: this request refreshes inline; the claim
+          // is released when it returns or throws.
+          counters_.refreshes.fetch_add(1, std::memory_order_relaxed);
+          run_origin(req, request.key, accepted, res, next);
+          return;
+        }
+      }
+
+      coalesce(req, request.key, accepted, res, next);
+    }
+
+    // Leader runs the handler; followers wait for its entry.
+    void coalesce(vix::Request &req,
+                  const std::string &key,
+                  const std::vector<std::string> &accepted,
+                  vix::Response &res,
+                  vix::App::Next &next)
+    {
+      std::shared_ptr<Flight> flight;
+      bool leader = false;
+      {
+        std::lock_guard<std::mutex> lock(flightsMutex_);
+        auto &slot = flights_[key];
+        if (!slot)
+        {
+          slot = std::make_shared<Flight>();
+          leader = true;
+        }
+        flight = slot;
+      }
+
+      if (leader)
+      {
+        // Publishes even if the handler throws, so followers never hang.
+        struct Publish
+        {
+          CoalescingHttpCache &cache;
+          const std::string &key;
+          Flight &flight;
+          std::shared_ptr<const Prepared> prepared;
+
+          ~Publish()
+          {
+            {
+              std::lock_guard<std::mutex> lock(cache.flightsMutex_);
+              cache.flights_.erase(key);
+            }
+            {
+              std::lock_guard<std::mutex> lock(flight.mutex);
+              flight.prepared = std::move(prepared);
+              flight.done = true;
+            }
+            flight.cv.notify_all();
+          }
+        } publish{*this, key, *flight, nullptr};
+
+        publish.prepared = run_origin(req, key, accepted, res, next);
+        return;
+      }
+
+      std::shared_ptr<const Prepared> prepared;
+      bool done = false;
+      {
+        std::unique_lock<std::mutex> lock(flight->mutex);
+        done = flight->cv.wait_for(lock, config_.coalesce_timeout, [&]
+                                   { return flight->done; });
+        if (done)
+        {
+          prepared = flight->prepared;
+        }
+      }
+
+      if (prepared)
+      {
+        counters_.coalesced.fetch_add(1, std::memory_order_relaxed);
+        replay(req, res, pick(*prepared, accepted), "coalesced");
+        return;
+      }
+
+      // Timed out, or the leader's response was not cacheable.
+      if (!done)
+      {
+        counters_.coalesce_timeouts.fetch_add(1, std::memory_order_relaxed);
+      }
+      counters_.misses.fetch_add(1, std::memory_order_relaxed);
+      next();
+      set_status_header(res, "miss");
+    }
+
+    // Runs the handler and, when cacheable, answers with the prepared
+    // variant this client accepts (or a 304).
+    std::shared_ptr<const Prepared> run_origin(vix::Request &req,
+                                               const std::string &key,
+                                               const std::vector<std::string> &accepted,
+                                               vix::Response &res,
+                                               vix::App::Next &next)
+    {
+      counters_.misses.fetch_add(1, std::memory_order_relaxed);
+      const std::uint64_t generation = index_->generation();
+      next();
+
+      auto entry = capture(req, res.res);
+      if (!entry)
+      {
+        set_status_header(res, "miss");
+        return nullptr;
+      }
+
+      auto prepared = fill(key, std::move(*entry), generation);
+      replay(req, res, pick(*prepared, accepted), "miss");
+      return prepared;
+    }
+
+    // Holds a key in refreshing_ until the last owner goes away: the
+    // inline refresh returned or threw, or the scheduled task ran or was
+    // dropped without running.
+    struct RefreshClaim
+    {
+      std::shared_ptr<CoalescingHttpCache> cache;
+      std::string key;
+
+      RefreshClaim(std::shared_ptr<CoalescingHttpCache> c, std::string k)
+          : cache(std::move(c)),
+            key(std::move(k))
+      {
+      }
+
+      RefreshClaim(const RefreshClaim &) = delete;
+      RefreshClaim &operator=(const RefreshClaim &) = delete;
+
+      ~RefreshClaim() { release(); }
+
+      // Once the task has run; an executor may keep its copy a while.
+      void release()
+      {
+        if (!released.exchange(true))
+        {
+          cache->release_refresh(key);
+        }
+      }
+
+      std::atomic<bool> released{false};
+    };
+
+    // Null when another request or task is already refreshing `key`.
+    std::shared_ptr<RefreshClaim> claim_refresh(const std::string &key)
+    {
+      {
+        std::lock_guard<std::mutex> lock(refreshMutex_);
+        if (!refreshing_.insert(key).second)
+        {
+          return nullptr;
+        }
+      }
+      return std::make_shared<RefreshClaim>(shared_from_this(), key);
+    }
+
+    void release_refresh(const std::string &key)
+    {
+      std::lock_guard<std::mutex> lock(refreshMutex_);
+      refreshing_.erase(key);
+    }
+
+    // The task shares `claim`, so a scheduler that throws or drops the task
+    // still frees the key for the next stale hit.
+    void schedule_refresh(RefreshRequest request, std::shared_ptr<RefreshClaim> claim)
+    {
+      counters_.refreshes.fetch_add(1, std::memory_order_relaxed);
+
+      config_.schedule([self = shared_from_this(), request = std::move(request), claim = std::move(claim)]()
+                       {
+                         try
+                         {
+                           const std::uint64_t generation = self->index_->generation();
+                           auto entry = self->config_.refresh(request);
+                           std::string cacheControl;
+                           if (entry)
+                           {
+                             for (const auto &[name, value] : entry->headers)
+                             {
+                               if (lower(name) == "cache-control")
+                               {
+                                 cacheControl = lower(value);
+                               }
+                             }
+                             if (!request.tags.empty() && !entry->headers.count(std::string(vix_examples::cache::kCacheTagsHeader)))
+                             {
+                               set_tags(*entry, request.tags);
+                             }
+                             entry->created_at_ms = now_ms();
+                             entry = self->stamp(std::move(*entry), cacheControl);
+                           }
+
+                           if (entry)
+                           {
+                             self->fill(request.key, std::move(*entry), generation);
+                           }
+                           else
+                           {
+                             self->counters_.refresh_failures.fetch_add(1, std::memory_order_relaxed);
+                           }
+                         }
+                         catch (...)
+                         {
+                           self->counters_.refresh_failures.fetch_add(1, std::memory_order_relaxed);
+                         }
+                         claim->release(); });
+    }
+
+    CoalescingCacheConfig config_;
+    std::shared_ptr<vix_examples::cache::TaggedStore> index_; // same object as config_.store
+    Counters counters_;
+
+    std::mutex flightsMutex_;
+    std::unordered_map<std::string, std::shared_ptr<Flight>> flights_;
+
+    std::mutex refreshMutex_;
+    std::unordered_set<std::string> refreshing_;
+  };
+} // namespace vix_examples::cache_http
+
+#endif // VIX_EXAMPLES_CACHE_HTTP_COALESCING_HTTP_CACHE_HPP
@@ -0,0 +1,149 @@
+/**
+ *
+ *  @file  http_cache_app_coalescing.cpp — HTTP Cache (Single-flight + stale-while-revalidate)
+ *  @author Gaspard Kirira
+ *
+ *  Copyright 2025, Gaspard Kirira.  All rights reserved.
+ *  https://github.com/vixcpp/vix
+ *  Use of this source code is governed by a MIT license
+ *  that can be found in the License file.
+ *
+ *  Vix.cpp
+ *
+ */
+// Run:
+//   vix run examples/cache_http/http_cache_app_coalescing.cpp
+//
+// Test:
+//   # 20 concurrent cold requests -> 1 miss, 19 coalesced, 1 handler run
+//   seq 20 | xargs -P20 -I{} curl -s -o /dev/null -D - "http://localhost:8080/api/users" | grep -i x-vix-cache-status | sort | uniq -c
+//
+//   # after 2 s the entry is stale for 10 s: served immediately, refreshed in the background
+//   sleep 3; curl -i "http://localhost:8080/api/users"        # x-vix-cache-status: stale
+//   curl -i "http://localhost:8080/api/users"                 # hit (refreshed copy)
+//
+//   # precompressed variant and 304 straight from the cache
+//   curl -s -o /dev/null -D - -H "Accept-Encoding: br, gzip" "http://localhost:8080/api/users"
+//   curl -i -H 'If-None-Match: "<etag from above>"' "http://localhost:8080/api/users"
+//
+//   # a write drops every entry tagged "users" (all encodings, all query variants)
+//   curl -s -X POST "http://localhost:8080/api/users"          # {"ok":true,"invalidated":N}
+//   curl -i "http://localhost:8080/api/users"                 # miss
+//
+//   # counters
+//   curl -s "http://localhost:8080/_cache/metrics"
+//
+// Notes:
+// - The route and the background refresh share load_users(), so a refresh
+//   never needs a live request.
+// - /api/feed sets its own Cache-Control: max-age=1, stale-while-revalidate=30,
+//   which overrides the configured TTL and stale window.
+// ============================================================================
+
+#include <atomic>
+#include <chrono>
+#include <optional>
+#include <string>
+#include <thread>
+
+#include <vix.hpp>
+
+#include "coalescing_http_cache.hpp"
+
+using namespace vix;
+using vix_examples::cache_http::CoalescingHttpCache;
+using vix_examples::cache_http::RefreshRequest;
+using vix_examples::cache_http::tag_response;
+
+static std::atomic<int> origin_calls{0};
+
+// The expensive part: a slow database query.
+static std::string load_users()
+{
+  origin_calls.fetch_add(1);
+  std::this_thread::sleep_for(std::chrono::milliseconds(250));
+  return R"({"ok":true,"users":["ada","grace","linus"],"origin_calls":)" +
+         std::to_string(origin_calls.load()) + "}";
+}
+
+static std::string load_feed()
+{
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  return R"({"ok":true,"feed":"latest"})";
+}
+
+static constexpr const char *feed_cache_control = "public, max-age=1, stale-while-revalidate=30";
+
+int main()
+{
+  App app;
+
+  auto cache = CoalescingHttpCache::create({
+      .ttl_ms = 2'000,
+      .stale_while_revalidate_ms = 10'000,
+      .schedule = [&app](std::function<void()> fn)
+      { app.executor().post(std::move(fn)); },
+      .refresh = [](const RefreshRequest &request) -> std::optional<vix::cache::CacheEntry>
+      {
+        vix::cache::CacheEntry entry;
+        entry.status = 200;
+        entry.headers["Content-Type"] = "application/json";
+
+        if (request.target == "/api/users")
+        {
+          entry.body = load_users();
+        }
+        else if (request.target == "/api/feed")
+        {
+          entry.headers["Cache-Control"] = feed_cache_control;
+          entry.body = load_feed();
+        }
+        else
+        {
+          return std::nullopt; // keep serving the stale copy
+        }
+        return entry;
+      },
+      // gzip/br copies built once per fill; needs VIX_EXAMPLE_WITH_ZLIB / _BROTLI.
+      .precompress = {"br", "gzip"},
+  });
+
+  app.use("/api", cache->middleware());
+
+  app.get("/api/users", [](Request &req, Response &res)
+          {
+            tag_response(req, "users");
+            res.res.set_header("Content-Type", "application/json");
+            res.res.set_body(load_users()); });
+
+  app.get("/api/feed", [](Request &, Response &res)
+          {
+            res.res.set_header("Content-Type", "application/json");
+            res.res.set_header("Cache-Control", feed_cache_control);
+            res.res.set_body(load_feed()); });
+
+  // Not cached (GET only); invalidates what the GET routes tagged.
+  app.post("/api/users", [cache](Request &, Response &res)
+           {
+             const auto dropped = cache->invalidate_tag("users");
+             res.json({"ok", true, "invalidated", dropped}); });
+
+  app.get("/_cache/metrics", [cache](Request &, Response &res)
+          {
+            const auto m = cache->metrics();
+            res.json({"hits", m.hits,
+                      "misses", m.misses,
+                      "coalesced", m.coalesced,
+                      "stale", m.stale,
+                      "bypass", m.bypass,
+                      "refreshes", m.refreshes,
+                      "refresh_failures", m.refresh_failures,
+                      "not_modified", m.not_modified,
+                      "encoded_hits", m.encoded_hits,
+                      "invalidated", m.invalidated,
+                      "dropped_fills", m.dropped_fills,
+                      "origin_calls", origin_calls.load()}); });
+
+  app.run(8080);
+  return 0;
+}
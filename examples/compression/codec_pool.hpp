@@ -0,0 +1,711 @@
+/**
+ *
+ *  @file codec_pool.hpp
+ *  @author Gaspard Kirira
+ *
+ *  Copyright 2025, Gaspard Kirira.
+ *  All rights reserved.
+ *  https://github.com/vixcpp/vix
+ *
+ *  Use of this source code is governed by a MIT license
+ *  that can be found in the License file.
+ *
+ *  Vix.cpp
+ *
+ */
+#ifndef VIX_EXAMPLES_COMPRESSION_CODEC_POOL_HPP
+#define VIX_EXAMPLES_COMPRESSION_CODEC_POOL_HPP
+
+// Streaming Content-Encoding encoders, recycled per thread.
+//
+// Setting up a compressor costs more than compressing a small JSON body:
+// deflateInit2 allocates about 256 KiB, a brotli encoder allocates its
+// ring buffer and hash tables, and a zstd context allocates its tables.
+// CodecPool keeps finished encoders on the thread that used them. The next
+// response then reuses them: deflateReset for gzip, a session reset for
+// zstd. Brotli has no reset, so its encoder is rebuilt for each stream.
+// Its allocations go through a per-thread block cache that hands the same
+// blocks back.
+//
+// gzip needs zlib (VIX_EXAMPLE_WITH_ZLIB), br needs the brotli encoder
+// (VIX_EXAMPLE_WITH_BROTLI), zstd needs libzstd (VIX_EXAMPLE_WITH_ZSTD).
+
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <memory>
+#include <span>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#if defined(VIX_EXAMPLE_WITH_ZLIB)
+#include <zlib.h>
+#endif
+
+#if defined(VIX_EXAMPLE_WITH_BROTLI)
+#include <brotli/encode.h>
+#endif
+
+#if defined(VIX_EXAMPLE_WITH_ZSTD)
+#include <zstd.h>
+#endif
+
+namespace vix_examples::compression
+{
+  enum class Encoding
+  {
+    identity,
+    gzip,
+    br,
+    zstd,
+  };
+
+  inline constexpr std::size_t kEncodingCount = 4;
+
+  inline std::string_view to_string(Encoding encoding) noexcept
+  {
+    switch (encoding)
+    {
+    case Encoding::gzip:
+      return "gzip";
+    case Encoding::br:
+      return "br";
+    case Encoding::zstd:
+      return "zstd";
+    case Encoding::identity:
+      break;
+    }
+    return "identity";
+  }
+
+  // Whether this build can produce `encoding`.
+  inline bool available(Encoding encoding) noexcept
+  {
+    switch (encoding)
+    {
+    case Encoding::identity:
+      return true;
+#if defined(VIX_EXAMPLE_WITH_ZLIB)
+    case Encoding::gzip:
+      return true;
+#endif
+#if defined(VIX_EXAMPLE_WITH_BROTLI)
+    case Encoding::br:
+      return true;
+#endif
+#if defined(VIX_EXAMPLE_WITH_ZSTD)
+    case Encoding::zstd:
+      return true;
+#endif
+    default:
+      return false;
+    }
+  }
+
+  namespace detail
+  {
+    inline bool iequals(std::string_view a, std::string_view b) noexcept
+    {
+      if (a.size() != b.size())
+      {
+        return false;
+      }
+      for (std::size_t i = 0; i < a.size(); ++i)
+      {
+        if (std::tolower(static_cast<unsigned char>(a[i])) != std::tolower(static_cast<unsigned char>(b[i])))
+        {
+          return false;
+        }
+      }
+      return true;
+    }
+
+    inline std::string_view trim(std::string_view s) noexcept
+    {
+      const auto first = s.find_first_not_of(" \t");
+      if (first == std::string_view::npos)
+      {
+        return {};
+      }
+      return s.substr(first, s.find_last_not_of(" \t") - first + 1);
+    }
+
+    // q-value of one Accept-Encoding element; malformed values count as 1.
+    inline double qvalue(std::string_view params) noexcept
+    {
+      while (!params.empty())
+      {
+        const auto semi = params.find(';');
+        const std::string_view param = trim(params.substr(0, semi));
+        params = semi == std::string_view::npos ? std::string_view{} : params.substr(semi + 1);
+
+        if (param.size() >= 2 && (param[0] == 'q' || param[0] == 'Q') && param[1] == '=')
+        {
+          const std::string value(param.substr(2));
+          char *end = nullptr;
+          const double q = std::strtod(value.c_str(), &end);
+          return end == value.c_str() ? 1.0 : q;
+        }
+      }
+      return 1.0;
+    }
+  } // namespace detail
+
+  // Picks the encoding to use for an Accept-Encoding header. The highest
+  // q-value wins; ties go to the first entry of `preference`. "q=0" refuses
+  // an encoding and "*" stands for anything not listed.
+  inline Encoding negotiate(std::string_view accept_encoding, std::span<const Encoding> preference)
+  {
+    Encoding best = Encoding::identity;
+    double bestQ = 0.0;
+
+    for (const Encoding candidate : preference)
+    {
+      if (candidate == Encoding::identity || !available(candidate))
+      {
+        continue;
+      }
+
+      double q = -1.0;     // not listed
+      double starQ = -1.0; // "*"
+      std::string_view rest = accept_encoding;
+      while (!rest.empty())
+      {
+        const auto comma = rest.find(',');
+        const std::string_view element = rest.substr(0, comma);
+        rest = comma == std::string_view::npos ? std::string_view{} : rest.substr(comma + 1);
+
+        const auto semi = element.find(';');
+        const std::string_view name = detail::trim(element.substr(0, semi));
+        const double value = semi == std::string_view::npos ? 1.0 : detail::qvalue(element.substr(semi + 1));
+
+        if (detail::iequals(name, to_string(candidate)))
+        {
+          q = value;
+        }
+        else if (name == "*")
+        {
+          starQ = value;
+        }
+      }
+
+      if (q < 0.0)
+      {
+        q = starQ;
+      }
+      if (q > bestQ)
+      {
+        best = candidate;
+        bestQ = q;
+      }
+    }
+    return best;
+  }
+
+  inline Encoding negotiate(std::string_view accept_encoding)
+  {
+    static constexpr Encoding kPreference[] = {Encoding::zstd, Encoding::br, Encoding::gzip};
+    return negotiate(accept_encoding, kPreference);
+  }
+
+  namespace detail
+  {
+    // Recycles fixed-size heap blocks on one thread. A brotli encoder at a
+    // given quality and window asks for the same few block sizes on every
+    // stream. Handing back the previous stream's blocks avoids a malloc for
+    // each one, and for large blocks the mmap and page faults behind it.
+    class BlockCache
+    {
+    public:
+      static constexpr std::size_t kMaxCachedBytes = 32u << 20;
+
+      BlockCache() = default;
+      BlockCache(const BlockCache &) = delete;
+      BlockCache &operator=(const BlockCache &) = delete;
+
+      ~BlockCache()
+      {
+        for (const auto &[size, block] : free_)
+        {
+          std::free(block);
+        }
+      }
+
+      void *take(std::size_t size)
+      {
+        for (std::size_t i = free_.size(); i-- > 0;)
+        {
+          if (free_[i].first == size)
+          {
+            void *block = free_[i].second;
+            free_[i] = free_.back();
+            free_.pop_back();
+            cached_ -= size;
+            return static_cast<char *>(block) + kHeader;
+          }
+        }
+
+        void *block = std::malloc(size + kHeader);
+        if (block == nullptr)
+        {
+          return nullptr;
+        }
+        *static_cast<std::size_t *>(block) = size;
+        return static_cast<char *>(block) + kHeader;
+      }
+
+      void give(void *p)
+      {
+        if (p == nullptr)
+        {
+          return;
+        }
+        void *block = static_cast<char *>(p) - kHeader;
+        const std::size_t size = *static_cast<std::size_t *>(block);
+        if (cached_ + size > kMaxCachedBytes)
+        {
+          std::free(block);
+          return;
+        }
+        free_.emplace_back(size, block);
+        cached_ += size;
+      }
+
+    private:
+      static constexpr std::size_t kHeader = alignof(std::max_align_t);
+
+      std::vector<std::pair<std::size_t, void *>> free_;
+      std::size_t cached_{0};
+    };
+
+    inline BlockCache &thread_blocks()
+    {
+      thread_local BlockCache blocks;
+      return blocks;
+    }
+
+#if defined(VIX_EXAMPLE_WITH_BROTLI)
+    inline void *brotli_alloc(void *, std::size_t size)
+    {
+      return thread_blocks().take(size);
+    }
+
+    inline void brotli_free(void *, void *p)
+    {
+      thread_blocks().give(p);
+    }
+#endif
+  } // namespace detail
+
+  // One streaming encoder for any available encoding. begin() starts a
+  // stream, write() appends compressed output to `out`, and finish() ends
+  // the stream. After that, begin() may start another stream on the same
+  // state.
+  class StreamEncoder
+  {
+  public:
+    enum class Flush
+    {
+      none,   // buffer freely
+      sync,   // everything written so far is decodable by the client
+      finish, // end of stream
+    };
+
+    StreamEncoder() = default;
+    StreamEncoder(const StreamEncoder &) = delete;
+    StreamEncoder &operator=(const StreamEncoder &) = delete;
+
+    ~StreamEncoder()
+    {
+#if defined(VIX_EXAMPLE_WITH_ZLIB)
+      if (zlibReady_)
+      {
+        deflateEnd(&zs_);
+      }
+#endif
+      abandon();
+#if defined(VIX_EXAMPLE_WITH_ZSTD)
+      ZSTD_freeCCtx(zstd_);
+#endif
+    }
+
+    // `size_hint` is the expected input size when known (0 = unknown).
+    // Returns false if this build cannot produce `encoding`.
+    bool begin(Encoding encoding, int level, std::size_t size_hint = 0)
+    {
+      abandon();
+      encoding_ = encoding;
+      finished_ = false;
+      (void)level;
+      (void)size_hint;
+
+      switch (encoding)
+      {
+      case Encoding::identity:
+        return true;
+
+#if defined(VIX_EXAMPLE_WITH_ZLIB)
+      case Encoding::gzip:
+        if (!zlibReady_)
+        {
+          // 15 + 16: gzip wrapper.
+          if (deflateInit2(&zs_, level, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+          {
+            return false;
+          }
+          zlibReady_ = true;
+          zlibLevel_ = level;
+        }
+        else
+        {
+          // Keeps the window and hash buffers from the previous stream.
+          if (deflateReset(&zs_) != Z_OK)
+          {
+            return false;
+          }
+          if (level != zlibLevel_)
+          {
+            if (deflateParams(&zs_, level, Z_DEFAULT_STRATEGY) != Z_OK)
+            {
+              return false;
+            }
+            zlibLevel_ = level;
+          }
+        }
+        ++streams_;
+        return true;
+#endif
+
+#if defined(VIX_EXAMPLE_WITH_BROTLI)
+      case Encoding::br:
+        br_ = BrotliEncoderCreateInstance(&detail::brotli_alloc, &detail::brotli_free, nullptr);
+        if (br_ == nullptr)
+        {
+          return false;
+        }
+        BrotliEncoderSetParameter(br_, BROTLI_PARAM_QUALITY, static_cast<std::uint32_t>(level));
+        if (size_hint > 0)
+        {
+          // Lets brotli shrink its ring buffer for small bodies.
+          BrotliEncoderSetParameter(br_, BROTLI_PARAM_SIZE_HINT,
+                                    static_cast<std::uint32_t>(std::min<std::size_t>(size_hint, 1u << 30)));
+        }
+        ++streams_;
+        return true;
+#endif
+
+#if defined(VIX_EXAMPLE_WITH_ZSTD)
+      case Encoding::zstd:
+        if (zstd_ == nullptr && (zstd_ = ZSTD_createCCtx()) == nullptr)
+        {
+          return false;
+        }
+        // Drops the previous frame but keeps the allocated tables.
+        ZSTD_CCtx_reset(zstd_, ZSTD_reset_session_only);
+        if (ZSTD_isError(ZSTD_CCtx_setParameter(zstd_, ZSTD_c_compressionLevel, level)))
+        {
+          return false;
+        }
+        ++streams_;
+        return true;
+#endif
+
+      default:
+        return false;
+      }
+    }
+
+    bool write(std::string_view input, std::string &out, Flush flush = Flush::none)
+    {
+      if (finished_)
+      {
+        return false;
+      }
+      finished_ = flush == Flush::finish;
+
+      switch (encoding_)
+      {
+      case Encoding::identity:
+        out.append(input);
+        return true;
+#if defined(VIX_EXAMPLE_WITH_ZLIB)
+      case Encoding::gzip:
+        return write_gzip(input, out, flush);
+#endif
+#if defined(VIX_EXAMPLE_WITH_BROTLI)
+      case Encoding::br:
+        return write_brotli(input, out, flush);
+#endif
+#if defined(VIX_EXAMPLE_WITH_ZSTD)
+      case Encoding::zstd:
+        return write_zstd(input, out, flush);
+#endif
+      default:
+        return false;
+      }
+    }
+
+    bool finish(std::string &out)
+    {
+      return write({}, out, Flush::finish);
+    }
+
+    // Drops an unfinished stream; the next begin() starts clean.
+    void abandon() noexcept
+    {
+#if defined(VIX_EXAMPLE_WITH_BROTLI)
+      if (br_ != nullptr)
+      {
+        BrotliEncoderDestroyInstance(br_);
+        br_ = nullptr;
+      }
+#endif
+    }
+
+    [[nodiscard]] Encoding encoding() const noexcept { return encoding_; }
+
+    // Streams started on this encoder; more than one means it was reused.
+    [[nodiscard]] std::uint64_t streams() const noexcept { return streams_; }
+
+  private:
+    // Output grows in steps so a large body never needs a worst-case bound up front.
+    static char *grow(std::string &out, std::size_t &used, std::size_t hint)
+    {
+      used = out.size();
+      out.resize(used + std::max<std::size_t>(hint, 4096));
+      return out.data() + used;
+    }
+
+#if defined(VIX_EXAMPLE_WITH_ZLIB)
+    bool write_gzip(std::string_view input, std::string &out, Flush flush)
+    {
+      const int mode = flush == Flush::finish ? Z_FINISH : flush == Flush::sync ? Z_SYNC_FLUSH
+                                                                                : Z_NO_FLUSH;
+      std::size_t used = 0;
+      int rc = Z_OK;
+
+      do
+      {
+        // avail_in is 32-bit; feed large inputs in slices.
+        const std::size_t slice = std::min<std::size_t>(input.size(), 1u << 30);
+        const bool last = slice == input.size();
+        zs_.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(input.data()));
+        zs_.avail_in = static_cast<uInt>(slice);
+
+        do
+        {
+          char *dst = grow(out, used, slice / 2 + 64);
+          zs_.next_out = reinterpret_cast<Bytef *>(dst);
+          zs_.avail_out = static_cast<uInt>(out.size() - used);
+          rc = deflate(&zs_, last ? mode : Z_NO_FLUSH);
+          out.resize(out.size() - zs_.avail_out);
+          if (rc == Z_STREAM_ERROR)
+          {
+            return false;
+          }
+        } while (zs_.avail_out == 0);
+
+        input.remove_prefix(slice);
+      } while (!input.empty());
+
+      return flush != Flush::finish || rc == Z_STREAM_END;
+    }
+#endif
+
+#if defined(VIX_EXAMPLE_WITH_BROTLI)
+    bool write_brotli(std::string_view input, std::string &out, Flush flush)
+    {
+      const BrotliEncoderOperation op = flush == Flush::finish ? BROTLI_OPERATION_FINISH : flush == Flush::sync ? BROTLI_OPERATION_FLUSH
+                                                                                                                 : BROTLI_OPERATION_PROCESS;
+      std::size_t availIn = input.size();
+      const auto *nextIn = reinterpret_cast<const std::uint8_t *>(input.data());
+      std::size_t availOut = 0;
+
+      for (;;)
+      {
+        if (!BrotliEncoderCompressStream(br_, op, &availIn, &nextIn, &availOut, nullptr, nullptr))
+        {
+          return false;
+        }
+
+        std::size_t size = 0;
+        const std::uint8_t *produced = BrotliEncoderTakeOutput(br_, &size);
+        out.append(reinterpret_cast<const char *>(produced), size);
+
+        const bool done = op == BROTLI_OPERATION_FINISH
+                              ? BrotliEncoderIsFinished(br_) != 0
+                              : availIn == 0 && BrotliEncoderHasMoreOutput(br_) == 0;
+        if (done)
+        {
+          break;
+        }
+      }
+
+      if (op == BROTLI_OPERATION_FINISH)
+      {
+        abandon(); // its blocks go back to the thread's cache
+      }
+      return true;
+    }
+#endif
+
+#if defined(VIX_EXAMPLE_WITH_ZSTD)
+    bool write_zstd(std::string_view input, std::string &out, Flush flush)
+    {
+      const ZSTD_EndDirective mode = flush == Flush::finish ? ZSTD_e_end : flush == Flush::sync ? ZSTD_e_flush
+                                                                                                  : ZSTD_e_continue;
+      ZSTD_inBuffer in{input.data(), input.size(), 0};
+      std::size_t used = 0;
+
+      for (;;)
+      {
+        char *dst = grow(out, used, ZSTD_CStreamOutSize());
+        ZSTD_outBuffer buffer{dst, out.size() - used, 0};
+        const std::size_t remaining = ZSTD_compressStream2(zstd_, &buffer, &in, mode);
+        out.resize(used + buffer.pos);
+        if (ZSTD_isError(remaining))
+        {
+          return false;
+        }
+
+        const bool done = mode == ZSTD_e_continue ? in.pos == in.size : remaining == 0;
+        if (done)
+        {
+          return true;
+        }
+      }
+    }
+#endif
+
+    Encoding encoding_{Encoding::identity};
+    bool finished_{false};
+    std::uint64_t streams_{0};
+
+#if defined(VIX_EXAMPLE_WITH_ZLIB)
+    z_stream zs_{};
+    bool zlibReady_{false};
+    int zlibLevel_{-1};
+#endif
+#if defined(VIX_EXAMPLE_WITH_BROTLI)
+    BrotliEncoderState *br_{nullptr};
+#endif
+#if defined(VIX_EXAMPLE_WITH_ZSTD)
+    ZSTD_CCtx *zstd_{nullptr};
+#endif
+  };
+
+  // Per-thread free lists of StreamEncoder, one per encoding. Nothing is
+  // shared between threads, so acquire and release take no lock. An
+  // encoder released on another thread joins that thread's list.
+  class CodecPool
+  {
+  public:
+    static constexpr std::size_t kMaxIdlePerEncoding = 8;
+
+    struct Stats
+    {
+      std::uint64_t created{0};
+      std::uint64_t reused{0};
+    };
+
+    class Lease
+    {
+    public:
+      Lease() = default;
+      explicit Lease(std::unique_ptr<StreamEncoder> encoder) : encoder_(std::move(encoder)) {}
+
+      Lease(Lease &&) noexcept = default;
+      Lease &operator=(Lease &&other) noexcept
+      {
+        if (this != &other)
+        {
+          CodecPool::release(std::move(encoder_));
+          encoder_ = std::move(other.encoder_);
+        }
+        return *this;
+      }
+
+      ~Lease()
+      {
+        CodecPool::release(std::move(encoder_));
+      }
+
+      explicit operator bool() const noexcept { return encoder_ != nullptr; }
+      StreamEncoder *operator->() const noexcept { return encoder_.get(); }
+      StreamEncoder &operator*() const noexcept { return *encoder_; }
+
+    private:
+      std::unique_ptr<StreamEncoder> encoder_;
+    };
+
+    // An encoder with begin() already called, or an empty lease if this
+    // build cannot produce `encoding`.
+    static Lease acquire(Encoding encoding, int level, std::size_t size_hint = 0)
+    {
+      auto &local = thread_state();
+      auto &idle = local.idle[static_cast<std::size_t>(encoding)];
+
+      std::unique_ptr<StreamEncoder> encoder;
+      if (!idle.empty())
+      {
+        encoder = std::move(idle.back());
+        idle.pop_back();
+        ++local.stats.reused;
+      }
+      else
+      {
+        encoder = std::make_unique<StreamEncoder>();
+        ++local.stats.created;
+      }
+
+      if (!encoder->begin(encoding, level, size_hint))
+      {
+        return Lease{};
+      }
+      return Lease{std::move(encoder)};
+    }
+
+    // Counters for the calling thread.
+    static Stats thread_stats()
+    {
+      return thread_state().stats;
+    }
+
+  private:
+    struct ThreadState
+    {
+      std::array<std::vector<std::unique_ptr<StreamEncoder>>, kEncodingCount> idle;
+      Stats stats;
+    };
+
+    static ThreadState &thread_state()
+    {
+      // Constructed first, so the block cache outlives the pooled encoders.
+      (void)detail::thread_blocks();
+      thread_local ThreadState state;
+      return state;
+    }
+
+    static void release(std::unique_ptr<StreamEncoder> encoder)
+    {
+      if (!encoder)
+      {
+        return;
+      }
+      encoder->abandon();
+
+      auto &idle = thread_state().idle[static_cast<std::size_t>(encoder->encoding())];
+      if (idle.size() < kMaxIdlePerEncoding)
+      {
+        idle.push_back(std::move(encoder));
+      }
+    }
+  };
+} // namespace vix_examples::compression
+
+#endif // VIX_EXAMPLES_COMPRESSION_CODEC_POOL_HPP
@@ -0,0 +1,200 @@
+/**
+ *
+ *  @file  compression_pool_bench.cpp — Fresh vs pooled encoder contexts (Vix.cpp)
+ *  @author Gaspard Kirira
+ *
+ *  Copyright 2025, Gaspard Kirira.  All rights reserved.
+ *  https://github.com/vixcpp/vix
+ *  Use of this source code is governed by a MIT license
+ *  that can be found in the License file.
+ *
+ *  Vix.cpp
+ *
+ */
+// ----------------------------------------------------------------------------
+// Run (same defines and libraries as compression_pooled_app.cpp):
+//   vix run compression_pool_bench.cpp
+//
+// Knobs (environment):
+//   VIX_COMP_BENCH_BYTES      response body size (default 4096)
+//   VIX_COMP_BENCH_RESPONSES  responses per encoding (default 20000)
+//
+// For each encoding, compresses the same JSON body once per simulated
+// response. The "fresh" path builds a new encoder per response, as a
+// one-shot compressor does. The "pooled" path goes through CodecPool.
+// Both run at the dynamic (fast) level of the default CompressionPolicy.
+// The last table shows what a sync flush per 4 KiB chunk costs a
+// streamed body, next to buffering across chunks.
+// ============================================================================
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <string>
+
+#include "pooled_compression.hpp"
+
+using namespace vix_examples::compression;
+
+static std::size_t env_size(const char *name, std::size_t fallback)
+{
+  const char *value = std::getenv(name);
+  if (value == nullptr || *value == '\0')
+  {
+    return fallback;
+  }
+  return static_cast<std::size_t>(std::strtoull(value, nullptr, 10));
+}
+
+static std::string json_body(std::size_t bytes)
+{
+  std::string out = "[";
+  for (std::size_t i = 1; out.size() < bytes; ++i)
+  {
+    out += (i > 1 ? "," : "");
+    out += R"({"id":)" + std::to_string(i) + R"(,"email":"user)" + std::to_string(i * 7919 % 100003) +
+           R"(@example.com","active":)" + (i % 3 == 0 ? "false" : "true") + "}";
+  }
+  out.resize(bytes - 1);
+  return out + "]";
+}
+
+// One new encoder per response, released right after.
+static std::size_t fresh_once(Encoding encoding, int level, const std::string &body)
+{
+  std::string out;
+
+#if defined(VIX_EXAMPLE_WITH_ZLIB)
+  if (encoding == Encoding::gzip)
+  {
+    z_stream zs{};
+    deflateInit2(&zs, level, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY);
+    out.resize(deflateBound(&zs, static_cast<uLong>(body.size())));
+    zs.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(body.data()));
+    zs.avail_in = static_cast<uInt>(body.size());
+    zs.next_out = reinterpret_cast<Bytef *>(out.data());
+    zs.avail_out = static_cast<uInt>(out.size());
+    deflate(&zs, Z_FINISH);
+    out.resize(zs.total_out);
+    deflateEnd(&zs);
+  }
+#endif
+
+#if defined(VIX_EXAMPLE_WITH_BROTLI)
+  if (encoding == Encoding::br)
+  {
+    std::size_t size = BrotliEncoderMaxCompressedSize(body.size());
+    out.resize(size);
+    BrotliEncoderCompress(level, BROTLI_DEFAULT_WINDOW, BROTLI_MODE_GENERIC, body.size(),
+                          reinterpret_cast<const std::uint8_t *>(body.data()), &size,
+                          reinterpret_cast<std::uint8_t *>(out.data()));
+    out.resize(size);
+  }
+#endif
+
+#if defined(VIX_EXAMPLE_WITH_ZSTD)
+  if (encoding == Encoding::zstd)
+  {
+    ZSTD_CCtx *ctx = ZSTD_createCCtx();
+    ZSTD_CCtx_setParameter(ctx, ZSTD_c_compressionLevel, level);
+    std::string dst;
+    dst.resize(body.size() + ZSTD_CStreamOutSize());
+    ZSTD_inBuffer in{body.data(), body.size(), 0};
+    ZSTD_outBuffer buffer{dst.data(), dst.size(), 0};
+    ZSTD_compressStream2(ctx, &buffer, &in, ZSTD_e_end);
+    out.assign(dst.data(), buffer.pos);
+    ZSTD_freeCCtx(ctx);
+  }
+#endif
+
+  (void)encoding;
+  (void)level;
+  (void)body;
+  return out.size();
+}
+
+static std::size_t pooled_once(Encoding encoding, int level, const std::string &body)
+{
+  const auto out = compress_body(encoding, level, body);
+  return out ? out->size() : 0;
+}
+
+template <class F>
+static double per_second(std::size_t n, F &&fn)
+{
+  const auto start = std::chrono::steady_clock::now();
+  for (std::size_t i = 0; i < n; ++i)
+  {
+    fn();
+  }
+  const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+  return static_cast<double>(n) / elapsed.count();
+}
+
+int main()
+{
+  const std::size_t bytes = std::max<std::size_t>(env_size("VIX_COMP_BENCH_BYTES", 4096), 64);
+  const std::size_t responses = env_size("VIX_COMP_BENCH_RESPONSES", 20'000);
+  const std::string body = json_body(bytes);
+  const CompressionLevels levels = CompressionPolicy{}.dynamic;
+
+  std::cout << responses << " responses of " << body.size() << " bytes per encoding\n\n"
+            << "encoding   level   fresh resp/s   pooled resp/s   speedup   ratio\n";
+
+  for (const Encoding encoding : {Encoding::gzip, Encoding::br, Encoding::zstd})
+  {
+    if (!available(encoding))
+    {
+      std::cout << std::left << std::setw(11) << to_string(encoding) << "(not built)\n";
+      continue;
+    }
+
+    const int level = levels.for_encoding(encoding);
+    std::size_t compressed = 0;
+    const double fresh = per_second(responses, [&]
+                                    { compressed = fresh_once(encoding, level, body); });
+    const double pooled = per_second(responses, [&]
+                                     { compressed = pooled_once(encoding, level, body); });
+
+    std::cout << std::left << std::setw(11) << to_string(encoding) << std::setw(8) << level << std::right
+              << std::fixed << std::setprecision(0) << std::setw(12) << fresh << std::setw(16) << pooled
+              << std::setprecision(2) << std::setw(9) << pooled / fresh << "x"
+              << std::setw(8) << static_cast<double>(compressed) / static_cast<double>(body.size()) << "\n";
+  }
+
+  // Streaming: a 4 MiB NDJSON body in 4 KiB chunks.
+  std::string rows;
+  for (std::size_t i = 0; rows.size() < (4u << 20); ++i)
+  {
+    rows += R"({"id":)" + std::to_string(i) + R"(,"event":"login","ok":true})" + "\n";
+  }
+
+  std::cout << "\nstreamed " << rows.size() / 1024 << " KiB in 4 KiB chunks\n"
+            << "encoding   flush per chunk   buffered\n";
+  for (const Encoding encoding : {Encoding::gzip, Encoding::br, Encoding::zstd})
+  {
+    if (!available(encoding))
+    {
+      continue;
+    }
+
+    std::size_t sizes[2] = {0, 0};
+    for (const bool flushEach : {true, false})
+    {
+      CompressedStream stream(encoding, levels.for_encoding(encoding), {}, flushEach);
+      for (std::size_t i = 0; i < rows.size(); i += 4096)
+      {
+        stream.write(std::string_view(rows).substr(i, 4096));
+      }
+      stream.finish();
+      sizes[flushEach ? 0 : 1] = stream.bytes_out();
+    }
+    std::cout << std::left << std::setw(11) << to_string(encoding) << std::right
+              << std::setw(12) << sizes[0] / 1024 << " KiB" << std::setw(7) << sizes[1] / 1024 << " KiB\n";
+  }
+
+  const auto stats = CodecPool::thread_stats();
+  std::cout << "\npool: " << stats.created << " encoders created, " << stats.reused << " reuses\n";
+  return 0;
+}
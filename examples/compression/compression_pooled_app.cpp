@@ -0,0 +1,117 @@
+/**
+ *
+ *  @file  compression_pooled_app.cpp — Pooled, streaming and zstd compression (Vix.cpp)
+ *  @author Gaspard Kirira
+ *
+ *  Copyright 2025, Gaspard Kirira.  All rights reserved.
+ *  https://github.com/vixcpp/vix
+ *  Use of this source code is governed by a MIT license
+ *  that can be found in the License file.
+ *
+ *  Vix.cpp
+ *
+ */
+// Run (link the codecs you enable):
+//   vix run compression_pooled_app.cpp
+//   with -DVIX_EXAMPLE_WITH_ZLIB -DVIX_EXAMPLE_WITH_BROTLI -DVIX_EXAMPLE_WITH_ZSTD
+//   and -lz -lbrotlienc -lzstd
+//
+// Test:
+//   # JSON: fast level (1), zstd preferred when the client accepts it
+//   curl -s -D - -o /dev/null -H "Accept-Encoding: gzip, br, zstd" http://localhost:8080/api/users
+//
+//   # Cacheable asset: high level (Cache-Control: public, max-age=86400)
+//   curl -s -D - -o /dev/null -H "Accept-Encoding: br" http://localhost:8080/assets/app.js
+//
+//   # Already compressed type: left alone
+//   curl -s -D - -o /dev/null -H "Accept-Encoding: gzip" http://localhost:8080/assets/logo.png
+//
+//   # NDJSON export compressed chunk by chunk as rows are produced
+//   curl -s -H "Accept-Encoding: gzip" http://localhost:8080/api/export | gunzip | head -3
+//
+//   # Encoder reuse on the threads that served requests
+//   curl -s http://localhost:8080/_compression/stats
+// ============================================================================
+
+#include <iostream>
+#include <string>
+
+#include <vix.hpp>
+
+#include "pooled_compression.hpp"
+
+using namespace vix;
+using namespace vix_examples::compression;
+
+static std::string users_json(int count)
+{
+  std::string out = "[";
+  for (int i = 1; i <= count; ++i)
+  {
+    out += (i > 1 ? "," : "");
+    out += R"({"id":)" + std::to_string(i) + R"(,"name":"user )" + std::to_string(i) +
+           R"(","role":")" + (i % 7 == 0 ? "admin" : "member") + R"("})";
+  }
+  return out + "]";
+}
+
+int main()
+{
+  App app;
+
+  PooledCompressionOptions options;
+  options.min_size = 1024;
+  options.policy.rules.push_back({.content_type = "text/event-stream", .levels = {.gzip = 1, .brotli = 0, .zstd = 1}});
+
+  app.use(pooled_compression(options));
+
+  app.get("/api/users", [](Request &, Response &res)
+          {
+            res.res.set_header("Content-Type", "application/json");
+            res.res.set_body(users_json(200)); });
+
+  app.get("/assets/app.js", [](Request &, Response &res)
+          {
+            std::string js;
+            for (int i = 0; i < 500; ++i)
+            {
+              js += "export function handler" + std::to_string(i) + "(event) { return render(event.target, state); }\n";
+            }
+            res.res.set_header("Content-Type", "text/javascript");
+            res.res.set_header("Cache-Control", "public, max-age=86400");
+            res.res.set_body(std::move(js)); });
+
+  app.get("/assets/logo.png", [](Request &, Response &res)
+          {
+            res.res.set_header("Content-Type", "image/png");
+            res.res.set_body(std::string(4096, '\x89')); });
+
+  // The export never exists uncompressed: each row is compressed as it is
+  // produced. With a chunked transport, the sink would write to the socket.
+  app.get("/api/export", [options](Request &req, Response &res)
+          {
+            std::string body;
+            {
+              auto stream = open_compressed_stream(req, res, "application/x-ndjson",
+                                                   [&body](std::string_view bytes) { body.append(bytes); },
+                                                   options, /*flush_each_write=*/false);
+              for (int i = 1; i <= 50'000; ++i)
+              {
+                stream.write(R"({"id":)" + std::to_string(i) + R"(,"event":"login","ok":true})" + "\n");
+              }
+            }
+            res.res.set_body(std::move(body)); });
+
+  app.get("/_compression/stats", [](Request &, Response &res)
+          {
+            const auto stats = CodecPool::thread_stats();
+            res.json({"thread_encoders_created", stats.created,
+                      "thread_encoders_reused", stats.reused,
+                      "gzip", available(Encoding::gzip),
+                      "br", available(Encoding::br),
+                      "zstd", available(Encoding::zstd)}); });
+
+  std::cout << "Pooled compression example on http://localhost:8080\n";
+  app.run(8080);
+  return 0;
+}
@@ -0,0 +1,413 @@
+/**
+ *
+ *  @file pooled_compression.hpp
+ *  @author Gaspard Kirira
+ *
+ *  Copyright 2025, Gaspard Kirira.
+ *  All rights reserved.
+ *  https://github.com/vixcpp/vix
+ *
+ *  Use of this source code is governed by a MIT license
+ *  that can be found in the License file.
+ *
+ *  Vix.cpp
+ *
+ */
+#ifndef VIX_EXAMPLES_COMPRESSION_POOLED_COMPRESSION_HPP
+#define VIX_EXAMPLES_COMPRESSION_POOLED_COMPRESSION_HPP
+
+// Response compression on top of CodecPool.
+//
+// - pooled_compression(): App middleware that compresses the finished body
+//   after the handler, with gzip, br or zstd, using a pooled encoder.
+// - CompressedStream: compresses a body chunk by chunk as the handler
+//   produces it. Each chunk goes to a sink, so the uncompressed body never
+//   exists in memory at once.
+// - CompressionPolicy: the level per content type. Dynamic JSON gets a
+//   fast level. Responses marked cacheable get a higher one, because their
+//   compressed bytes are reused.
+
+#include <cctype>
+#include <cstddef>
+#include <cstdlib>
+#include <functional>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include <vix.hpp>
+
+#include "codec_pool.hpp"
+
+namespace vix_examples::compression
+{
+  namespace detail
+  {
+    inline const std::string *find_header(const vix::http::Response &res, std::string_view name)
+    {
+      for (const auto &[key, value] : res.headers())
+      {
+        if (iequals(key, name))
+        {
+          return &value;
+        }
+      }
+      return nullptr;
+    }
+
+    inline Encoding negotiate(const vix::Request &req, const std::vector<Encoding> &preference)
+    {
+      if (!req.has_header("accept-encoding"))
+      {
+        return Encoding::identity;
+      }
+      return compression::negotiate(req.header("accept-encoding"), preference);
+    }
+
+    inline std::string lower(std::string_view s)
+    {
+      std::string out(s);
+      for (char &c : out)
+      {
+        c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+      }
+      return out;
+    }
+  } // namespace detail
+
+  struct CompressionLevels
+  {
+    int gzip{6};
+    int brotli{5};
+    int zstd{3};
+
+    [[nodiscard]] int for_encoding(Encoding encoding) const noexcept
+    {
+      switch (encoding)
+      {
+      case Encoding::gzip:
+        return gzip;
+      case Encoding::br:
+        return brotli;
+      case Encoding::zstd:
+        return zstd;
+      case Encoding::identity:
+        break;
+      }
+      return 0;
+    }
+  };
+
+  struct CompressionPolicy
+  {
+    struct Rule
+    {
+      std::string content_type;  // prefix, e.g. "application/json" or "text/"
+      CompressionLevels levels{};
+    };
+
+    // Per-request output, usually JSON: spend as little CPU as possible.
+    CompressionLevels dynamic{.gzip = 1, .brotli = 1, .zstd = 1};
+
+    // Cache-Control allows reuse (public, max-age, immutable): the bytes
+    // are compressed once and served many times.
+    CompressionLevels cacheable{.gzip = 9, .brotli = 9, .zstd = 15};
+
+    // Checked first; the first matching prefix wins over dynamic/cacheable.
+    std::vector<Rule> rules{};
+
+    // Already compressed formats; compressing them again only costs CPU.
+    std::vector<std::string> skip{"image/", "video/", "audio/", "font/woff",
+                                  "application/zip", "application/gzip", "application/zstd",
+                                  "application/octet-stream", "application/pdf"};
+
+    // Exceptions to `skip`.
+    std::vector<std::string> always{"image/svg+xml"};
+
+    // nullopt: do not compress this content type.
+    [[nodiscard]] std::optional<CompressionLevels> levels_for(std::string_view content_type, bool cacheable_response) const
+    {
+      const std::string type = detail::lower(content_type.substr(0, content_type.find(';')));
+
+      if (!matches(always, type) && matches(skip, type))
+      {
+        return std::nullopt;
+      }
+
+      for (const auto &rule : rules)
+      {
+        if (type.starts_with(detail::lower(rule.content_type)))
+        {
+          return rule.levels;
+        }
+      }
+      return cacheable_response ? cacheable : dynamic;
+    }
+
+    // "public", "immutable" or a non-zero max-age, and not no-store/private.
+    [[nodiscard]] static bool is_cacheable(std::string_view cache_control)
+    {
+      const std::string cc = detail::lower(cache_control);
+      if (cc.empty() || cc.find("no-store") != std::string::npos || cc.find("private") != std::string::npos)
+      {
+        return false;
+      }
+      if (cc.find("public") != std::string::npos || cc.find("immutable") != std::string::npos)
+      {
+        return true;
+      }
+      const auto maxAge = cc.find("max-age=");
+      return maxAge != std::string::npos && std::strtol(cc.c_str() + maxAge + 8, nullptr, 10) > 0;
+    }
+
+  private:
+    static bool matches(const std::vector<std::string> &prefixes, std::string_view type)
+    {
+      for (const auto &prefix : prefixes)
+      {
+        if (type.starts_with(prefix))
+        {
+          return true;
+        }
+      }
+      return false;
+    }
+  };
+
+  struct PooledCompressionOptions
+  {
+    std::size_t min_size{1024};
+    bool add_vary{true};
+    bool enabled{true};
+
+    // Server order when the client accepts several at the same q-value.
+    std::vector<Encoding> preference{Encoding::zstd, Encoding::br, Encoding::gzip};
+
+    CompressionPolicy policy{};
+  };
+
+  // Compresses `body` in one call on a pooled encoder. Returns nullopt if
+  // the encoding is unavailable or the output would not be smaller.
+  inline std::optional<std::string> compress_body(Encoding encoding, int level, std::string_view body)
+  {
+    auto encoder = CodecPool::acquire(encoding, level, body.size());
+    if (!encoder)
+    {
+      return std::nullopt;
+    }
+
+    std::string out;
+    out.reserve(body.size() / 2 + 64);
+    if (!encoder->write(body, out, StreamEncoder::Flush::finish) || out.size() >= body.size())
+    {
+      return std::nullopt;
+    }
+    return out;
+  }
+
+  // Compresses a body chunk by chunk and hands each compressed piece to a
+  // sink. With flush_each_write, every write() is decodable by the client
+  // on arrival (a sync flush per chunk), which is what a live feed needs.
+  // Without it, the encoder buffers across chunks and compresses better.
+  class CompressedStream
+  {
+  public:
+    using Sink = std::function<void(std::string_view)>;
+
+    CompressedStream(Encoding encoding, int level, Sink sink, bool flush_each_write = true)
+        : sink_(std::move(sink)), flush_(flush_each_write)
+    {
+      if (encoding != Encoding::identity)
+      {
+        encoder_ = CodecPool::acquire(encoding, level);
+      }
+      encoding_ = encoder_ ? encoding : Encoding::identity;
+    }
+
+    CompressedStream(const CompressedStream &) = delete;
+    CompressedStream &operator=(const CompressedStream &) = delete;
+    CompressedStream(CompressedStream &&) noexcept = default;
+
+    ~CompressedStream()
+    {
+      finish();
+    }
+
+    bool write(std::string_view chunk)
+    {
+      if (finished_)
+      {
+        return false;
+      }
+      bytesIn_ += chunk.size();
+
+      if (!encoder_)
+      {
+        emit(chunk);
+        return true;
+      }
+
+      buffer_.clear();
+      const bool ok = encoder_->write(chunk, buffer_, flush_ ? StreamEncoder::Flush::sync : StreamEncoder::Flush::none);
+      emit(buffer_);
+      return ok;
+    }
+
+    // Ends the stream; also called by the destructor.
+    bool finish()
+    {
+      if (finished_)
+      {
+        return true;
+      }
+      finished_ = true;
+
+      if (!encoder_)
+      {
+        return true;
+      }
+      buffer_.clear();
+      const bool ok = encoder_->finish(buffer_);
+      emit(buffer_);
+      encoder_ = CodecPool::Lease{}; // back to the pool before the response is sent
+      return ok;
+    }
+
+    [[nodiscard]] Encoding encoding() const noexcept { return encoding_; }
+    [[nodiscard]] std::size_t bytes_in() const noexcept { return bytesIn_; }
+    [[nodiscard]] std::size_t bytes_out() const noexcept { return bytesOut_; }
+
+  private:
+    void emit(std::string_view bytes)
+    {
+      bytesOut_ += bytes.size();
+      if (!bytes.empty() && sink_)
+      {
+        sink_(bytes);
+      }
+    }
+
+    CodecPool::Lease encoder_;
+    Encoding encoding_{Encoding::identity};
+    Sink sink_;
+    std::string buffer_;
+    bool flush_{true};
+    bool finished_{false};
+    std::size_t bytesIn_{0};
+    std::size_t bytesOut_{0};
+  };
+
+  // Starts a compressed body for a handler that writes it in chunks. It
+  // negotiates the encoding, picks the level from the policy, and sets
+  // Content-Type, Content-Encoding and Vary on `res`. The response then
+  // carries Content-Encoding, so pooled_compression() leaves it alone.
+  //
+  // A vix::Response holds one body. With a transport that writes chunks,
+  // the sink is its write function. Otherwise the sink appends to a string
+  // that becomes the body, which holds only the compressed bytes.
+  inline CompressedStream open_compressed_stream(vix::Request &req,
+                                                 vix::Response &res,
+                                                 std::string_view content_type,
+                                                 CompressedStream::Sink sink,
+                                                 const PooledCompressionOptions &options = {},
+                                                 bool flush_each_write = true)
+  {
+    res.res.set_header("Content-Type", std::string(content_type));
+
+    Encoding encoding = Encoding::identity;
+    int level = 0;
+    const auto *cacheControl = detail::find_header(res.res, "cache-control");
+    if (options.enabled)
+    {
+      if (const auto levels = options.policy.levels_for(content_type, cacheControl && CompressionPolicy::is_cacheable(*cacheControl)))
+      {
+        encoding = detail::negotiate(req, options.preference);
+        level = levels->for_encoding(encoding);
+      }
+    }
+
+    if (options.add_vary)
+    {
+      res.res.set_header("Vary", "Accept-Encoding");
+    }
+
+    CompressedStream stream(encoding, level, std::move(sink), flush_each_write);
+    if (stream.encoding() != Encoding::identity)
+    {
+      res.res.set_header("Content-Encoding", std::string(to_string(stream.encoding())));
+    }
+    return stream;
+  }
+
+  // Compresses finished responses after the handler, like
+  // performance::compression(), but on pooled encoders, with zstd and the
+  // per-content-type levels of `options.policy`.
+  inline std::function<void(vix::Request &, vix::Response &, vix::App::Next)>
+  pooled_compression(PooledCompressionOptions options = {})
+  {
+    return [options = std::move(options)](vix::Request &req, vix::Response &res, vix::App::Next next)
+    {
+      next();
+
+      if (!options.enabled || req.method() == "HEAD")
+      {
+        return;
+      }
+
+      auto &raw = res.res;
+      const int status = raw.status();
+      if (status < 200 || status == 204 || status == 206 || status == 304)
+      {
+        return;
+      }
+      if (raw.body().size() < options.min_size || detail::find_header(raw, "content-encoding") != nullptr)
+      {
+        return;
+      }
+
+      const auto *contentType = detail::find_header(raw, "content-type");
+      const auto *cacheControl = detail::find_header(raw, "cache-control");
+      if (cacheControl != nullptr && cacheControl->find("no-transform") != std::string::npos)
+      {
+        return;
+      }
+
+      const auto levels = options.policy.levels_for(contentType ? std::string_view(*contentType) : std::string_view{},
+                                                    cacheControl && CompressionPolicy::is_cacheable(*cacheControl));
+      if (!levels)
+      {
+        return;
+      }
+
+      // Vary applies whether or not this client gets a compressed body.
+      if (options.add_vary)
+      {
+        const auto *vary = detail::find_header(raw, "vary");
+        if (vary == nullptr)
+        {
+          raw.set_header("Vary", "Accept-Encoding");
+        }
+        else if (detail::lower(*vary).find("accept-encoding") == std::string::npos)
+        {
+          raw.set_header("Vary", *vary + ", Accept-Encoding");
+        }
+      }
+
+      const Encoding encoding = detail::negotiate(req, options.preference);
+      if (encoding == Encoding::identity)
+      {
+        return;
+      }
+
+      if (auto body = compress_body(encoding, levels->for_encoding(encoding), raw.body()))
+      {
+        raw.set_body(std::move(*body));
+        raw.set_header("Content-Encoding", std::string(to_string(encoding)));
+      }
+    };
+  }
+} // namespace vix_examples::compression
+
+#endif // VIX_EXAMPLES_COMPRESSION_POOLED_COMPRESSION_HPP
@@ -0,0 +1,118 @@
+/**
+ *
+ *  @file  etag_fast_app.cpp — Declared-version ETags and incremental hashing (Vix.cpp)
+ *  @author Gaspard Kirira
+ *
+ *  Copyright 2025, Gaspard Kirira.  All rights reserved.
+ *  https://github.com/vixcpp/vix
+ *  Use of this source code is governed by a MIT license
+ *  that can be found in the License file.
+ *
+ *  Vix.cpp
+ *
+ */
+// ----------------------------------------------------------------------------
+// Run:
+//   vix run etag_fast_app.cpp
+//
+// Test:
+//   # Version declared by the handler: the 304 skips building the report
+//   curl -i http://localhost:8080/api/report
+//   curl -i -H 'If-None-Match: <etag>' http://localhost:8080/api/report
+//
+//   # Version resolved per prefix before the handler runs
+//   curl -i http://localhost:8080/api/users/42
+//   curl -i -H 'If-None-Match: <etag>' http://localhost:8080/api/users/42
+//
+//   # Body hashed while it is written; fast_etag() reuses the digest
+//   curl -i http://localhost:8080/api/feed
+//   curl -i -H 'If-None-Match: <etag>' http://localhost:8080/api/feed
+//
+//   # Bump the data version; every declared ETag changes
+//   curl -s -X POST http://localhost:8080/api/touch
+//
+//   # How many bodies were actually built
+//   curl -s http://localhost:8080/_etag/stats
+// ============================================================================
+
+#include <atomic>
+#include <iostream>
+#include <optional>
+#include <string>
+
+#include <vix.hpp>
+
+#include "fast_etag.hpp"
+
+using namespace vix;
+using namespace vix_examples::etag;
+
+// Stand-in for a DB "updated_at" column.
+static std::atomic<long long> g_updated_at{1735689600};
+static std::atomic<long long> g_bodies_built{0};
+
+static std::string build_report()
+{
+  ++g_bodies_built;
+  std::string out = "[";
+  for (int i = 0; i < 5000; ++i)
+  {
+    out += (i > 0 ? "," : "");
+    out += R"({"day":)" + std::to_string(i) + R"(,"visits":)" + std::to_string((i * 7919) % 1000) + "}";
+  }
+  return out + "]";
+}
+
+int main()
+{
+  App app;
+
+  // Outermost: tags responses that declared nothing.
+  app.use(fast_etag({.weak = true, .min_body_size = 1}));
+
+  // /api/users/<id>: version resolved before the handler.
+  app.use("/api/users", etag_precondition([](Request &req) -> std::optional<std::string>
+                                          {
+                                            const std::string path = req.path();
+                                            const auto slash = path.rfind('/');
+                                            if (slash == std::string::npos || slash + 1 == path.size())
+                                            {
+                                              return std::nullopt;
+                                            }
+                                            return "user:" + path.substr(slash + 1) + "@" + std::to_string(g_updated_at.load()); }));
+
+  app.get("/api/report", [](Request &req, Response &res)
+          {
+            if (check_not_modified(req, res, "report@" + std::to_string(g_updated_at.load())))
+            {
+              return; // 304, report never built
+            }
+            res.res.set_header("Content-Type", "application/json");
+            res.res.set_body(build_report()); });
+
+  app.get("/api/users/42", [](Request &, Response &res)
+          {
+            ++g_bodies_built;
+            res.json({"id", 42, "name", "Ada", "updated_at", g_updated_at.load()}); });
+
+  app.get("/api/feed", [](Request &req, Response &res)
+          {
+            ++g_bodies_built;
+            HashedBody body(64 * 1024);
+            for (int i = 0; i < 2000; ++i)
+            {
+              body += "event " + std::to_string(i) + ": login ok\n";
+            }
+            res.res.set_header("Content-Type", "text/plain");
+            send_hashed(req, res, std::move(body)); });
+
+  app.post("/api/touch", [](Request &, Response &res)
+           { res.json({"ok", true, "updated_at", ++g_updated_at}); });
+
+  app.get("/_etag/stats", [](Request &, Response &res)
+          { res.json({"bodies_built", g_bodies_built.load(), "updated_at", g_updated_at.load()}); });
+
+  std::cout << "Fast ETag example on http://localhost:8080\n";
+  app.run(8080);
+  return 0;
+}
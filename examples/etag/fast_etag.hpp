@@ -0,0 +1,265 @@
+/**
+ *
+ *  @file fast_etag.hpp
+ *  @author Gaspard Kirira
+ *
+ *  Copyright 2025, Gaspard Kirira.
+ *  All rights reserved.
+ *  https://github.com/vixcpp/vix
+ *
+ *  Use of this source code is governed by a MIT license
+ *  that can be found in the License file.
+ *
+ *  Vix.cpp
+ *
+ */
+#ifndef VIX_EXAMPLES_ETAG_FAST_ETAG_HPP
+#define VIX_EXAMPLES_ETAG_FAST_ETAG_HPP
+
+// ETags with less work per request than performance::etag().
+//
+// 1. Declare the version up front. A handler that knows its resource
+//    version (a DB updated_at, a row version, a file mtime) calls
+//    check_not_modified() before building anything. If the client's
+//    If-None-Match matches, the response is 304 and the body is never
+//    built. etag_precondition() does the same for a whole prefix, from a
+//    resolver, before the handler runs.
+//
+// 2. Hash while writing. HashedBody hashes each chunk as it is appended,
+//    while the bytes are still in cache. send_hashed() hands the digest to
+//    fast_etag(), so the finished body is not read a second time.
+//
+// fast_etag() covers everything else: it hashes the final body with the
+// 128-bit FastHasher, sets ETag and answers If-None-Match with 304.
+
+#include <algorithm>
+#include <cctype>
+#include <cstddef>
+#include <functional>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+
+#include <vix.hpp>
+
+#include "fast_hash.hpp"
+
+namespace vix_examples::etag
+{
+  struct FastEtagOptions
+  {
+    bool weak{true};
+    std::size_t min_body_size{1};
+  };
+
+  // Request state set by send_hashed(): the digest of the body it set,
+  // and where that body lives, so a replaced body is never matched.
+  struct BodyDigest
+  {
+    Hash128 hash{};
+    std::size_t size{0};
+    const char *data{nullptr};
+  };
+
+  inline std::string format_etag(const Hash128 &hash, bool weak)
+  {
+    return std::string(weak ? "W/\"" : "\"") + hash.hex() + "\"";
+  }
+
+  // ETag for a declared version string. Any text works: it is hashed, so
+  // quotes or spaces in the version cannot break the header.
+  inline std::string etag_for_version(std::string_view version, bool weak = true)
+  {
+    return format_etag(fast_hash128(version), weak);
+  }
+
+  // If-None-Match uses weak comparison: W/"x" matches "x". The header
+  // may list several tags, or be "*".
+  inline bool if_none_match(std::string_view header, std::string_view etag)
+  {
+    const auto opaque = [](std::string_view tag)
+    {
+      const auto first = tag.find_first_not_of(" \t");
+      if (first == std::string_view::npos)
+      {
+        return std::string_view{};
+      }
+      tag = tag.substr(first, tag.find_last_not_of(" \t") - first + 1);
+      return tag.starts_with("W/") ? tag.substr(2) : tag;
+    };
+
+    const std::string_view wanted = opaque(etag);
+    while (!header.empty())
+    {
+      const auto comma = header.find(',');
+      const std::string_view candidate = opaque(header.substr(0, comma));
+      header = comma == std::string_view::npos ? std::string_view{} : header.substr(comma + 1);
+
+      if (candidate == "*" || (!candidate.empty() && candidate == wanted))
+      {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  namespace detail
+  {
+    inline bool cacheable_method(const vix::Request &req)
+    {
+      return req.method() == "GET" || req.method() == "HEAD";
+    }
+
+    inline bool set_not_modified_if_match(const vix::Request &req, vix::Response &res, const std::string &etag)
+    {
+      if (!cacheable_method(req) || !req.has_header("if-none-match") ||
+          !if_none_match(req.header("if-none-match"), etag))
+      {
+        return false;
+      }
+      res.res.set_status(304);
+      res.res.set_body(std::string());
+      return true;
+    }
+
+    inline const std::string *find_header(const vix::http::Response &res, std::string_view name)
+    {
+      for (const auto &[key, value] : res.headers())
+      {
+        if (key.size() == name.size() &&
+            std::equal(key.begin(), key.end(), name.begin(), [](char a, char b)
+                       { return std::tolower(static_cast<unsigned char>(a)) == b; }))
+        {
+          return &value;
+        }
+      }
+      return nullptr;
+    }
+  } // namespace detail
+
+  // Sets ETag from `version`. Returns true after turning the response into
+  // a 304, in which case the handler should return without building the
+  // body:
+  //
+  //   if (check_not_modified(req, res, std::to_string(user.updated_at)))
+  //     return;
+  inline bool check_not_modified(vix::Request &req, vix::Response &res, std::string_view version, bool weak = true)
+  {
+    const std::string etag = etag_for_version(version, weak);
+    res.res.set_header("ETag", etag);
+    return detail::set_not_modified_if_match(req, res, etag);
+  }
+
+  // Builds a body and hashes it as it goes; the digest always matches the
+  // bytes in str().
+  class HashedBody
+  {
+  public:
+    HashedBody() = default;
+    explicit HashedBody(std::size_t reserve) { body_.reserve(reserve); }
+
+    HashedBody &append(std::string_view chunk)
+    {
+      hasher_.update(chunk);
+      body_.append(chunk);
+      return *this;
+    }
+
+    HashedBody &operator+=(std::string_view chunk) { return append(chunk); }
+
+    [[nodiscard]] const std::string &str() const noexcept { return body_; }
+    [[nodiscard]] std::size_t size() const noexcept { return body_.size(); }
+    [[nodiscard]] Hash128 digest() const noexcept { return hasher_.digest(); }
+
+    std::string release() noexcept
+    {
+      hasher_.reset();
+      return std::move(body_);
+    }
+
+  private:
+    FastHasher hasher_;
+    std::string body_;
+  };
+
+  // Moves the body into the response and records its digest for fast_etag().
+  inline void send_hashed(vix::Request &req, vix::Response &res, HashedBody &&body)
+  {
+    const Hash128 hash = body.digest();
+    res.res.set_body(body.release());
+
+    const std::string &sent = res.res.body();
+    req.state().set(BodyDigest{hash, sent.size(), sent.data()});
+  }
+
+  // Resolves the version of the resource behind a request, or nullopt when
+  // unknown (the handler then runs as usual).
+  using VersionResolver = std::function<std::optional<std::string>(vix::Request &)>;
+
+  // For app.use(prefix, ...): answers 304 before the handler runs when the
+  // resolved version matches If-None-Match.
+  inline std::function<void(vix::Request &, vix::Response &, vix::App::Next)>
+  etag_precondition(VersionResolver resolver, FastEtagOptions options = {})
+  {
+    return [resolver = std::move(resolver), options](vix::Request &req, vix::Response &res, vix::App::Next next)
+    {
+      if (detail::cacheable_method(req))
+      {
+        if (const auto version = resolver(req))
+        {
+          if (check_not_modified(req, res, *version, options.weak))
+          {
+            return;
+          }
+        }
+      }
+      next();
+    };
+  }
+
+  // After the handler: sets ETag on 200 GET/HEAD responses that have none,
+  // from the send_hashed() digest when the body is unchanged since, or by
+  // hashing it. Answers a matching If-None-Match with 304.
+  inline std::function<void(vix::Request &, vix::Response &, vix::App::Next)>
+  fast_etag(FastEtagOptions options = {})
+  {
+    return [options](vix::Request &req, vix::Response &res, vix::App::Next next)
+    {
+      next();
+
+      auto &raw = res.res;
+      if (!detail::cacheable_method(req) || raw.status() != 200)
+      {
+        return;
+      }
+
+      if (const auto *existing = detail::find_header(raw, "etag"))
+      {
+        detail::set_not_modified_if_match(req, res, *existing);
+        return;
+      }
+
+      const std::string &body = raw.body();
+      if (body.size() < options.min_body_size)
+      {
+        return;
+      }
+
+      // A middleware between this one and the handler may have replaced
+      // the body, even with one of the same length. The digest is only
+      // used for the very buffer send_hashed() set; any other body is
+      // hashed as sent. A middleware that edits the body in place should
+      // clear BodyDigest itself.
+      const auto *digest = req.state().try_get<BodyDigest>();
+      const bool same_body = digest != nullptr && digest->data == body.data() && digest->size == body.size();
+      const Hash128 hash = same_body ? digest->hash : fast_hash128(body);
+
+      const std::string etag = format_etag(hash, options.weak);
+      raw.set_header("ETag", etag);
+      detail::set_not_modified_if_match(req, res, etag);
+    };
+  }
+} // namespace vix_examples::etag
+
+#endif // VIX_EXAMPLES_ETAG_FAST_ETAG_HPP
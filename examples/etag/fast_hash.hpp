@@ -0,0 +1,264 @@
+/**
+ *
+ *  @file fast_hash.hpp
+ *  @author Gaspard Kirira
+ *
+ *  Copyright 2025, Gaspard Kirira.
+ *  All rights reserved.
+ *  https://github.com/vixcpp/vix
+ *
+ *  Use of this source code is governed by a MIT license
+ *  that can be found in the License file.
+ *
+ *  Vix.cpp
+ *
+ */
+#ifndef VIX_EXAMPLES_ETAG_FAST_HASH_HPP
+#define VIX_EXAMPLES_ETAG_FAST_HASH_HPP
+
+// Streaming 128-bit non-cryptographic hash for ETags.
+//
+// The hash is built like XXH3. Eight 64-bit lanes take one 64-byte stripe
+// per step. Each lane does a 32x32->64 multiply of the input XOR a secret
+// and adds the raw input to its neighbour. Lanes are scrambled every 16
+// stripes and folded with 128-bit multiplies at the end. The lanes are
+// independent, so the stripe loop is plain enough for the compiler to
+// vectorize (SSE2/AVX2/NEON at -O3).
+//
+// The output is not compatible with XXH3. It is stable across runs and
+// machines, which is all an ETag needs. It resists accidental collisions,
+// not adversarial ones, so never use it as a security check.
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+
+namespace vix_examples::etag
+{
+  struct Hash128
+  {
+    std::uint64_t lo{0};
+    std::uint64_t hi{0};
+
+    friend bool operator==(const Hash128 &, const Hash128 &) = default;
+
+    // 32 lowercase hex digits.
+    [[nodiscard]] std::string hex() const
+    {
+      static constexpr char digits[] = "0123456789abcdef";
+      std::string out(32, '0');
+      for (int i = 0; i < 16; ++i)
+      {
+        out[static_cast<std::size_t>(i)] = digits[(hi >> (60 - 4 * i)) & 0xF];
+        out[static_cast<std::size_t>(16 + i)] = digits[(lo >> (60 - 4 * i)) & 0xF];
+      }
+      return out;
+    }
+  };
+
+  namespace detail
+  {
+    inline constexpr std::size_t kLanes = 8;
+    inline constexpr std::size_t kStripe = kLanes * sizeof(std::uint64_t); // 64 bytes
+    inline constexpr std::size_t kStripesPerBlock = 16;
+
+    inline constexpr std::uint64_t kPrime32 = 0x9E3779B1ULL;
+    inline constexpr std::uint64_t kPrime64a = 0x9E3779B185EBCA87ULL;
+    inline constexpr std::uint64_t kPrime64b = 0xC2B2AE3D27D4EB4FULL;
+
+    constexpr std::uint64_t splitmix64(std::uint64_t &state) noexcept
+    {
+      std::uint64_t z = (state += 0x9E3779B97F4A7C15ULL);
+      z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+      z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+      return z ^ (z >> 31);
+    }
+
+    // One key word per (stripe, lane) offset, then scramble and finalize keys.
+    inline constexpr std::size_t kSecretWords = kLanes + kStripesPerBlock + 2 * kLanes + kLanes;
+
+    constexpr std::array<std::uint64_t, kSecretWords> make_secret() noexcept
+    {
+      std::array<std::uint64_t, kSecretWords> out{};
+      std::uint64_t state = 0x76697863707065ULL; // "vixcppe"
+      for (auto &word : out)
+      {
+        word = splitmix64(state);
+      }
+      return out;
+    }
+
+    inline constexpr auto kSecret = make_secret();
+    inline constexpr std::size_t kScrambleKey = kLanes + kStripesPerBlock;
+    inline constexpr std::size_t kFinalKey = kScrambleKey + kLanes;
+
+    inline std::uint64_t load64(const unsigned char *p) noexcept
+    {
+      std::uint64_t v;
+      std::memcpy(&v, p, sizeof(v));
+      return v; // little-endian hosts; big-endian hosts get different (still stable) tags
+    }
+
+    inline void accumulate_stripe(std::uint64_t *acc, const unsigned char *p, std::size_t keyOffset) noexcept
+    {
+      for (std::size_t i = 0; i < kLanes; ++i)
+      {
+        const std::uint64_t data = load64(p + 8 * i);
+        const std::uint64_t key = data ^ kSecret[keyOffset + i];
+        acc[i ^ 1] += data;
+        acc[i] += (key & 0xFFFFFFFFULL) * (key >> 32);
+      }
+    }
+
+    inline void scramble(std::uint64_t *acc) noexcept
+    {
+      for (std::size_t i = 0; i < kLanes; ++i)
+      {
+        std::uint64_t a = acc[i];
+        a ^= a >> 47;
+        a ^= kSecret[kScrambleKey + i];
+        acc[i] = a * kPrime32;
+      }
+    }
+
+    inline std::uint64_t mul128_fold64(std::uint64_t a, std::uint64_t b) noexcept
+    {
+#if defined(__SIZEOF_INT128__)
+      __extension__ using uint128 = unsigned __int128;
+      const uint128 product = static_cast<uint128>(a) * b;
+      return static_cast<std::uint64_t>(product) ^ static_cast<std::uint64_t>(product >> 64);
+#else
+      const std::uint64_t aLo = a & 0xFFFFFFFFULL, aHi = a >> 32;
+      const std::uint64_t bLo = b & 0xFFFFFFFFULL, bHi = b >> 32;
+      const std::uint64_t lolo = aLo * bLo, hilo = aHi * bLo, lohi = aLo * bHi, hihi = aHi * bHi;
+      const std::uint64_t cross = (lolo >> 32) + (hilo & 0xFFFFFFFFULL) + lohi;
+      const std::uint64_t upper = (hilo >> 32) + (cross >> 32) + hihi;
+      const std::uint64_t lower = (cross << 32) | (lolo & 0xFFFFFFFFULL);
+      return lower ^ upper;
+#endif
+    }
+
+    inline std::uint64_t avalanche(std::uint64_t h) noexcept
+    {
+      h ^= h >> 37;
+      h *= 0x165667919E3779F9ULL;
+      return h ^ (h >> 32);
+    }
+  } // namespace detail
+
+  // Incremental hasher: update() any number of times, then digest(). The
+  // result depends only on the concatenated bytes, not on how they were
+  // split across update() calls.
+  class FastHasher
+  {
+  public:
+    FastHasher() noexcept
+    {
+      reset();
+    }
+
+    void reset() noexcept
+    {
+      acc_ = {detail::kPrime32, detail::kPrime64a, detail::kPrime64b, 0x165667B19E3779F9ULL,
+              0x85EBCA77C2B2AE63ULL, 0x27D4EB2F165667C5ULL, detail::kPrime64a ^ detail::kPrime64b, detail::kPrime32 << 32};
+      total_ = 0;
+      buffered_ = 0;
+      stripe_ = 0;
+    }
+
+    void update(std::string_view data) noexcept
+    {
+      if (data.empty())
+      {
+        return;
+      }
+      const auto *p = reinterpret_cast<const unsigned char *>(data.data());
+      std::size_t n = data.size();
+      total_ += n;
+
+      // Top up a partial stripe first.
+      if (buffered_ > 0)
+      {
+        const std::size_t take = std::min(n, detail::kStripe - buffered_);
+        std::memcpy(buffer_.data() + buffered_, p, take);
+        buffered_ += take;
+        p += take;
+        n -= take;
+        if (n == 0)
+        {
+          return; // a full buffer may still be the tail
+        }
+        consume(buffer_.data());
+        buffered_ = 0;
+      }
+
+      // Hold back the last (possibly full) stripe: digest() treats the
+      // tail specially and must always have it.
+      while (n > detail::kStripe)
+      {
+        consume(p);
+        p += detail::kStripe;
+        n -= detail::kStripe;
+      }
+
+      std::memcpy(buffer_.data(), p, n);
+      buffered_ = n;
+    }
+
+    // Does not modify the state; more update() calls may follow.
+    [[nodiscard]] Hash128 digest() const noexcept
+    {
+      auto acc = acc_;
+
+      // The tail stripe, zero-padded, with its own key offset; the total
+      // length below separates real zero bytes from padding.
+      std::array<unsigned char, detail::kStripe> tail{};
+      std::memcpy(tail.data(), buffer_.data(), buffered_);
+      detail::accumulate_stripe(acc.data(), tail.data(), detail::kStripesPerBlock - 1);
+
+      const auto len = static_cast<std::uint64_t>(total_);
+      std::uint64_t lo = len * detail::kPrime64a;
+      std::uint64_t hi = ~len * detail::kPrime64b;
+      for (std::size_t i = 0; i < detail::kLanes; i += 2)
+      {
+        lo += detail::mul128_fold64(acc[i] ^ detail::kSecret[detail::kFinalKey + i],
+                                    acc[i + 1] ^ detail::kSecret[detail::kFinalKey + i + 1]);
+        hi += detail::mul128_fold64(acc[i] ^ detail::kSecret[detail::kFinalKey + detail::kLanes + i],
+                                    acc[i + 1] ^ detail::kSecret[detail::kFinalKey + detail::kLanes + i + 1]);
+      }
+      return Hash128{detail::avalanche(lo), detail::avalanche(hi + lo)};
+    }
+
+    [[nodiscard]] std::size_t size() const noexcept { return total_; }
+
+  private:
+    void consume(const unsigned char *stripe) noexcept
+    {
+      detail::accumulate_stripe(acc_.data(), stripe, stripe_);
+      if (++stripe_ == detail::kStripesPerBlock)
+      {
+        detail::scramble(acc_.data());
+        stripe_ = 0;
+      }
+    }
+
+    std::array<std::uint64_t, detail::kLanes> acc_{};
+    std::array<unsigned char, detail::kStripe> buffer_{};
+    std::size_t total_{0};
+    std::size_t buffered_{0};
+    std::size_t stripe_{0};
+  };
+
+  inline Hash128 fast_hash128(std::string_view data) noexcept
+  {
+    FastHasher hasher;
+    hasher.update(data);
+    return hasher.digest();
+  }
+} // namespace vix_examples::etag
+
+#endif // VIX_EXAMPLES_ETAG_FAST_HASH_HPP
@@ -0,0 +1,420 @@
+/**
+ *
+ *  @file cidr_trie.hpp
+ *  @author Gaspard Kirira
+ *
+ *  Copyright 2025, Gaspard Kirira.
+ *  All rights reserved.
+ *  https://github.com/vixcpp/vix
+ *
+ *  Use of this source code is governed by a MIT license
+ *  that can be found in the License file.
+ *
+ *  Vix.cpp
+ *
+ */
+#ifndef VIX_EXAMPLES_IP_FILTER_CIDR_TRIE_HPP
+#define VIX_EXAMPLES_IP_FILTER_CIDR_TRIE_HPP
+
+// IPv4/IPv6 CIDR set as a path-compressed binary (Patricia) trie.
+//
+//   CidrSet set;
+//   set.add("10.0.0.0/8", 1);
+//   set.add("2001:db8::/32", 2);
+//   set.find("10.1.2.3");        // -> 1 (id of the longest match)
+//
+// A lookup visits at most one node per prefix bit (32 or 128) and does
+// one masked compare per node, whatever the number of prefixes. Nodes
+// live in one vector and refer to each other by index, so 200k prefixes
+// make a few MiB of contiguous memory.
+//
+// freeze() adds a 64K-entry table on the first 16 bits, so a lookup
+// starts where those bits already lead instead of walking the top of the
+// trie (the part that costs a cache miss per level).
+//
+// Addresses are parsed with inet_pton (POSIX). IPv4-mapped IPv6
+// addresses (::ffff:a.b.c.d) match IPv4 prefixes.
+
+#include <arpa/inet.h>
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <charconv>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace vix_examples::ip_filter
+{
+  // 128-bit address; IPv4 sits in the top 32 bits of `hi`.
+  struct IpBits
+  {
+    std::uint64_t hi{0};
+    std::uint64_t lo{0};
+  };
+
+  struct IpAddress
+  {
+    IpBits bits{};
+    bool v6{false};
+
+    [[nodiscard]] unsigned width() const noexcept
+    {
+      return v6 ? 128u : 32u;
+    }
+  };
+
+  struct Cidr
+  {
+    IpAddress address{}; // host bits cleared
+    unsigned length{0};
+  };
+
+  inline std::optional<IpAddress> parse_ip(std::string_view text)
+  {
+    // inet_pton needs a terminated string; addresses are short.
+    char buffer[INET6_ADDRSTRLEN + 1];
+    if (text.empty() || text.size() >= sizeof(buffer))
+    {
+      return std::nullopt;
+    }
+    std::copy(text.begin(), text.end(), buffer);
+    buffer[text.size()] = '\0';
+
+    IpAddress out;
+    if (text.find(':') == std::string_view::npos)
+    {
+      std::array<unsigned char, 4> b{};
+      if (::inet_pton(AF_INET, buffer, b.data()) != 1)
+      {
+        return std::nullopt;
+      }
+      out.bits.hi = (std::uint64_t{b[0]} << 56) | (std::uint64_t{b[1]} << 48) |
+                    (std::uint64_t{b[2]} << 40) | (std::uint64_t{b[3]} << 32);
+      return out;
+    }
+
+    std::array<unsigned char, 16> b{};
+    if (::inet_pton(AF_INET6, buffer, b.data()) != 1)
+    {
+      return std::nullopt;
+    }
+    for (int i = 0; i < 8; ++i)
+    {
+      out.bits.hi = (out.bits.hi << 8) | b[i];
+      out.bits.lo = (out.bits.lo << 8) | b[8 + i];
+    }
+
+    // ::ffff:a.b.c.d is an IPv4 client on a dual-stack socket.
+    if (out.bits.hi == 0 && (out.bits.lo >> 32) == 0xffff)
+    {
+      return IpAddress{IpBits{out.bits.lo << 32, 0}, false};
+    }
+    out.v6 = true;
+    return out;
+  }
+
+  inline IpBits prefix_mask(unsigned length) noexcept
+  {
+    IpBits m;
+    m.hi = length == 0 ? 0 : (length >= 64 ? ~std::uint64_t{0} : ~std::uint64_t{0} << (64 - length));
+    m.lo = length <= 64 ? 0 : (length >= 128 ? ~std::uint64_t{0} : ~std::uint64_t{0} << (128 - length));
+    return m;
+  }
+
+  // "10.0.0.0/8", "2001:db8::/32", or a bare address (/32, /128).
+  inline std::optional<Cidr> parse_cidr(std::string_view text)
+  {
+    const auto slash = text.find('/');
+    auto address = parse_ip(text.substr(0, slash));
+    if (!address)
+    {
+      return std::nullopt;
+    }
+
+    const bool written_v6 = text.substr(0, slash).find(':') != std::string_view::npos;
+    unsigned length = written_v6 ? 128u : 32u;
+    if (slash != std::string_view::npos)
+    {
+      const auto digits = text.substr(slash + 1);
+      const auto [end, ec] = std::from_chars(digits.data(), digits.data() + digits.size(), length);
+      if (ec != std::errc{} || end != digits.data() + digits.size() || digits.empty() || length > (written_v6 ? 128u : 32u))
+      {
+        return std::nullopt;
+      }
+    }
+
+    // An IPv4-mapped /N becomes an IPv4 /(N - 96).
+    if (!address->v6 && written_v6)
+    {
+      if (slash != std::string_view::npos && length < 96)
+      {
+        return std::nullopt;
+      }
+      length = slash == std::string_view::npos ? 32 : length - 96;
+    }
+
+    const IpBits m = prefix_mask(length);
+    address->bits.hi &= m.hi;
+    address->bits.lo &= m.lo;
+    return Cidr{*address, length};
+  }
+
+  class CidrSet
+  {
+  public:
+    static constexpr std::int32_t npos = -1;
+
+    CidrSet()
+    {
+      for (auto &root : roots_)
+      {
+        root = static_cast<std::uint32_t>(nodes_.size());
+        nodes_.push_back(Node{});
+      }
+    }
+
+    // Returns false when `cidr` does not parse.
+    bool add(std::string_view cidr, std::int32_t id = 0)
+    {
+      const auto parsed = parse_cidr(cidr);
+      if (!parsed)
+      {
+        return false;
+      }
+      insert(*parsed, id);
+      return true;
+    }
+
+    // The first id given to a prefix is kept when it is added again.
+    void insert(const Cidr &cidr, std::int32_t id)
+    {
+      std::uint32_t n = roots_[cidr.address.v6 ? 1 : 0];
+      const IpBits key = cidr.address.bits;
+      const unsigned length = cidr.length;
+      index_ = {}; // stale until the next freeze()
+
+      for (;;)
+      {
+        if (nodes_[n].length == length)
+        {
+          if (nodes_[n].id == npos)
+          {
+            nodes_[n].id = id;
+            ++size_;
+          }
+          return;
+        }
+
+        const unsigned side = bit(key, nodes_[n].length);
+        const std::uint32_t c = nodes_[n].child[side];
+        if (c == 0)
+        {
+          nodes_[n].child[side] = make_node(key, length, id);
+          ++size_;
+          return;
+        }
+
+        const Node child = nodes_[c];
+        const unsigned common = common_prefix(key, child.key, std::min(length, child.length));
+        if (common == child.length)
+        {
+          n = c; // child's prefix is a prefix of ours
+          continue;
+        }
+
+        if (common == length)
+        {
+          // Ours is a prefix of the child's: slot in above it.
+          const std::uint32_t inserted = make_node(key, length, id);
+          nodes_[inserted].child[bit(child.key, length)] = c;
+          nodes_[n].child[side] = inserted;
+          ++size_;
+          return;
+        }
+
+        // They diverge at bit `common`: branch there.
+        const IpBits m = prefix_mask(common);
+        const std::uint32_t branch = make_node(IpBits{key.hi & m.hi, key.lo & m.lo}, common, npos);
+        const std::uint32_t leaf = make_node(key, length, id);
+        nodes_[branch].child[bit(key, common)] = leaf;
+        nodes_[branch].child[bit(child.key, common)] = c;
+        nodes_[n].child[side] = branch;
+        ++size_;
+        return;
+      }
+    }
+
+    // Id of the longest prefix containing `address`, or npos.
+    [[nodiscard]] std::int32_t find(const IpAddress &address) const noexcept
+    {
+      const IpBits key = address.bits;
+      const unsigned width = address.width();
+
+      const auto family = address.v6 ? 1u : 0u;
+      std::uint32_t n = roots_[family];
+      std::int32_t best = nodes_[n].id;
+
+      if (!index_[family].empty())
+      {
+        const Start &start = index_[family][key.hi >> (64 - kIndexBits)];
+        if (start.done)
+        {
+          return start.best;
+        }
+        n = start.node;
+        best = start.best;
+      }
+
+      while (nodes_[n].length < width)
+      {
+        const std::uint32_t c = nodes_[n].child[bit(key, nodes_[n].length)];
+        if (c == 0)
+        {
+          break;
+        }
+
+        const Node &child = nodes_[c];
+        const IpBits m = prefix_mask(child.length);
+        if (((key.hi ^ child.key.hi) & m.hi) != 0 || ((key.lo ^ child.key.lo) & m.lo) != 0)
+        {
+          break;
+        }
+        if (child.id != npos)
+        {
+          best = child.id;
+        }
+        n = c;
+      }
+      return best;
+    }
+
+    [[nodiscard]] std::int32_t find(std::string_view ip) const
+    {
+      const auto address = parse_ip(ip);
+      return address ? find(*address) : npos;
+    }
+
+    [[nodiscard]] bool contains(std::string_view ip) const
+    {
+      return find(ip) != npos;
+    }
+
+    [[nodiscard]] std::size_t size() const noexcept
+    {
+      return size_;
+    }
+
+    [[nodiscard]] bool empty() const noexcept
+    {
+      return size_ == 0;
+    }
+
+    [[nodiscard]] std::size_t memory_bytes() const noexcept
+    {
+      return nodes_.capacity() * sizeof(Node) + (index_[0].capacity() + index_[1].capacity()) * sizeof(Start);
+    }
+
+    // Builds the first-level table; call once the set is complete.
+    // Another insert drops it until the next freeze().
+    void freeze()
+    {
+      nodes_.shrink_to_fit();
+
+      for (unsigned family = 0; family < 2; ++family)
+      {
+        auto &table = index_[family];
+        const Node &root = nodes_[roots_[family]];
+        if (root.child[0] == 0 && root.child[1] == 0)
+        {
+          table.clear(); // no prefixes in this family: nothing to skip
+          continue;
+        }
+        table.assign(std::size_t{1} << kIndexBits, Start{});
+
+        for (std::uint64_t v = 0; v < table.size(); ++v)
+        {
+          const IpBits key{v << (64 - kIndexBits), 0};
+          Start &start = table[v];
+          start.node = roots_[family];
+          start.best = nodes_[start.node].id;
+
+          // Same walk as find(), limited to nodes these 16 bits decide.
+          while (nodes_[start.node].length < kIndexBits)
+          {
+            const std::uint32_t c = nodes_[start.node].child[bit(key, nodes_[start.node].length)];
+            if (c == 0)
+            {
+              start.done = 1;
+              break;
+            }
+
+            const Node &child = nodes_[c];
+            if (child.length > kIndexBits)
+            {
+              break; // depends on later bits: find() resumes here
+            }
+            if (((key.hi ^ child.key.hi) & prefix_mask(child.length).hi) != 0)
+            {
+              start.done = 1;
+              break;
+            }
+            if (child.id != npos)
+            {
+              start.best = child.id;
+            }
+            start.node = c;
+          }
+        }
+      }
+    }
+
+  private:
+    static constexpr unsigned kIndexBits = 16;
+
+    struct Start
+    {
+      std::uint32_t node{0};
+      std::int32_t best{npos};
+      std::uint32_t done{0}; // best is final, no need to walk
+    };
+
+    struct Node
+    {
+      IpBits key{};
+      std::uint32_t child[2]{0, 0}; // 0 = none (index 0 is a root)
+      std::int32_t id{npos};
+      std::uint32_t length{0};
+    };
+
+    static unsigned bit(const IpBits &key, unsigned i) noexcept
+    {
+      return i < 64 ? static_cast<unsigned>((key.hi >> (63 - i)) & 1u)
+                    : static_cast<unsigned>((key.lo >> (127 - i)) & 1u);
+    }
+
+    static unsigned common_prefix(const IpBits &a, const IpBits &b, unsigned limit) noexcept
+    {
+      const std::uint64_t hi = a.hi ^ b.hi;
+      const unsigned n = hi != 0 ? static_cast<unsigned>(std::countl_zero(hi))
+                                 : 64u + static_cast<unsigned>(std::countl_zero(a.lo ^ b.lo));
+      return std::min(n, limit);
+    }
+
+    std::uint32_t make_node(const IpBits &key, unsigned length, std::int32_t id)
+    {
+      nodes_.push_back(Node{key, {0, 0}, id, length});
+      return static_cast<std::uint32_t>(nodes_.size() - 1);
+    }
+
+    std::vector<Node> nodes_;
+    std::array<std::uint32_t, 2> roots_{}; // IPv4, IPv6
+    std::array<std::vector<Start>, 2> index_{};
+    std::size_t size_{0};
+  };
+} // namespace vix_examples::ip_filter
+
+#endif // VIX_EXAMPLES_IP_FILTER_CIDR_TRIE_HPP
@@ -0,0 +1,361 @@
+/**
+ *
+ *  @file compiled_ip_filter.hpp
+ *  @author Gaspard Kirira
+ *
+ *  Copyright 2025, Gaspard Kirira.
+ *  All rights reserved.
+ *  https://github.com/vixcpp/vix
+ *
+ *  Use of this source code is governed by a MIT license
+ *  that can be found in the License file.
+ *
+ *  Vix.cpp
+ *
+ */
+#ifndef VIX_EXAMPLES_IP_FILTER_COMPILED_IP_FILTER_HPP
+#define VIX_EXAMPLES_IP_FILTER_COMPILED_IP_FILTER_HPP
+
+// IP filter whose allow/deny lists are compiled into CIDR tries once, at
+// startup or on reload, instead of being scanned per request.
+//
+// Same rules as security::ip_filter: deny wins, then a non-empty allow
+// list admits only its members. Entries may be addresses or CIDR ranges,
+// IPv4 or IPv6.
+//
+// ReloadableIpFilter holds the current CompiledIpFilter behind an atomic
+// shared_ptr. Requests keep using the old lists while new ones are parsed;
+// the swap is one pointer store, and a list file that fails to read keeps
+// the previous lists in place. watch() polls the files' mtimes.
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <vix.hpp>
+
+#include "cidr_trie.hpp"
+
+namespace vix_examples::ip_filter
+{
+  enum class IpVerdict
+  {
+    allowed,
+    denied,      // matched the deny list
+    not_allowed, // allow list set, no match
+  };
+
+  // One parsed list, with the source text of each rule for diagnostics.
+  struct IpRuleList
+  {
+    CidrSet set;
+    std::vector<std::string> rules;          // rules[id]
+    std::vector<std::string> errors;         // "file:line: text"
+
+    bool add(std::string_view rule, std::string_view origin = {})
+    {
+      const auto id = static_cast<std::int32_t>(rules.size());
+      if (!set.add(rule, id))
+      {
+        errors.push_back(std::string(origin) + (origin.empty() ? "" : ": ") + std::string(rule));
+        return false;
+      }
+      rules.emplace_back(rule);
+      return true;
+    }
+
+    // One rule per line; '#' starts a comment.
+    bool load_file(const std::filesystem::path &path)
+    {
+      std::ifstream in(path);
+      if (!in)
+      {
+        errors.push_back(path.string() + ": cannot open");
+        return false;
+      }
+
+      std::string line;
+      std::size_t number = 0;
+      while (std::getline(in, line))
+      {
+        ++number;
+        std::string_view text = line;
+        text = text.substr(0, text.find('#'));
+        const auto first = text.find_first_not_of(" \t\r");
+        if (first == std::string_view::npos)
+        {
+          continue;
+        }
+        text = text.substr(first, text.find_last_not_of(" \t\r") - first + 1);
+        add(text, path.string() + ":" + std::to_string(number));
+      }
+      return true;
+    }
+  };
+
+  class CompiledIpFilter
+  {
+  public:
+    struct Match
+    {
+      IpVerdict verdict{IpVerdict::allowed};
+      std::string_view rule{}; // the matching deny/allow rule, if any
+    };
+
+    CompiledIpFilter() = default;
+
+    CompiledIpFilter(IpRuleList allow, IpRuleList deny)
+        : allow_(std::move(allow)), deny_(std::move(deny))
+    {
+      allow_.set.freeze();
+      deny_.set.freeze();
+    }
+
+    static CompiledIpFilter from_lists(const std::vector<std::string> &allow, const std::vector<std::string> &deny)
+    {
+      IpRuleList a;
+      IpRuleList d;
+      for (const auto &rule : allow)
+      {
+        a.add(rule);
+      }
+      for (const auto &rule : deny)
+      {
+        d.add(rule);
+      }
+      return CompiledIpFilter(std::move(a), std::move(d));
+    }
+
+    // An address that does not parse matches nothing.
+    [[nodiscard]] Match check(std::string_view ip) const
+    {
+      const auto address = parse_ip(ip);
+
+      if (address)
+      {
+        if (const auto id = deny_.set.find(*address); id != CidrSet::npos)
+        {
+          return Match{IpVerdict::denied, deny_.rules[static_cast<std::size_t>(id)]};
+        }
+      }
+
+      if (allow_.set.empty())
+      {
+        return Match{};
+      }
+
+      if (address)
+      {
+        if (const auto id = allow_.set.find(*address); id != CidrSet::npos)
+        {
+          return Match{IpVerdict::allowed, allow_.rules[static_cast<std::size_t>(id)]};
+        }
+      }
+      return Match{IpVerdict::not_allowed, {}};
+    }
+
+    [[nodiscard]] const IpRuleList &allow() const noexcept { return allow_; }
+    [[nodiscard]] const IpRuleList &deny() const noexcept { return deny_; }
+
+  private:
+    IpRuleList allow_;
+    IpRuleList deny_;
+  };
+
+  class ReloadableIpFilter
+  {
+  public:
+    struct Files
+    {
+      std::filesystem::path allow{}; // empty = no allow list
+      std::filesystem::path deny{};
+    };
+
+    struct ReloadResult
+    {
+      bool swapped{false};
+      std::size_t allow_rules{0};
+      std::size_t deny_rules{0};
+      std::vector<std::string> errors; // bad lines are skipped, unreadable files abort
+    };
+
+    explicit ReloadableIpFilter(std::shared_ptr<const CompiledIpFilter> initial = std::make_shared<const CompiledIpFilter>())
+        : current_(std::move(initial))
+    {
+    }
+
+    ReloadableIpFilter(const ReloadableIpFilter &) = delete;
+    ReloadableIpFilter &operator=(const ReloadableIpFilter &) = delete;
+
+    ~ReloadableIpFilter()
+    {
+      stop_watching();
+    }
+
+    [[nodiscard]] std::shared_ptr<const CompiledIpFilter> current() const
+    {
+      return current_.load(std::memory_order_acquire);
+    }
+
+    void replace(std::shared_ptr<const CompiledIpFilter> next)
+    {
+      current_.store(std::move(next), std::memory_order_release);
+      generation_.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    // Parses both files off to the side and swaps them in together.
+    ReloadResult reload(const Files &files)
+    {
+      ReloadResult result;
+
+      IpRuleList allow;
+      IpRuleList deny;
+      const bool ok = (files.allow.empty() || allow.load_file(files.allow)) &&
+                      (files.deny.empty() || deny.load_file(files.deny));
+
+      result.errors = allow.errors;
+      result.errors.insert(result.errors.end(), deny.errors.begin(), deny.errors.end());
+      if (!ok)
+      {
+        return result;
+      }
+
+      result.allow_rules = allow.set.size();
+      result.deny_rules = deny.set.size();
+      replace(std::make_shared<const CompiledIpFilter>(std::move(allow), std::move(deny)));
+      result.swapped = true;
+      return result;
+    }
+
+    // Reloads whenever either file's mtime changes; `on_reload` sees each result.
+    void watch(Files files,
+               std::chrono::milliseconds interval = std::chrono::seconds(2),
+               std::function<void(const ReloadResult &)> on_reload = {})
+    {
+      stop_watching();
+      stopping_ = false;
+
+      watcher_ = std::thread([this, files = std::move(files), interval, on_reload = std::move(on_reload)]
+                             {
+                               auto seen = stamps(files);
+                               std::unique_lock<std::mutex> lock(mutex_);
+                               while (!wake_.wait_for(lock, interval, [this] { return stopping_; }))
+                               {
+                                 const auto now = stamps(files);
+                                 if (now == seen)
+                                 {
+                                   continue;
+                                 }
+
+                                 lock.unlock();
+                                 const auto result = reload(files);
+                                 if (on_reload)
+                                 {
+                                   on_reload(result);
+                                 }
+                                 lock.lock();
+
+                                 // A failed read is retried on the next poll.
+                                 if (result.swapped)
+                                 {
+                                   seen = now;
+                                 }
+                               } });
+    }
+
+    void stop_watching()
+    {
+      if (!watcher_.joinable())
+      {
+        return;
+      }
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+      }
+      wake_.notify_all();
+      watcher_.join();
+    }
+
+    [[nodiscard]] std::uint64_t generation() const noexcept
+    {
+      return generation_.load(std::memory_order_relaxed);
+    }
+
+  private:
+    static std::pair<std::filesystem::file_time_type, std::filesystem::file_time_type> stamps(const Files &files)
+    {
+      std::error_code ec;
+      const auto allow = files.allow.empty() ? std::filesystem::file_time_type{} : std::filesystem::last_write_time(files.allow, ec);
+      const auto deny = files.deny.empty() ? std::filesystem::file_time_type{} : std::filesystem::last_write_time(files.deny, ec);
+      return {allow, deny};
+    }
+
+    std::atomic<std::shared_ptr<const CompiledIpFilter>> current_;
+    std::atomic<std::uint64_t> generation_{0};
+
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    bool stopping_{false};
+    std::thread watcher_;
+  };
+
+  struct IpFilterMiddlewareOptions
+  {
+    std::string header_name{"x-forwarded-for"}; // first hop is the client
+    bool use_remote_addr_fallback{true};        // then x-real-ip
+  };
+
+  inline std::string client_ip(const vix::Request &req, const IpFilterMiddlewareOptions &options)
+  {
+    std::string value = req.header(options.header_name);
+    if (value.empty() && options.use_remote_addr_fallback)
+    {
+      value = req.header("x-real-ip");
+    }
+
+    value = value.substr(0, value.find(','));
+    const auto first = value.find_first_not_of(' ');
+    const auto last = value.find_last_not_of(' ');
+    return first == std::string::npos ? std::string{} : value.substr(first, last - first + 1);
+  }
+
+  // Middleware for app.use(prefix, ...): 403 ip_denied / ip_not_allowed.
+  inline std::function<void(vix::Request &, vix::Response &, vix::App::Next)>
+  ip_filter_middleware(std::shared_ptr<ReloadableIpFilter> filter, IpFilterMiddlewareOptions options = {})
+  {
+    return [filter = std::move(filter), options = std::move(options)](vix::Request &req, vix::Response &res, vix::App::Next next)
+    {
+      const auto lists = filter->current(); // stays valid across a reload
+      const auto match = lists->check(client_ip(req, options));
+
+      switch (match.verdict)
+      {
+      case IpVerdict::allowed:
+        next();
+        return;
+      case IpVerdict::denied:
+        res.status(403).json({"ok", false, "error", "ip_denied"});
+        return;
+      case IpVerdict::not_allowed:
+        res.status(403).json({"ok", false, "error", "ip_not_allowed"});
+        return;
+      }
+    };
+  }
+} // namespace vix_examples::ip_filter
+
+#endif // VIX_EXAMPLES_IP_FILTER_COMPILED_IP_FILTER_HPP
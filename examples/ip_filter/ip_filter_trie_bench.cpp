@@ -0,0 +1,209 @@
+/**
+ *
+ *  @file  ip_filter_trie_bench.cpp — CIDR trie lookups per second (Vix.cpp)
+ *  @author Gaspard Kirira
+ *
+ *  Copyright 2025, Gaspard Kirira.  All rights reserved.
+ *  https://github.com/vixcpp/vix
+ *  Use of this source code is governed by a MIT license
+ *  that can be found in the License file.
+ *
+ *  Vix.cpp
+ *
+ */
+// ----------------------------------------------------------------------------
+// Run:
+//   vix run ip_filter_trie_bench.cpp
+//
+// Knobs (environment):
+//   VIX_IPF_BENCH_RULES    CIDRs in the deny list (default 200000, 10% IPv6)
+//   VIX_IPF_BENCH_LOOKUPS  lookups per run (default 2000000)
+//
+// Builds a deny list of random CIDRs and measures lookups per second for
+// the compiled trie, with and without address parsing. A linear scan over
+// the same rules, as a per-request list check would do, runs on a small
+// sample and doubles as a correctness check.
+// ============================================================================
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "cidr_trie.hpp"
+#include "compiled_ip_filter.hpp"
+
+using namespace vix_examples::ip_filter;
+
+static std::size_t env_size(const char *name, std::size_t fallback)
+{
+  const char *value = std::getenv(name);
+  if (value == nullptr || *value == '\0')
+  {
+    return fallback;
+  }
+  return static_cast<std::size_t>(std::strtoull(value, nullptr, 10));
+}
+
+static std::string ipv4(std::uint32_t v)
+{
+  return std::to_string(v >> 24) + "." + std::to_string((v >> 16) & 255) + "." +
+         std::to_string((v >> 8) & 255) + "." + std::to_string(v & 255);
+}
+
+static std::string ipv6(std::uint64_t hi, std::uint64_t lo)
+{
+  static constexpr char digits[] = "0123456789abcdef";
+  std::string out;
+  for (int group = 0; group < 8; ++group)
+  {
+    const std::uint64_t word = group < 4 ? hi : lo;
+    const int shift = 48 - 16 * (group % 4);
+    const unsigned v = static_cast<unsigned>((word >> shift) & 0xffff);
+    if (group > 0)
+    {
+      out += ':';
+    }
+    for (int d = 12; d >= 0; d -= 4)
+    {
+      out += digits[(v >> d) & 15];
+    }
+  }
+  return out;
+}
+
+static bool linear_match(const std::vector<Cidr> &rules, const IpAddress &address)
+{
+  for (const auto &rule : rules)
+  {
+    if (rule.address.v6 != address.v6)
+    {
+      continue;
+    }
+    const IpBits m = prefix_mask(rule.length);
+    if (((address.bits.hi ^ rule.address.bits.hi) & m.hi) == 0 &&
+        ((address.bits.lo ^ rule.address.bits.lo) & m.lo) == 0)
+    {
+      return true;
+    }
+  }
+  return false;
+}
+
+template <class F>
+static double per_second(std::size_t n, F &&fn)
+{
+  const auto start = std::chrono::steady_clock::now();
+  fn();
+  const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+  return static_cast<double>(n) / elapsed.count();
+}
+
+int main()
+{
+  const std::size_t ruleCount = env_size("VIX_IPF_BENCH_RULES", 200'000);
+  const std::size_t lookups = env_size("VIX_IPF_BENCH_LOOKUPS", 2'000'000);
+
+  std::mt19937_64 rng(42);
+  std::uniform_int_distribution<unsigned> v4len(16, 32);
+  std::uniform_int_distribution<unsigned> v6len(32, 64);
+
+  // 1) Rules: 90% IPv4 /16../32, 10% IPv6 /32../64 under 2001::/16.
+  std::vector<std::string> text;
+  text.reserve(ruleCount);
+  for (std::size_t i = 0; i < ruleCount; ++i)
+  {
+    if (i % 10 == 9)
+    {
+      const std::uint64_t hi = (0x2001ULL << 48) | (rng() >> 16);
+      text.push_back(ipv6(hi, 0) + "/" + std::to_string(v6len(rng)));
+    }
+    else
+    {
+      text.push_back(ipv4(static_cast<std::uint32_t>(rng())) + "/" + std::to_string(v4len(rng)));
+    }
+  }
+
+  std::shared_ptr<const CompiledIpFilter> filter;
+  const auto buildStart = std::chrono::steady_clock::now();
+  filter = std::make_shared<const CompiledIpFilter>(CompiledIpFilter::from_lists({}, text));
+  const std::chrono::duration<double, std::milli> buildMs = std::chrono::steady_clock::now() - buildStart;
+
+  const CidrSet &set = filter->deny().set;
+  std::cout << ruleCount << " rules compiled in " << std::fixed << std::setprecision(1) << buildMs.count()
+            << " ms, " << set.size() << " distinct prefixes, "
+            << static_cast<double>(set.memory_bytes()) / (1024.0 * 1024.0) << " MiB\n";
+
+  // 2) Probe addresses: half drawn from inside rules, half random.
+  std::vector<std::string> probes;
+  probes.reserve(lookups);
+  std::uniform_int_distribution<std::size_t> pick(0, ruleCount - 1);
+  for (std::size_t i = 0; i < lookups; ++i)
+  {
+    if (i % 2 == 0)
+    {
+      const auto rule = parse_cidr(text[pick(rng)]);
+      const IpBits m = prefix_mask(rule->length);
+      const std::uint64_t hostHi = rng() & ~m.hi;
+      const std::uint64_t hostLo = rng() & ~m.lo;
+      probes.push_back(rule->address.v6 ? ipv6(rule->address.bits.hi | hostHi, rule->address.bits.lo | hostLo)
+                                        : ipv4(static_cast<std::uint32_t>((rule->address.bits.hi | hostHi) >> 32)));
+    }
+    else
+    {
+      probes.push_back(i % 20 == 19 ? ipv6((0x2001ULL << 48) | (rng() >> 16), rng()) : ipv4(static_cast<std::uint32_t>(rng())));
+    }
+  }
+
+  std::vector<IpAddress> parsed;
+  parsed.reserve(probes.size());
+  for (const auto &p : probes)
+  {
+    parsed.push_back(*parse_ip(p));
+  }
+
+  // 3) Lookups per second.
+  std::size_t hits = 0;
+  const double withParse = per_second(probes.size(), [&]
+                                      {
+                                        for (const auto &p : probes)
+                                        {
+                                          hits += filter->check(p).verdict == IpVerdict::denied ? 1 : 0;
+                                        } });
+
+  std::size_t hitsParsed = 0;
+  const double trieOnly = per_second(parsed.size(), [&]
+                                     {
+                                       for (const auto &a : parsed)
+                                       {
+                                         hitsParsed += set.find(a) != CidrSet::npos ? 1 : 0;
+                                       } });
+
+  // 4) Linear scan on a sample; also checks the trie's answers.
+  std::vector<Cidr> rules;
+  rules.reserve(text.size());
+  for (const auto &t : text)
+  {
+    rules.push_back(*parse_cidr(t));
+  }
+
+  const std::size_t sample = std::min<std::size_t>(2'000, parsed.size());
+  std::size_t mismatches = 0;
+  const double linear = per_second(sample, [&]
+                                   {
+                                     for (std::size_t i = 0; i < sample; ++i)
+                                     {
+                                       mismatches += linear_match(rules, parsed[i]) != (set.find(parsed[i]) != CidrSet::npos) ? 1 : 0;
+                                     } });
+
+  std::cout << std::setprecision(0)
+            << "trie + parse : " << std::setw(12) << withParse << " lookups/s (" << hits << " denied)\n"
+            << "trie only    : " << std::setw(12) << trieOnly << " lookups/s (" << hitsParsed << " denied)\n"
+            << "linear scan  : " << std::setw(12) << linear << " lookups/s (" << sample << " sampled)\n"
+            << "mismatches   : " << mismatches << "\n";
+
+  return mismatches == 0 && hits == hitsParsed ? 0 : 1;
+}
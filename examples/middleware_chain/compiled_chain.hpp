@@ -0,0 +1,460 @@
+/**
+ *
+ *  @file compiled_chain.hpp
+ *  @author Gaspard Kirira
+ *
+ *  Copyright 2025, Gaspard Kirira.
+ *  All rights reserved.
+ *  https://github.com/vixcpp/vix
+ *
+ *  Use of this source code is governed by a MIT license
+ *  that can be found in the License file.
+ *
+ *  Vix.cpp
+ *
+ */
+#ifndef VIX_EXAMPLES_MIDDLEWARE_CHAIN_COMPILED_CHAIN_HPP
+#define VIX_EXAMPLES_MIDDLEWARE_CHAIN_COMPILED_CHAIN_HPP
+
+// Middleware stacks compiled once at startup.
+//
+// With app.use(prefix, mw), every middleware checks its prefix on every
+// request, and each when()/chain() wrapper adds a std::function layer.
+// ChainBuilder takes the same registrations and compile() produces, for
+// each distinct prefix, the list of middleware that applies to it. All
+// lists live in one flat array. At request time, one hash lookup (known
+// route) or a longest-prefix scan picks a list, which then runs with no
+// prefix checks and no wrappers. when() predicates are stored next to
+// their middleware instead of around it.
+//
+// Each App middleware step still costs a std::function call plus a new
+// next(). Steps registered as hooks (before()/after()) cost neither: a
+// run of hooks executes as a plain loop over function pointers.
+//
+// Why one lookup is enough: every registered prefix that matches a path
+// is also a prefix of the longest one that matches. So the longest
+// matching prefix decides the whole list.
+//
+// StaticChain<A, B, C> (alias chain<A, B, C>) goes further for hooks known
+// at compile time. Their before()/after() calls are inlined into one
+// function, and only the App boundary stays type-erased.
+
+#include <algorithm>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <vix.hpp>
+
+namespace vix_examples::middleware_chain
+{
+  using Middleware = vix::App::Middleware;
+  using Predicate = std::function<bool(const vix::Request &)>;
+
+  enum class PrefixMatch
+  {
+    plain,   // starts_with, as app.use(prefix, ...) does
+    segment, // "/api" matches "/api" and "/api/...", not "/apix"
+  };
+
+  inline bool prefix_matches(std::string_view path, std::string_view prefix, PrefixMatch mode) noexcept
+  {
+    if (!path.starts_with(prefix))
+    {
+      return false;
+    }
+    if (mode == PrefixMatch::plain || prefix.empty() || prefix.back() == '/' || path.size() == prefix.size())
+    {
+      return true;
+    }
+    return path[prefix.size()] == '/';
+  }
+
+  // A hook is a middleware split around next(): before() returns false to
+  // stop (it has written the response), and after() runs on the way back
+  // out. Hooks are shared by all request threads, so both methods are const.
+  template <class T>
+  concept BeforeHook = requires(const T &hook, vix::Request &req, vix::Response &res) {
+    { hook.before(req, res) } -> std::convertible_to<bool>;
+  };
+
+  template <class T>
+  concept AfterHook = requires(const T &hook, vix::Request &req, vix::Response &res) {
+    hook.after(req, res);
+  };
+
+  // The result of ChainBuilder::compile(). Immutable and shared by every
+  // request thread.
+  class CompiledChains
+  {
+  public:
+    // A hook called through plain function pointers: no std::function and
+    // no next object, so a run of hooks is a loop.
+    struct HookThunk
+    {
+      const void *self{nullptr};
+      bool (*before)(const void *, vix::Request &, vix::Response &){nullptr};
+      void (*after)(const void *, vix::Request &, vix::Response &){nullptr};
+    };
+
+    struct Step
+    {
+      const Middleware *fn{nullptr}; // null: a hook step
+      const Predicate *when{nullptr}; // null: always runs
+      HookThunk hook{};
+    };
+
+    CompiledChains(const CompiledChains &) = delete;
+    CompiledChains &operator=(const CompiledChains &) = delete;
+
+    // Index of the list for `path`.
+    [[nodiscard]] std::uint32_t resolve(std::string_view path) const
+    {
+      if (const auto it = exact_.find(path); it != exact_.end())
+      {
+        return it->second;
+      }
+      for (const auto &[prefix, chain] : prefixes_) // longest first; "" last
+      {
+        if (prefix_matches(path, prefix, mode_))
+        {
+          return chain;
+        }
+      }
+      return root_;
+    }
+
+    // Runs the list for the request's path; `done` is the route handler
+    // (App's next) and runs only if every middleware calls next().
+    void run(vix::Request &req, vix::Response &res, const vix::App::Next &done) const
+    {
+      const Range range = chains_[resolve(strip_query(req.path()))];
+      const Frame frame{flat_.data() + range.offset, range.count, &req, &res, &done};
+      run_from(frame, 0);
+    }
+
+    // Middleware count in the list `path` resolves to, for diagnostics.
+    [[nodiscard]] std::size_t chain_size(std::string_view path) const
+    {
+      return chains_[resolve(path)].count;
+    }
+
+    [[nodiscard]] std::size_t chain_count() const noexcept { return chains_.size(); }
+    [[nodiscard]] std::size_t step_count() const noexcept { return flat_.size(); }
+
+  private:
+    friend class ChainBuilder;
+
+    struct Range
+    {
+      std::uint32_t offset{0};
+      std::uint32_t count{0};
+    };
+
+    struct Frame
+    {
+      const Step *steps;
+      std::uint32_t count;
+      vix::Request *req;
+      vix::Response *res;
+      const vix::App::Next *done;
+    };
+
+    struct PathHash
+    {
+      using is_transparent = void;
+      std::size_t operator()(std::string_view s) const noexcept { return std::hash<std::string_view>{}(s); }
+    };
+
+    CompiledChains() = default;
+
+    static std::string_view strip_query(std::string_view path) noexcept
+    {
+      return path.substr(0, path.find('?'));
+    }
+
+    // Runs hooks from `i` in a loop until a middleware step, which gets a
+    // next() that continues after it. Then runs the after() of each hook
+    // entered here, innermost first.
+    static void run_from(const Frame &frame, std::uint32_t i)
+    {
+      std::uint64_t entered = 0; // bit k: hook i + k ran before()
+      std::uint32_t j = i;
+
+      for (; j < frame.count && frame.steps[j].fn == nullptr && j - i < 64; ++j)
+      {
+        const Step &step = frame.steps[j];
+        if (step.when != nullptr && !(*step.when)(*frame.req))
+        {
+          continue;
+        }
+        if (step.hook.before != nullptr && !step.hook.before(step.hook.self, *frame.req, *frame.res))
+        {
+          unwind(frame, i, j, entered);
+          return;
+        }
+        entered |= std::uint64_t{1} << (j - i);
+      }
+
+      if (j == frame.count)
+      {
+        if (*frame.done)
+        {
+          (*frame.done)();
+        }
+      }
+      else if (frame.steps[j].fn == nullptr)
+      {
+        run_from(frame, j); // more than 64 hooks in a row
+      }
+      else
+      {
+        const Step &step = frame.steps[j];
+        if (step.when != nullptr && !(*step.when)(*frame.req))
+        {
+          run_from(frame, j + 1);
+        }
+        else
+        {
+          // Captures 16 bytes, so std::function stores it inline (no allocation).
+          (*step.fn)(*frame.req, *frame.res, [&frame, j]
+                     { run_from(frame, j + 1); });
+        }
+      }
+
+      unwind(frame, i, j, entered);
+    }
+
+    static void unwind(const Frame &frame, std::uint32_t i, std::uint32_t j, std::uint64_t entered)
+    {
+      while (j-- > i)
+      {
+        const HookThunk &hook = frame.steps[j].hook;
+        if ((entered >> (j - i) & 1) != 0 && hook.after != nullptr)
+        {
+          hook.after(hook.self, *frame.req, *frame.res);
+        }
+      }
+    }
+
+    PrefixMatch mode_{PrefixMatch::plain};
+    std::vector<Middleware> middleware_; // registration order, owns the callables
+    std::vector<Predicate> predicates_;
+    std::vector<std::shared_ptr<const void>> hooks_; // owns hook objects
+    std::vector<Step> flat_;             // every list, back to back
+    std::vector<Range> chains_;
+    std::vector<std::pair<std::string, std::uint32_t>> prefixes_;
+    std::unordered_map<std::string, std::uint32_t, PathHash, std::equal_to<>> exact_;
+    std::uint32_t root_{0};
+  };
+
+  // Collects registrations in app.use() order, then compiles them.
+  class ChainBuilder
+  {
+  public:
+    explicit ChainBuilder(PrefixMatch mode = PrefixMatch::plain) : mode_(mode) {}
+
+    ChainBuilder &use(Middleware mw)
+    {
+      return use(std::string{}, std::move(mw));
+    }
+
+    ChainBuilder &use(std::string prefix, Middleware mw)
+    {
+      entries_.push_back(Entry{std::move(prefix), std::move(mw), nullptr, nullptr, {}});
+      return *this;
+    }
+
+    // Like app::when(pred, mw) under a prefix, without the wrapper layer.
+    ChainBuilder &use_if(std::string prefix, Predicate when, Middleware mw)
+    {
+      entries_.push_back(Entry{std::move(prefix), std::move(mw), std::move(when), nullptr, {}});
+      return *this;
+    }
+
+    // A hook (see BeforeHook/AfterHook) runs inline in the compiled loop,
+    // which costs a few ns instead of a std::function call and a next().
+    template <class Hook>
+      requires BeforeHook<Hook> || AfterHook<Hook>
+    ChainBuilder &use_hook(std::string prefix, Hook hook, Predicate when = {})
+    {
+      auto object = std::make_shared<const Hook>(std::move(hook));
+      CompiledChains::HookThunk thunk{object.get(), nullptr, nullptr};
+      if constexpr (BeforeHook<Hook>)
+      {
+        thunk.before = [](const void *self, vix::Request &req, vix::Response &res) -> bool
+        { return static_cast<const Hook *>(self)->before(req, res); };
+      }
+      if constexpr (AfterHook<Hook>)
+      {
+        thunk.after = [](const void *self, vix::Request &req, vix::Response &res)
+        { static_cast<const Hook *>(self)->after(req, res); };
+      }
+      entries_.push_back(Entry{std::move(prefix), Middleware{}, std::move(when), std::move(object), thunk});
+      return *this;
+    }
+
+    // Declares a route path. At request time it resolves with one hash
+    // lookup instead of the prefix scan. Paths with parameters need not
+    // be declared: they resolve through their prefix.
+    ChainBuilder &route(std::string path)
+    {
+      routes_.push_back(std::move(path));
+      return *this;
+    }
+
+    [[nodiscard]] std::shared_ptr<const CompiledChains> compile() const
+    {
+      std::shared_ptr<CompiledChains> out(new CompiledChains());
+      out->mode_ = mode_;
+
+      // Storage first, so Step pointers stay valid.
+      out->middleware_.reserve(entries_.size());
+      out->predicates_.reserve(entries_.size());
+      std::vector<const Predicate *> when(entries_.size(), nullptr);
+      for (std::size_t i = 0; i < entries_.size(); ++i)
+      {
+        out->middleware_.push_back(entries_[i].fn);
+        if (entries_[i].hook)
+        {
+          out->hooks_.push_back(entries_[i].hook);
+        }
+        if (entries_[i].when)
+        {
+          out->predicates_.push_back(entries_[i].when);
+          when[i] = &out->predicates_.back();
+        }
+      }
+
+      // One list per distinct prefix, "" included.
+      std::vector<std::string> prefixes{""};
+      for (const auto &entry : entries_)
+      {
+        prefixes.push_back(entry.prefix);
+      }
+      std::sort(prefixes.begin(), prefixes.end(), [](const std::string &a, const std::string &b)
+                { return a.size() != b.size() ? a.size() > b.size() : a < b; });
+      prefixes.erase(std::unique(prefixes.begin(), prefixes.end()), prefixes.end());
+
+      for (const auto &prefix : prefixes)
+      {
+        const auto id = static_cast<std::uint32_t>(out->chains_.size());
+        CompiledChains::Range range{static_cast<std::uint32_t>(out->flat_.size()), 0};
+        for (std::size_t i = 0; i < entries_.size(); ++i)
+        {
+          if (prefix_matches(prefix, entries_[i].prefix, mode_))
+          {
+            const bool isHook = entries_[i].hook != nullptr;
+            out->flat_.push_back({isHook ? nullptr : &out->middleware_[i], when[i], entries_[i].thunk});
+            ++range.count;
+          }
+        }
+        out->chains_.push_back(range);
+        out->prefixes_.emplace_back(prefix, id);
+        if (prefix.empty())
+        {
+          out->root_ = id;
+        }
+      }
+
+      for (const auto &path : routes_)
+      {
+        out->exact_.emplace(path, out->resolve(path));
+      }
+      return out;
+    }
+
+  private:
+    struct Entry
+    {
+      std::string prefix;
+      Middleware fn; // empty for hooks
+      Predicate when;
+      std::shared_ptr<const void> hook;
+      CompiledChains::HookThunk thunk;
+    };
+
+    PrefixMatch mode_;
+    std::vector<Entry> entries_;
+    std::vector<std::string> routes_;
+  };
+
+  // One App middleware that runs the compiled lists. Install it once with
+  // app.use() in place of the individual registrations.
+  inline Middleware compiled_middleware(std::shared_ptr<const CompiledChains> chains)
+  {
+    return [chains = std::move(chains)](vix::Request &req, vix::Response &res, vix::App::Next next)
+    {
+      chains->run(req, res, next);
+    };
+  }
+
+  // Hooks known at compile time, run in order with no type erasure:
+  //
+  //   struct RequireJson { bool before(Request &, Response &) const; };
+  //   struct Timing      { bool before(...) const; void after(...) const; };
+  //
+  //   app.use("/api", chain<Timing, RequireJson>{});
+  //
+  // Same hook semantics as ChainBuilder::use_hook(), but the whole chain
+  // is one function the compiler can inline.
+  template <class... Hooks>
+  class StaticChain
+  {
+    static_assert(((BeforeHook<Hooks> || AfterHook<Hooks>) && ...),
+                  "each hook needs a const before(req, res) -> bool and/or after(req, res)");
+
+  public:
+    StaticChain() = default;
+    explicit StaticChain(Hooks... hooks) : hooks_(std::move(hooks)...) {}
+
+    template <class Next>
+    void operator()(vix::Request &req, vix::Response &res, Next &&next) const
+    {
+      run<0>(req, res, next);
+    }
+
+  private:
+    template <std::size_t I, class Next>
+    void run(vix::Request &req, vix::Response &res, Next &next) const
+    {
+      if constexpr (I == sizeof...(Hooks))
+      {
+        next();
+      }
+      else
+      {
+        using Hook = std::tuple_element_t<I, std::tuple<Hooks...>>;
+        const Hook &hook = std::get<I>(hooks_);
+
+        if constexpr (BeforeHook<Hook>)
+        {
+          if (!hook.before(req, res))
+          {
+            return;
+          }
+        }
+        run<I + 1>(req, res, next);
+        if constexpr (AfterHook<Hook>)
+        {
+          hook.after(req, res);
+        }
+      }
+    }
+
+    std::tuple<Hooks...> hooks_;
+  };
+
+  template <class... Hooks>
+  using chain = StaticChain<Hooks...>;
+} // namespace vix_examples::middleware_chain
+
+#endif // VIX_EXAMPLES_MIDDLEWARE_CHAIN_COMPILED_CHAIN_HPP
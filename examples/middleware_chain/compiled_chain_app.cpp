@@ -0,0 +1,131 @@
+/**
+ *
+ *  @file  compiled_chain_app.cpp — Middleware stacks compiled once (Vix.cpp)
+ *  @author Gaspard Kirira
+ *
+ *  Copyright 2025, Gaspard Kirira.  All rights reserved.
+ *  https://github.com/vixcpp/vix
+ *  Use of this source code is governed by a MIT license
+ *  that can be found in the License file.
+ *
+ *  Vix.cpp
+ *
+ */
+// Run:
+//   vix run compiled_chain_app.cpp
+//
+// Test:
+//   # Global + /api + /api/users stacks, resolved by one hash lookup
+//   curl -s -D - http://localhost:8080/api/users
+//
+//   # Same stack through the prefix scan (path not declared as a route)
+//   curl -s -D - http://localhost:8080/api/users/42
+//
+//   # Segment matching: /apix does not get the /api stack
+//   curl -s -D - http://localhost:8080/apix
+//
+//   # RequireKey stops the request before the handler
+//   curl -s -D - http://localhost:8080/admin/stats
+//   curl -s -D - -H "x-api-key: secret" http://localhost:8080/admin/stats
+//
+//   # The compiled lists
+//   curl -s http://localhost:8080/_chains
+// ============================================================================
+
+#include <chrono>
+#include <iostream>
+#include <string>
+
+#include <vix.hpp>
+
+#include "compiled_chain.hpp"
+
+using namespace vix;
+using namespace vix_examples::middleware_chain;
+
+// Hooks: plain structs with a const before() and/or after().
+struct ServerHeader
+{
+  void after(Request &, Response &res) const { res.res.set_header("Server", "vix"); }
+};
+
+struct NoStore
+{
+  void after(Request &, Response &res) const { res.res.set_header("Cache-Control", "no-store"); }
+};
+
+struct RequireKey
+{
+  std::string key;
+
+  bool before(Request &req, Response &res) const
+  {
+    if (req.has_header("x-api-key") && req.header("x-api-key") == key)
+    {
+      return true;
+    }
+    res.res.set_status(401);
+    res.res.set_body("missing or invalid x-api-key");
+    return false;
+  }
+};
+
+struct StackTag
+{
+  const char *name;
+  void after(Request &, Response &res) const { res.res.set_header(std::string("X-Stack-") + name, "1"); }
+};
+
+int main()
+{
+  App app;
+
+  ChainBuilder builder(PrefixMatch::segment);
+
+  // An App middleware: anything that needs code around next().
+  builder.use([](Request &, Response &res, App::Next next)
+              {
+                const auto start = std::chrono::steady_clock::now();
+                next();
+                const auto us = std::chrono::duration_cast<std::chrono::microseconds>(
+                    std::chrono::steady_clock::now() - start);
+                res.res.set_header("X-Response-Time-Us", std::to_string(us.count())); });
+
+  // A compile-time chain of hooks is one App middleware step.
+  builder.use(chain<ServerHeader, StackTag>{ServerHeader{}, StackTag{"global"}});
+
+  // Everything else is a hook: no std::function call, no next().
+  builder.use_hook("/api", StackTag{"api"})
+      .use_hook("/api", NoStore{}, [](const Request &req)
+                { return req.method() != "GET"; })
+      .use_hook("/api/users", StackTag{"users"})
+      .use_hook("/admin", RequireKey{"secret"})
+      .route("/api/users")
+      .route("/admin/stats");
+
+  const auto chains = builder.compile();
+  app.use(compiled_middleware(chains));
+
+  app.get("/api/users", [](Request &, Response &res)
+          { res.json({"users", 2}); });
+
+  app.get("/api/users/{id}", [](Request &req, Response &res)
+          { res.json({"id", req.param("id")}); });
+
+  app.get("/apix", [](Request &, Response &res)
+          { res.json({"route", "apix"}); });
+
+  app.get("/admin/stats", [](Request &, Response &res)
+          { res.json({"ok", true}); });
+
+  app.get("/_chains", [chains](Request &, Response &res)
+          { res.json({"lists", chains->chain_count(),
+                      "steps", chains->step_count(),
+                      "api_users", chains->chain_size("/api/users/42"),
+                      "apix", chains->chain_size("/apix"),
+                      "admin", chains->chain_size("/admin/stats")}); });
+
+  std::cout << "Compiled middleware chains on http://localhost:8080\n";
+  app.run(8080);
+  return 0;
+}
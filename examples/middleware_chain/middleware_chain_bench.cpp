@@ -0,0 +1,242 @@
+/**
+ *
+ *  @file  middleware_chain_bench.cpp — Per-request vs compiled middleware dispatch (Vix.cpp)
+ *  @author Gaspard Kirira
+ *
+ *  Copyright 2025, Gaspard Kirira.  All rights reserved.
+ *  https://github.com/vixcpp/vix
+ *  Use of this source code is governed by a MIT license
+ *  that can be found in the License file.
+ *
+ *  Vix.cpp
+ *
+ */
+// ----------------------------------------------------------------------------
+// Run:
+//   vix run middleware_chain_bench.cpp
+//
+// Knobs (environment):
+//   VIX_CHAIN_BENCH_REQUESTS  requests per variant (default 2000000)
+//
+// The same 10-middleware stack for GET /api/users/42, three ways:
+//   per-request  prefix checks on every registration, when()/chain()
+//                wrappers, a new std::function next per step (App::use style)
+//   compiled     ChainBuilder::compile(): one lookup, then a flat array
+//                of App middlewares, or of hooks (use_hook)
+//   static       chain<H0, ..., H9>: hooks inlined, one call at the boundary
+// Middleware bodies are trivial, so the numbers are dispatch overhead.
+// ============================================================================
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <vix.hpp>
+
+#include "compiled_chain.hpp"
+
+using namespace vix_examples::middleware_chain;
+
+static std::uint64_t g_work = 0;
+
+static std::size_t env_size(const char *name, std::size_t fallback)
+{
+  const char *value = std::getenv(name);
+  if (value == nullptr || *value == '\0')
+  {
+    return fallback;
+  }
+  return static_cast<std::size_t>(std::strtoull(value, nullptr, 10));
+}
+
+static Middleware counting(std::uint64_t weight)
+{
+  return [weight](vix::Request &, vix::Response &, vix::App::Next next)
+  {
+    g_work += weight;
+    next();
+  };
+}
+
+static bool is_get(const vix::Request &req)
+{
+  return req.method() == "GET";
+}
+
+// --- per-request dispatch, as app.use(prefix, ...) plus wrappers ------------
+
+static Middleware when(Predicate pred, Middleware mw)
+{
+  return [pred = std::move(pred), mw = std::move(mw)](vix::Request &req, vix::Response &res, vix::App::Next next)
+  {
+    if (pred(req))
+    {
+      mw(req, res, std::move(next));
+      return;
+    }
+    next();
+  };
+}
+
+static Middleware chain2(Middleware a, Middleware b)
+{
+  return [a = std::move(a), b = std::move(b)](vix::Request &req, vix::Response &res, vix::App::Next next)
+  {
+    a(req, res, [&]
+      { b(req, res, next); });
+  };
+}
+
+class PerRequestStack
+{
+public:
+  void use(std::string prefix, Middleware mw) { stack_.emplace_back(std::move(prefix), std::move(mw)); }
+
+  void run(vix::Request &req, vix::Response &res, const vix::App::Next &done) const
+  {
+    step(0, req, res, done);
+  }
+
+private:
+  void step(std::size_t i, vix::Request &req, vix::Response &res, const vix::App::Next &done) const
+  {
+    for (; i < stack_.size(); ++i)
+    {
+      if (req.path().rfind(stack_[i].first, 0) == 0)
+      {
+        stack_[i].second(req, res, [this, i, &req, &res, &done]
+                         { step(i + 1, req, res, done); });
+        return;
+      }
+    }
+    done();
+  }
+
+  std::vector<std::pair<std::string, Middleware>> stack_;
+};
+
+// --- static hooks -------------------------------------------------------------
+
+template <int N>
+struct Hook
+{
+  bool before(vix::Request &, vix::Response &) const
+  {
+    g_work += N + 1;
+    return true;
+  }
+};
+
+struct Counting
+{
+  std::uint64_t weight;
+  bool before(vix::Request &, vix::Response &) const
+  {
+    g_work += weight;
+    return true;
+  }
+};
+
+template <class F>
+static double ns_per_request(std::size_t n, F &&fn)
+{
+  const auto start = std::chrono::steady_clock::now();
+  for (std::size_t i = 0; i < n; ++i)
+  {
+    fn();
+  }
+  const std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+  return elapsed.count() / static_cast<double>(n);
+}
+
+int main()
+{
+  const std::size_t requests = env_size("VIX_CHAIN_BENCH_REQUESTS", 2'000'000);
+
+  vix::Request req;
+  req.t = "/api/users/42";
+  vix::Response res;
+  std::uint64_t handled = 0;
+  const vix::App::Next handler = [&handled]
+  { ++handled; };
+
+  // 10 middlewares reach /api/users/42; /admin and /static ones do not.
+  PerRequestStack perRequest;
+  perRequest.use("", counting(1));
+  perRequest.use("", counting(2));
+  perRequest.use("/admin", counting(100));
+  perRequest.use("/api", counting(3));
+  perRequest.use("/api", when(is_get, counting(4)));
+  perRequest.use("/static", counting(100));
+  perRequest.use("/api/users", chain2(counting(5), counting(6)));
+  perRequest.use("/api/users", counting(7));
+  perRequest.use("/api/users", when(is_get, counting(8)));
+  perRequest.use("/api", counting(9));
+  perRequest.use("/api/users", counting(10));
+
+  ChainBuilder builder;
+  builder.use(counting(1))
+      .use(counting(2))
+      .use("/admin", counting(100))
+      .use("/api", counting(3))
+      .use_if("/api", is_get, counting(4))
+      .use("/static", counting(100))
+      .use("/api/users", counting(5))
+      .use("/api/users", counting(6))
+      .use("/api/users", counting(7))
+      .use_if("/api/users", is_get, counting(8))
+      .use("/api", counting(9))
+      .use("/api/users", counting(10));
+  const auto compiled = builder.compile();
+
+  ChainBuilder routed = builder;
+  routed.route("/api/users/42");
+  const auto compiledRouted = routed.compile();
+
+  ChainBuilder hookBuilder;
+  hookBuilder.use_hook("", Counting{1})
+      .use_hook("", Counting{2})
+      .use_hook("/admin", Counting{100})
+      .use_hook("/api", Counting{3})
+      .use_hook("/api", Counting{4}, is_get)
+      .use_hook("/static", Counting{100})
+      .use_hook("/api/users", Counting{5})
+      .use_hook("/api/users", Counting{6})
+      .use_hook("/api/users", Counting{7})
+      .use_hook("/api/users", Counting{8}, is_get)
+      .use_hook("/api", Counting{9})
+      .use_hook("/api/users", Counting{10});
+  const auto compiledHooks = hookBuilder.compile();
+
+  const chain<Hook<0>, Hook<1>, Hook<2>, Hook<3>, Hook<4>, Hook<5>, Hook<6>, Hook<7>, Hook<8>, Hook<9>> hooks;
+  const Middleware staticChain = hooks;
+
+  std::cout << "10 middlewares, GET /api/users/42, " << requests << " requests per variant\n\n";
+
+  const auto report = [&](const char *name, double ns)
+  {
+    std::cout << std::left << std::setw(32) << name << std::right << std::fixed << std::setprecision(1)
+              << std::setw(8) << ns << " ns/request\n";
+  };
+
+  report("per-request prefix + wrappers", ns_per_request(requests, [&]
+                                                         { perRequest.run(req, res, handler); }));
+  report("compiled (prefix scan)", ns_per_request(requests, [&]
+                                                  { compiled->run(req, res, handler); }));
+  report("compiled (declared route)", ns_per_request(requests, [&]
+                                                     { compiledRouted->run(req, res, handler); }));
+  report("compiled hooks (prefix scan)", ns_per_request(requests, [&]
+                                                        { compiledHooks->run(req, res, handler); }));
+  report("static chain<10 hooks>", ns_per_request(requests, [&]
+                                                  { staticChain(req, res, handler); }));
+
+  std::cout << "\ncompiled: " << compiled->chain_count() << " lists, " << compiled->step_count()
+            << " steps in the flat array; /api/users/42 runs " << compiled->chain_size("/api/users/42") << "\n"
+            << "(handled " << handled << ", work " << g_work << ")\n";
+  return 0;
+}
@@ -0,0 +1,192 @@
+/**
+ *
+ *  @file  rate_limit_state_bench.cpp — Rate limiter state under a unique-IP burst (Vix.cpp)
+ *  @author Gaspard Kirira
+ *
+ *  Copyright 2025, Gaspard Kirira.  All rights reserved.
+ *  https://github.com/vixcpp/vix
+ *  Use of this source code is governed by a MIT license
+ *  that can be found in the License file.
+ *
+ *  Vix.cpp
+ *
+ */
+// ----------------------------------------------------------------------------
+// Run:
+//   vix run rate_limit_state_bench.cpp
+//
+// Knobs (environment):
+//   VIX_RL_BENCH_OPS          hits per run (default 2000000)
+//   VIX_RL_BENCH_MAX_THREADS  highest thread count (default 32)
+//
+// Compares one map behind one mutex (what a single RateLimiterState
+// amounts to) with ShardedRateLimiter while every request comes from a
+// new IP, then checks that forked worker processes sharing a
+// SharedMemoryRateLimiter enforce a single limit.
+// ============================================================================
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "sharded_rate_limiter.hpp"
+#include "shm_rate_limiter.hpp"
+
+using namespace vix_examples::rate_limit;
+
+static std::size_t env_size(const char *name, std::size_t fallback)
+{
+  const char *value = std::getenv(name);
+  if (value == nullptr || *value == '\0')
+  {
+    return fallback;
+  }
+  return static_cast<std::size_t>(std::strtoull(value, nullptr, 10));
+}
+
+// Baseline: one lock, one ever-growing map.
+class SingleMapLimiter final : public RateLimiterBackend
+{
+public:
+  explicit SingleMapLimiter(RateLimitConfig config) : config_(config) {}
+
+  RateLimitDecision hit(std::string_view key) override
+  {
+    const std::int64_t now = steady_now_ms();
+    std::lock_guard<std::mutex> lock(mutex_);
+    return apply(config_, states_[std::string(key)], now);
+  }
+
+  std::size_t size()
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return states_.size();
+  }
+
+private:
+  RateLimitConfig config_;
+  std::mutex mutex_;
+  std::unordered_map<std::string, BucketState> states_;
+};
+
+static std::string ip_for(std::uint64_t n)
+{
+  return std::to_string(10 + (n >> 24) % 240) + "." + std::to_string((n >> 16) & 255) + "." +
+         std::to_string((n >> 8) & 255) + "." + std::to_string(n & 255);
+}
+
+// Every hit is a new client: the worst case for table growth.
+static double run(RateLimiterBackend &limiter, std::size_t threads, std::size_t ops)
+{
+  std::atomic<std::uint64_t> next{0};
+  std::vector<std::thread> workers;
+
+  const auto start = std::chrono::steady_clock::now();
+  for (std::size_t t = 0; t < threads; ++t)
+  {
+    workers.emplace_back([&]
+                         {
+                           for (;;)
+                           {
+                             const std::uint64_t n = next.fetch_add(1, std::memory_order_relaxed);
+                             if (n >= ops)
+                             {
+                               return;
+                             }
+                             (void)limiter.hit(ip_for(n));
+                           } });
+  }
+  for (auto &w : workers)
+  {
+    w.join();
+  }
+  const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+  return static_cast<double>(ops) / elapsed.count();
+}
+
+static int shared_memory_check()
+{
+  const std::string name = "/vix-rl-bench-" + std::to_string(::getpid());
+  SharedMemoryRateLimiter::unlink(name);
+
+  RateLimitConfig limit;
+  limit.algorithm = RateLimitAlgorithm::sliding_window;
+  limit.limit = 100;
+  limit.window_ms = 60'000;
+
+  const SharedMemoryRateLimiter::Config config{.name = name, .limit = limit, .max_keys = 1024};
+  SharedMemoryRateLimiter parent(config);
+
+  // 4 workers x 100 hits on one key, limit 100: exactly 100 may pass.
+  constexpr int workers = 4;
+  for (int i = 0; i < workers; ++i)
+  {
+    if (::fork() == 0)
+    {
+      SharedMemoryRateLimiter child(config);
+      int allowed = 0;
+      for (int n = 0; n < 100; ++n)
+      {
+        allowed += child.hit("203.0.113.7").allowed ? 1 : 0;
+      }
+      std::_Exit(allowed);
+    }
+  }
+
+  int total = 0;
+  for (int i = 0; i < workers; ++i)
+  {
+    int status = 0;
+    ::wait(&status);
+    total += WIFEXITED(status) ? WEXITSTATUS(status) : 0;
+  }
+
+  const auto s = parent.stats();
+  std::cout << "shared memory: " << workers << " processes x 100 hits, limit 100 -> allowed "
+            << total << " (table: allowed=" << s.allowed << " limited=" << s.limited << ")\n";
+
+  SharedMemoryRateLimiter::unlink(name);
+  return total == 100 ? 0 : 1;
+}
+
+int main()
+{
+  const std::size_t ops = env_size("VIX_RL_BENCH_OPS", 2'000'000);
+  const std::size_t maxThreads = env_size("VIX_RL_BENCH_MAX_THREADS", 32);
+
+  RateLimitConfig limit;
+  limit.capacity = 60.0;
+  limit.refill_per_sec = 1.0;
+
+  std::cout << "unique-IP burst, " << ops << " hits\n"
+            << std::setw(8) << "threads" << std::setw(18) << "single map op/s"
+            << std::setw(18) << "sharded op/s" << std::setw(14) << "map keys"
+            << std::setw(14) << "sharded keys" << "\n";
+
+  for (std::size_t threads = 1; threads <= maxThreads; threads *= 2)
+  {
+    SingleMapLimiter single(limit);
+    ShardedRateLimiter sharded(ShardedRateLimiter::Config{.limit = limit, .max_keys = 100'000});
+
+    const double a = run(single, threads, ops);
+    const double b = run(sharded, threads, ops);
+
+    std::cout << std::setw(8) << threads << std::fixed << std::setprecision(0)
+              << std::setw(18) << a << std::setw(18) << b
+              << std::setw(14) << single.size() << std::setw(14) << sharded.stats().keys << "\n";
+  }
+
+  return shared_memory_check();
+}
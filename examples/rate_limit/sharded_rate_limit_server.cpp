@@ -0,0 +1,110 @@
+/**
+ *
+ *  @file  sharded_rate_limit_server.cpp — Sharded / shared-memory rate limit (Vix.cpp)
+ *  @author Gaspard Kirira
+ *
+ *  Copyright 2025, Gaspard Kirira.  All rights reserved.
+ *  https://github.com/vixcpp/vix
+ *  Use of this source code is governed by a MIT license
+ *  that can be found in the License file.
+ *
+ *  Vix.cpp
+ *
+ */
+// ----------------------------------------------------------------------------
+// Run:
+//   vix run sharded_rate_limit_server.cpp
+//
+//   # several worker processes sharing one limit table (SO_REUSEPORT setups)
+//   VIX_RATE_LIMIT_SHM=/vix-rl vix run sharded_rate_limit_server.cpp
+//
+// Endpoints:
+//   GET  /                    (public)
+//   GET  /api/ping            sliding window, 20 requests / 10 s per client
+//   POST /auth/login          token bucket, burst 5, one more every 5 s
+//   GET  /_rate_limit/stats   table counters
+//
+// Test:
+//   for i in $(seq 1 22); do curl -s -o /dev/null -w "%{http_code} " -H "X-Forwarded-For: 9.9.9.9" http://localhost:8080/api/ping; done; echo
+//   # 20 x 200, then 429 with Retry-After
+// ============================================================================
+#include <cstdlib>
+#include <memory>
+#include <string>
+
+#include <vix.hpp>
+
+#include "sharded_rate_limiter.hpp"
+#include "shm_rate_limiter.hpp"
+
+using namespace vix;
+using namespace vix_examples::rate_limit;
+
+int main()
+{
+  App app;
+
+  RateLimitConfig api;
+  api.algorithm = RateLimitAlgorithm::sliding_window;
+  api.limit = 20;
+  api.window_ms = 10'000;
+
+  RateLimitConfig login;
+  login.algorithm = RateLimitAlgorithm::token_bucket;
+  login.capacity = 5.0;
+  login.refill_per_sec = 0.2;
+
+  std::shared_ptr<RateLimiterBackend> apiLimiter;
+  std::shared_ptr<RateLimiterBackend> loginLimiter;
+
+  if (const char *shm = std::getenv("VIX_RATE_LIMIT_SHM"); shm != nullptr && *shm == '/')
+  {
+    // One table per limit; every worker opening the same names shares them.
+    apiLimiter = std::make_shared<SharedMemoryRateLimiter>(
+        SharedMemoryRateLimiter::Config{.name = std::string(shm) + "-api", .limit = api});
+    loginLimiter = std::make_shared<SharedMemoryRateLimiter>(
+        SharedMemoryRateLimiter::Config{.name = std::string(shm) + "-login", .limit = login});
+  }
+  else
+  {
+    // At most 200k clients tracked, about 30 MiB with short keys.
+    apiLimiter = std::make_shared<ShardedRateLimiter>(
+        ShardedRateLimiter::Config{.limit = api, .max_keys = 200'000});
+    loginLimiter = std::make_shared<ShardedRateLimiter>(
+        ShardedRateLimiter::Config{.limit = login, .max_keys = 50'000});
+  }
+
+  app.use("/api", rate_limit_middleware(apiLimiter));
+  app.use("/auth", rate_limit_middleware(loginLimiter));
+
+  app.get("/", [](Request &, Response &res)
+          { res.send("public route"); });
+
+  app.get("/api/ping", [](Request &req, Response &res)
+          { res.json({"ok", true, "msg", "pong", "xff", req.header("x-forwarded-for")}); });
+
+  app.post("/auth/login", [](Request &, Response &res)
+           { res.json({"ok", true}); });
+
+  app.get("/_rate_limit/stats", [apiLimiter](Request &, Response &res)
+          {
+            if (auto sharded = std::dynamic_pointer_cast<ShardedRateLimiter>(apiLimiter))
+            {
+              const auto s = sharded->stats();
+              res.json({"backend", "sharded",
+                        "keys", s.keys,
+                        "allowed", s.allowed,
+                        "limited", s.limited,
+                        "evicted_idle", s.evicted_idle,
+                        "evicted_full", s.evicted_full});
+              return;
+            }
+            const auto s = std::static_pointer_cast<SharedMemoryRateLimiter>(apiLimiter)->stats();
+            res.json({"backend", "shared_memory",
+                      "slots", s.slots,
+                      "allowed", s.allowed,
+                      "limited", s.limited,
+                      "evictions", s.evictions}); });
+
+  app.run(8080);
+}
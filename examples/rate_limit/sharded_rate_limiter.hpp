@@ -0,0 +1,461 @@
+/**
+ *
+ *  @file sharded_rate_limiter.hpp
+ *  @author Gaspard Kirira
+ *
+ *  Copyright 2025, Gaspard Kirira.
+ *  All rights reserved.
+ *  https://github.com/vixcpp/vix
+ *
+ *  Use of this source code is governed by a MIT license
+ *  that can be found in the License file.
+ *
+ *  Vix.cpp
+ *
+ */
+#ifndef VIX_EXAMPLES_RATE_LIMIT_SHARDED_RATE_LIMITER_HPP
+#define VIX_EXAMPLES_RATE_LIMIT_SHARDED_RATE_LIMITER_HPP
+
+// Rate limiter state for many clients and many threads.
+//
+// security::rate_limit keeps one bucket per key in a single map behind a
+// single lock. A burst of unique IPs makes that lock the hot spot and
+// grows the map without bound. ShardedRateLimiter instead:
+//
+// - hashes each key to one of `shards` independently locked shards;
+// - keeps at most `max_keys` keys, evicting the least recently seen;
+// - drops keys idle for `idle_ms`, by default the time after which their
+//   state equals a fresh one (so the eviction loses nothing);
+// - supports a token bucket or a sliding window counter.
+//
+// The algorithms work on a trivially copyable BucketState, so the same
+// code runs over a shared-memory table (shm_rate_limiter.hpp) when
+// several worker processes must enforce one limit.
+//
+// rate_limit_middleware() plugs any RateLimiterBackend into vix::App with
+// the usual 429 / X-RateLimit-* behavior.
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <vix.hpp>
+
+namespace vix_examples::rate_limit
+{
+  enum class RateLimitAlgorithm : std::uint32_t
+  {
+    token_bucket,
+    // Weighted previous window + current window: smooth like a log,
+    // O(1) memory per key.
+    sliding_window,
+  };
+
+  struct RateLimitConfig
+  {
+    RateLimitAlgorithm algorithm{RateLimitAlgorithm::token_bucket};
+
+    // token_bucket
+    double capacity{60.0};
+    double refill_per_sec{1.0};
+
+    // sliding_window: `limit` requests per `window_ms`
+    std::uint32_t limit{60};
+    std::int64_t window_ms{60'000};
+  };
+
+  struct RateLimitDecision
+  {
+    bool allowed{true};
+    std::uint32_t limit{0};
+    std::uint32_t remaining{0};
+    std::int64_t retry_after_ms{-1}; // -1 when it will never free up (no refill)
+    std::int64_t reset_ms{0};        // until the state is back to full
+  };
+
+  // Per-key state. Plain data, so it can live in shared memory.
+  struct BucketState
+  {
+    std::int64_t last_ms{0};
+    std::int64_t window_start_ms{0};
+    double tokens{0.0};
+    std::uint32_t current{0};
+    std::uint32_t previous{0};
+    std::uint32_t initialized{0};
+    std::uint32_t reserved{0};
+  };
+
+  static_assert(std::is_trivially_copyable_v<BucketState>);
+
+  // How long a key must be idle before its state equals a fresh one;
+  // 0 when it never does (token bucket without refill).
+  inline std::int64_t lossless_idle_ms(const RateLimitConfig &config) noexcept
+  {
+    if (config.algorithm == RateLimitAlgorithm::sliding_window)
+    {
+      return 2 * config.window_ms;
+    }
+    if (config.refill_per_sec <= 0.0)
+    {
+      return 0;
+    }
+    return static_cast<std::int64_t>(std::ceil(config.capacity / config.refill_per_sec * 1000.0));
+  }
+
+  inline RateLimitDecision apply_token_bucket(const RateLimitConfig &config, BucketState &s, std::int64_t now)
+  {
+    if (!s.initialized)
+    {
+      s.initialized = 1;
+      s.tokens = config.capacity;
+      s.last_ms = now;
+    }
+
+    const double rate = config.refill_per_sec / 1000.0; // tokens per ms
+    if (now > s.last_ms)
+    {
+      s.tokens = std::min(config.capacity, s.tokens + static_cast<double>(now - s.last_ms) * rate);
+      s.last_ms = now;
+    }
+
+    RateLimitDecision d;
+    d.limit = static_cast<std::uint32_t>(config.capacity);
+    d.allowed = s.tokens >= 1.0;
+    if (d.allowed)
+    {
+      s.tokens -= 1.0;
+    }
+    d.remaining = static_cast<std::uint32_t>(std::max(0.0, std::floor(s.tokens)));
+
+    if (rate > 0.0)
+    {
+      d.retry_after_ms = d.allowed ? 0 : static_cast<std::int64_t>(std::ceil((1.0 - s.tokens) / rate));
+      d.reset_ms = static_cast<std::int64_t>(std::ceil((config.capacity - s.tokens) / rate));
+    }
+    else
+    {
+      d.retry_after_ms = d.allowed ? 0 : -1;
+      d.reset_ms = -1;
+    }
+    return d;
+  }
+
+  inline RateLimitDecision apply_sliding_window(const RateLimitConfig &config, BucketState &s, std::int64_t now)
+  {
+    const std::int64_t window = std::max<std::int64_t>(1, config.window_ms);
+
+    if (!s.initialized)
+    {
+      s.initialized = 1;
+      s.window_start_ms = now;
+    }
+
+    if (now >= s.window_start_ms + window)
+    {
+      const std::int64_t passed = (now - s.window_start_ms) / window;
+      s.previous = passed == 1 ? s.current : 0;
+      s.current = 0;
+      s.window_start_ms += passed * window;
+    }
+    s.last_ms = now;
+
+    const std::int64_t elapsed = now - s.window_start_ms;
+    const double weight = static_cast<double>(window - elapsed) / static_cast<double>(window);
+    const double estimated = static_cast<double>(s.previous) * weight + static_cast<double>(s.current);
+
+    RateLimitDecision d;
+    d.limit = config.limit;
+    d.allowed = estimated + 1.0 <= static_cast<double>(config.limit);
+    if (d.allowed)
+    {
+      ++s.current;
+    }
+
+    const double used = estimated + (d.allowed ? 1.0 : 0.0);
+    d.remaining = static_cast<std::uint32_t>(std::max(0.0, std::floor(static_cast<double>(config.limit) - used)));
+    d.reset_ms = s.current > 0 ? 2 * window - elapsed : (s.previous > 0 ? window - elapsed : 0);
+
+    if (d.allowed)
+    {
+      d.retry_after_ms = 0;
+      return d;
+    }
+    if (config.limit == 0)
+    {
+      d.retry_after_ms = -1;
+      return d;
+    }
+
+    // Earliest offset into a window where `weighted * (W - e) / W + fixed`
+    // fits one more request.
+    const double room = static_cast<double>(config.limit) - 1.0;
+    const auto decay_point = [&](double weighted, double fixed)
+    {
+      if (weighted <= 0.0)
+      {
+        return 0.0;
+      }
+      // The epsilon keeps exact boundaries (300.00000000000006) from
+      // rounding up a whole millisecond.
+      return std::max(0.0, static_cast<double>(window) * (1.0 - (room - fixed) / weighted) - 1e-9);
+    };
+
+    if (static_cast<double>(s.current) <= room)
+    {
+      // Once the previous window has decayed enough, or at the latest when
+      // the next window starts.
+      const double at = std::min(decay_point(s.previous, s.current), static_cast<double>(window));
+      d.retry_after_ms = std::max<std::int64_t>(1, static_cast<std::int64_t>(std::ceil(at)) - elapsed);
+    }
+    else
+    {
+      // Next window, where this window's count becomes the decaying one.
+      d.retry_after_ms = window - elapsed + static_cast<std::int64_t>(std::ceil(decay_point(s.current, 0.0)));
+    }
+    return d;
+  }
+
+  inline RateLimitDecision apply(const RateLimitConfig &config, BucketState &state, std::int64_t now)
+  {
+    return config.algorithm == RateLimitAlgorithm::sliding_window
+               ? apply_sliding_window(config, state, now)
+               : apply_token_bucket(config, state, now);
+  }
+
+  inline std::int64_t steady_now_ms()
+  {
+    using namespace std::chrono;
+    return duration_cast<milliseconds>(steady_clock::now().time_since_epoch()).count();
+  }
+
+  // One limiter table; in-process or shared between processes.
+  class RateLimiterBackend
+  {
+  public:
+    virtual ~RateLimiterBackend() = default;
+
+    // Counts one request for `key` and says whether it may proceed.
+    virtual RateLimitDecision hit(std::string_view key) = 0;
+  };
+
+  class ShardedRateLimiter final : public RateLimiterBackend
+  {
+  public:
+    struct Config
+    {
+      RateLimitConfig limit{};
+      std::size_t max_keys{100'000};          // memory budget, over all shards
+      std::int64_t idle_ms{-1};               // -1 = lossless_idle_ms(limit), 0 = never
+      std::size_t shards{0};                  // 0 = 4 x hardware threads, rounded to a power of two
+      std::function<std::int64_t()> clock{};  // steady ms by default
+    };
+
+    struct Stats
+    {
+      std::size_t keys{0};
+      std::uint64_t allowed{0};
+      std::uint64_t limited{0};
+      std::uint64_t evicted_idle{0};
+      std::uint64_t evicted_full{0}; // pushed out by max_keys
+    };
+
+    ShardedRateLimiter() : ShardedRateLimiter(Config{}) {}
+
+    explicit ShardedRateLimiter(Config config)
+        : config_(std::move(config))
+    {
+      if (!config_.clock)
+      {
+        config_.clock = steady_now_ms;
+      }
+      if (config_.idle_ms < 0)
+      {
+        config_.idle_ms = lossless_idle_ms(config_.limit);
+      }
+
+      std::size_t wanted = config_.shards;
+      if (wanted == 0)
+      {
+        wanted = 4 * std::max(1u, std::thread::hardware_concurrency());
+      }
+      std::size_t count = 1;
+      while (count < wanted)
+      {
+        count <<= 1;
+      }
+      count = std::min(count, std::max<std::size_t>(1, config_.max_keys));
+
+      shards_ = std::vector<Shard>(count);
+      mask_ = count - 1;
+      perShard_ = std::max<std::size_t>(1, config_.max_keys / count);
+    }
+
+    RateLimitDecision hit(std::string_view key) override
+    {
+      Shard &shard = shards_[std::hash<std::string_view>{}(key)&mask_];
+      const std::int64_t now = config_.clock();
+
+      RateLimitDecision decision;
+      {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        evict_idle(shard, now);
+
+        auto it = shard.index.find(key);
+        if (it != shard.index.end())
+        {
+          shard.lru.splice(shard.lru.begin(), shard.lru, it->second);
+        }
+        else
+        {
+          if (shard.index.size() >= perShard_)
+          {
+            shard.index.erase(shard.lru.back().key);
+            shard.lru.pop_back();
+            ++shard.evictedFull;
+          }
+          shard.lru.push_front(Entry{std::string(key), {}, now});
+          // The view points into the list node, which never moves.
+          it = shard.index.emplace(shard.lru.front().key, shard.lru.begin()).first;
+        }
+
+        Entry &entry = *it->second;
+        entry.last_seen = now;
+        decision = apply(config_.limit, entry.state, now);
+      }
+
+      (decision.allowed ? allowed_ : limited_).fetch_add(1, std::memory_order_relaxed);
+      return decision;
+    }
+
+    [[nodiscard]] Stats stats() const
+    {
+      Stats out;
+      out.allowed = allowed_.load(std::memory_order_relaxed);
+      out.limited = limited_.load(std::memory_order_relaxed);
+      for (const auto &shard : shards_)
+      {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        out.keys += shard.index.size();
+        out.evicted_idle += shard.evictedIdle;
+        out.evicted_full += shard.evictedFull;
+      }
+      return out;
+    }
+
+    [[nodiscard]] std::size_t shard_count() const noexcept
+    {
+      return shards_.size();
+    }
+
+  private:
+    struct Entry
+    {
+      std::string key;
+      BucketState state;
+      std::int64_t last_seen{0};
+    };
+
+    struct Shard
+    {
+      mutable std::mutex mutex;
+      std::list<Entry> lru; // most recently seen first
+      std::unordered_map<std::string_view, std::list<Entry>::iterator> index;
+      std::uint64_t evictedIdle{0};
+      std::uint64_t evictedFull{0};
+    };
+
+    // The LRU tail is the longest idle key, so this stops at the first
+    // key still in use.
+    void evict_idle(Shard &shard, std::int64_t now)
+    {
+      if (config_.idle_ms <= 0)
+      {
+        return;
+      }
+      while (!shard.lru.empty() && now - shard.lru.back().last_seen > config_.idle_ms)
+      {
+        shard.index.erase(shard.lru.back().key);
+        shard.lru.pop_back();
+        ++shard.evictedIdle;
+      }
+    }
+
+    Config config_;
+    std::vector<Shard> shards_;
+    std::size_t mask_{0};
+    std::size_t perShard_{1};
+
+    std::atomic<std::uint64_t> allowed_{0};
+    std::atomic<std::uint64_t> limited_{0};
+  };
+
+  struct RateLimitMiddlewareOptions
+  {
+    bool add_headers{true};
+    std::string key_header{"x-forwarded-for"}; // first hop is the client
+    std::function<std::string(const vix::Request &)> key_fn{};
+  };
+
+  inline std::string rate_limit_key(const vix::Request &req, const RateLimitMiddlewareOptions &options)
+  {
+    if (options.key_fn)
+    {
+      return options.key_fn(req);
+    }
+
+    std::string value = req.header(options.key_header);
+    value = value.substr(0, value.find(','));
+    const auto first = value.find_first_not_of(' ');
+    const auto last = value.find_last_not_of(' ');
+    return first == std::string::npos ? "anonymous" : value.substr(first, last - first + 1);
+  }
+
+  // Middleware for app.use(prefix, ...): 429 {"ok":false,"error":"rate_limited"}
+  // once the key is over its limit.
+  inline std::function<void(vix::Request &, vix::Response &, vix::App::Next)>
+  rate_limit_middleware(std::shared_ptr<RateLimiterBackend> limiter, RateLimitMiddlewareOptions options = {})
+  {
+    return [limiter = std::move(limiter), options = std::move(options)](vix::Request &req, vix::Response &res, vix::App::Next next)
+    {
+      const RateLimitDecision d = limiter->hit(rate_limit_key(req, options));
+
+      if (options.add_headers)
+      {
+        res.res.set_header("X-RateLimit-Limit", std::to_string(d.limit));
+        res.res.set_header("X-RateLimit-Remaining", std::to_string(d.remaining));
+        if (d.reset_ms >= 0)
+        {
+          res.res.set_header("X-RateLimit-Reset", std::to_string((d.reset_ms + 999) / 1000));
+        }
+      }
+
+      if (d.allowed)
+      {
+        next();
+        return;
+      }
+
+      if (d.retry_after_ms >= 0)
+      {
+        res.res.set_header("Retry-After", std::to_string(std::max<std::int64_t>(1, (d.retry_after_ms + 999) / 1000)));
+      }
+      res.status(429).json({"ok", false, "error", "rate_limited"});
+    };
+  }
+} // namespace vix_examples::rate_limit
+
+#endif // VIX_EXAMPLES_RATE_LIMIT_SHARDED_RATE_LIMITER_HPP
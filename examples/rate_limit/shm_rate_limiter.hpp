@@ -0,0 +1,317 @@
+/**
+ *
+ *  @file shm_rate_limiter.hpp
+ *  @author Gaspard Kirira
+ *
+ *  Copyright 2025, Gaspard Kirira.
+ *  All rights reserved.
+ *  https://github.com/vixcpp/vix
+ *
+ *  Use of this source code is governed by a MIT license
+ *  that can be found in the License file.
+ *
+ *  Vix.cpp
+ *
+ */
+#ifndef VIX_EXAMPLES_RATE_LIMIT_SHM_RATE_LIMITER_HPP
+#define VIX_EXAMPLES_RATE_LIMIT_SHM_RATE_LIMITER_HPP
+
+// Rate limiter table in POSIX shared memory, so every worker process
+// behind SO_REUSEPORT enforces the same limit for a key.
+//
+// The table is a fixed array of buckets, each with a spinlock and
+// `kSlotsPerBucket` slots. A key hashes to one bucket and never leaves
+// it, so a hit takes exactly one uncontended-in-practice lock and no
+// system call. Memory is fixed at open time (about 64 bytes per slot).
+//
+// A full bucket reuses an idle slot (idle longer than idle_ms) first, and
+// otherwise its least recently seen slot. Slots store a 64-bit hash of
+// the key, not the key: two keys that collide share one limit.
+//
+// Every process must open the table with the same name, slot count and
+// limit settings; a mismatch throws. The critical sections make no
+// system calls, but a process killed inside one leaves that bucket
+// locked, so restart the whole group (and unlink()) after a crash.
+// POSIX only (shm_open, mmap); link with -lrt on older glibc.
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "sharded_rate_limiter.hpp"
+
+namespace vix_examples::rate_limit
+{
+  class SharedMemoryRateLimiter final : public RateLimiterBackend
+  {
+  public:
+    static constexpr std::size_t kSlotsPerBucket = 8;
+
+    struct Config
+    {
+      std::string name{"/vix-rate-limit"}; // shm object, starts with '/'
+      RateLimitConfig limit{};
+      std::size_t max_keys{65'536};         // rounded up to whole buckets
+      std::int64_t idle_ms{-1};             // -1 = lossless_idle_ms(limit)
+      std::function<std::int64_t()> clock{}; // must agree across processes; steady ms by default
+    };
+
+    SharedMemoryRateLimiter() : SharedMemoryRateLimiter(Config{}) {}
+
+    explicit SharedMemoryRateLimiter(Config config)
+        : config_(std::move(config))
+    {
+      static_assert(std::atomic<std::uint32_t>::is_always_lock_free, "shared spinlocks need lock-free atomics");
+      static_assert(std::atomic<std::uint64_t>::is_always_lock_free, "shared counters need lock-free atomics");
+
+      if (!config_.clock)
+      {
+        config_.clock = steady_now_ms;
+      }
+      if (config_.idle_ms < 0)
+      {
+        config_.idle_ms = lossless_idle_ms(config_.limit);
+      }
+
+      bucketCount_ = 1;
+      while (bucketCount_ * kSlotsPerBucket < config_.max_keys)
+      {
+        bucketCount_ <<= 1;
+      }
+      size_ = sizeof(Header) + bucketCount_ * sizeof(Bucket);
+
+      const int fd = ::shm_open(config_.name.c_str(), O_CREAT | O_RDWR, 0600);
+      if (fd < 0)
+      {
+        throw std::runtime_error("shm_open failed: " + config_.name);
+      }
+
+      struct stat st{};
+      if (::fstat(fd, &st) != 0 ||
+          (st.st_size == 0 && ::ftruncate(fd, static_cast<off_t>(size_)) != 0))
+      {
+        ::close(fd);
+        throw std::runtime_error("cannot size shared memory: " + config_.name);
+      }
+      if (st.st_size != 0 && static_cast<std::size_t>(st.st_size) != size_)
+      {
+        ::close(fd);
+        throw std::runtime_error("shared rate limiter size mismatch: " + config_.name);
+      }
+
+      void *base = ::mmap(nullptr, size_, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+      ::close(fd);
+      if (base == MAP_FAILED)
+      {
+        throw std::runtime_error("mmap failed: " + config_.name);
+      }
+
+      // Fresh shm pages are zero, which is an empty table with every lock free.
+      header_ = static_cast<Header *>(base);
+      buckets_ = reinterpret_cast<Bucket *>(static_cast<char *>(base) + sizeof(Header));
+      initialize_or_check();
+    }
+
+    SharedMemoryRateLimiter(const SharedMemoryRateLimiter &) = delete;
+    SharedMemoryRateLimiter &operator=(const SharedMemoryRateLimiter &) = delete;
+
+    ~SharedMemoryRateLimiter() override
+    {
+      ::munmap(header_, size_);
+    }
+
+    // Removes the shm object; processes that have it open keep their mapping.
+    static void unlink(const std::string &name)
+    {
+      ::shm_unlink(name.c_str());
+    }
+
+    RateLimitDecision hit(std::string_view key) override
+    {
+      const std::uint64_t h = hash(key);
+      Bucket &bucket = buckets_[(h >> 1) & (bucketCount_ - 1)];
+      const std::int64_t now = config_.clock();
+
+      lock(bucket);
+
+      Slot *slot = nullptr;
+      Slot *victim = &bucket.slots[0];
+      for (auto &candidate : bucket.slots)
+      {
+        if (candidate.key_hash == h)
+        {
+          slot = &candidate;
+          break;
+        }
+        if (rank(candidate, now) < rank(*victim, now))
+        {
+          victim = &candidate;
+        }
+      }
+
+      if (slot == nullptr)
+      {
+        if (victim->key_hash != 0)
+        {
+          header_->evictions.fetch_add(1, std::memory_order_relaxed);
+        }
+        slot = victim;
+        slot->key_hash = h;
+        slot->state = BucketState{};
+      }
+
+      slot->last_seen = now;
+      const RateLimitDecision decision = apply(config_.limit, slot->state, now);
+
+      unlock(bucket);
+
+      (decision.allowed ? header_->allowed : header_->limited).fetch_add(1, std::memory_order_relaxed);
+      return decision;
+    }
+
+    struct Stats
+    {
+      std::uint64_t allowed{0}; // all processes
+      std::uint64_t limited{0};
+      std::uint64_t evictions{0};
+      std::size_t slots{0};
+    };
+
+    [[nodiscard]] Stats stats() const noexcept
+    {
+      return Stats{header_->allowed.load(std::memory_order_relaxed),
+                   header_->limited.load(std::memory_order_relaxed),
+                   header_->evictions.load(std::memory_order_relaxed),
+                   bucketCount_ * kSlotsPerBucket};
+    }
+
+  private:
+    static constexpr std::uint64_t kMagic = 0x564958524C310001ULL; // "VIXRL1", v1
+
+    struct Slot
+    {
+      std::uint64_t key_hash; // 0 = empty
+      std::int64_t last_seen;
+      BucketState state;
+    };
+
+    struct alignas(64) Bucket
+    {
+      std::atomic<std::uint32_t> lock;
+      Slot slots[kSlotsPerBucket];
+    };
+
+    struct alignas(64) Header
+    {
+      std::atomic<std::uint32_t> ready; // 0 empty, 1 initializing, 2 ready
+      std::uint64_t magic;
+      std::uint64_t bucket_count;
+      std::uint32_t algorithm;
+      double capacity;
+      double refill_per_sec;
+      std::uint32_t limit;
+      std::int64_t window_ms;
+      std::atomic<std::uint64_t> allowed;
+      std::atomic<std::uint64_t> limited;
+      std::atomic<std::uint64_t> evictions;
+    };
+
+    void initialize_or_check()
+    {
+      std::uint32_t expected = 0;
+      if (header_->ready.compare_exchange_strong(expected, 1, std::memory_order_acq_rel))
+      {
+        header_->magic = kMagic;
+        header_->bucket_count = bucketCount_;
+        header_->algorithm = static_cast<std::uint32_t>(config_.limit.algorithm);
+        header_->capacity = config_.limit.capacity;
+        header_->refill_per_sec = config_.limit.refill_per_sec;
+        header_->limit = config_.limit.limit;
+        header_->window_ms = config_.limit.window_ms;
+        header_->ready.store(2, std::memory_order_release);
+        return;
+      }
+
+      while (header_->ready.load(std::memory_order_acquire) != 2)
+      {
+        std::this_thread::yield();
+      }
+
+      const auto &l = config_.limit;
+      if (header_->magic != kMagic || header_->bucket_count != bucketCount_ ||
+          header_->algorithm != static_cast<std::uint32_t>(l.algorithm) ||
+          header_->capacity != l.capacity || header_->refill_per_sec != l.refill_per_sec ||
+          header_->limit != l.limit || header_->window_ms != l.window_ms)
+      {
+        ::munmap(header_, size_);
+        throw std::runtime_error("shared rate limiter opened with different settings: " + config_.name);
+      }
+    }
+
+    // Lower is a better slot to reuse: empty, then idle, then oldest.
+    std::int64_t rank(const Slot &slot, std::int64_t now) const noexcept
+    {
+      if (slot.key_hash == 0)
+      {
+        return std::numeric_limits<std::int64_t>::min();
+      }
+      if (config_.idle_ms > 0 && now - slot.last_seen > config_.idle_ms)
+      {
+        return std::numeric_limits<std::int64_t>::min() + 1;
+      }
+      return slot.last_seen;
+    }
+
+    static void lock(Bucket &bucket) noexcept
+    {
+      for (;;)
+      {
+        if (bucket.lock.exchange(1, std::memory_order_acquire) == 0)
+        {
+          return;
+        }
+        while (bucket.lock.load(std::memory_order_relaxed) != 0)
+        {
+          std::this_thread::yield();
+        }
+      }
+    }
+
+    static void unlock(Bucket &bucket) noexcept
+    {
+      bucket.lock.store(0, std::memory_order_release);
+    }
+
+    // FNV-1a, never 0 (0 marks an empty slot). std::hash may differ
+    // between builds, and every process must agree.
+    static std::uint64_t hash(std::string_view key) noexcept
+    {
+      std::uint64_t h = 0xcbf29ce484222325ULL;
+      for (const unsigned char c : key)
+      {
+        h = (h ^ c) * 0x100000001b3ULL;
+      }
+      return h | 1;
+    }
+
+    Config config_;
+    std::size_t bucketCount_{1};
+    std::size_t size_{0};
+    Header *header_{nullptr};
+    Bucket *buckets_{nullptr};
+  };
+} // namespace vix_examples::rate_limit
+
+#endif // VIX_EXAMPLES_RATE_LIMIT_SHM_RATE_LIMITER_HPP
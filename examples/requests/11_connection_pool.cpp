@@ -0,0 +1,158 @@
+#include <vix/async/core/io_context.hpp>
+#include <vix/async/core/task.hpp>
+#include "connection_pool.hpp"
+#include "example_env.hpp"
+
+#include <chrono>
+#include <exception>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace
+{
+  using vix_examples::requests::ConnectionPool;
+  using vix_examples::requests::PoolMetrics;
+  using vix_examples::requests::PoolOptions;
+  using vix_examples::requests::PooledClient;
+  using vix_examples::requests::PooledResponse;
+
+  void print_metrics(const char *label, const PoolMetrics &m)
+  {
+    std::cout << label << ": hits=" << m.hits << " misses=" << m.misses
+              << " waits=" << m.waits << " wait_timeouts=" << m.wait_timeouts
+              << " closed_idle=" << m.closed_idle << " closed_unhealthy=" << m.closed_unhealthy
+              << " discarded=" << m.discarded << " tls_handshakes=" << m.tls_handshakes
+              << " tls_resumed=" << m.tls_resumed << " open=" << m.open_connections << '\n';
+  }
+
+  double run_sequential(PooledClient &client, const std::string &url, int count)
+  {
+    const auto start = std::chrono::steady_clock::now();
+
+    for (int i = 0; i < count; ++i)
+    {
+      const auto response = client.get(url);
+
+      if (response.status >= 400)
+      {
+        std::cerr << "status " << response.status << '\n';
+      }
+    }
+
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+  }
+
+  // The blocking exchange runs on the io_context CPU pool; the pool is
+  // shared with the synchronous callers.
+  vix::async::core::task<PooledResponse> async_get(
+      vix::async::core::io_context &ctx,
+      PooledClient &client,
+      std::string url)
+  {
+    auto response = co_await ctx.cpu_pool().submit([&client, &url]()
+                                                    { return client.get(url); });
+    co_return response;
+  }
+
+  vix::async::core::task<void> async_app(
+      vix::async::core::io_context &ctx,
+      PooledClient &client,
+      std::string url,
+      std::exception_ptr &error)
+  {
+    try
+    {
+      for (int i = 0; i < 4; ++i)
+      {
+        const auto response = co_await async_get(ctx, client, url);
+        std::cout << "async status: " << response.status
+                  << " reused=" << (response.reused_connection ? "yes" : "no") << '\n';
+      }
+    }
+    catch (...)
+    {
+      error = std::current_exception();
+    }
+
+    ctx.stop();
+    co_return;
+  }
+}
+
+int main()
+{
+  const std::string baseUrl = vix_examples::requests::env_or("VIX_REQUESTS_BASE_URL", "https://httpbin.org");
+  const std::string url = baseUrl + "/get";
+  const int count = std::stoi(vix_examples::requests::env_or("VIX_REQUESTS_POOL_REQUESTS", "20"));
+
+  PoolOptions options;
+  options.ca_file = vix_examples::requests::env_or_empty("VIX_REQUESTS_CA_FILE");
+
+  // Baseline: nothing is kept idle, so every request connects again.
+  {
+    PoolOptions noReuse = options;
+    noReuse.max_idle_per_host = 0;
+
+    ConnectionPool pool(noReuse);
+    PooledClient client(pool);
+
+    const double ms = run_sequential(client, url, count);
+    std::cout << count << " requests without reuse: " << ms << " ms\n";
+    print_metrics("no reuse", pool.metrics());
+  }
+
+  // Keep-alive reuse.
+  {
+    ConnectionPool pool(options);
+    PooledClient client(pool);
+
+    const double ms = run_sequential(client, url, count);
+    std::cout << count << " requests with reuse: " << ms << " ms\n";
+    print_metrics("pooled", pool.metrics());
+  }
+
+  // Eight threads sharing two connections: the others wait for a release.
+  {
+    PoolOptions limited = options;
+    limited.max_per_host = 2;
+
+    ConnectionPool pool(limited);
+    PooledClient client(pool);
+    std::vector<std::thread> threads;
+
+    for (int t = 0; t < 8; ++t)
+    {
+      threads.emplace_back([&client, &url, count]()
+                           { run_sequential(client, url, count / 8 + 1); });
+    }
+
+    for (auto &thread : threads)
+    {
+      thread.join();
+    }
+
+    print_metrics("max_per_host=2", pool.metrics());
+  }
+
+  // Async callers share the same pool.
+  {
+    ConnectionPool pool(options);
+    PooledClient client(pool);
+
+    vix::async::core::io_context ctx;
+    std::exception_ptr error;
+
+    auto runner = async_app(ctx, client, url, error);
+    ctx.post(runner.handle());
+    ctx.run();
+
+    if (error)
+    {
+      std::rethrow_exception(error);
+    }
+
+    print_metrics("async", pool.metrics());
+  }
+}
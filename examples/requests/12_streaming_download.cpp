@@ -0,0 +1,138 @@
+#include <vix/async/core/io_context.hpp>
+#include <vix/async/core/task.hpp>
+#include "connection_pool.hpp"
+#include "example_env.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <exception>
+#include <iostream>
+#include <string>
+#include <string_view>
+
+namespace
+{
+  using vix_examples::requests::ConnectionPool;
+  using vix_examples::requests::PooledClient;
+  using vix_examples::requests::StreamingResponse;
+  using vix_examples::requests::StreamOptions;
+  using vix_examples::requests::StreamProgress;
+
+  // Prints a line every 10% when the size is known, every MiB otherwise.
+  StreamOptions with_progress(const std::string &label)
+  {
+    StreamOptions options;
+    options.on_progress = [label, next = std::uint64_t{0}](const StreamProgress &p) mutable
+    {
+      const std::uint64_t step = p.total_bytes > 0 ? p.total_bytes / 10 + 1 : 1024 * 1024;
+      const std::uint64_t done = p.total_bytes > 0 ? p.wire_bytes : p.decoded_bytes;
+
+      if (done >= next)
+      {
+        std::cout << label << ": " << p.decoded_bytes << " bytes";
+        if (p.total_bytes > 0)
+        {
+          std::cout << " (" << (100 * p.wire_bytes / p.total_bytes) << "% of " << p.total_bytes << " on the wire)";
+        }
+        std::cout << '\n';
+        next = done + step;
+      }
+    };
+    return options;
+  }
+
+  // Pulls the body from a coroutine: every read runs on the CPU pool, so
+  // the io_context thread never blocks on the socket.
+  vix::async::core::task<std::uint64_t> async_drain(
+      vix::async::core::io_context &ctx,
+      StreamingResponse &response)
+  {
+    std::uint64_t total = 0;
+
+    for (;;)
+    {
+      const std::size_t size = co_await ctx.cpu_pool().submit([&response]()
+                                                             { return response.next().size(); });
+      if (size == 0)
+      {
+        break;
+      }
+
+      total += size;
+    }
+
+    co_return total;
+  }
+
+  vix::async::core::task<void> async_app(
+      vix::async::core::io_context &ctx,
+      PooledClient &client,
+      std::string url,
+      std::exception_ptr &error)
+  {
+    try
+    {
+      auto response = client.open("GET", url);
+      const std::uint64_t total = co_await async_drain(ctx, response);
+      std::cout << "async status: " << response.status() << " bytes=" << total << '\n';
+    }
+    catch (...)
+    {
+      error = std::current_exception();
+    }
+
+    ctx.stop();
+    co_return;
+  }
+}
+
+int main()
+{
+  const std::string baseUrl = vix_examples::requests::env_or("VIX_REQUESTS_BASE_URL", "https://httpbin.org");
+  const std::string downloadUrl = vix_examples::requests::env_or("VIX_REQUESTS_DOWNLOAD_URL", baseUrl + "/bytes/102400");
+  const std::string compressedUrl = vix_examples::requests::env_or("VIX_REQUESTS_COMPRESSED_URL", baseUrl + "/gzip");
+  const std::string outputPath = vix_examples::requests::env_or("VIX_REQUESTS_OUTPUT", "requests_download.bin");
+
+  vix_examples::requests::PoolOptions poolOptions;
+  poolOptions.ca_file = vix_examples::requests::env_or_empty("VIX_REQUESTS_CA_FILE");
+
+  ConnectionPool pool(poolOptions);
+  PooledClient client(pool);
+
+  // Straight to disk; memory use does not grow with the file size.
+  const auto result = client.download_to(downloadUrl, outputPath, with_progress("download"));
+  if (result.status < 200 || result.status >= 300)
+  {
+    std::cerr << "download failed: HTTP " << result.status << '\n';
+    return 1;
+  }
+  std::cout << "downloaded " << result.bytes_written << " bytes to " << outputPath
+            << (result.decoded ? " (decoded)" : "") << '\n';
+
+  // Compressed bodies are decoded piece by piece.
+  std::uint64_t pieces = 0;
+  std::uint64_t bytes = 0;
+  std::size_t largest = 0;
+
+  const auto head = client.stream(compressedUrl, [&](std::string_view piece)
+                                  {
+                                    ++pieces;
+                                    bytes += piece.size();
+                                    largest = std::max(largest, piece.size());
+                                  });
+  std::cout << "stream status: " << head.status << " encoding=" << head.header("Content-Encoding")
+            << " decoded bytes=" << bytes << " pieces=" << pieces << " largest piece=" << largest << '\n';
+
+  // Same pool, pulled from a coroutine.
+  vix::async::core::io_context ctx;
+  std::exception_ptr error;
+
+  auto runner = async_app(ctx, client, downloadUrl, error);
+  ctx.post(runner.handle());
+  ctx.run();
+
+  if (error)
+  {
+    std::rethrow_exception(error);
+  }
+}
@@ -0,0 +1,133 @@
+#include <vix/async/core/io_context.hpp>
+#include <vix/async/core/spawn.hpp>
+#include <vix/async/core/task.hpp>
+#include "connection_pool.hpp"
+#include "example_env.hpp"
+#include "h2_client.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <exception>
+#include <iostream>
+#include <string>
+
+namespace
+{
+  using vix_examples::requests::ConnectionPool;
+  using vix_examples::requests::H2Metrics;
+  using vix_examples::requests::H2Options;
+  using vix_examples::requests::MultiplexClient;
+  using vix_examples::requests::PoolMetrics;
+  using vix_examples::requests::PoolOptions;
+
+  struct FanOut
+  {
+    int remaining{0};
+    int failed{0};
+    std::exception_ptr error;
+  };
+
+  vix::async::core::task<void> fetch_one(
+      vix::async::core::io_context &ctx,
+      MultiplexClient &client,
+      std::string url,
+      FanOut &state)
+  {
+    try
+    {
+      const auto response = co_await client.async_get(ctx, url);
+      if (response.status >= 400)
+      {
+        ++state.failed;
+      }
+    }
+    catch (...)
+    {
+      ++state.failed;
+      state.error = std::current_exception();
+    }
+
+    // Every task resumes on the io_context thread, so no lock is needed.
+    if (--state.remaining == 0)
+    {
+      ctx.stop();
+    }
+    co_return;
+  }
+
+  double scatter_gather(MultiplexClient &client, const std::string &url, int count)
+  {
+    vix::async::core::io_context ctx;
+    FanOut state;
+    state.remaining = count;
+
+    const auto start = std::chrono::steady_clock::now();
+
+    for (int i = 0; i < count; ++i)
+    {
+      vix::async::core::spawn_detached(ctx, fetch_one(ctx, client, url, state));
+    }
+
+    ctx.run();
+
+    if (state.error)
+    {
+      std::rethrow_exception(state.error);
+    }
+
+    if (state.failed > 0)
+    {
+      std::cerr << state.failed << " requests failed\n";
+    }
+
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+  }
+
+  void print_metrics(const char *label, const H2Metrics &h2, const PoolMetrics &pool)
+  {
+    std::cout << label << ": h2 sessions=" << h2.sessions << " streams=" << h2.streams
+              << " peak_streams=" << h2.peak_streams << " queued=" << h2.queued
+              << " retries=" << h2.retries << " http1_fallbacks=" << h2.http1_fallbacks
+              << " | tcp connections=" << pool.misses + h2.sessions << '\n';
+  }
+}
+
+int main()
+{
+  const std::string baseUrl = vix_examples::requests::env_or("VIX_REQUESTS_BASE_URL", "https://httpbin.org");
+  const std::string url = baseUrl + "/get";
+  const int count = std::stoi(vix_examples::requests::env_or("VIX_REQUESTS_H2_REQUESTS", "64"));
+
+  PoolOptions poolOptions;
+  poolOptions.ca_file = vix_examples::requests::env_or_empty("VIX_REQUESTS_CA_FILE");
+  poolOptions.max_per_host = 16;
+
+  // One origin, `count` concurrent calls. With h2 they share a single
+  // connection; otherwise they spread over up to max_per_host sockets.
+  {
+    ConnectionPool pool(poolOptions);
+    MultiplexClient client(pool);
+
+    const double ms = scatter_gather(client, url, count);
+    std::cout << count << " concurrent requests: " << ms << " ms\n";
+    print_metrics("multiplexed", client.metrics(), pool.metrics());
+  }
+
+  // A low stream limit queues the excess inside the session.
+  {
+    H2Options h2;
+    h2.max_concurrent_streams = 8;
+
+    ConnectionPool pool(poolOptions);
+    MultiplexClient client(pool, h2);
+
+    const double ms = scatter_gather(client, url, count);
+    std::cout << count << " requests, 8 streams: " << ms << " ms\n";
+    print_metrics("max_concurrent_streams=8", client.metrics(), pool.metrics());
+
+    // The blocking API shares the same session.
+    const auto response = client.get(url);
+    std::cout << "sync status: " << response.status << '\n';
+  }
+}
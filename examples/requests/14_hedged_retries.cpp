@@ -0,0 +1,109 @@
+#include "connection_pool.hpp"
+#include "example_env.hpp"
+#include "resilient_client.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <exception>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace
+{
+  using vix_examples::requests::ConnectionPool;
+  using vix_examples::requests::HedgePolicy;
+  using vix_examples::requests::PooledClient;
+  using vix_examples::requests::PoolOptions;
+  using vix_examples::requests::ResilienceMetrics;
+  using vix_examples::requests::ResilientClient;
+  using vix_examples::requests::RetryBudgetOptions;
+  using vix_examples::requests::RetryPolicy;
+
+  void print_metrics(const char *label, const ResilienceMetrics &m)
+  {
+    std::cout << label << ": requests=" << m.requests << " attempts=" << m.attempts
+              << " retries=" << m.retries << " budget_exhausted=" << m.budget_exhausted
+              << " hedges=" << m.hedges << " hedge_wins=" << m.hedge_wins << '\n';
+  }
+
+  // Sequential requests; returns sorted latencies in milliseconds.
+  std::vector<double> measure(ResilientClient &client, const std::string &url, int count)
+  {
+    std::vector<double> latencies;
+    latencies.reserve(static_cast<std::size_t>(count));
+
+    for (int i = 0; i < count; ++i)
+    {
+      const auto start = std::chrono::steady_clock::now();
+      try
+      {
+        client.get(url);
+      }
+      catch (const std::exception &error)
+      {
+        std::cerr << "request failed: " << error.what() << '\n';
+      }
+      latencies.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+    }
+
+    std::sort(latencies.begin(), latencies.end());
+    return latencies;
+  }
+
+  double at(const std::vector<double> &sorted, double p)
+  {
+    return sorted[std::min(sorted.size() - 1, static_cast<std::size_t>(p * static_cast<double>(sorted.size())))];
+  }
+}
+
+int main()
+{
+  const std::string baseUrl = vix_examples::requests::env_or("VIX_REQUESTS_BASE_URL", "https://httpbin.org");
+  const std::string failingUrl = vix_examples::requests::env_or("VIX_REQUESTS_FAILING_URL", baseUrl + "/status/503");
+  const std::string hedgeUrl = vix_examples::requests::env_or("VIX_REQUESTS_HEDGE_URL", baseUrl + "/get");
+  const int count = std::stoi(vix_examples::requests::env_or("VIX_REQUESTS_HEDGE_REQUESTS", "100"));
+
+  PoolOptions poolOptions;
+  poolOptions.ca_file = vix_examples::requests::env_or_empty("VIX_REQUESTS_CA_FILE");
+
+  ConnectionPool pool(poolOptions);
+  PooledClient pooled(pool);
+
+  // An upstream that always answers 503: the budget caps the extra load
+  // at roughly `ratio` retries per request once the initial tokens are
+  // spent, instead of max_attempts - 1.
+  {
+    RetryPolicy retry;
+    retry.base_delay = std::chrono::milliseconds(5);
+    retry.max_delay = std::chrono::milliseconds(50);
+
+    RetryBudgetOptions budget;
+    budget.ratio = 0.1;
+    budget.max_tokens = 5;
+
+    ResilientClient client(pooled, retry, budget);
+
+    for (int i = 0; i < 50; ++i)
+    {
+      client.get(failingUrl);
+    }
+
+    print_metrics("failing upstream", client.metrics());
+  }
+
+  // Tail latency with and without hedging at p90.
+  for (const bool hedging : {false, true})
+  {
+    HedgePolicy hedge;
+    hedge.enabled = hedging;
+    hedge.percentile = 0.90;
+
+    ResilientClient client(pooled, RetryPolicy{}, RetryBudgetOptions{}, hedge);
+    const auto latencies = measure(client, hedgeUrl, count);
+
+    std::cout << (hedging ? "hedged" : "plain") << ": p50=" << at(latencies, 0.50)
+              << " ms p99=" << at(latencies, 0.99) << " ms max=" << latencies.back() << " ms\n";
+    print_metrics(hedging ? "hedged" : "plain", client.metrics());
+  }
+}
@@ -0,0 +1,272 @@
+#ifndef VIX_EXAMPLES_REQUESTS_BODY_DECODER_HPP
+#define VIX_EXAMPLES_REQUESTS_BODY_DECODER_HPP
+
+// Incremental Content-Encoding decoder.
+//
+// BodyDecoder turns compressed body bytes into plain bytes piece by piece
+// with a fixed output buffer, so a large compressed download never needs
+// the whole payload in memory:
+//
+//   std::string_view in = raw;
+//   while (!in.empty() || decoder.has_output())
+//   {
+//     const std::string_view out = decoder.decode(in); // consumes from `in`
+//     write(out);
+//   }
+//
+// gzip and deflate need zlib (VIX_EXAMPLE_WITH_ZLIB), br needs brotli
+// (VIX_EXAMPLE_WITH_BROTLI). Without them only identity is supported and
+// accepted_encodings() advertises nothing.
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <system_error>
+
+#if defined(VIX_EXAMPLE_WITH_ZLIB)
+#include <zlib.h>
+#endif
+
+#if defined(VIX_EXAMPLE_WITH_BROTLI)
+#include <brotli/decode.h>
+#endif
+
+namespace vix_examples::requests
+{
+  class BodyDecoder
+  {
+  public:
+    // Accept-Encoding value for what this build can decode; empty if none.
+    static std::string accepted_encodings()
+    {
+      std::string out;
+#if defined(VIX_EXAMPLE_WITH_BROTLI)
+      out += "br";
+#endif
+#if defined(VIX_EXAMPLE_WITH_ZLIB)
+      out += out.empty() ? "gzip, deflate" : ", gzip, deflate";
+#endif
+      return out;
+    }
+
+    static bool supports(std::string_view encoding) noexcept
+    {
+      return kind_of(encoding) != Kind::unsupported;
+    }
+
+    // Throws for an encoding this build cannot decode; check supports().
+    explicit BodyDecoder(std::string_view encoding, std::size_t outputSize = 64 * 1024)
+        : kind_(kind_of(encoding)),
+          output_(new char[outputSize]),
+          outputSize_(outputSize)
+    {
+      switch (kind_)
+      {
+#if defined(VIX_EXAMPLE_WITH_ZLIB)
+      case Kind::zlib:
+        // 15 + 32: accept both gzip and zlib headers.
+        if (inflateInit2(&zstream_, 15 + 32) != Z_OK)
+        {
+          throw std::system_error(std::make_error_code(std::errc::not_enough_memory), "inflateInit2");
+        }
+        break;
+#endif
+#if defined(VIX_EXAMPLE_WITH_BROTLI)
+      case Kind::brotli:
+        brotli_ = BrotliDecoderCreateInstance(nullptr, nullptr, nullptr);
+        if (brotli_ == nullptr)
+        {
+          throw std::system_error(std::make_error_code(std::errc::not_enough_memory), "BrotliDecoderCreateInstance");
+        }
+        break;
+#endif
+      case Kind::identity:
+        break;
+      default:
+        throw std::system_error(std::make_error_code(std::errc::not_supported),
+                                "unsupported content encoding: " + std::string(encoding));
+      }
+    }
+
+    BodyDecoder(const BodyDecoder &) = delete;
+    BodyDecoder &operator=(const BodyDecoder &) = delete;
+
+    ~BodyDecoder()
+    {
+#if defined(VIX_EXAMPLE_WITH_ZLIB)
+      if (kind_ == Kind::zlib)
+      {
+        inflateEnd(&zstream_);
+      }
+#endif
+#if defined(VIX_EXAMPLE_WITH_BROTLI)
+      if (brotli_ != nullptr)
+      {
+        BrotliDecoderDestroyInstance(brotli_);
+      }
+#endif
+    }
+
+    // Consumes a prefix of `input` and returns the bytes it produced (maybe
+    // none). The view stays valid until the next call.
+    std::string_view decode(std::string_view &input)
+    {
+      switch (kind_)
+      {
+#if defined(VIX_EXAMPLE_WITH_ZLIB)
+      case Kind::zlib:
+        return inflate_some(input);
+#endif
+#if defined(VIX_EXAMPLE_WITH_BROTLI)
+      case Kind::brotli:
+        return brotli_some(input);
+#endif
+      default:
+      {
+        const std::string_view out = input;
+        input = {};
+        return out;
+      }
+      }
+    }
+
+    // True when output is pending that needs no further input.
+    [[nodiscard]] bool has_output() const noexcept { return pending_; }
+
+    // True once the compressed stream ended. Identity never ends by itself.
+    [[nodiscard]] bool done() const noexcept { return done_ || kind_ == Kind::identity; }
+
+    [[nodiscard]] bool identity() const noexcept { return kind_ == Kind::identity; }
+
+  private:
+    enum class Kind
+    {
+      identity,
+      zlib,
+      brotli,
+      unsupported,
+    };
+
+    static Kind kind_of(std::string_view encoding) noexcept
+    {
+      while (!encoding.empty() && encoding.front() == ' ')
+      {
+        encoding.remove_prefix(1);
+      }
+      while (!encoding.empty() && encoding.back() == ' ')
+      {
+        encoding.remove_suffix(1);
+      }
+
+      auto is = [&](std::string_view name)
+      {
+        if (encoding.size() != name.size())
+        {
+          return false;
+        }
+        for (std::size_t i = 0; i < name.size(); ++i)
+        {
+          if ((encoding[i] | 0x20) != name[i])
+          {
+            return false;
+          }
+        }
+        return true;
+      };
+
+      if (encoding.empty() || is("identity"))
+      {
+        return Kind::identity;
+      }
+#if defined(VIX_EXAMPLE_WITH_ZLIB)
+      if (is("gzip") || is("x-gzip") || is("deflate"))
+      {
+        return Kind::zlib;
+      }
+#endif
+#if defined(VIX_EXAMPLE_WITH_BROTLI)
+      if (is("br"))
+      {
+        return Kind::brotli;
+      }
+#endif
+      return Kind::unsupported;
+    }
+
+#if defined(VIX_EXAMPLE_WITH_ZLIB)
+    std::string_view inflate_some(std::string_view &input)
+    {
+      if (done_)
+      {
+        // Bytes after the end of the stream are ignored.
+        input = {};
+        return {};
+      }
+
+      zstream_.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(input.data()));
+      zstream_.avail_in = static_cast<uInt>(input.size());
+      zstream_.next_out = reinterpret_cast<Bytef *>(output_.get());
+      zstream_.avail_out = static_cast<uInt>(outputSize_);
+
+      const int rc = inflate(&zstream_, Z_NO_FLUSH);
+
+      if (rc != Z_OK && rc != Z_STREAM_END && rc != Z_BUF_ERROR)
+      {
+        throw std::system_error(std::make_error_code(std::errc::illegal_byte_sequence),
+                                zstream_.msg != nullptr ? zstream_.msg : "inflate");
+      }
+
+      input.remove_prefix(input.size() - zstream_.avail_in);
+      done_ = rc == Z_STREAM_END;
+      pending_ = !done_ && zstream_.avail_out == 0;
+
+      return {output_.get(), outputSize_ - zstream_.avail_out};
+    }
+
+    z_stream zstream_{};
+#endif
+
+#if defined(VIX_EXAMPLE_WITH_BROTLI)
+    std::string_view brotli_some(std::string_view &input)
+    {
+      if (done_)
+      {
+        input = {};
+        return {};
+      }
+
+      std::size_t availIn = input.size();
+      const auto *nextIn = reinterpret_cast<const std::uint8_t *>(input.data());
+      std::size_t availOut = outputSize_;
+      auto *nextOut = reinterpret_cast<std::uint8_t *>(output_.get());
+
+      const BrotliDecoderResult rc =
+          BrotliDecoderDecompressStream(brotli_, &availIn, &nextIn, &availOut, &nextOut, nullptr);
+
+      if (rc == BROTLI_DECODER_RESULT_ERROR)
+      {
+        throw std::system_error(std::make_error_code(std::errc::illegal_byte_sequence),
+                                BrotliDecoderErrorString(BrotliDecoderGetErrorCode(brotli_)));
+      }
+
+      input.remove_prefix(input.size() - availIn);
+      done_ = rc == BROTLI_DECODER_RESULT_SUCCESS;
+      pending_ = rc == BROTLI_DECODER_RESULT_NEEDS_MORE_OUTPUT;
+
+      return {output_.get(), outputSize_ - availOut};
+    }
+
+    BrotliDecoderState *brotli_{nullptr};
+#endif
+
+    Kind kind_;
+    std::unique_ptr<char[]> output_;
+    std::size_t outputSize_;
+    bool pending_{false};
+    bool done_{false};
+  };
+} // namespace vix_examples::requests
+
+#endif // VIX_EXAMPLES_REQUESTS_BODY_DECODER_HPP
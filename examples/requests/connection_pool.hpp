@@ -0,0 +1,1854 @@
+#ifndef VIX_EXAMPLES_REQUESTS_CONNECTION_POOL_HPP
+#define VIX_EXAMPLES_REQUESTS_CONNECTION_POOL_HPP
+
+// Keep-alive connection pool for HTTP/1.1 clients.
+//
+// ConnectionPool keeps idle connections per origin (scheme, host, port)
+// and hands them out again instead of paying TCP and TLS setup on every
+// request:
+//
+//  - at most max_per_host connections per origin; callers beyond that
+//    wait up to wait_timeout for one to be released
+//  - idle connections older than idle_timeout are closed on checkout
+//  - a checked-out connection is probed first; one the server closed (or
+//    that has unexpected bytes pending) is dropped
+//  - TLS sessions are cached per origin, so new connections resume
+//    instead of running a full handshake
+//
+// PooledClient speaks HTTP/1.1 over the pool (Content-Length and chunked
+// bodies, Connection: close). Idempotent requests that fail on a reused
+// connection before any response byte arrives are retried once on a
+// fresh one, which covers the server closing an idle socket at the same
+// moment it is reused.
+//
+// Bodies can be consumed without buffering them: open() returns a
+// StreamingResponse to pull pieces from, stream() calls a function per
+// piece and download_to() writes to a file. gzip/deflate/br bodies are
+// decoded on the fly (see body_decoder.hpp) and on_progress reports wire
+// and decoded byte counts.
+//
+// TLS needs OpenSSL; define VIX_EXAMPLE_WITH_OPENSSL to enable it.
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <cerrno>
+#include <charconv>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <cstdio>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "body_decoder.hpp"
+
+#if defined(VIX_EXAMPLE_WITH_OPENSSL)
+#include <openssl/err.h>
+#include <openssl/ssl.h>
+#endif
+
+namespace vix_examples::requests
+{
+  using Clock = std::chrono::steady_clock;
+
+  struct Origin
+  {
+    std::string scheme;
+    std::string host;
+    std::uint16_t port{0};
+
+    [[nodiscard]] bool tls() const noexcept { return scheme == "https"; }
+
+    [[nodiscard]] std::string key() const
+    {
+      return scheme + "://" + host + ":" + std::to_string(port);
+    }
+
+    // Host header / :authority value; the port is left out when default.
+    [[nodiscard]] std::string authority() const
+    {
+      std::string out = host.find(':') != std::string::npos ? "[" + host + "]" : host;
+      if (port != (tls() ? 443 : 80))
+      {
+        out += ":" + std::to_string(port);
+      }
+      return out;
+    }
+  };
+
+  namespace detail
+  {
+    // The whole of `text` as a number: no sign, no spaces, no trailing
+    // bytes, no overflow. nullopt otherwise.
+    template <class T>
+    [[nodiscard]] std::optional<T> parse_number(std::string_view text, int base = 10)
+    {
+      T value{};
+      const auto [ptr, ec] = std::from_chars(text.data(), text.data() + text.size(), value, base);
+
+      if (text.empty() || ec != std::errc{} || ptr != text.data() + text.size())
+      {
+        return std::nullopt;
+      }
+
+      return value;
+    }
+  } // namespace detail
+
+  struct Url
+  {
+    Origin origin;
+    std::string target;
+  };
+
+  [[nodiscard]] inline Url parse_url(std::string_view text)
+  {
+    Url url;
+
+    const auto scheme_end = text.find("://");
+    if (scheme_end == std::string_view::npos)
+    {
+      throw std::invalid_argument("url without scheme: " + std::string(text));
+    }
+
+    url.origin.scheme = std::string(text.substr(0, scheme_end));
+    if (url.origin.scheme != "http" && url.origin.scheme != "https")
+    {
+      throw std::invalid_argument("unsupported scheme: " + url.origin.scheme);
+    }
+
+    text.remove_prefix(scheme_end + 3);
+
+    const auto path_start = text.find('/');
+    std::string_view authority = text.substr(0, path_start);
+    url.target = path_start == std::string_view::npos ? "/" : std::string(text.substr(path_start));
+
+    url.origin.port = url.origin.tls() ? 443 : 80;
+
+    // host, host:port, [v6] or [v6]:port
+    std::string_view port;
+    if (!authority.empty() && authority.front() == '[')
+    {
+      const auto close = authority.find(']');
+      if (close == std::string_view::npos)
+      {
+        throw std::invalid_argument("bad IPv6 host: " + std::string(authority));
+      }
+
+      if (close + 1 < authority.size() && authority[close + 1] == ':')
+      {
+        port = authority.substr(close + 2);
+      }
+
+      authority = authority.substr(1, close - 1);
+    }
+    else if (const auto colon = authority.rfind(':'); colon != std::string_view::npos)
+    {
+      port = authority.substr(colon + 1);
+      authority = authority.substr(0, colon);
+    }
+
+    if (!port.empty())
+    {
+      const auto value = detail::parse_number<std::uint16_t>(port);
+      if (!value || *value == 0)
+      {
+        throw std::invalid_argument("bad port: " + std::string(port));
+      }
+      url.origin.port = *value;
+    }
+
+    url.origin.host = std::string(authority);
+    return url;
+  }
+
+  struct PoolOptions
+  {
+    std::size_t max_per_host{8};
+    std::size_t max_idle_per_host{8};
+    std::chrono::milliseconds idle_timeout{std::chrono::seconds(30)};
+    std::chrono::milliseconds wait_timeout{std::chrono::seconds(5)};
+    std::chrono::milliseconds connect_timeout{std::chrono::seconds(5)};
+    std::chrono::milliseconds io_timeout{std::chrono::seconds(15)};
+
+    bool verify_peer{true};
+    std::string ca_file;
+  };
+
+  struct PoolMetrics
+  {
+    std::uint64_t hits{0};
+    std::uint64_t misses{0};
+    std::uint64_t waits{0};
+    std::uint64_t wait_timeouts{0};
+    std::uint64_t closed_idle{0};
+    std::uint64_t closed_unhealthy{0};
+    std::uint64_t discarded{0};
+    std::uint64_t tls_handshakes{0};
+    std::uint64_t tls_resumed{0};
+    std::uint64_t open_connections{0};
+  };
+
+  namespace detail
+  {
+    [[noreturn]] inline void throw_errno(const char *what)
+    {
+      throw std::system_error(errno, std::system_category(), what);
+    }
+
+    // Returns false on timeout.
+    inline bool wait_fd(int fd, short events, std::chrono::milliseconds timeout)
+    {
+      pollfd p{fd, events, 0};
+
+      for (;;)
+      {
+        const int rc = ::poll(&p, 1, static_cast<int>(timeout.count()));
+
+        if (rc > 0)
+        {
+          return true;
+        }
+
+        if (rc == 0)
+        {
+          return false;
+        }
+
+        if (errno != EINTR)
+        {
+          throw_errno("poll");
+        }
+      }
+    }
+
+    inline int connect_tcp(const Origin &origin, std::chrono::milliseconds timeout)
+    {
+      addrinfo hints{};
+      hints.ai_family = AF_UNSPEC;
+      hints.ai_socktype = SOCK_STREAM;
+
+      addrinfo *list = nullptr;
+      const std::string port = std::to_string(origin.port);
+
+      if (const int rc = ::getaddrinfo(origin.host.c_str(), port.c_str(), &hints, &list); rc != 0)
+      {
+        throw std::system_error(std::make_error_code(std::errc::host_unreachable),
+                                origin.host + ": " + ::gai_strerror(rc));
+      }
+
+      std::unique_ptr<addrinfo, decltype(&::freeaddrinfo)> guard(list, &::freeaddrinfo);
+      std::error_code last = std::make_error_code(std::errc::host_unreachable);
+
+      for (addrinfo *ai = list; ai != nullptr; ai = ai->ai_next)
+      {
+        const int fd = ::socket(ai->ai_family, ai->ai_socktype | SOCK_NONBLOCK | SOCK_CLOEXEC, ai->ai_protocol);
+        if (fd < 0)
+        {
+          last = std::error_code(errno, std::system_category());
+          continue;
+        }
+
+        if (::connect(fd, ai->ai_addr, ai->ai_addrlen) == 0 ||
+            (errno == EINPROGRESS && wait_fd(fd, POLLOUT, timeout)))
+        {
+          int error = 0;
+          socklen_t len = sizeof(error);
+          ::getsockopt(fd, SOL_SOCKET, SO_ERROR, &error, &len);
+
+          if (error == 0)
+          {
+            const int one = 1;
+            ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+            return fd;
+          }
+
+          last = std::error_code(error, std::system_category());
+        }
+        else
+        {
+          last = errno == EINPROGRESS ? std::make_error_code(std::errc::timed_out)
+                                      : std::error_code(errno, std::system_category());
+        }
+
+        ::close(fd);
+      }
+
+      throw std::system_error(last, "connect " + origin.key());
+    }
+
+    inline bool iequals(std::string_view a, std::string_view b)
+    {
+      return a.size() == b.size() &&
+             std::equal(a.begin(), a.end(), b.begin(), [](char x, char y)
+                        { return std::tolower(static_cast<unsigned char>(x)) ==
+                                 std::tolower(static_cast<unsigned char>(y)); });
+    }
+
+    // True when the comma-separated header value lists `token`.
+    inline bool has_token(std::string_view list, std::string_view token)
+    {
+      while (!list.empty())
+      {
+        const auto comma = list.find(',');
+        std::string_view item = list.substr(0, comma);
+        list = comma == std::string_view::npos ? std::string_view{} : list.substr(comma + 1);
+
+        while (!item.empty() && (item.front() == ' ' || item.front() == '\t'))
+        {
+          item.remove_prefix(1);
+        }
+        while (!item.empty() && (item.back() == ' ' || item.back() == '\t'))
+        {
+          item.remove_suffix(1);
+        }
+
+        if (iequals(item, token))
+        {
+          return true;
+        }
+      }
+      return false;
+    }
+
+#if defined(VIX_EXAMPLE_WITH_OPENSSL)
+    // OpenSSL's socket BIO writes with write(2), which raises SIGPIPE on a
+    // connection the peer reset. This one sends with MSG_NOSIGNAL like the
+    // plain path, so neither SSL_write nor SSL_shutdown can kill the process.
+    inline int nosignal_bio_write(BIO *bio, const char *data, int size)
+    {
+      const int fd = static_cast<int>(reinterpret_cast<std::intptr_t>(BIO_get_data(bio)));
+      BIO_clear_retry_flags(bio);
+
+      const ssize_t n = ::send(fd, data, static_cast<std::size_t>(size), MSG_NOSIGNAL);
+      if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR))
+      {
+        BIO_set_retry_write(bio);
+      }
+
+      return static_cast<int>(n);
+    }
+
+    inline int nosignal_bio_read(BIO *bio, char *out, int size)
+    {
+      const int fd = static_cast<int>(reinterpret_cast<std::intptr_t>(BIO_get_data(bio)));
+      BIO_clear_retry_flags(bio);
+
+      const ssize_t n = ::recv(fd, out, static_cast<std::size_t>(size), 0);
+      if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR))
+      {
+        BIO_set_retry_read(bio);
+      }
+
+      return static_cast<int>(n);
+    }
+
+    inline long nosignal_bio_ctrl(BIO *bio, int cmd, long, void *)
+    {
+      switch (cmd)
+      {
+      case BIO_CTRL_FLUSH:
+        return 1;
+      case BIO_C_GET_FD:
+        return static_cast<long>(reinterpret_cast<std::intptr_t>(BIO_get_data(bio)));
+      default:
+        return 0;
+      }
+    }
+
+    // The BIO does not own the descriptor; Connection closes it.
+    inline BIO *nosignal_bio(int fd)
+    {
+      static BIO_METHOD *method = []
+      {
+        BIO_METHOD *m = BIO_meth_new(BIO_get_new_index() | BIO_TYPE_SOURCE_SINK | BIO_TYPE_DESCRIPTOR,
+                                     "vix nosignal socket");
+        BIO_meth_set_write(m, nosignal_bio_write);
+        BIO_meth_set_read(m, nosignal_bio_read);
+        BIO_meth_set_ctrl(m, nosignal_bio_ctrl);
+        return m;
+      }();
+
+      BIO *bio = BIO_new(method);
+      if (bio == nullptr)
+      {
+        throw std::runtime_error("BIO_new failed");
+      }
+
+      BIO_set_data(bio, reinterpret_cast<void *>(static_cast<std::intptr_t>(fd)));
+      BIO_set_init(bio, 1);
+      return bio;
+    }
+#endif
+  } // namespace detail
+
+  class ConnectionPool;
+
+  // One TCP (optionally TLS) connection. Buffered reads; bytes read past
+  // the end of a response stay in the buffer for the next one.
+  class Connection
+  {
+  public:
+    Connection(const Connection &) = delete;
+    Connection &operator=(const Connection &) = delete;
+
+    ~Connection()
+    {
+#if defined(VIX_EXAMPLE_WITH_OPENSSL)
+      if (ssl_ != nullptr)
+      {
+        // Without a close_notify OpenSSL marks the session not resumable.
+        // Skipped when the peer already hung up; the write goes through
+        // nosignal_bio either way, so it cannot raise SIGPIPE.
+        pollfd p{fd_, POLLIN, 0};
+        if (fd_ >= 0 && ::poll(&p, 1, 0) == 0)
+        {
+          SSL_shutdown(ssl_);
+        }
+        SSL_free(ssl_);
+      }
+#endif
+      if (fd_ >= 0)
+      {
+        ::close(fd_);
+      }
+    }
+
+    void write_all(std::string_view data)
+    {
+      while (!data.empty())
+      {
+        const long n = raw_write(data);
+
+        if (n > 0)
+        {
+          data.remove_prefix(static_cast<std::size_t>(n));
+        }
+        else if (n == 0)
+        {
+          throw std::system_error(std::make_error_code(std::errc::connection_reset), "write");
+        }
+        else if (!detail::wait_fd(fd_, want_ == POLLIN ? POLLIN : POLLOUT, io_timeout_))
+        {
+          throw std::system_error(std::make_error_code(std::errc::timed_out), "write");
+        }
+      }
+    }
+
+    // Appends at least one byte to `buffer_`; returns false on clean EOF.
+    bool fill()
+    {
+      char chunk[16 * 1024];
+
+      for (;;)
+      {
+        const long n = raw_read(chunk, sizeof(chunk));
+
+        if (n > 0)
+        {
+          buffer_.append(chunk, static_cast<std::size_t>(n));
+          bytes_received_ += static_cast<std::size_t>(n);
+          return true;
+        }
+
+        if (n == 0)
+        {
+          return false;
+        }
+
+        if (!detail::wait_fd(fd_, want_ == POLLOUT ? POLLOUT : POLLIN, io_timeout_))
+        {
+          throw std::system_error(std::make_error_code(std::errc::timed_out), "read");
+        }
+      }
+    }
+
+    std::string &buffer() noexcept { return buffer_; }
+    [[nodiscard]] std::size_t bytes_received() const noexcept { return bytes_received_; }
+    [[nodiscard]] std::size_t requests_served() const noexcept { return requests_; }
+    [[nodiscard]] bool reused() const noexcept { return requests_ > 0; }
+    [[nodiscard]] const std::string &origin_key() const noexcept { return key_; }
+
+    // Non-blocking I/O for callers running their own poll loop (HTTP/2):
+    // > 0 bytes, 0 EOF, -1 would block; want() then says which way.
+    long read_some(char *out, std::size_t size) { return raw_read(out, size); }
+    long write_some(std::string_view data) { return raw_write(data); }
+    [[nodiscard]] int native_handle() const noexcept { return fd_; }
+    [[nodiscard]] short want() const noexcept { return want_; }
+
+    // Protocol selected by ALPN; empty without TLS or when none was offered.
+    [[nodiscard]] const std::string &alpn() const noexcept { return alpn_; }
+
+    void begin_request() noexcept { bytes_received_ = 0; }
+    void end_request() noexcept
+    {
+      ++requests_;
+      last_used_ = Clock::now();
+    }
+
+  private:
+    friend class ConnectionPool;
+
+    Connection(int fd, std::string key, std::chrono::milliseconds io_timeout)
+        : fd_(fd),
+          key_(std::move(key)),
+          io_timeout_(io_timeout),
+          last_used_(Clock::now())
+    {
+    }
+
+    // > 0 bytes, 0 EOF, -1 would block (want_ says which way).
+    long raw_read(char *out, std::size_t size)
+    {
+#if defined(VIX_EXAMPLE_WITH_OPENSSL)
+      if (ssl_ != nullptr)
+      {
+        const int n = SSL_read(ssl_, out, static_cast<int>(size));
+        return n > 0 ? n : ssl_status(n, "SSL_read");
+      }
+#endif
+      const ssize_t n = ::recv(fd_, out, size, 0);
+
+      if (n >= 0)
+      {
+        return n;
+      }
+
+      if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)
+      {
+        want_ = POLLIN;
+        return -1;
+      }
+
+      detail::throw_errno("recv");
+    }
+
+    long raw_write(std::string_view data)
+    {
+#if defined(VIX_EXAMPLE_WITH_OPENSSL)
+      if (ssl_ != nullptr)
+      {
+        const int n = SSL_write(ssl_, data.data(), static_cast<int>(data.size()));
+        return n > 0 ? n : ssl_status(n, "SSL_write");
+      }
+#endif
+      const ssize_t n = ::send(fd_, data.data(), data.size(), MSG_NOSIGNAL);
+
+      if (n >= 0)
+      {
+        return n;
+      }
+
+      if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)
+      {
+        want_ = POLLOUT;
+        return -1;
+      }
+
+      detail::throw_errno("send");
+    }
+
+#if defined(VIX_EXAMPLE_WITH_OPENSSL)
+    long ssl_status(int rc, const char *what)
+    {
+      switch (SSL_get_error(ssl_, rc))
+      {
+      case SSL_ERROR_WANT_READ:
+        want_ = POLLIN;
+        return -1;
+      case SSL_ERROR_WANT_WRITE:
+        want_ = POLLOUT;
+        return -1;
+      case SSL_ERROR_ZERO_RETURN:
+        return 0;
+      case SSL_ERROR_SYSCALL:
+        if (errno == 0)
+        {
+          return 0;
+        }
+        detail::throw_errno(what);
+      default:
+        throw std::system_error(std::make_error_code(std::errc::protocol_error),
+                                std::string(what) + ": " + ERR_error_string(ERR_get_error(), nullptr));
+      }
+    }
+
+    SSL *ssl_{nullptr};
+#endif
+
+    int fd_{-1};
+    std::string key_;
+    std::chrono::milliseconds io_timeout_;
+    Clock::time_point last_used_;
+    std::string buffer_;
+    std::string alpn_;
+    std::size_t bytes_received_{0};
+    std::size_t requests_{0};
+    short want_{POLLIN};
+  };
+
+  class ConnectionPool
+  {
+  public:
+    explicit ConnectionPool(PoolOptions options = {})
+        : options_(std::move(options))
+    {
+#if defined(VIX_EXAMPLE_WITH_OPENSSL)
+      ssl_ctx_ = SSL_CTX_new(TLS_client_method());
+      SSL_CTX_set_min_proto_version(ssl_ctx_, TLS1_2_VERSION);
+      SSL_CTX_set_session_cache_mode(ssl_ctx_, SSL_SESS_CACHE_CLIENT | SSL_SESS_CACHE_NO_INTERNAL_STORE);
+
+      if (options_.verify_peer)
+      {
+        SSL_CTX_set_verify(ssl_ctx_, SSL_VERIFY_PEER, nullptr);
+
+        if (!options_.ca_file.empty())
+        {
+          SSL_CTX_load_verify_locations(ssl_ctx_, options_.ca_file.c_str(), nullptr);
+        }
+        else
+        {
+          SSL_CTX_set_default_verify_paths(ssl_ctx_);
+        }
+      }
+#endif
+    }
+
+    ConnectionPool(const ConnectionPool &) = delete;
+    ConnectionPool &operator=(const ConnectionPool &) = delete;
+
+    ~ConnectionPool()
+    {
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        hosts_.clear();
+      }
+
+#if defined(VIX_EXAMPLE_WITH_OPENSSL)
+      for (auto &[key, session] : sessions_)
+      {
+        SSL_SESSION_free(session);
+      }
+
+      SSL_CTX_free(ssl_ctx_);
+#endif
+    }
+
+    // Checked-out connection. Goes back to the pool on destruction unless
+    // discard() was called.
+    class Lease
+    {
+    public:
+      Lease(Lease &&other) noexcept
+          : pool_(std::exchange(other.pool_, nullptr)),
+            conn_(std::move(other.conn_))
+      {
+      }
+
+      Lease &operator=(Lease &&) = delete;
+
+      ~Lease()
+      {
+        if (pool_ != nullptr && conn_)
+        {
+          pool_->release(std::move(conn_));
+        }
+      }
+
+      Connection &operator*() const noexcept { return *conn_; }
+      Connection *operator->() const noexcept { return conn_.get(); }
+
+      // The connection cannot be reused (error, Connection: close).
+      void discard()
+      {
+        if (pool_ != nullptr && conn_)
+        {
+          pool_->drop(std::move(conn_));
+        }
+      }
+
+    private:
+      friend class ConnectionPool;
+
+      Lease(ConnectionPool *pool, std::unique_ptr<Connection> conn)
+          : pool_(pool),
+            conn_(std::move(conn))
+      {
+      }
+
+      ConnectionPool *pool_;
+      std::unique_ptr<Connection> conn_;
+    };
+
+    // Reuses an idle connection when one is healthy, opens a new one while
+    // the origin is below max_per_host, and otherwise waits.
+    [[nodiscard]] Lease acquire(const Origin &origin, bool fresh = false)
+    {
+      const std::string key = origin.key();
+      const auto deadline = Clock::now() + options_.wait_timeout;
+      bool counted_wait = false;
+
+      std::vector<std::unique_ptr<Connection>> closing; // destroyed after the lock
+      std::unique_lock<std::mutex> lock(mutex_);
+      HostState &host = hosts_[key];
+
+      for (;;)
+      {
+        while (!fresh && !host.idle.empty())
+        {
+          std::unique_ptr<Connection> conn = std::move(host.idle.back());
+          host.idle.pop_back();
+
+          if (Clock::now() - conn->last_used_ > options_.idle_timeout)
+          {
+            close_locked(host, std::move(conn), metrics_.closed_idle, closing);
+            continue;
+          }
+
+          if (!healthy(*conn))
+          {
+            close_locked(host, std::move(conn), metrics_.closed_unhealthy, closing);
+            continue;
+          }
+
+          ++metrics_.hits;
+          return Lease(this, std::move(conn));
+        }
+
+        if (host.open < options_.max_per_host)
+        {
+          ++host.open;
+          ++metrics_.misses;
+          ++metrics_.open_connections;
+          lock.unlock();
+
+          try
+          {
+            return Lease(this, open(origin, key));
+          }
+          catch (...)
+          {
+            lock.lock();
+            --host.open;
+            --metrics_.open_connections;
+            cv_.notify_all();
+            throw;
+          }
+        }
+
+        // At the limit; a fresh connection can still replace an idle one.
+        if (fresh && !host.idle.empty())
+        {
+          close_locked(host, std::move(host.idle.front()), metrics_.closed_idle, closing);
+          host.idle.pop_front();
+          continue;
+        }
+
+        if (!counted_wait)
+        {
+          ++metrics_.waits;
+          counted_wait = true;
+        }
+
+        if (!closing.empty())
+        {
+          lock.unlock();
+          closing.clear();
+          lock.lock();
+          continue;
+        }
+
+        if (cv_.wait_until(lock, deadline) == std::cv_status::timeout)
+        {
+          ++metrics_.wait_timeouts;
+          throw std::system_error(std::make_error_code(std::errc::timed_out),
+                                  "connection pool wait for " + key);
+        }
+      }
+    }
+
+    [[nodiscard]] PoolMetrics metrics() const
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      return metrics_;
+    }
+
+    [[nodiscard]] const PoolOptions &options() const noexcept { return options_; }
+
+    // Opens a connection that is not pooled, offering `protocols` through
+    // ALPN (e.g. {"h2", "http/1.1"}). One that settles on HTTP/1.1 can be
+    // handed to the pool with adopt().
+    [[nodiscard]] std::unique_ptr<Connection> connect(const Origin &origin,
+                                                      const std::vector<std::string> &protocols = {})
+    {
+      std::string wire;
+      for (const auto &protocol : protocols)
+      {
+        wire += static_cast<char>(protocol.size());
+        wire += protocol;
+      }
+
+      return open(origin, origin.key(), wire);
+    }
+
+    // Takes over a connection from connect() as an idle pooled one.
+    void adopt(std::unique_ptr<Connection> conn)
+    {
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        HostState &host = hosts_[conn->key_];
+
+        if (host.open >= options_.max_per_host)
+        {
+          return;
+        }
+
+        ++host.open;
+        ++metrics_.open_connections;
+      }
+
+      release(std::move(conn));
+    }
+
+    // Closes every idle connection, e.g. after a configuration change.
+    void close_idle()
+    {
+      std::vector<std::unique_ptr<Connection>> closing;
+      std::lock_guard<std::mutex> lock(mutex_);
+
+      for (auto &[key, host] : hosts_)
+      {
+        while (!host.idle.empty())
+        {
+          close_locked(host, std::move(host.idle.back()), metrics_.closed_idle, closing);
+          host.idle.pop_back();
+        }
+      }
+    }
+
+  private:
+    struct HostState
+    {
+      std::deque<std::unique_ptr<Connection>> idle;
+      std::size_t open{0};
+    };
+
+    // A pooled connection has nothing to read. Readable means the server
+    // closed it (EOF) or sent bytes nobody asked for.
+    static bool healthy(const Connection &conn)
+    {
+      if (!conn.buffer_.empty())
+      {
+        return false;
+      }
+
+      pollfd p{conn.fd_, POLLIN, 0};
+      return ::poll(&p, 1, 0) == 0;
+    }
+
+    std::unique_ptr<Connection> open(const Origin &origin, const std::string &key,
+                                     [[maybe_unused]] const std::string &alpn = {})
+    {
+      const int fd = detail::connect_tcp(origin, options_.connect_timeout);
+      std::unique_ptr<Connection> conn(new Connection(fd, key, options_.io_timeout));
+
+      if (origin.tls())
+      {
+#if defined(VIX_EXAMPLE_WITH_OPENSSL)
+        handshake(*conn, origin, key, alpn);
+#else
+        throw std::system_error(std::make_error_code(std::errc::protocol_not_supported),
+                                "https requires VIX_EXAMPLE_WITH_OPENSSL");
+#endif
+      }
+
+      return conn;
+    }
+
+#if defined(VIX_EXAMPLE_WITH_OPENSSL)
+    void handshake(Connection &conn, const Origin &origin, const std::string &key,
+                   const std::string &alpn)
+    {
+      conn.ssl_ = SSL_new(ssl_ctx_);
+      BIO *bio = detail::nosignal_bio(conn.fd_);
+      SSL_set_bio(conn.ssl_, bio, bio);
+      SSL_set_tlsext_host_name(conn.ssl_, origin.host.c_str());
+
+      if (!alpn.empty())
+      {
+        SSL_set_alpn_protos(conn.ssl_, reinterpret_cast<const unsigned char *>(alpn.data()),
+                            static_cast<unsigned>(alpn.size()));
+      }
+
+      if (options_.verify_peer)
+      {
+        SSL_set1_host(conn.ssl_, origin.host.c_str());
+      }
+
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (auto it = sessions_.find(key); it != sessions_.end())
+        {
+          SSL_set_session(conn.ssl_, it->second);
+        }
+      }
+
+      for (;;)
+      {
+        const int rc = SSL_connect(conn.ssl_);
+
+        if (rc == 1)
+        {
+          break;
+        }
+
+        if (conn.ssl_status(rc, "SSL_connect") == 0)
+        {
+          throw std::system_error(std::make_error_code(std::errc::connection_reset), "SSL_connect");
+        }
+
+        if (!detail::wait_fd(conn.fd_, conn.want_, options_.connect_timeout))
+        {
+          throw std::system_error(std::make_error_code(std::errc::timed_out), "SSL_connect");
+        }
+      }
+
+      const unsigned char *selected = nullptr;
+      unsigned selected_len = 0;
+      SSL_get0_alpn_selected(conn.ssl_, &selected, &selected_len);
+      if (selected != nullptr)
+      {
+        conn.alpn_.assign(reinterpret_cast<const char *>(selected), selected_len);
+      }
+
+      std::lock_guard<std::mutex> lock(mutex_);
+      ++metrics_.tls_handshakes;
+
+      if (SSL_session_reused(conn.ssl_))
+      {
+        ++metrics_.tls_resumed;
+      }
+    }
+
+    // TLS 1.3 tickets arrive after the handshake, so the session is saved
+    // when the connection comes back from its first request.
+    void remember_session_locked(Connection &conn)
+    {
+      if (conn.ssl_ == nullptr || conn.requests_ != 1)
+      {
+        return;
+      }
+
+      SSL_SESSION *session = SSL_get1_session(conn.ssl_);
+      if (session == nullptr || !SSL_SESSION_is_resumable(session))
+      {
+        SSL_SESSION_free(session);
+        return;
+      }
+
+      SSL_SESSION *&slot = sessions_[conn.key_];
+      if (slot != nullptr)
+      {
+        SSL_SESSION_free(slot);
+      }
+
+      slot = session;
+    }
+#endif
+
+    void release(std::unique_ptr<Connection> conn)
+    {
+      std::vector<std::unique_ptr<Connection>> closing;
+      std::lock_guard<std::mutex> lock(mutex_);
+      HostState &host = hosts_[conn->key_];
+
+#if defined(VIX_EXAMPLE_WITH_OPENSSL)
+      remember_session_locked(*conn);
+#endif
+
+      if (host.idle.size() >= options_.max_idle_per_host)
+      {
+        close_locked(host, std::move(conn), metrics_.closed_idle, closing);
+        return;
+      }
+
+      host.idle.push_back(std::move(conn));
+      cv_.notify_one();
+    }
+
+    void drop(std::unique_ptr<Connection> conn)
+    {
+      std::vector<std::unique_ptr<Connection>> closing;
+      std::lock_guard<std::mutex> lock(mutex_);
+      HostState &host = hosts_[conn->key_];
+
+#if defined(VIX_EXAMPLE_WITH_OPENSSL)
+      remember_session_locked(*conn);
+#endif
+      close_locked(host, std::move(conn), metrics_.discarded, closing);
+    }
+
+    // Connections are only moved to `closing` here: their destructor may
+    // send a TLS close_notify, which callers run after releasing mutex_.
+    void close_locked(HostState &host, std::unique_ptr<Connection> conn, std::uint64_t &counter,
+                      std::vector<std::unique_ptr<Connection>> &closing)
+    {
+      closing.push_back(std::move(conn));
+      --host.open;
+      --metrics_.open_connections;
+      ++counter;
+      cv_.notify_one();
+    }
+
+    PoolOptions options_;
+
+    mutable std::mutex mutex_;
+    std::condition_variable cv_;
+    std::map<std::string, HostState> hosts_;
+    PoolMetrics metrics_;
+
+#if defined(VIX_EXAMPLE_WITH_OPENSSL)
+    SSL_CTX *ssl_ctx_{nullptr};
+    std::map<std::string, SSL_SESSION *> sessions_;
+#endif
+  };
+
+  struct PooledResponse
+  {
+    int status{0};
+    std::vector<std::pair<std::string, std::string>> headers;
+    std::string body;
+    bool reused_connection{false};
+
+    [[nodiscard]] std::string header(std::string_view name) const
+    {
+      for (const auto &[key, value] : headers)
+      {
+        if (detail::iequals(key, name))
+        {
+          return value;
+        }
+      }
+
+      return {};
+    }
+  };
+
+  struct StreamProgress
+  {
+    std::uint64_t wire_bytes{0};    // body bytes read from the socket
+    std::uint64_t decoded_bytes{0}; // bytes handed to the caller
+    std::uint64_t total_bytes{0};   // Content-Length, 0 when unknown
+  };
+
+  // Aborts a request from another thread by shutting its socket down; the
+  // blocked read or write then fails with operation_canceled. Hedged
+  // requests use it to stop the attempt that lost.
+  class CancelHandle
+  {
+  public:
+    void cancel()
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      cancelled_ = true;
+
+      if (fd_ >= 0)
+      {
+        ::shutdown(fd_, SHUT_RDWR);
+      }
+    }
+
+    [[nodiscard]] bool cancelled() const
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      return cancelled_;
+    }
+
+  private:
+    friend class PooledClient;
+    friend class StreamingResponse;
+
+    void attach(int fd)
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (cancelled_)
+      {
+        throw std::system_error(std::make_error_code(std::errc::operation_canceled), "request cancelled");
+      }
+      fd_ = fd;
+    }
+
+    // Returns true when cancel() ran; the connection must not be reused.
+    bool detach()
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      fd_ = -1;
+      return cancelled_;
+    }
+
+    mutable std::mutex mutex_;
+    int fd_{-1};
+    bool cancelled_{false};
+  };
+
+  struct StreamOptions
+  {
+    // Adds Accept-Encoding for the codecs this build has, unless the
+    // request already sets one.
+    bool accept_compressed{true};
+    // Decodes gzip/deflate/br bodies; unknown encodings pass through.
+    bool decode{true};
+    std::function<void(const StreamProgress &)> on_progress;
+    std::shared_ptr<CancelHandle> cancel;
+    // Caps the response head, each chunk-size line and the trailers, so a
+    // peer that never sends CRLF cannot grow the buffer without bound.
+    std::size_t max_header_bytes{64 * 1024};
+  };
+
+  // Response whose body is pulled piece by piece from the connection.
+  // next() returns an empty view at the end; the connection goes back to
+  // the pool at that point. Dropping the response earlier closes it.
+  class StreamingResponse
+  {
+  public:
+    StreamingResponse(StreamingResponse &&) = default;
+    StreamingResponse &operator=(StreamingResponse &&) = delete;
+
+    ~StreamingResponse()
+    {
+      if (cancel_)
+      {
+        cancel_->detach();
+      }
+
+      if (lease_ && !finished_)
+      {
+        lease_->discard();
+      }
+    }
+
+    [[nodiscard]] int status() const noexcept { return head_.status; }
+    [[nodiscard]] const PooledResponse &head() const noexcept { return head_; }
+    [[nodiscard]] std::string header(std::string_view name) const { return head_.header(name); }
+    [[nodiscard]] bool decoded() const noexcept { return decoder_ && !decoder_->identity(); }
+    [[nodiscard]] const StreamProgress &progress() const noexcept { return progress_; }
+
+    // Next body piece (at most one socket read or one decoder buffer).
+    // The view stays valid until the following call.
+    std::string_view next()
+    {
+      try
+      {
+        return next_piece();
+      }
+      catch (const std::system_error &)
+      {
+        if (cancel_ && cancel_->cancelled())
+        {
+          throw std::system_error(std::make_error_code(std::errc::operation_canceled), "request cancelled");
+        }
+        throw;
+      }
+    }
+
+  private:
+    friend class PooledClient;
+
+    enum class Framing
+    {
+      none,
+      length,
+      chunked,
+      until_eof,
+    };
+
+    std::string_view next_piece()
+    {
+      for (;;)
+      {
+        if (finished_)
+        {
+          return {};
+        }
+
+        if (unconsumed_ > 0)
+        {
+          consume_raw(std::exchange(unconsumed_, 0));
+        }
+
+        if (decoder_ && decoder_->has_output())
+        {
+          std::string_view none;
+          const std::string_view out = decoder_->decode(none);
+          if (!out.empty())
+          {
+            return deliver(out);
+          }
+        }
+
+        const std::string_view raw = raw_piece();
+
+        if (raw.empty())
+        {
+          if (raw_done_)
+          {
+            finish();
+          }
+          continue;
+        }
+
+        if (!decoder_ || decoder_->identity())
+        {
+          // Handed out in place; erased from the buffer on the next call.
+          unconsumed_ = raw.size();
+          progress_.wire_bytes += raw.size();
+          return deliver(raw);
+        }
+
+        std::string_view in = raw;
+        const std::string_view out = decoder_->decode(in);
+        progress_.wire_bytes += raw.size() - in.size();
+        consume_raw(raw.size() - in.size());
+
+        if (!out.empty())
+        {
+          return deliver(out);
+        }
+      }
+    }
+
+    StreamingResponse(ConnectionPool::Lease lease, PooledResponse head, Framing framing,
+                      std::uint64_t length, bool keepAlive, std::unique_ptr<BodyDecoder> decoder,
+                      std::function<void(const StreamProgress &)> onProgress,
+                      std::shared_ptr<CancelHandle> cancel, std::size_t maxHeaderBytes)
+        : lease_(std::move(lease)),
+          head_(std::move(head)),
+          framing_(framing),
+          remaining_(length),
+          keepAlive_(keepAlive),
+          decoder_(std::move(decoder)),
+          onProgress_(std::move(onProgress)),
+          cancel_(std::move(cancel)),
+          maxHeaderBytes_(maxHeaderBytes)
+    {
+      progress_.total_bytes = framing == Framing::length ? length : 0;
+
+      if (framing_ == Framing::none || (framing_ == Framing::length && remaining_ == 0))
+      {
+        raw_done_ = true;
+      }
+    }
+
+    std::string_view deliver(std::string_view out)
+    {
+      progress_.decoded_bytes += out.size();
+      if (onProgress_)
+      {
+        onProgress_(progress_);
+      }
+      return out;
+    }
+
+    // Body bytes available in the connection buffer, reading more when it
+    // is empty. Returns an empty view and sets raw_done_ at the end.
+    std::string_view raw_piece()
+    {
+      if (raw_done_)
+      {
+        return {};
+      }
+
+      Connection &conn = **lease_;
+      std::string &buf = conn.buffer();
+
+      switch (framing_)
+      {
+      case Framing::length:
+        if (buf.empty() && !conn.fill())
+        {
+          throw std::system_error(std::make_error_code(std::errc::connection_reset), "truncated body");
+        }
+        return std::string_view(buf).substr(0, static_cast<std::size_t>(
+                                                   std::min<std::uint64_t>(remaining_, buf.size())));
+
+      case Framing::chunked:
+        if (remaining_ == 0 && !next_chunk(conn))
+        {
+          raw_done_ = true;
+          return {};
+        }
+        if (buf.empty() && !conn.fill())
+        {
+          throw std::system_error(std::make_error_code(std::errc::connection_reset), "truncated chunk");
+        }
+        return std::string_view(buf).substr(0, static_cast<std::size_t>(
+                                                   std::min<std::uint64_t>(remaining_, buf.size())));
+
+      case Framing::until_eof:
+        if (buf.empty() && !conn.fill())
+        {
+          raw_done_ = true;
+          return {};
+        }
+        return buf;
+
+      default:
+        raw_done_ = true;
+        return {};
+      }
+    }
+
+    void consume_raw(std::size_t n)
+    {
+      (*lease_)->buffer().erase(0, n);
+
+      if (framing_ == Framing::length || framing_ == Framing::chunked)
+      {
+        remaining_ -= n;
+      }
+
+      if (framing_ == Framing::length && remaining_ == 0)
+      {
+        raw_done_ = true;
+      }
+    }
+
+    // Reads the CRLF closing the previous chunk and the next size line.
+    // Returns false after the last chunk and its trailers.
+    bool next_chunk(Connection &conn)
+    {
+      std::string &buf = conn.buffer();
+
+      if (inChunk_)
+      {
+        while (buf.size() < 2)
+        {
+          fill_or_throw(conn, "truncated chunk");
+        }
+        if (buf.compare(0, 2, "\r\n") != 0)
+        {
+          throw std::system_error(std::make_error_code(std::errc::protocol_error), "chunk not followed by CRLF");
+        }
+        buf.erase(0, 2);
+      }
+
+      std::size_t line_end = 0;
+      while ((line_end = buf.find("\r\n")) == std::string::npos)
+      {
+        check_size(buf.size(), "chunk size line too long");
+        fill_or_throw(conn, "truncated chunk");
+      }
+
+      // "1a2b" or "1a2b ; ext=value": the size is the hex run before any
+      // extension. Garbage or an overflowing size desynchronises the
+      // stream, so the response (and its connection) is abandoned.
+      std::string_view line = std::string_view(buf).substr(0, std::min(line_end, buf.find(';')));
+      while (!line.empty() && (line.back() == ' ' || line.back() == '\t'))
+      {
+        line.remove_suffix(1);
+      }
+
+      const auto parsed = detail::parse_number<std::uint64_t>(line, 16);
+      if (!parsed)
+      {
+        throw std::system_error(std::make_error_code(std::errc::protocol_error),
+                                "bad chunk size: " + std::string(buf, 0, line_end));
+      }
+
+      const std::uint64_t size = *parsed;
+      buf.erase(0, line_end + 2);
+
+      if (size > 0)
+      {
+        remaining_ = size;
+        inChunk_ = true;
+        return true;
+      }
+
+      // Trailers end with an empty line.
+      std::size_t trailer_bytes = 0;
+      while ((line_end = buf.find("\r\n")) != 0)
+      {
+        if (line_end == std::string::npos)
+        {
+          check_size(trailer_bytes + buf.size(), "trailers too large");
+          fill_or_throw(conn, "truncated trailer");
+          continue;
+        }
+
+        trailer_bytes += line_end + 2;
+        check_size(trailer_bytes, "trailers too large");
+        buf.erase(0, line_end + 2);
+      }
+
+      buf.erase(0, 2);
+      return false;
+    }
+
+    void check_size(std::size_t size, const char *what) const
+    {
+      if (size > maxHeaderBytes_)
+      {
+        throw std::system_error(std::make_error_code(std::errc::message_size), what);
+      }
+    }
+
+    static void fill_or_throw(Connection &conn, const char *what)
+    {
+      if (!conn.fill())
+      {
+        throw std::system_error(std::make_error_code(std::errc::connection_reset), what);
+      }
+    }
+
+    void finish()
+    {
+      if (decoder_ && !decoder_->done())
+      {
+        throw std::system_error(std::make_error_code(std::errc::connection_reset), "truncated encoded body");
+      }
+
+      finished_ = true;
+      (*lease_)->end_request();
+
+      const bool cancelled = cancel_ && cancel_->detach();
+
+      if (!keepAlive_ || framing_ == Framing::until_eof || cancelled)
+      {
+        lease_->discard();
+      }
+
+      lease_.reset();
+    }
+
+    std::optional<ConnectionPool::Lease> lease_;
+    PooledResponse head_;
+    Framing framing_;
+    std::uint64_t remaining_;
+    bool keepAlive_;
+    bool inChunk_{false};
+    bool raw_done_{false};
+    bool finished_{false};
+    std::size_t unconsumed_{0};
+    std::unique_ptr<BodyDecoder> decoder_;
+    StreamProgress progress_;
+    std::function<void(const StreamProgress &)> onProgress_;
+    std::shared_ptr<CancelHandle> cancel_;
+    std::size_t maxHeaderBytes_;
+  };
+
+  struct DownloadResult
+  {
+    int status{0};
+    std::uint64_t bytes_written{0};
+    std::uint64_t wire_bytes{0};
+    bool decoded{false};
+    bool reused_connection{false};
+  };
+
+  class PooledClient
+  {
+  public:
+    explicit PooledClient(ConnectionPool &pool, std::string userAgent = "vix-pooled-client/1.0")
+        : pool_(pool),
+          userAgent_(std::move(userAgent))
+    {
+    }
+
+    PooledResponse get(const std::string &url,
+                       const std::vector<std::pair<std::string, std::string>> &headers = {})
+    {
+      return send("GET", url, headers, {});
+    }
+
+    PooledResponse post(const std::string &url, std::string body, const std::string &contentType,
+                        std::vector<std::pair<std::string, std::string>> headers = {})
+    {
+      headers.emplace_back("Content-Type", contentType);
+      return send("POST", url, headers, std::move(body));
+    }
+
+    // Buffers the whole body; use open(), stream() or download_to() for
+    // large payloads.
+    PooledResponse send(const std::string &method, const std::string &url,
+                        const std::vector<std::pair<std::string, std::string>> &headers,
+                        const std::string &body, std::shared_ptr<CancelHandle> cancel = {})
+    {
+      StreamOptions options;
+      options.accept_compressed = false;
+      options.cancel = std::move(cancel);
+
+      auto response = open(method, url, headers, body, options);
+      PooledResponse out = response.head();
+
+      for (std::string_view piece = response.next(); !piece.empty(); piece = response.next())
+      {
+        out.body.append(piece);
+      }
+
+      return out;
+    }
+
+    // Sends the request and reads the head; the body is left on the wire.
+    StreamingResponse open(const std::string &method, const std::string &url,
+                           std::vector<std::pair<std::string, std::string>> headers = {},
+                           const std::string &body = {}, const StreamOptions &options = {})
+    {
+      const Url parsed = parse_url(url);
+
+      if (options.accept_compressed && !has_header(headers, "Accept-Encoding"))
+      {
+        if (std::string codecs = BodyDecoder::accepted_encodings(); !codecs.empty())
+        {
+          headers.emplace_back("Accept-Encoding", std::move(codecs));
+        }
+      }
+
+      const std::string request = serialize(method, parsed, headers, body);
+      const bool idempotent = method == "GET" || method == "HEAD" || method == "PUT" ||
+                              method == "DELETE" || method == "OPTIONS";
+
+      auto lease = pool_.acquire(parsed.origin);
+
+      try
+      {
+        return exchange(std::move(lease), method, request, options);
+      }
+      catch (const RetryableError &)
+      {
+        if (!idempotent)
+        {
+          throw std::system_error(std::make_error_code(std::errc::connection_reset),
+                                  "connection closed before response");
+        }
+      }
+
+      auto fresh = pool_.acquire(parsed.origin, true);
+      return exchange(std::move(fresh), method, request, options);
+    }
+
+    // Calls `onChunk` for every body piece; memory stays bounded by the
+    // socket and decoder buffers.
+    PooledResponse stream(const std::string &url,
+                          const std::function<void(std::string_view)> &onChunk,
+                          const StreamOptions &options = {},
+                          const std::vector<std::pair<std::string, std::string>> &headers = {})
+    {
+      auto response = open("GET", url, headers, {}, options);
+
+      for (std::string_view piece = response.next(); !piece.empty(); piece = response.next())
+      {
+        onChunk(piece);
+      }
+
+      return response.head();
+    }
+
+    // Streams a GET to `path` through `path + ".part"`, renamed on success.
+    // Non-2xx responses leave the file untouched.
+    DownloadResult download_to(const std::string &url, const std::string &path,
+                               const StreamOptions &options = {},
+                               const std::vector<std::pair<std::string, std::string>> &headers = {})
+    {
+      auto response = open("GET", url, headers, {}, options);
+
+      DownloadResult result;
+      result.status = response.status();
+      result.decoded = response.decoded();
+      result.reused_connection = response.head().reused_connection;
+
+      if (result.status < 200 || result.status >= 300)
+      {
+        return result;
+      }
+
+      const std::string partial = path + ".part";
+      std::FILE *file = std::fopen(partial.c_str(), "wb");
+      if (file == nullptr)
+      {
+        detail::throw_errno("fopen");
+      }
+
+      try
+      {
+        for (std::string_view piece = response.next(); !piece.empty(); piece = response.next())
+        {
+          if (std::fwrite(piece.data(), 1, piece.size(), file) != piece.size())
+          {
+            detail::throw_errno("fwrite");
+          }
+          result.bytes_written += piece.size();
+        }
+
+        if (std::fclose(std::exchange(file, nullptr)) != 0)
+        {
+          detail::throw_errno("fclose");
+        }
+
+        if (std::rename(partial.c_str(), path.c_str()) != 0)
+        {
+          detail::throw_errno("rename");
+        }
+      }
+      catch (...)
+      {
+        if (file != nullptr)
+        {
+          std::fclose(file);
+        }
+        std::remove(partial.c_str());
+        throw;
+      }
+
+      result.wire_bytes = response.progress().wire_bytes;
+      return result;
+    }
+
+  private:
+    // A reused connection failed before any response byte arrived.
+    struct RetryableError
+    {
+    };
+
+    static bool has_header(const std::vector<std::pair<std::string, std::string>> &headers,
+                           std::string_view name)
+    {
+      return std::any_of(headers.begin(), headers.end(), [&](const auto &header)
+                         { return detail::iequals(header.first, name); });
+    }
+
+    std::string serialize(const std::string &method, const Url &url,
+                          const std::vector<std::pair<std::string, std::string>> &headers,
+                          const std::string &body) const
+    {
+      std::string out;
+      out.reserve(256 + body.size());
+      out += method + " " + url.target + " HTTP/1.1\r\n";
+      out += "Host: " + url.origin.authority() + "\r\n";
+      out += "User-Agent: " + userAgent_ + "\r\n";
+
+      for (const auto &[key, value] : headers)
+      {
+        out += key + ": " + value + "\r\n";
+      }
+
+      if (!body.empty() || method == "POST" || method == "PUT")
+      {
+        out += "Content-Length: " + std::to_string(body.size()) + "\r\n";
+      }
+
+      out += "\r\n";
+      out += body;
+      return out;
+    }
+
+    // Writes the request and parses the response head. Errors on a reused
+    // connection before any byte came back become RetryableError.
+    static StreamingResponse exchange(ConnectionPool::Lease lease, const std::string &method,
+                                      const std::string &request, const StreamOptions &options)
+    {
+      try
+      {
+        if (options.cancel)
+        {
+          options.cancel->attach(lease->native_handle());
+        }
+
+        return read_head(std::move(lease), method, request, options);
+      }
+      catch (const std::system_error &error)
+      {
+        if (options.cancel && options.cancel->detach())
+        {
+          lease.discard();
+          throw std::system_error(std::make_error_code(std::errc::operation_canceled), "request cancelled");
+        }
+
+        const bool stale = lease->reused() && lease->bytes_received() == 0 &&
+                           error.code() != std::errc::timed_out;
+        lease.discard();
+
+        if (stale)
+        {
+          throw RetryableError{};
+        }
+        throw;
+      }
+      catch (...)
+      {
+        if (options.cancel)
+        {
+          options.cancel->detach();
+        }
+        lease.discard();
+        throw;
+      }
+    }
+
+    static StreamingResponse read_head(ConnectionPool::Lease &&lease, const std::string &method,
+                                       const std::string &request, const StreamOptions &options)
+    {
+      Connection &conn = *lease;
+      conn.begin_request();
+
+      PooledResponse head;
+      head.reused_connection = conn.reused();
+
+      conn.write_all(request);
+
+      std::string &buf = conn.buffer();
+      std::size_t header_end = 0;
+      bool http_1_0 = false;
+
+      // Skip interim 1xx responses.
+      for (;;)
+      {
+        while ((header_end = buf.find("\r\n\r\n")) == std::string::npos)
+        {
+          if (buf.size() > options.max_header_bytes)
+          {
+            throw std::system_error(std::make_error_code(std::errc::message_size), "response head too large");
+          }
+          if (!conn.fill())
+          {
+            throw std::system_error(std::make_error_code(std::errc::connection_reset),
+                                    "connection closed before response");
+          }
+        }
+
+        head.status = parse_head(std::string_view(buf).substr(0, header_end), head);
+        http_1_0 = buf.compare(0, 9, "HTTP/1.0 ") == 0;
+
+        if (head.status >= 200 || head.status == 101)
+        {
+          break;
+        }
+
+        buf.erase(0, header_end + 4);
+        head.headers.clear();
+      }
+
+      buf.erase(0, header_end + 4);
+
+      const std::string te = head.header("Transfer-Encoding");
+      const std::string cl = head.header("Content-Length");
+      // HTTP/1.1 connections persist unless the server says close; HTTP/1.0
+      // ones only when it says keep-alive.
+      const std::string connection = head.header("Connection");
+      const bool keep_alive = http_1_0 ? detail::has_token(connection, "keep-alive")
+                                       : !detail::has_token(connection, "close");
+      const bool no_body = method == "HEAD" || head.status == 204 || head.status == 304;
+
+      using Framing = StreamingResponse::Framing;
+      Framing framing = Framing::until_eof;
+      std::uint64_t length = 0;
+
+      if (no_body)
+      {
+        framing = Framing::none;
+      }
+      else if (te.find("chunked") != std::string::npos)
+      {
+        framing = Framing::chunked;
+      }
+      else if (!cl.empty())
+      {
+        // A length we cannot trust leaves the connection's framing unknown;
+        // exchange() discards the lease on the throw.
+        const auto first = cl.find_first_not_of(" \t");
+        const auto last = cl.find_last_not_of(" \t");
+        const auto value = first == std::string::npos
+                               ? std::nullopt
+                               : detail::parse_number<std::uint64_t>(std::string_view(cl).substr(first, last - first + 1));
+        if (!value)
+        {
+          throw std::system_error(std::make_error_code(std::errc::protocol_error), "bad Content-Length: " + cl);
+        }
+
+        framing = Framing::length;
+        length = *value;
+      }
+
+      // Built before the lease moves, so a failure here still discards it.
+      std::unique_ptr<BodyDecoder> decoder;
+      const std::string encoding = head.header("Content-Encoding");
+      if (options.decode && framing != Framing::none && !encoding.empty() &&
+          BodyDecoder::supports(encoding))
+      {
+        decoder = std::make_unique<BodyDecoder>(encoding);
+      }
+
+      return StreamingResponse(std::move(lease), std::move(head), framing, length, keep_alive,
+                               std::move(decoder), options.on_progress, options.cancel, options.max_header_bytes);
+    }
+
+    static int parse_head(std::string_view head, PooledResponse &response)
+    {
+      const auto line_end = head.find("\r\n");
+      const std::string_view status_line = head.substr(0, line_end);
+
+      // "HTTP/1.1 200 OK"
+      const auto status = status_line.size() >= 12 && status_line.substr(0, 5) == "HTTP/" && status_line[8] == ' ' &&
+                                  (status_line.size() == 12 || status_line[12] == ' ')
+                              ? detail::parse_number<int>(status_line.substr(9, 3))
+                              : std::nullopt;
+      if (!status || *status < 100)
+      {
+        throw std::system_error(std::make_error_code(std::errc::protocol_error), "bad status line");
+      }
+
+      std::size_t pos = line_end == std::string_view::npos ? head.size() : line_end + 2;
+
+      while (pos < head.size())
+      {
+        auto end = head.find("\r\n", pos);
+        if (end == std::string_view::npos)
+        {
+          end = head.size();
+        }
+
+        const std::string_view line = head.substr(pos, end - pos);
+        if (const auto colon = line.find(':'); colon != std::string_view::npos)
+        {
+          std::string_view value = line.substr(colon + 1);
+          while (!value.empty() && (value.front() == ' ' || value.front() == '\t'))
+          {
+            value.remove_prefix(1);
+          }
+
+          response.headers.emplace_back(std::string(line.substr(0, colon)), std::string(value));
+        }
+
+        pos = end + 2;
+      }
+
+      return *status;
+    }
+
+    ConnectionPool &pool_;
+    std::string userAgent_;
+  };
+} // namespace vix_examples::requests
+
+#endif // VIX_EXAMPLES_REQUESTS_CONNECTION_POOL_HPP
@@ -0,0 +1,957 @@
+#ifndef VIX_EXAMPLES_REQUESTS_H2_CLIENT_HPP
+#define VIX_EXAMPLES_REQUESTS_H2_CLIENT_HPP
+
+// HTTP/2 multiplexing for the pooled client.
+//
+// MultiplexClient offers "h2" and "http/1.1" through ALPN on the first
+// https request to an origin:
+//
+//  - h2: one connection per origin carries every request as a stream.
+//    A session thread owns the socket and the nghttp2 state (HPACK, flow
+//    control, SETTINGS); callers hand it requests through a queue.
+//    At most max_concurrent_streams streams are open at once (lowered by
+//    the server's SETTINGS_MAX_CONCURRENT_STREAMS); the rest wait in order.
+//  - anything else (http://, a server without h2, a build without
+//    nghttp2): the connection goes to the ConnectionPool and requests use
+//    the HTTP/1.1 PooledClient.
+//
+// async_send() does not hold a thread per request on the h2 path: the
+// coroutine is resumed on the io_context when its stream completes.
+// Requests refused by the server (REFUSED_STREAM, GOAWAY) or cut off
+// before any response frame are retried once on a new session when the
+// method is idempotent.
+//
+// Needs nghttp2 and OpenSSL; define VIX_EXAMPLE_WITH_NGHTTP2 and
+// VIX_EXAMPLE_WITH_OPENSSL to enable h2.
+
+#include <vix/async/core/io_context.hpp>
+#include <vix/async/core/task.hpp>
+#include "connection_pool.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <charconv>
+#include <coroutine>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <future>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#if defined(VIX_EXAMPLE_WITH_NGHTTP2) && defined(VIX_EXAMPLE_WITH_OPENSSL)
+#define VIX_EXAMPLE_HAS_H2 1
+#include <nghttp2/nghttp2.h>
+#include <sys/eventfd.h>
+#endif
+
+namespace vix_examples::requests
+{
+  using Headers = std::vector<std::pair<std::string, std::string>>;
+
+  struct H2Options
+  {
+    // Streams in flight per origin; the server's SETTINGS can lower it.
+    std::uint32_t max_concurrent_streams{100};
+    // Receive windows advertised to the server.
+    std::uint32_t stream_window{1U << 20};
+    std::uint32_t connection_window{16U << 20};
+  };
+
+  struct H2Metrics
+  {
+    std::uint64_t sessions{0};
+    std::uint64_t http1_fallbacks{0}; // origins that did not negotiate h2
+    std::uint64_t streams{0};
+    std::uint64_t queued{0}; // requests that waited for a stream slot
+    std::uint64_t retries{0};
+    std::uint64_t peak_streams{0};
+  };
+
+  struct H2Result
+  {
+    PooledResponse response;
+    std::exception_ptr error;
+    // Failed before the server saw the request; safe to retry if idempotent.
+    bool retryable{false};
+  };
+
+  namespace detail
+  {
+    struct H2Stats
+    {
+      std::atomic<std::uint64_t> sessions{0};
+      std::atomic<std::uint64_t> http1_fallbacks{0};
+      std::atomic<std::uint64_t> streams{0};
+      std::atomic<std::uint64_t> queued{0};
+      std::atomic<std::uint64_t> retries{0};
+      std::atomic<std::uint64_t> peak_streams{0};
+    };
+
+    inline bool idempotent(std::string_view method)
+    {
+      return method == "GET" || method == "HEAD" || method == "PUT" ||
+             method == "DELETE" || method == "OPTIONS";
+    }
+  } // namespace detail
+
+#if defined(VIX_EXAMPLE_HAS_H2)
+  class H2Session
+  {
+  public:
+    struct Request
+    {
+      std::string method;
+      Url url;
+      Headers headers;
+      std::string body;
+      std::function<void(H2Result)> done;
+    };
+
+    H2Session(std::unique_ptr<Connection> conn, H2Options options, std::string userAgent,
+              std::chrono::milliseconds ioTimeout, detail::H2Stats &stats)
+        : conn_(std::move(conn)),
+          options_(options),
+          userAgent_(std::move(userAgent)),
+          ioTimeout_(ioTimeout),
+          stats_(stats)
+    {
+      nghttp2_session_callbacks *callbacks = nullptr;
+      nghttp2_session_callbacks_new(&callbacks);
+      nghttp2_session_callbacks_set_on_begin_headers_callback(callbacks, &H2Session::on_begin_headers);
+      nghttp2_session_callbacks_set_on_header_callback(callbacks, &H2Session::on_header);
+      nghttp2_session_callbacks_set_on_data_chunk_recv_callback(callbacks, &H2Session::on_data_chunk);
+      nghttp2_session_callbacks_set_on_frame_recv_callback(callbacks, &H2Session::on_frame_recv);
+      nghttp2_session_callbacks_set_on_stream_close_callback(callbacks, &H2Session::on_stream_close);
+
+      const int rc = nghttp2_session_client_new(&session_, callbacks, this);
+      nghttp2_session_callbacks_del(callbacks);
+
+      if (rc != 0)
+      {
+        throw std::system_error(std::make_error_code(std::errc::not_enough_memory), nghttp2_strerror(rc));
+      }
+
+      const nghttp2_settings_entry settings[] = {
+          {NGHTTP2_SETTINGS_ENABLE_PUSH, 0},
+          {NGHTTP2_SETTINGS_INITIAL_WINDOW_SIZE, options_.stream_window},
+      };
+      nghttp2_submit_settings(session_, NGHTTP2_FLAG_NONE, settings, std::size(settings));
+      nghttp2_session_set_local_window_size(session_, NGHTTP2_FLAG_NONE, 0,
+                                            static_cast<std::int32_t>(options_.connection_window));
+
+      wake_ = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+      if (wake_ < 0)
+      {
+        nghttp2_session_del(session_);
+        detail::throw_errno("eventfd");
+      }
+
+      thread_ = std::thread([this]()
+                            { run(); });
+    }
+
+    H2Session(const H2Session &) = delete;
+    H2Session &operator=(const H2Session &) = delete;
+
+    ~H2Session()
+    {
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+      }
+
+      wake();
+      thread_.join();
+      nghttp2_session_del(session_);
+      ::close(wake_);
+    }
+
+    // False once the connection failed or the server sent GOAWAY.
+    [[nodiscard]] bool alive() const noexcept { return alive_.load(std::memory_order_acquire); }
+
+    // Queues a request; `done` runs on the session thread.
+    void submit(Request request)
+    {
+      bool queued = false;
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+
+        if (alive() && !stopping_)
+        {
+          incoming_.push_back(std::move(request));
+          queued = true;
+        }
+      }
+
+      if (!queued)
+      {
+        fail(request.done, std::make_error_code(std::errc::connection_aborted), "h2 session closed", true);
+        return;
+      }
+
+      wake();
+    }
+
+  private:
+    struct Stream
+    {
+      Request request;
+      PooledResponse response;
+      std::size_t sent{0};
+      bool answered{false};
+      bool bad_status{false};
+    };
+
+    static void fail(const std::function<void(H2Result)> &done, std::error_code ec, const char *what,
+                     bool retryable)
+    {
+      H2Result result;
+      result.error = std::make_exception_ptr(std::system_error(ec, what));
+      result.retryable = retryable;
+      done(std::move(result));
+    }
+
+    void wake() const noexcept
+    {
+      const std::uint64_t one = 1;
+      [[maybe_unused]] const auto n = ::write(wake_, &one, sizeof(one));
+    }
+
+    std::size_t stream_limit() const
+    {
+      const std::uint32_t remote =
+          nghttp2_session_get_remote_settings(session_, NGHTTP2_SETTINGS_MAX_CONCURRENT_STREAMS);
+      return std::max<std::uint32_t>(1, std::min(options_.max_concurrent_streams, remote));
+    }
+
+    // Session thread: submits waiting requests, flushes frames and feeds
+    // received bytes to nghttp2 until the connection ends or is stopped.
+    void run()
+    {
+      try
+      {
+        for (;;)
+        {
+          bool stopping = false;
+          {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stopping = stopping_;
+
+            for (auto &request : incoming_)
+            {
+              if (streams_.size() + waiting_.size() >= stream_limit())
+              {
+                ++stats_.queued;
+              }
+              waiting_.push_back(std::move(request));
+            }
+            incoming_.clear();
+          }
+
+          if (stopping)
+          {
+            alive_.store(false, std::memory_order_release);
+            nghttp2_session_terminate_session(session_, NGHTTP2_NO_ERROR);
+            flush();
+            fail_all(std::make_error_code(std::errc::operation_canceled), "h2 session stopped");
+            return;
+          }
+
+          start_streams();
+
+          if (!flush())
+          {
+            continue;
+          }
+
+          if (!nghttp2_session_want_read(session_) && !nghttp2_session_want_write(session_))
+          {
+            break;
+          }
+
+          wait_and_read();
+        }
+      }
+      catch (const std::system_error &error)
+      {
+        alive_.store(false, std::memory_order_release);
+        fail_all(error.code(), error.what());
+        return;
+      }
+
+      alive_.store(false, std::memory_order_release);
+      fail_all(std::make_error_code(std::errc::connection_aborted), "h2 session closed");
+    }
+
+    void start_streams()
+    {
+      if (!alive())
+      {
+        return;
+      }
+
+      while (!waiting_.empty() && streams_.size() < stream_limit())
+      {
+        auto stream = std::make_unique<Stream>();
+        stream->request = std::move(waiting_.front());
+        waiting_.pop_front();
+
+        const Request &request = stream->request;
+        Headers fields;
+        fields.reserve(request.headers.size() + 6);
+        fields.emplace_back(":method", request.method);
+        fields.emplace_back(":scheme", request.url.origin.scheme);
+        fields.emplace_back(":authority", request.url.origin.authority());
+        fields.emplace_back(":path", request.url.target);
+        fields.emplace_back("user-agent", userAgent_);
+
+        for (const auto &[key, value] : request.headers)
+        {
+          std::string name = key;
+          for (char &c : name)
+          {
+            c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+          }
+
+          // Connection-specific fields are not allowed in HTTP/2.
+          if (name == "host" || name == "connection" || name == "keep-alive" ||
+              name == "transfer-encoding" || name == "upgrade" || name == "proxy-connection")
+          {
+            continue;
+          }
+
+          fields.emplace_back(std::move(name), value);
+        }
+
+        const bool has_body = !request.body.empty() || request.method == "POST" || request.method == "PUT";
+        if (has_body)
+        {
+          fields.emplace_back("content-length", std::to_string(request.body.size()));
+        }
+
+        std::vector<nghttp2_nv> nva;
+        nva.reserve(fields.size());
+        for (auto &[name, value] : fields)
+        {
+          nva.push_back({reinterpret_cast<std::uint8_t *>(name.data()),
+                         reinterpret_cast<std::uint8_t *>(value.data()),
+                         name.size(), value.size(), NGHTTP2_NV_FLAG_NONE});
+        }
+
+        nghttp2_data_provider provider{};
+        provider.source.ptr = stream.get();
+        provider.read_callback = &H2Session::read_body;
+
+        const std::int32_t id = nghttp2_submit_request(session_, nullptr, nva.data(), nva.size(),
+                                                       has_body ? &provider : nullptr, nullptr);
+        if (id < 0)
+        {
+          fail(stream->request.done, std::make_error_code(std::errc::protocol_error), nghttp2_strerror(id), true);
+          continue;
+        }
+
+        streams_.emplace(id, std::move(stream));
+        ++stats_.streams;
+
+        const std::uint64_t active = streams_.size();
+        std::uint64_t peak = stats_.peak_streams.load();
+        while (active > peak && !stats_.peak_streams.compare_exchange_weak(peak, active))
+        {
+        }
+      }
+    }
+
+    // Writes what nghttp2 has queued. Returns false if the socket would
+    // block before everything went out.
+    bool flush()
+    {
+      for (;;)
+      {
+        if (outOffset_ == out_.size())
+        {
+          out_.clear();
+          outOffset_ = 0;
+
+          const std::uint8_t *data = nullptr;
+          const ssize_t n = nghttp2_session_mem_send(session_, &data);
+
+          if (n < 0)
+          {
+            throw std::system_error(std::make_error_code(std::errc::protocol_error), nghttp2_strerror(static_cast<int>(n)));
+          }
+
+          if (n == 0)
+          {
+            return true;
+          }
+
+          out_.assign(reinterpret_cast<const char *>(data), static_cast<std::size_t>(n));
+        }
+
+        const long n = conn_->write_some(std::string_view(out_).substr(outOffset_));
+
+        if (n > 0)
+        {
+          outOffset_ += static_cast<std::size_t>(n);
+        }
+        else if (n == 0)
+        {
+          throw std::system_error(std::make_error_code(std::errc::connection_reset), "h2 write");
+        }
+        else
+        {
+          wait_and_read();
+          return false;
+        }
+      }
+    }
+
+    void wait_and_read()
+    {
+      const bool pending_write = outOffset_ < out_.size() || conn_->want() == POLLOUT;
+
+      pollfd fds[2] = {
+          {conn_->native_handle(), static_cast<short>(POLLIN | (pending_write ? POLLOUT : 0)), 0},
+          {wake_, POLLIN, 0},
+      };
+
+      const bool busy = !streams_.empty() || pending_write;
+      const int rc = ::poll(fds, 2, busy ? static_cast<int>(ioTimeout_.count()) : -1);
+
+      if (rc < 0)
+      {
+        if (errno == EINTR)
+        {
+          return;
+        }
+        detail::throw_errno("poll");
+      }
+
+      if (rc == 0)
+      {
+        throw std::system_error(std::make_error_code(std::errc::timed_out), "h2 read");
+      }
+
+      if (fds[1].revents != 0)
+      {
+        std::uint64_t count = 0;
+        [[maybe_unused]] const auto n = ::read(wake_, &count, sizeof(count));
+      }
+
+      if (fds[0].revents == 0)
+      {
+        return;
+      }
+
+      char buffer[16 * 1024];
+
+      for (;;)
+      {
+        const long n = conn_->read_some(buffer, sizeof(buffer));
+
+        if (n < 0)
+        {
+          return;
+        }
+
+        if (n == 0)
+        {
+          throw std::system_error(std::make_error_code(std::errc::connection_reset), "h2 connection closed");
+        }
+
+        const ssize_t used = nghttp2_session_mem_recv(session_, reinterpret_cast<const std::uint8_t *>(buffer),
+                                                      static_cast<std::size_t>(n));
+        if (used < 0)
+        {
+          throw std::system_error(std::make_error_code(std::errc::protocol_error), nghttp2_strerror(static_cast<int>(used)));
+        }
+      }
+    }
+
+    void fail_all(std::error_code ec, const char *what)
+    {
+      std::deque<Request> pending;
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        pending.swap(incoming_);
+      }
+
+      for (auto &[id, stream] : streams_)
+      {
+        fail(stream->request.done, ec, what, !stream->answered);
+      }
+      streams_.clear();
+
+      for (auto &request : waiting_)
+      {
+        fail(request.done, ec, what, true);
+      }
+      waiting_.clear();
+
+      for (auto &request : pending)
+      {
+        fail(request.done, ec, what, true);
+      }
+    }
+
+    Stream *find(std::int32_t id)
+    {
+      const auto it = streams_.find(id);
+      return it == streams_.end() ? nullptr : it->second.get();
+    }
+
+    static ssize_t read_body(nghttp2_session *, std::int32_t, std::uint8_t *buf, std::size_t length,
+                             std::uint32_t *flags, nghttp2_data_source *source, void *)
+    {
+      auto *stream = static_cast<Stream *>(source->ptr);
+      const std::string &body = stream->request.body;
+      const std::size_t n = std::min(length, body.size() - stream->sent);
+
+      std::memcpy(buf, body.data() + stream->sent, n);
+      stream->sent += n;
+
+      if (stream->sent == body.size())
+      {
+        *flags |= NGHTTP2_DATA_FLAG_EOF;
+      }
+
+      return static_cast<ssize_t>(n);
+    }
+
+    static int on_begin_headers(nghttp2_session *, const nghttp2_frame *frame, void *user)
+    {
+      if (Stream *stream = static_cast<H2Session *>(user)->find(frame->hd.stream_id))
+      {
+        stream->answered = true;
+      }
+      return 0;
+    }
+
+    static int on_header(nghttp2_session *, const nghttp2_frame *frame, const std::uint8_t *name,
+                         std::size_t namelen, const std::uint8_t *value, std::size_t valuelen,
+                         std::uint8_t, void *user)
+    {
+      Stream *stream = static_cast<H2Session *>(user)->find(frame->hd.stream_id);
+      if (stream == nullptr || frame->hd.type != NGHTTP2_HEADERS)
+      {
+        return 0;
+      }
+
+      const std::string_view key(reinterpret_cast<const char *>(name), namelen);
+      const std::string_view val(reinterpret_cast<const char *>(value), valuelen);
+
+      if (key == ":status")
+      {
+        // A final response replaces any interim 1xx block.
+        stream->response.headers.clear();
+
+        int status = 0;
+        const auto [ptr, ec] = std::from_chars(val.data(), val.data() + val.size(), status);
+        if (val.size() != 3 || ec != std::errc{} || ptr != val.data() + val.size() || status < 100)
+        {
+          // Resets the stream; on_stream_close reports it as a protocol error.
+          stream->bad_status = true;
+          return NGHTTP2_ERR_TEMPORAL_CALLBACK_FAILURE;
+        }
+
+        stream->response.status = status;
+        return 0;
+      }
+
+      stream->response.headers.emplace_back(std::string(key), std::string(val));
+      return 0;
+    }
+
+    static int on_data_chunk(nghttp2_session *, std::uint8_t, std::int32_t id, const std::uint8_t *data,
+                             std::size_t len, void *user)
+    {
+      if (Stream *stream = static_cast<H2Session *>(user)->find(id))
+      {
+        stream->response.body.append(reinterpret_cast<const char *>(data), len);
+      }
+      return 0;
+    }
+
+    static int on_frame_recv(nghttp2_session *, const nghttp2_frame *frame, void *user)
+    {
+      if (frame->hd.type == NGHTTP2_GOAWAY)
+      {
+        // Streams above last_stream_id come back as REFUSED_STREAM.
+        static_cast<H2Session *>(user)->alive_.store(false, std::memory_order_release);
+      }
+      return 0;
+    }
+
+    static int on_stream_close(nghttp2_session *, std::int32_t id, std::uint32_t error, void *user)
+    {
+      auto *self = static_cast<H2Session *>(user);
+      const auto it = self->streams_.find(id);
+      if (it == self->streams_.end())
+      {
+        return 0;
+      }
+
+      std::unique_ptr<Stream> stream = std::move(it->second);
+      self->streams_.erase(it);
+
+      if (stream->bad_status)
+      {
+        fail(stream->request.done, std::make_error_code(std::errc::protocol_error), "bad :status", false);
+      }
+      else if (error == NGHTTP2_NO_ERROR)
+      {
+        H2Result result;
+        result.response = std::move(stream->response);
+        stream->request.done(std::move(result));
+      }
+      else
+      {
+        fail(stream->request.done, std::make_error_code(std::errc::connection_reset),
+             nghttp2_http2_strerror(error), error == NGHTTP2_REFUSED_STREAM);
+      }
+
+      return 0;
+    }
+
+    std::unique_ptr<Connection> conn_;
+    H2Options options_;
+    std::string userAgent_;
+    std::chrono::milliseconds ioTimeout_;
+    detail::H2Stats &stats_;
+    nghttp2_session *session_{nullptr};
+    int wake_{-1};
+
+    std::mutex mutex_;
+    std::deque<Request> incoming_;
+    bool stopping_{false};
+    std::atomic<bool> alive_{true};
+
+    // Session thread only.
+    std::deque<Request> waiting_;
+    std::map<std::int32_t, std::unique_ptr<Stream>> streams_;
+    std::string out_;
+    std::size_t outOffset_{0};
+
+    std::thread thread_;
+  };
+#endif
+
+  class MultiplexClient
+  {
+  public:
+    explicit MultiplexClient(ConnectionPool &pool, H2Options options = {},
+                             std::string userAgent = "vix-pooled-client/1.0")
+        : pool_(pool),
+          http1_(pool, userAgent),
+          options_(options),
+          userAgent_(std::move(userAgent))
+    {
+    }
+
+    PooledResponse get(const std::string &url, const Headers &headers = {})
+    {
+      return send("GET", url, headers, {});
+    }
+
+    PooledResponse post(const std::string &url, std::string body, const std::string &contentType,
+                        Headers headers = {})
+    {
+      headers.emplace_back("Content-Type", contentType);
+      return send("POST", url, headers, std::move(body));
+    }
+
+    // Blocks the calling thread until the response is complete.
+    PooledResponse send(const std::string &method, const std::string &url,
+                        const Headers &headers, const std::string &body)
+    {
+#if defined(VIX_EXAMPLE_HAS_H2)
+      const Url parsed = parse_url(url);
+
+      for (int attempt = 0;; ++attempt)
+      {
+        const std::shared_ptr<H2Session> session = session_for(parsed.origin);
+        if (!session)
+        {
+          break;
+        }
+
+        std::promise<H2Result> promise;
+        auto future = promise.get_future();
+        session->submit({method, parsed, headers, body, [&promise](H2Result result)
+                         { promise.set_value(std::move(result)); }});
+
+        H2Result result = future.get();
+        if (!result.error)
+        {
+          return std::move(result.response);
+        }
+
+        if (!result.retryable || attempt > 0 || !detail::idempotent(method))
+        {
+          std::rethrow_exception(result.error);
+        }
+
+        ++stats_.retries;
+      }
+#endif
+      return http1_.send(method, url, headers, body);
+    }
+
+    vix::async::core::task<PooledResponse> async_get(vix::async::core::io_context &ctx,
+                                                     std::string url, Headers headers = {})
+    {
+      auto response = co_await async_send(ctx, "GET", std::move(url), std::move(headers), {});
+      co_return response;
+    }
+
+    vix::async::core::task<PooledResponse> async_post(vix::async::core::io_context &ctx,
+                                                      std::string url, std::string body,
+                                                      std::string contentType, Headers headers = {})
+    {
+      headers.emplace_back("Content-Type", std::move(contentType));
+      auto response = co_await async_send(ctx, "POST", std::move(url), std::move(headers), std::move(body));
+      co_return response;
+    }
+
+    // On h2 the coroutine waits for its stream without holding a thread;
+    // on HTTP/1.1 the blocking exchange runs on the CPU pool.
+    vix::async::core::task<PooledResponse> async_send(vix::async::core::io_context &ctx,
+                                                      std::string method, std::string url,
+                                                      Headers headers, std::string body)
+    {
+#if defined(VIX_EXAMPLE_HAS_H2)
+      const Url parsed = parse_url(url);
+
+      for (int attempt = 0;; ++attempt)
+      {
+        std::shared_ptr<H2Session> session = find_session(parsed.origin);
+
+        if (!session && !known_http1(parsed.origin))
+        {
+          // Connecting blocks (TCP, TLS); keep it off the io_context thread.
+          session = co_await ctx.cpu_pool().submit([this, &parsed]()
+                                                   { return session_for(parsed.origin); });
+        }
+
+        if (!session)
+        {
+          break;
+        }
+
+        StreamAwaiter op{session.get(), &ctx, {method, parsed, headers, body, {}}, {}};
+        H2Result result = co_await op;
+
+        if (!result.error)
+        {
+          co_return std::move(result.response);
+        }
+
+        if (!result.retryable || attempt > 0 || !detail::idempotent(method))
+        {
+          std::rethrow_exception(result.error);
+        }
+
+        ++stats_.retries;
+      }
+#endif
+      auto response = co_await ctx.cpu_pool().submit([this, &method, &url, &headers, &body]()
+                                                     { return http1_.send(method, url, headers, body); });
+      co_return response;
+    }
+
+    [[nodiscard]] H2Metrics metrics() const
+    {
+      H2Metrics out;
+      out.sessions = stats_.sessions.load();
+      out.http1_fallbacks = stats_.http1_fallbacks.load();
+      out.streams = stats_.streams.load();
+      out.queued = stats_.queued.load();
+      out.retries = stats_.retries.load();
+      out.peak_streams = stats_.peak_streams.load();
+      return out;
+    }
+
+  private:
+#if defined(VIX_EXAMPLE_HAS_H2)
+    struct OriginState
+    {
+      bool http1{false};
+      std::shared_ptr<H2Session> session;
+
+      // Set while one caller connects; the others wait on it instead of
+      // opening their own connection. Null session means HTTP/1.1.
+      std::shared_future<std::shared_ptr<H2Session>> connecting;
+    };
+
+    // Kept as a named local in async_send: the request is moved into the
+    // session in await_suspend and the result is written back before the
+    // coroutine is posted to resume.
+    struct StreamAwaiter
+    {
+      H2Session *session;
+      vix::async::core::io_context *ctx;
+      H2Session::Request request;
+      H2Result result;
+
+      bool await_ready() const noexcept { return false; }
+
+      void await_suspend(std::coroutine_handle<> handle)
+      {
+        request.done = [this, handle](H2Result r)
+        {
+          result = std::move(r);
+          ctx->post(handle);
+        };
+        session->submit(std::move(request));
+      }
+
+      H2Result await_resume() { return std::move(result); }
+    };
+
+    // Plain http:// has no ALPN; h2c is not attempted.
+    bool known_http1(const Origin &origin)
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      OriginState &state = origins_[origin.key()];
+
+      if (!origin.tls() && !state.http1)
+      {
+        state.http1 = true;
+        ++stats_.http1_fallbacks;
+      }
+
+      return state.http1;
+    }
+
+    std::shared_ptr<H2Session> find_session(const Origin &origin)
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      const auto it = origins_.find(origin.key());
+
+      if (it != origins_.end() && it->second.session && it->second.session->alive())
+      {
+        return it->second.session;
+      }
+
+      return nullptr;
+    }
+
+    // Live session for the origin, connecting when needed. Returns null for
+    // origins that speak HTTP/1.1 only.
+    std::shared_ptr<H2Session> session_for(const Origin &origin)
+    {
+      if (known_http1(origin))
+      {
+        return nullptr;
+      }
+
+      if (auto session = find_session(origin))
+      {
+        return session;
+      }
+
+      // One connect per origin at a time, so concurrent first requests
+      // share the session (or the HTTP/1.1 verdict) instead of each
+      // opening a connection. Other origins connect in parallel.
+      std::promise<std::shared_ptr<H2Session>> promise;
+      {
+        std::unique_lock<std::mutex> lock(mutex_);
+        OriginState &state = origins_[origin.key()];
+
+        if (state.http1)
+        {
+          return nullptr;
+        }
+
+        if (state.session && state.session->alive())
+        {
+          return state.session;
+        }
+
+        if (state.connecting.valid())
+        {
+          auto pending = state.connecting;
+          lock.unlock();
+          return pending.get();
+        }
+
+        state.connecting = promise.get_future().share();
+      }
+
+      try
+      {
+        std::shared_ptr<H2Session> session = connect_session(origin);
+
+        std::shared_ptr<H2Session> previous;
+        {
+          std::lock_guard<std::mutex> lock(mutex_);
+          OriginState &state = origins_[origin.key()];
+          state.connecting = {};
+          if (session)
+          {
+            previous = std::exchange(state.session, session);
+          }
+        }
+
+        promise.set_value(session);
+        return session;
+      }
+      catch (...)
+      {
+        {
+          std::lock_guard<std::mutex> lock(mutex_);
+          origins_[origin.key()].connecting = {};
+        }
+        promise.set_exception(std::current_exception());
+        throw;
+      }
+    }
+
+    std::shared_ptr<H2Session> connect_session(const Origin &origin)
+    {
+      auto conn = pool_.connect(origin, {"h2", "http/1.1"});
+
+      if (conn->alpn() != "h2")
+      {
+        {
+          std::lock_guard<std::mutex> lock(mutex_);
+          origins_[origin.key()].http1 = true;
+        }
+        ++stats_.http1_fallbacks;
+        pool_.adopt(std::move(conn));
+        return nullptr;
+      }
+
+      auto session = std::make_shared<H2Session>(std::move(conn), options_, userAgent_,
+                                                 pool_.options().io_timeout, stats_);
+      ++stats_.sessions;
+      return session;
+    }
+
+#endif
+
+    ConnectionPool &pool_;
+    PooledClient http1_;
+    H2Options options_;
+    std::string userAgent_;
+    detail::H2Stats stats_;
+
+#if defined(VIX_EXAMPLE_HAS_H2)
+    // Declared last: sessions update stats_ until they are joined.
+    std::mutex mutex_;
+    std::map<std::string, OriginState> origins_;
+#endif
+  };
+} // namespace vix_examples::requests
+
+#endif // VIX_EXAMPLES_REQUESTS_H2_CLIENT_HPP
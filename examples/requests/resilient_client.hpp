@@ -0,0 +1,458 @@
+#ifndef VIX_EXAMPLES_REQUESTS_RESILIENT_CLIENT_HPP
+#define VIX_EXAMPLES_REQUESTS_RESILIENT_CLIENT_HPP
+
+// Retries, retry budgets and hedged requests over PooledClient.
+//
+//  - RetryPolicy: transport errors and retryable statuses (429, 502, 503,
+//    504 by default) are retried with full-jitter exponential backoff;
+//    Retry-After is honoured up to max_delay. Only idempotent methods are
+//    retried.
+//  - RetryBudget: a token bucket per host. Every first attempt deposits
+//    `ratio` tokens, every retry or hedge spends one, and a small
+//    time-based refill keeps retries possible at low traffic. When the
+//    bucket is empty the failure is returned as is, so a struggling
+//    upstream sees at most about (1 + ratio) times its normal load.
+//  - HedgePolicy: once a host has enough latency samples, a request still
+//    running after the chosen percentile gets a second attempt; the first
+//    response wins and the other attempt is cancelled (its socket is shut
+//    down through CancelHandle).
+
+#include "connection_pool.hpp"
+
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <random>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace vix_examples::requests
+{
+  struct RetryPolicy
+  {
+    int max_attempts{3};
+    std::chrono::milliseconds base_delay{100};
+    std::chrono::milliseconds max_delay{std::chrono::seconds(2)};
+    std::vector<int> retry_statuses{429, 502, 503, 504};
+    bool respect_retry_after{true};
+  };
+
+  struct RetryBudgetOptions
+  {
+    // Tokens earned per first attempt; 0.1 allows one retry per ten requests.
+    double ratio{0.1};
+    // Floor so a quiet host can still retry now and then.
+    double refill_per_second{1.0};
+    double max_tokens{10.0};
+  };
+
+  struct HedgePolicy
+  {
+    bool enabled{false};
+    // Hedge after this latency percentile of recent successful requests.
+    double percentile{0.95};
+    std::size_t min_samples{20};
+    std::chrono::milliseconds min_delay{5};
+    std::chrono::milliseconds max_delay{std::chrono::seconds(1)};
+  };
+
+  struct ResilienceMetrics
+  {
+    std::uint64_t requests{0};
+    std::uint64_t attempts{0};
+    std::uint64_t retries{0};
+    std::uint64_t budget_exhausted{0};
+    std::uint64_t hedges{0};
+    std::uint64_t hedge_wins{0};
+  };
+
+  // Per-host token bucket shared by every request to that host.
+  class RetryBudget
+  {
+  public:
+    explicit RetryBudget(RetryBudgetOptions options = {})
+        : options_(options),
+          tokens_(options.max_tokens),
+          refilled_(Clock::now())
+    {
+    }
+
+    void deposit()
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      refill_locked();
+      tokens_ = std::min(options_.max_tokens, tokens_ + options_.ratio);
+    }
+
+    [[nodiscard]] bool withdraw()
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      refill_locked();
+
+      if (tokens_ < 1.0)
+      {
+        return false;
+      }
+
+      tokens_ -= 1.0;
+      return true;
+    }
+
+  private:
+    void refill_locked()
+    {
+      const auto now = Clock::now();
+      const double seconds = std::chrono::duration<double>(now - refilled_).count();
+      tokens_ = std::min(options_.max_tokens, tokens_ + seconds * options_.refill_per_second);
+      refilled_ = now;
+    }
+
+    RetryBudgetOptions options_;
+    std::mutex mutex_;
+    double tokens_;
+    Clock::time_point refilled_;
+  };
+
+  // Last 256 successful latencies of a host.
+  class LatencyWindow
+  {
+  public:
+    void record(std::chrono::microseconds latency)
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      samples_[next_++ % samples_.size()] = latency;
+      count_ = std::min(count_ + 1, samples_.size());
+    }
+
+    [[nodiscard]] std::optional<std::chrono::microseconds> percentile(double p, std::size_t minSamples) const
+    {
+      std::array<std::chrono::microseconds, 256> copy;
+      std::size_t n = 0;
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (count_ < minSamples || count_ == 0)
+        {
+          return std::nullopt;
+        }
+        n = count_;
+        std::copy_n(samples_.begin(), n, copy.begin());
+      }
+
+      const std::size_t k = std::min(n - 1, static_cast<std::size_t>(p * static_cast<double>(n)));
+      std::nth_element(copy.begin(), copy.begin() + static_cast<std::ptrdiff_t>(k), copy.begin() + static_cast<std::ptrdiff_t>(n));
+      return copy[k];
+    }
+
+  private:
+    mutable std::mutex mutex_;
+    std::array<std::chrono::microseconds, 256> samples_{};
+    std::size_t next_{0};
+    std::size_t count_{0};
+  };
+
+  class ResilientClient
+  {
+  public:
+    explicit ResilientClient(PooledClient &client, RetryPolicy retry = {},
+                             RetryBudgetOptions budget = {}, HedgePolicy hedge = {})
+        : client_(client),
+          retry_(std::move(retry)),
+          budget_(budget),
+          hedge_(hedge)
+    {
+    }
+
+    ResilientClient(const ResilientClient &) = delete;
+    ResilientClient &operator=(const ResilientClient &) = delete;
+
+    // Waits for cancelled hedge attempts that are still unwinding.
+    ~ResilientClient()
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      workersDone_.wait(lock, [this]()
+                        { return workers_ == 0; });
+    }
+
+    PooledResponse get(const std::string &url,
+                       const std::vector<std::pair<std::string, std::string>> &headers = {})
+    {
+      return send("GET", url, headers, {});
+    }
+
+    PooledResponse send(const std::string &method, const std::string &url,
+                        const std::vector<std::pair<std::string, std::string>> &headers,
+                        const std::string &body)
+    {
+      const std::string host = parse_url(url).origin.key();
+      HostState &state = host_state(host);
+      const bool idempotent = method == "GET" || method == "HEAD" || method == "PUT" ||
+                              method == "DELETE" || method == "OPTIONS";
+
+      count(&ResilienceMetrics::requests);
+      state.budget.deposit();
+
+      for (int attempt = 1;; ++attempt)
+      {
+        std::optional<PooledResponse> response;
+        std::exception_ptr error;
+
+        try
+        {
+          response = hedge_.enabled && idempotent ? hedged(state, method, url, headers, body)
+                                                  : timed(state, method, url, headers, body, nullptr);
+        }
+        catch (const std::system_error &)
+        {
+          error = std::current_exception();
+        }
+
+        const bool retryable = error != nullptr || retryable_status(response->status);
+
+        if (!retryable || !idempotent || attempt >= retry_.max_attempts)
+        {
+          rethrow_if_failed(response, error);
+          return std::move(*response);
+        }
+
+        if (!state.budget.withdraw())
+        {
+          count(&ResilienceMetrics::budget_exhausted);
+          rethrow_if_failed(response, error);
+          return std::move(*response);
+        }
+
+        count(&ResilienceMetrics::retries);
+        std::this_thread::sleep_for(backoff(attempt, response ? &*response : nullptr));
+      }
+    }
+
+    [[nodiscard]] ResilienceMetrics metrics() const
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      return metrics_;
+    }
+
+  private:
+    struct HostState
+    {
+      explicit HostState(RetryBudgetOptions options)
+          : budget(options)
+      {
+      }
+
+      RetryBudget budget;
+      LatencyWindow latency;
+    };
+
+    // Shared by the two attempts of a hedged request and the caller.
+    struct Race
+    {
+      std::mutex mutex;
+      std::condition_variable cv;
+      std::optional<PooledResponse> winner;
+      std::exception_ptr error;
+      int finished{0};
+      int winnerIndex{-1};
+      std::array<std::shared_ptr<CancelHandle>, 2> cancels{std::make_shared<CancelHandle>(),
+                                                          std::make_shared<CancelHandle>()};
+    };
+
+    static void rethrow_if_failed(std::optional<PooledResponse> &response, const std::exception_ptr &error)
+    {
+      if (!response)
+      {
+        std::rethrow_exception(error);
+      }
+    }
+
+    HostState &host_state(const std::string &host)
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      auto it = hosts_.find(host);
+      if (it == hosts_.end())
+      {
+        it = hosts_.emplace(host, std::make_unique<HostState>(budget_)).first;
+      }
+      return *it->second;
+    }
+
+    void count(std::uint64_t ResilienceMetrics::*field)
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      ++(metrics_.*field);
+    }
+
+    bool retryable_status(int status) const
+    {
+      return std::find(retry_.retry_statuses.begin(), retry_.retry_statuses.end(), status) !=
+             retry_.retry_statuses.end();
+    }
+
+    // Full jitter: uniform in [0, min(max_delay, base * 2^(attempt-1))].
+    std::chrono::milliseconds backoff(int attempt, const PooledResponse *response)
+    {
+      if (retry_.respect_retry_after && response != nullptr)
+      {
+        const std::string after = response->header("Retry-After");
+        long seconds = 0;
+        if (!after.empty() &&
+            std::from_chars(after.data(), after.data() + after.size(), seconds).ec == std::errc())
+        {
+          return std::min<std::chrono::milliseconds>(std::chrono::seconds(seconds), retry_.max_delay);
+        }
+      }
+
+      const auto ceiling = std::min<std::chrono::milliseconds>(
+          retry_.base_delay * (1LL << std::min(attempt - 1, 20)), retry_.max_delay);
+
+      thread_local std::minstd_rand rng{std::random_device{}()};
+      std::uniform_int_distribution<long long> pick(0, ceiling.count());
+      return std::chrono::milliseconds(pick(rng));
+    }
+
+    PooledResponse timed(HostState &state, const std::string &method, const std::string &url,
+                         const std::vector<std::pair<std::string, std::string>> &headers,
+                         const std::string &body, std::shared_ptr<CancelHandle> cancel)
+    {
+      count(&ResilienceMetrics::attempts);
+
+      const auto start = Clock::now();
+      PooledResponse response = client_.send(method, url, headers, body, std::move(cancel));
+
+      if (response.status < 500)
+      {
+        state.latency.record(std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - start));
+      }
+
+      return response;
+    }
+
+    // Runs attempt 0 now and attempt 1 once the hedge delay passes; the
+    // first to finish wins and the other is cancelled. A transport error
+    // is only reported once both attempts failed.
+    PooledResponse hedged(HostState &state, const std::string &method, const std::string &url,
+                          const std::vector<std::pair<std::string, std::string>> &headers,
+                          const std::string &body)
+    {
+      const auto threshold = state.latency.percentile(hedge_.percentile, hedge_.min_samples);
+      if (!threshold)
+      {
+        return timed(state, method, url, headers, body, nullptr);
+      }
+
+      const auto delay = std::clamp<std::chrono::milliseconds>(
+          std::chrono::duration_cast<std::chrono::milliseconds>(*threshold), hedge_.min_delay, hedge_.max_delay);
+
+      auto race = std::make_shared<Race>();
+      int launched = 1;
+      launch(race, 0, state, method, url, headers, body);
+
+      std::unique_lock<std::mutex> lock(race->mutex);
+
+      if (!race->cv.wait_for(lock, delay, [&]()
+                             { return race->finished > 0; }))
+      {
+        lock.unlock();
+        if (state.budget.withdraw())
+        {
+          count(&ResilienceMetrics::hedges);
+          launch(race, 1, state, method, url, headers, body);
+          ++launched;
+        }
+        else
+        {
+          count(&ResilienceMetrics::budget_exhausted);
+        }
+        lock.lock();
+      }
+
+      race->cv.wait(lock, [&]()
+                    { return race->winner.has_value() || race->finished == launched; });
+
+      if (race->winner)
+      {
+        race->cancels[1 - race->winnerIndex]->cancel();
+
+        if (race->winnerIndex == 1)
+        {
+          count(&ResilienceMetrics::hedge_wins);
+        }
+        return std::move(*race->winner);
+      }
+
+      std::rethrow_exception(race->error);
+    }
+
+    // Copies the request so the attempt can outlive the caller when it
+    // loses; the destructor waits for these threads.
+    void launch(const std::shared_ptr<Race> &race, int index, HostState &state, const std::string &method,
+                const std::string &url, const std::vector<std::pair<std::string, std::string>> &headers,
+                const std::string &body)
+    {
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        ++workers_;
+      }
+
+      std::thread([this, race, index, &state, method, url, headers, body]()
+                  {
+                    {
+                      std::optional<PooledResponse> response;
+                      std::exception_ptr error;
+
+                      try
+                      {
+                        response = timed(state, method, url, headers, body, race->cancels[index]);
+                      }
+                      catch (...)
+                      {
+                        error = std::current_exception();
+                      }
+
+                      std::lock_guard<std::mutex> lock(race->mutex);
+                      ++race->finished;
+
+                      if (response && !race->winner)
+                      {
+                        race->winner = std::move(response);
+                        race->winnerIndex = index;
+                      }
+                      else if (error && !race->error)
+                      {
+                        race->error = error;
+                      }
+
+                      race->cv.notify_all();
+                    }
+
+                    std::lock_guard<std::mutex> lock(mutex_);
+                    --workers_;
+                    workersDone_.notify_all(); })
+          .detach();
+    }
+
+    PooledClient &client_;
+    RetryPolicy retry_;
+    RetryBudgetOptions budget_;
+    HedgePolicy hedge_;
+
+    mutable std::mutex mutex_;
+    std::map<std::string, std::unique_ptr<HostState>> hosts_;
+    ResilienceMetrics metrics_;
+    std::condition_variable workersDone_;
+    std::size_t workers_{0};
+  };
+} // namespace vix_examples::requests
+
+#endif // VIX_EXAMPLES_REQUESTS_RESILIENT_CLIENT_HPP
@@ -0,0 +1,441 @@
+/**
+ *
+ * @file latency_histogram.cpp
+ * @author Gaspard Kirira
+ *
+ * Copyright 2025, Gaspard Kirira.
+ * All rights reserved.
+ * https://github.com/vixcpp/vix
+ *
+ * Use of this source code is governed by a MIT license
+ * that can be found in the License file.
+ *
+ * Vix.cpp
+ *
+ */
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <vix/threadpool/all.hpp>
+
+// Queue-wait and execution-time distributions for a ThreadPool.
+//
+// ThreadPoolMetrics and ThreadPoolStats report totals. This example wraps
+// submitted work so every task records how long it waited in the queue
+// and how long it ran, per priority, into lock-free log-linear histograms.
+namespace latency
+{
+  using vix::threadpool::TaskPriority;
+
+  inline constexpr std::array<TaskPriority, 5> priorities{
+      TaskPriority::lowest,
+      TaskPriority::low,
+      TaskPriority::normal,
+      TaskPriority::high,
+      TaskPriority::highest,
+  };
+
+  inline std::size_t priority_index(TaskPriority priority) noexcept
+  {
+    for (std::size_t i = 0; i < priorities.size(); ++i)
+    {
+      if (priorities[i] == priority)
+      {
+        return i;
+      }
+    }
+
+    return 2;
+  }
+
+  /**
+   * @brief HDR-style log-linear bucket layout, in nanoseconds.
+   *
+   * Values below 2^sub_bucket_bits get one bucket each. Above that, every
+   * power of two is split into 2^sub_bucket_bits linear sub-buckets, so
+   * the relative error stays below 1 / 2^sub_bucket_bits (12.5%) across
+   * the whole range. Values above 2^max_exponent ns (~39 hours) are
+   * clamped into the last bucket.
+   */
+  struct BucketLayout
+  {
+    static constexpr unsigned sub_bucket_bits = 3;
+    static constexpr std::uint64_t sub_bucket_count = std::uint64_t{1} << sub_bucket_bits;
+    static constexpr unsigned max_exponent = 47;
+    static constexpr std::size_t bucket_count =
+        static_cast<std::size_t>((max_exponent - sub_bucket_bits + 2) * sub_bucket_count);
+
+    static std::size_t index_of(std::uint64_t value) noexcept
+    {
+      if (value < sub_bucket_count)
+      {
+        return static_cast<std::size_t>(value);
+      }
+
+      unsigned msb = static_cast<unsigned>(std::bit_width(value)) - 1;
+
+      if (msb > max_exponent)
+      {
+        return bucket_count - 1;
+      }
+
+      const unsigned shift = msb - sub_bucket_bits;
+      const std::uint64_t sub = (value >> shift) - sub_bucket_count;
+
+      return static_cast<std::size_t>(((shift + 1) * sub_bucket_count) + sub);
+    }
+
+    // Largest value that maps to bucket @p index.
+    static std::uint64_t upper_bound_of(std::size_t index) noexcept
+    {
+      if (index < sub_bucket_count)
+      {
+        return index;
+      }
+
+      const unsigned shift = static_cast<unsigned>(index / sub_bucket_count) - 1;
+      const std::uint64_t sub = index % sub_bucket_count;
+      const std::uint64_t lower = (sub + sub_bucket_count) << shift;
+
+      return lower + ((std::uint64_t{1} << shift) - 1);
+    }
+  };
+
+  /**
+   * @brief One histogram owned by a single writer.
+   *
+   * Counters are atomics so a snapshot can read them while the owning
+   * worker keeps recording. Writers use relaxed increments; nothing is
+   * ordered against anything else.
+   */
+  struct alignas(64) HistogramShard
+  {
+    std::array<std::atomic<std::uint64_t>, BucketLayout::bucket_count> buckets{};
+    std::atomic<std::uint64_t> count{0};
+    std::atomic<std::uint64_t> sum_ns{0};
+    std::atomic<std::uint64_t> max_ns{0};
+
+    void record(std::uint64_t value_ns) noexcept
+    {
+      buckets[BucketLayout::index_of(value_ns)].fetch_add(1, std::memory_order_relaxed);
+      count.fetch_add(1, std::memory_order_relaxed);
+      sum_ns.fetch_add(value_ns, std::memory_order_relaxed);
+
+      std::uint64_t current = max_ns.load(std::memory_order_relaxed);
+      while (value_ns > current &&
+             !max_ns.compare_exchange_weak(current, value_ns, std::memory_order_relaxed))
+      {
+      }
+    }
+  };
+
+  /**
+   * @brief Merged, immutable view of one distribution.
+   */
+  struct HistogramSnapshot
+  {
+    std::vector<std::uint64_t> buckets = std::vector<std::uint64_t>(BucketLayout::bucket_count, 0);
+    std::uint64_t count{0};
+    std::uint64_t sum_ns{0};
+    std::uint64_t max_ns{0};
+
+    void merge(const HistogramShard &shard) noexcept
+    {
+      for (std::size_t i = 0; i < buckets.size(); ++i)
+      {
+        buckets[i] += shard.buckets[i].load(std::memory_order_relaxed);
+      }
+
+      count += shard.count.load(std::memory_order_relaxed);
+      sum_ns += shard.sum_ns.load(std::memory_order_relaxed);
+      max_ns = std::max(max_ns, shard.max_ns.load(std::memory_order_relaxed));
+    }
+
+    // Upper bound of the bucket holding quantile @p q, in nanoseconds.
+    std::uint64_t percentile(double q) const noexcept
+    {
+      if (count == 0)
+      {
+        return 0;
+      }
+
+      const auto rank = static_cast<std::uint64_t>(q * static_cast<double>(count - 1)) + 1;
+      std::uint64_t seen = 0;
+
+      for (std::size_t i = 0; i < buckets.size(); ++i)
+      {
+        seen += buckets[i];
+
+        if (seen >= rank)
+        {
+          return std::min(BucketLayout::upper_bound_of(i), max_ns);
+        }
+      }
+
+      return max_ns;
+    }
+
+    // Number of samples <= @p bound_ns. Exact when bound_ns + 1 is a power of two.
+    std::uint64_t count_at_or_below(std::uint64_t bound_ns) const noexcept
+    {
+      std::uint64_t total = 0;
+
+      for (std::size_t i = 0; i < buckets.size(); ++i)
+      {
+        if (BucketLayout::upper_bound_of(i) > bound_ns)
+        {
+          break;
+        }
+
+        total += buckets[i];
+      }
+
+      return total;
+    }
+  };
+
+  enum class Phase : std::size_t
+  {
+    queue_wait = 0,
+    execution = 1,
+  };
+
+  struct LatencySnapshot
+  {
+    // [priority][phase]
+    std::array<std::array<HistogramSnapshot, 2>, priorities.size()> histograms{};
+
+    const HistogramSnapshot &get(TaskPriority priority, Phase phase) const noexcept
+    {
+      return histograms[priority_index(priority)][static_cast<std::size_t>(phase)];
+    }
+
+    std::string render_prometheus() const;
+  };
+
+  /**
+   * @brief Per-worker latency recorder for one ThreadPool.
+   *
+   * Each worker writes only to its own shard, selected through
+   * this_worker::index(). Threads outside the pool share one extra shard.
+   * snapshot() merges all shards without stopping the writers.
+   */
+  class LatencyRecorder
+  {
+  public:
+    explicit LatencyRecorder(std::size_t workerCount)
+        : shards_(workerCount + 1)
+    {
+      for (auto &shard : shards_)
+      {
+        shard = std::make_unique<WorkerShard>();
+      }
+    }
+
+    void record(TaskPriority priority, Phase phase, std::chrono::nanoseconds value) noexcept
+    {
+      const auto ns = value.count() < 0 ? std::uint64_t{0} : static_cast<std::uint64_t>(value.count());
+
+      shard_for_current_thread()
+          .histograms[priority_index(priority)][static_cast<std::size_t>(phase)]
+          .record(ns);
+    }
+
+    LatencySnapshot snapshot() const
+    {
+      LatencySnapshot out;
+
+      for (const auto &shard : shards_)
+      {
+        for (std::size_t p = 0; p < priorities.size(); ++p)
+        {
+          for (std::size_t phase = 0; phase < 2; ++phase)
+          {
+            out.histograms[p][phase].merge(shard->histograms[p][phase]);
+          }
+        }
+      }
+
+      return out;
+    }
+
+  private:
+    struct WorkerShard
+    {
+      std::array<std::array<HistogramShard, 2>, priorities.size()> histograms{};
+    };
+
+    WorkerShard &shard_for_current_thread() noexcept
+    {
+      if (vix::threadpool::this_worker::inside_worker())
+      {
+        const std::size_t index = vix::threadpool::this_worker::index();
+
+        if (index + 1 < shards_.size())
+        {
+          return *shards_[index];
+        }
+      }
+
+      return *shards_.back();
+    }
+
+    std::vector<std::unique_ptr<WorkerShard>> shards_;
+  };
+
+  namespace detail
+  {
+    // Prometheus bucket bounds: 1.024 us .. ~68.7 s, one per power of two.
+    // Each bound is 2^k - 1 ns, which lines up with a log-linear bucket edge.
+    inline constexpr unsigned first_bound_exponent = 10;
+    inline constexpr unsigned last_bound_exponent = 36;
+
+    inline void render_family(
+        std::ostringstream &out,
+        const LatencySnapshot &snapshot,
+        const char *name,
+        const char *help,
+        Phase phase)
+    {
+      out << "# HELP " << name << ' ' << help << '\n';
+      out << "# TYPE " << name << " histogram\n";
+
+      for (const TaskPriority priority : priorities)
+      {
+        const HistogramSnapshot &h = snapshot.get(priority, phase);
+        const char *label = vix::threadpool::to_string(priority);
+
+        for (unsigned e = first_bound_exponent; e <= last_bound_exponent; ++e)
+        {
+          const std::uint64_t bound_ns = (std::uint64_t{1} << e) - 1;
+
+          out << name << "_bucket{priority=\"" << label << "\",le=\""
+              << static_cast<double>(bound_ns + 1) / 1e9 << "\"} "
+              << h.count_at_or_below(bound_ns) << '\n';
+        }
+
+        out << name << "_bucket{priority=\"" << label << "\",le=\"+Inf\"} " << h.count << '\n';
+        out << name << "_sum{priority=\"" << label << "\"} " << static_cast<double>(h.sum_ns) / 1e9 << '\n';
+        out << name << "_count{priority=\"" << label << "\"} " << h.count << '\n';
+      }
+
+      out << '\n';
+    }
+  } // namespace detail
+
+  inline std::string LatencySnapshot::render_prometheus() const
+  {
+    std::ostringstream out;
+
+    detail::render_family(
+        out, *this,
+        "vix_threadpool_queue_wait_seconds",
+        "Time tasks spent queued before a worker started them.",
+        Phase::queue_wait);
+
+    detail::render_family(
+        out, *this,
+        "vix_threadpool_execution_seconds",
+        "Time tasks spent running on a worker.",
+        Phase::execution);
+
+    return out.str();
+  }
+
+  /**
+   * @brief Posts @p fn and records its queue wait and execution time.
+   */
+  template <class Fn>
+  bool post_measured(
+      vix::threadpool::ThreadPool &pool,
+      LatencyRecorder &recorder,
+      Fn &&fn,
+      vix::threadpool::TaskOptions options = vix::threadpool::TaskOptions{})
+  {
+    const TaskPriority priority = options.priority;
+    const auto enqueued = std::chrono::steady_clock::now();
+
+    return pool.post(
+        [&recorder, priority, enqueued, fn = std::forward<Fn>(fn)]() mutable
+        {
+          const auto started = std::chrono::steady_clock::now();
+          recorder.record(priority, Phase::queue_wait, started - enqueued);
+
+          struct ExecutionTimer
+          {
+            LatencyRecorder &recorder;
+            TaskPriority priority;
+            std::chrono::steady_clock::time_point started;
+
+            ~ExecutionTimer()
+            {
+              recorder.record(priority, Phase::execution, std::chrono::steady_clock::now() - started);
+            }
+          } timer{recorder, priority, started};
+
+          fn();
+        },
+        options);
+  }
+} // namespace latency
+
+int main()
+{
+  using namespace std::chrono_literals;
+  using vix::threadpool::TaskPriority;
+
+  vix::threadpool::ThreadPool pool(4);
+  latency::LatencyRecorder recorder(pool.thread_count());
+
+  for (int i = 0; i < 200; ++i)
+  {
+    vix::threadpool::TaskOptions options;
+    options.set_priority(i % 4 == 0 ? TaskPriority::high : TaskPriority::normal);
+
+    latency::post_measured(
+        pool,
+        recorder,
+        [i]()
+        {
+          std::this_thread::sleep_for(std::chrono::microseconds{100 + (i % 10) * 50});
+        },
+        options);
+  }
+
+  pool.wait_idle();
+
+  const latency::LatencySnapshot snapshot = recorder.snapshot();
+
+  for (const TaskPriority priority : {TaskPriority::high, TaskPriority::normal})
+  {
+    const auto &wait = snapshot.get(priority, latency::Phase::queue_wait);
+    const auto &exec = snapshot.get(priority, latency::Phase::execution);
+
+    std::cout << vix::threadpool::to_string(priority)
+              << ": tasks=" << exec.count
+              << " wait p50=" << wait.percentile(0.50) / 1000 << "us"
+              << " p99=" << wait.percentile(0.99) / 1000 << "us"
+              << " | exec p50=" << exec.percentile(0.50) / 1000 << "us"
+              << " p99=" << exec.percentile(0.99) / 1000 << "us"
+              << " max=" << exec.max_ns / 1000 << "us\n";
+  }
+
+  std::cout << '\n'
+            << snapshot.render_prometheus();
+
+  pool.shutdown();
+
+  return 0;
+}
@@ -0,0 +1,714 @@
+/**
+ *
+ * @file parallel_sort_scan.cpp
+ * @author Gaspard Kirira
+ *
+ * Copyright 2025, Gaspard Kirira.
+ * All rights reserved.
+ * https://github.com/vixcpp/vix
+ *
+ * Use of this source code is governed by a MIT license
+ * that can be found in the License file.
+ *
+ * Vix.cpp
+ *
+ */
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <iostream>
+#include <iterator>
+#include <numeric>
+#include <optional>
+#include <random>
+#include <utility>
+#include <vector>
+#include <version>
+
+#if defined(VIX_EXAMPLE_WITH_STD_PAR) && defined(__cpp_lib_parallel_algorithm)
+#include <execution>
+#define VIX_EXAMPLE_HAS_STD_PAR 1
+#endif
+
+#include <vix/threadpool/all.hpp>
+
+// Sort, scan, partition and transform_reduce built on ThreadPool.
+//
+// Every algorithm splits its input with the same chunking rule as
+// parallel_for (ParallelForOptions::chunk_size, or an automatic size
+// from compute_parallel_chunk_size when zero), runs one task per chunk,
+// waits for every chunk, and rethrows the first captured exception.
+namespace parallel_ext
+{
+  using vix::threadpool::Future;
+  using vix::threadpool::ParallelForOptions;
+  using vix::threadpool::ThreadPool;
+
+  struct Block
+  {
+    std::size_t first{0};
+    std::size_t last{0};
+  };
+
+  inline std::vector<Block> make_blocks(
+      const ThreadPool &pool,
+      std::size_t total,
+      const ParallelForOptions &options)
+  {
+    std::vector<Block> blocks;
+
+    if (total == 0)
+    {
+      return blocks;
+    }
+
+    const std::size_t chunk =
+        vix::threadpool::compute_parallel_chunk_size(
+            total,
+            pool.thread_count(),
+            options.chunk_size);
+
+    blocks.reserve((total + chunk - 1) / chunk);
+
+    for (std::size_t first = 0; first < total; first += chunk)
+    {
+      blocks.push_back(Block{first, std::min(total, first + chunk)});
+    }
+
+    return blocks;
+  }
+
+  // Runs fn(blockIndex) once per block and waits for all of them.
+  template <class Fn>
+  void run_blocks(
+      ThreadPool &pool,
+      std::size_t blockCount,
+      Fn &&fn,
+      const ParallelForOptions &options)
+  {
+    std::vector<Future<void>> futures;
+    futures.reserve(blockCount);
+
+    try
+    {
+      for (std::size_t index = 0; index < blockCount; ++index)
+      {
+        futures.push_back(
+            pool.submit(
+                [&fn, index]()
+                {
+                  fn(index);
+                },
+                options.task_options));
+      }
+    }
+    catch (...)
+    {
+      // The submitted blocks reference the caller's locals, which unwind
+      // with this exception; let them finish first.
+      for (auto &future : futures)
+      {
+        if (future.valid())
+        {
+          future.wait();
+        }
+      }
+      throw;
+    }
+
+    std::exception_ptr first_error;
+
+    for (auto &future : futures)
+    {
+      try
+      {
+        future.get();
+      }
+      catch (...)
+      {
+        if (!first_error)
+        {
+          first_error = std::current_exception();
+        }
+      }
+    }
+
+    if (first_error)
+    {
+      std::rethrow_exception(first_error);
+    }
+  }
+
+  /**
+   * @brief Parallel merge sort.
+   *
+   * Sorts every chunk independently, then merges neighbouring runs in
+   * log2(chunks) rounds. Each round merges all pairs in parallel from one
+   * buffer into the other: the input range, and a scratch buffer
+   * move-constructed from it. Values only need to be movable, not
+   * default-constructible or copyable.
+   */
+  template <class RandomIt, class Compare = std::less<>>
+  void sort(
+      ThreadPool &pool,
+      RandomIt first,
+      RandomIt last,
+      Compare comp = Compare{},
+      ParallelForOptions options = ParallelForOptions{})
+  {
+    using Value = typename std::iterator_traits<RandomIt>::value_type;
+
+    const std::size_t total = static_cast<std::size_t>(std::distance(first, last));
+    std::vector<Block> runs = make_blocks(pool, total, options);
+
+    if (runs.size() <= 1)
+    {
+      std::sort(first, last, comp);
+      return;
+    }
+
+    run_blocks(
+        pool,
+        runs.size(),
+        [&](std::size_t index)
+        {
+          std::sort(first + static_cast<std::ptrdiff_t>(runs[index].first),
+                    first + static_cast<std::ptrdiff_t>(runs[index].last),
+                    comp);
+        },
+        options);
+
+    // Every element of both buffers stays constructed; merges only
+    // move-assign over moved-from values.
+    std::vector<Value> scratch(std::make_move_iterator(first), std::make_move_iterator(last));
+    bool inScratch = true;
+
+    const auto merge_round = [&](auto source, auto target)
+    {
+      const std::size_t pairs = (runs.size() + 1) / 2;
+      std::vector<Block> merged(pairs);
+
+      run_blocks(
+          pool,
+          pairs,
+          [&](std::size_t pair)
+          {
+            const Block &left = runs[pair * 2];
+            const auto out = target + static_cast<std::ptrdiff_t>(left.first);
+
+            if (pair * 2 + 1 == runs.size())
+            {
+              std::move(source + static_cast<std::ptrdiff_t>(left.first),
+                        source + static_cast<std::ptrdiff_t>(left.last),
+                        out);
+              merged[pair] = left;
+              return;
+            }
+
+            const Block &right = runs[pair * 2 + 1];
+
+            std::merge(std::make_move_iterator(source + static_cast<std::ptrdiff_t>(left.first)),
+                       std::make_move_iterator(source + static_cast<std::ptrdiff_t>(left.last)),
+                       std::make_move_iterator(source + static_cast<std::ptrdiff_t>(right.first)),
+                       std::make_move_iterator(source + static_cast<std::ptrdiff_t>(right.last)),
+                       out,
+                       comp);
+
+            merged[pair] = Block{left.first, right.last};
+          },
+          options);
+
+      runs = std::move(merged);
+    };
+
+    while (runs.size() > 1)
+    {
+      if (inScratch)
+      {
+        merge_round(scratch.begin(), first);
+      }
+      else
+      {
+        merge_round(first, scratch.begin());
+      }
+      inScratch = !inScratch;
+    }
+
+    if (inScratch)
+    {
+      std::move(scratch.begin(), scratch.end(), first);
+    }
+  }
+
+  /**
+   * @brief Parallel inclusive scan in three passes.
+   *
+   * 1. Reduce every chunk locally.
+   * 2. Scan the chunk totals on the caller thread.
+   * 3. Scan every chunk again, seeded with the preceding total.
+   *
+   * The operation must be associative. Returns the end of the output.
+   */
+  template <class InputIt, class OutputIt, class BinaryOp = std::plus<>>
+  OutputIt inclusive_scan(
+      ThreadPool &pool,
+      InputIt first,
+      InputIt last,
+      OutputIt out,
+      BinaryOp op = BinaryOp{},
+      ParallelForOptions options = ParallelForOptions{})
+  {
+    using Value = typename std::iterator_traits<InputIt>::value_type;
+
+    const std::size_t total = static_cast<std::size_t>(std::distance(first, last));
+    const std::vector<Block> blocks = make_blocks(pool, total, options);
+
+    if (blocks.size() <= 1)
+    {
+      return std::inclusive_scan(first, last, out, op);
+    }
+
+    std::vector<Value> totals(blocks.size());
+
+    run_blocks(
+        pool,
+        blocks.size(),
+        [&](std::size_t index)
+        {
+          auto it = first + static_cast<std::ptrdiff_t>(blocks[index].first);
+          const auto end = first + static_cast<std::ptrdiff_t>(blocks[index].last);
+
+          Value acc = *it;
+          for (++it; it != end; ++it)
+          {
+            acc = op(std::move(acc), *it);
+          }
+
+          totals[index] = std::move(acc);
+        },
+        options);
+
+    std::inclusive_scan(totals.begin(), totals.end(), totals.begin(), op);
+
+    run_blocks(
+        pool,
+        blocks.size(),
+        [&](std::size_t index)
+        {
+          const auto begin = first + static_cast<std::ptrdiff_t>(blocks[index].first);
+          const auto end = first + static_cast<std::ptrdiff_t>(blocks[index].last);
+          const auto dest = out + static_cast<std::ptrdiff_t>(blocks[index].first);
+
+          if (index == 0)
+          {
+            std::inclusive_scan(begin, end, dest, op);
+          }
+          else
+          {
+            std::inclusive_scan(begin, end, dest, op, totals[index - 1]);
+          }
+        },
+        options);
+
+    return out + static_cast<std::ptrdiff_t>(total);
+  }
+
+  /**
+   * @brief Parallel exclusive scan, seeded with @p init.
+   */
+  template <class InputIt, class OutputIt, class T, class BinaryOp = std::plus<>>
+  OutputIt exclusive_scan(
+      ThreadPool &pool,
+      InputIt first,
+      InputIt last,
+      OutputIt out,
+      T init,
+      BinaryOp op = BinaryOp{},
+      ParallelForOptions options = ParallelForOptions{})
+  {
+    const std::size_t total = static_cast<std::size_t>(std::distance(first, last));
+    const std::vector<Block> blocks = make_blocks(pool, total, options);
+
+    if (blocks.size() <= 1)
+    {
+      return std::exclusive_scan(first, last, out, init, op);
+    }
+
+    std::vector<T> totals(blocks.size());
+
+    run_blocks(
+        pool,
+        blocks.size(),
+        [&](std::size_t index)
+        {
+          auto it = first + static_cast<std::ptrdiff_t>(blocks[index].first);
+          const auto end = first + static_cast<std::ptrdiff_t>(blocks[index].last);
+
+          T acc = *it;
+          for (++it; it != end; ++it)
+          {
+            acc = op(std::move(acc), *it);
+          }
+
+          totals[index] = std::move(acc);
+        },
+        options);
+
+    std::exclusive_scan(totals.begin(), totals.end(), totals.begin(), init, op);
+
+    run_blocks(
+        pool,
+        blocks.size(),
+        [&](std::size_t index)
+        {
+          std::exclusive_scan(first + static_cast<std::ptrdiff_t>(blocks[index].first),
+                              first + static_cast<std::ptrdiff_t>(blocks[index].last),
+                              out + static_cast<std::ptrdiff_t>(blocks[index].first),
+                              totals[index],
+                              op);
+        },
+        options);
+
+    return out + static_cast<std::ptrdiff_t>(total);
+  }
+
+  /**
+   * @brief Parallel stable partition.
+   *
+   * Counts matches per chunk, derives every chunk's output offsets from
+   * the counts, then scatters both groups into a scratch buffer in
+   * parallel. Relative order is preserved inside each group.
+   *
+   * Returns an iterator to the first element of the second group.
+   */
+  template <class RandomIt, class Predicate>
+  RandomIt partition(
+      ThreadPool &pool,
+      RandomIt first,
+      RandomIt last,
+      Predicate pred,
+      ParallelForOptions options = ParallelForOptions{})
+  {
+    using Value = typename std::iterator_traits<RandomIt>::value_type;
+
+    const std::size_t total = static_cast<std::size_t>(std::distance(first, last));
+    const std::vector<Block> blocks = make_blocks(pool, total, options);
+
+    if (blocks.size() <= 1)
+    {
+      return std::stable_partition(first, last, pred);
+    }
+
+    std::vector<std::size_t> matches(blocks.size(), 0);
+
+    run_blocks(
+        pool,
+        blocks.size(),
+        [&](std::size_t index)
+        {
+          matches[index] = static_cast<std::size_t>(
+              std::count_if(first + static_cast<std::ptrdiff_t>(blocks[index].first),
+                            first + static_cast<std::ptrdiff_t>(blocks[index].last),
+                            pred));
+        },
+        options);
+
+    std::vector<std::size_t> match_offsets(blocks.size(), 0);
+    std::exclusive_scan(matches.begin(), matches.end(), match_offsets.begin(), std::size_t{0});
+
+    const std::size_t match_total = match_offsets.back() + matches.back();
+
+    std::vector<Value> scratch(total);
+
+    run_blocks(
+        pool,
+        blocks.size(),
+        [&](std::size_t index)
+        {
+          std::size_t yes = match_offsets[index];
+          std::size_t no = match_total + (blocks[index].first - match_offsets[index]);
+
+          for (std::size_t i = blocks[index].first; i < blocks[index].last; ++i)
+          {
+            auto &value = first[static_cast<std::ptrdiff_t>(i)];
+
+            if (pred(value))
+            {
+              scratch[yes++] = std::move(value);
+            }
+            else
+            {
+              scratch[no++] = std::move(value);
+            }
+          }
+        },
+        options);
+
+    run_blocks(
+        pool,
+        blocks.size(),
+        [&](std::size_t index)
+        {
+          std::move(scratch.begin() + static_cast<std::ptrdiff_t>(blocks[index].first),
+                    scratch.begin() + static_cast<std::ptrdiff_t>(blocks[index].last),
+                    first + static_cast<std::ptrdiff_t>(blocks[index].first));
+        },
+        options);
+
+    return first + static_cast<std::ptrdiff_t>(match_total);
+  }
+
+  /**
+   * @brief Parallel transform + reduce without an intermediate vector.
+   *
+   * Each chunk folds transform(x) into a local accumulator. Partial
+   * results are combined on the caller thread, in chunk order.
+   */
+  template <class InputIt, class T, class ReduceFn, class TransformFn>
+  T transform_reduce(
+      ThreadPool &pool,
+      InputIt first,
+      InputIt last,
+      T init,
+      ReduceFn reduce,
+      TransformFn transform,
+      ParallelForOptions options = ParallelForOptions{})
+  {
+    const std::size_t total = static_cast<std::size_t>(std::distance(first, last));
+    const std::vector<Block> blocks = make_blocks(pool, total, options);
+
+    if (blocks.size() <= 1)
+    {
+      return std::transform_reduce(first, last, std::move(init), reduce, transform);
+    }
+
+    std::vector<std::optional<T>> partials(blocks.size());
+
+    run_blocks(
+        pool,
+        blocks.size(),
+        [&](std::size_t index)
+        {
+          auto it = first + static_cast<std::ptrdiff_t>(blocks[index].first);
+          const auto end = first + static_cast<std::ptrdiff_t>(blocks[index].last);
+
+          T acc = transform(*it);
+          for (++it; it != end; ++it)
+          {
+            acc = reduce(std::move(acc), transform(*it));
+          }
+
+          partials[index] = std::move(acc);
+        },
+        options);
+
+    T result = std::move(init);
+
+    for (auto &partial : partials)
+    {
+      result = reduce(std::move(result), std::move(*partial));
+    }
+
+    return result;
+  }
+} // namespace parallel_ext
+
+namespace
+{
+  template <class Fn>
+  double measure_ms(Fn &&fn)
+  {
+    const auto start = std::chrono::steady_clock::now();
+    fn();
+    const auto end = std::chrono::steady_clock::now();
+
+    return std::chrono::duration<double, std::milli>(end - start).count();
+  }
+
+  std::vector<int> make_input(std::size_t size)
+  {
+    std::mt19937 rng(42);
+    std::uniform_int_distribution<int> dist(-1000, 1000);
+
+    std::vector<int> values(size);
+    for (int &value : values)
+    {
+      value = dist(rng);
+    }
+
+    return values;
+  }
+
+  void print_row(const char *name, double vix_ms, double seq_ms, double par_ms)
+  {
+    std::cout << "  " << name
+              << "  vix: " << vix_ms << " ms"
+              << "  seq: " << seq_ms << " ms";
+
+    if (par_ms >= 0.0)
+    {
+      std::cout << "  std::execution::par: " << par_ms << " ms";
+    }
+
+    std::cout << '\n';
+  }
+} // namespace
+
+int main()
+{
+  vix::threadpool::ThreadPool pool(4);
+
+  const auto options = vix::threadpool::ParallelForOptions::with_chunk_size(4);
+
+  // Small inputs with a tiny chunk size so every code path is exercised.
+  {
+    std::vector<int> values{9, 3, 7, 1, 8, 2, 6, 4, 5, 0, 11, 10};
+
+    parallel_ext::sort(pool, values.begin(), values.end(), std::less<>{}, options);
+
+    std::cout << "sort:";
+    for (const int value : values)
+    {
+      std::cout << ' ' << value;
+    }
+    std::cout << '\n';
+
+    std::vector<int> inclusive(values.size());
+    parallel_ext::inclusive_scan(pool, values.begin(), values.end(), inclusive.begin(),
+                                 std::plus<>{}, options);
+
+    std::cout << "inclusive_scan:";
+    for (const int value : inclusive)
+    {
+      std::cout << ' ' << value;
+    }
+    std::cout << '\n';
+
+    std::vector<int> exclusive(values.size());
+    parallel_ext::exclusive_scan(pool, values.begin(), values.end(), exclusive.begin(),
+                                 0, std::plus<>{}, options);
+
+    std::cout << "exclusive_scan:";
+    for (const int value : exclusive)
+    {
+      std::cout << ' ' << value;
+    }
+    std::cout << '\n';
+
+    const auto middle =
+        parallel_ext::partition(
+            pool, values.begin(), values.end(),
+            [](int value)
+            {
+              return value % 2 == 0;
+            },
+            options);
+
+    std::cout << "partition (even first):";
+    for (const int value : values)
+    {
+      std::cout << ' ' << value;
+    }
+    std::cout << "  | evens: " << std::distance(values.begin(), middle) << '\n';
+
+    const long long sum_of_squares =
+        parallel_ext::transform_reduce(
+            pool, values.begin(), values.end(), 0LL, std::plus<>{},
+            [](int value)
+            {
+              return static_cast<long long>(value) * value;
+            },
+            options);
+
+    std::cout << "transform_reduce (sum of squares): " << sum_of_squares << '\n';
+  }
+
+  // Timing comparison on a larger input, automatic chunk size.
+  {
+    constexpr std::size_t size = 2'000'000;
+    const std::vector<int> input = make_input(size);
+
+    std::cout << "\nbenchmark (" << size << " ints, " << pool.thread_count() << " workers)\n";
+
+    double par_ms = -1.0;
+
+    std::vector<int> a = input;
+    std::vector<int> b = input;
+    const double vix_sort = measure_ms([&]() { parallel_ext::sort(pool, a.begin(), a.end()); });
+    const double seq_sort = measure_ms([&]() { std::sort(b.begin(), b.end()); });
+#if defined(VIX_EXAMPLE_HAS_STD_PAR)
+    std::vector<int> c = input;
+    par_ms = measure_ms([&]() { std::sort(std::execution::par, c.begin(), c.end()); });
+#endif
+    print_row("sort          ", vix_sort, seq_sort, par_ms);
+
+    if (a != b)
+    {
+      std::cerr << "sort mismatch\n";
+      return 1;
+    }
+
+    std::vector<long long> scanned(size);
+    std::vector<long long> expected(size);
+    const double vix_scan = measure_ms([&]() { parallel_ext::inclusive_scan(pool, input.begin(), input.end(), scanned.begin(), std::plus<long long>{}); });
+    const double seq_scan = measure_ms([&]() { std::inclusive_scan(input.begin(), input.end(), expected.begin(), std::plus<long long>{}); });
+#if defined(VIX_EXAMPLE_HAS_STD_PAR)
+    std::vector<long long> par_scanned(size);
+    par_ms = measure_ms([&]() { std::inclusive_scan(std::execution::par, input.begin(), input.end(), par_scanned.begin(), std::plus<long long>{}); });
+#endif
+    print_row("inclusive_scan", vix_scan, seq_scan, par_ms);
+
+    if (scanned != expected)
+    {
+      std::cerr << "scan mismatch\n";
+      return 1;
+    }
+
+    const auto is_positive = [](int value)
+    {
+      return value > 0;
+    };
+
+    std::vector<int> p1 = input;
+    std::vector<int> p2 = input;
+    const double vix_part = measure_ms([&]() { parallel_ext::partition(pool, p1.begin(), p1.end(), is_positive); });
+    const double seq_part = measure_ms([&]() { std::stable_partition(p2.begin(), p2.end(), is_positive); });
+#if defined(VIX_EXAMPLE_HAS_STD_PAR)
+    std::vector<int> p3 = input;
+    par_ms = measure_ms([&]() { std::stable_partition(std::execution::par, p3.begin(), p3.end(), is_positive); });
+#endif
+    print_row("partition     ", vix_part, seq_part, par_ms);
+
+    if (p1 != p2)
+    {
+      std::cerr << "partition mismatch\n";
+      return 1;
+    }
+
+    const auto square = [](int value)
+    {
+      return static_cast<long long>(value) * value;
+    };
+
+    long long vix_sum = 0;
+    long long seq_sum = 0;
+    const double vix_tr = measure_ms([&]() { vix_sum = parallel_ext::transform_reduce(pool, input.begin(), input.end(), 0LL, std::plus<>{}, square); });
+    const double seq_tr = measure_ms([&]() { seq_sum = std::transform_reduce(input.begin(), input.end(), 0LL, std::plus<>{}, square); });
+#if defined(VIX_EXAMPLE_HAS_STD_PAR)
+    par_ms = measure_ms([&]() { (void)std::transform_reduce(std::execution::par, input.begin(), input.end(), 0LL, std::plus<>{}, square); });
+#endif
+    print_row("transform_red.", vix_tr, seq_tr, par_ms);
+
+    if (vix_sum != seq_sum)
+    {
+      std::cerr << "transform_reduce mismatch\n";
+      return 1;
+    }
+  }
+
+  pool.shutdown();
+
+  return 0;
+}
@@ -0,0 +1,765 @@
+/**
+ *
+ * @file timer_wheel.cpp
+ * @author Gaspard Kirira
+ *
+ * Copyright 2025, Gaspard Kirira.
+ * All rights reserved.
+ * https://github.com/vixcpp/vix
+ *
+ * Use of this source code is governed by a MIT license
+ * that can be found in the License file.
+ *
+ * Vix.cpp
+ *
+ */
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <vix/threadpool/all.hpp>
+
+// Thousands of periodic jobs and deadlines on one ticker thread.
+//
+// Each PeriodicTask waits on its own thread, which does not scale to tens
+// of thousands of timers. TimerWheel keeps every timer in a hierarchical
+// timing wheel driven by a single ticker thread and posts due callbacks
+// to a ThreadPool. Scheduling and cancelling are O(1).
+namespace timers
+{
+  using vix::threadpool::CancellationSource;
+  using vix::threadpool::Deadline;
+  using vix::threadpool::TaskOptions;
+  using vix::threadpool::ThreadPool;
+
+  /**
+   * @brief Handle to a scheduled timer.
+   *
+   * The generation makes stale handles harmless: once a slot is reused,
+   * cancelling an old handle is a no-op.
+   */
+  struct TimerId
+  {
+    std::uint32_t index{std::numeric_limits<std::uint32_t>::max()};
+    std::uint32_t generation{0};
+
+    bool valid() const noexcept
+    {
+      return index != std::numeric_limits<std::uint32_t>::max();
+    }
+  };
+
+  /**
+   * @brief Hierarchical timing wheel with one ticker thread.
+   *
+   * Four levels of 256 slots each. Level 0 holds timers due in fewer than
+   * 256 ticks; higher levels hold coarser ranges and are cascaded down
+   * when level 0 wraps. With the default 10 ms tick, the wheel covers
+   * about 497 days.
+   *
+   * Timers are nodes in a slab linked into per-slot intrusive lists, so
+   * schedule and cancel are O(1). Expired callbacks are posted to the
+   * pool outside the wheel lock. Deadline expirations run inline on the
+   * ticker thread, since they only flip a cancellation flag.
+   */
+  class TimerWheel
+  {
+    struct Link;
+
+  public:
+    using Callback = std::function<void()>;
+    using clock = std::chrono::steady_clock;
+
+    /**
+     * @brief Cancels timers from tasks that may outlive the wheel.
+     *
+     * Once the wheel is destroyed, cancel() is a no-op returning false.
+     */
+    class Canceller
+    {
+    public:
+      bool cancel(TimerId id) const noexcept
+      {
+        const auto link = link_.lock();
+
+        if (!link)
+        {
+          return false;
+        }
+
+        std::shared_lock<std::shared_mutex> lock(link->mutex);
+        return link->wheel != nullptr && link->wheel->cancel(id);
+      }
+
+    private:
+      friend class TimerWheel;
+
+      explicit Canceller(std::weak_ptr<Link> link) noexcept
+          : link_(std::move(link))
+      {
+      }
+
+      std::weak_ptr<Link> link_;
+    };
+
+    explicit TimerWheel(
+        ThreadPool &pool,
+        std::chrono::milliseconds tick = std::chrono::milliseconds{10})
+        : pool_(pool),
+          tick_(tick.count() > 0 ? tick : std::chrono::milliseconds{1}),
+          start_(clock::now()),
+          link_(std::make_shared<Link>())
+    {
+      link_->wheel = this;
+
+      for (auto &slot : slots_)
+      {
+        slot = npos;
+      }
+
+      ticker_ = std::thread(
+          [this]()
+          {
+            run();
+          });
+    }
+
+    TimerWheel(const TimerWheel &) = delete;
+    TimerWheel &operator=(const TimerWheel &) = delete;
+
+    ~TimerWheel()
+    {
+      {
+        std::unique_lock<std::shared_mutex> lock(link_->mutex);
+        link_->wheel = nullptr;
+      }
+
+      stop();
+    }
+
+    Canceller canceller() const noexcept
+    {
+      return Canceller(link_);
+    }
+
+    /**
+     * @brief Posts @p callback once, after @p delay.
+     */
+    TimerId schedule_after(
+        clock::duration delay,
+        Callback callback,
+        TaskOptions options = TaskOptions{})
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+
+      return insert_locked(
+          ticks_until_locked(clock::now() + delay),
+          0,
+          Kind::post,
+          std::make_shared<Timer>(std::move(callback)),
+          std::move(options));
+    }
+
+    /**
+     * @brief Posts @p callback every @p interval until cancelled.
+     *
+     * Ticks are counted from the schedule, not from when the previous run
+     * finished, so slow callbacks do not make the schedule drift.
+     */
+    TimerId schedule_every(
+        clock::duration interval,
+        Callback callback,
+        TaskOptions options = TaskOptions{},
+        bool run_immediately = false)
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+
+      const std::uint64_t period = ticks_for_locked(interval);
+
+      return insert_locked(
+          run_immediately ? current_ + 1 : current_ + period,
+          period,
+          Kind::post,
+          std::make_shared<Timer>(std::move(callback)),
+          std::move(options));
+    }
+
+    /**
+     * @brief Requests cancellation on @p source when @p deadline passes.
+     *
+     * Tasks posted with source->token() are then skipped by the pool
+     * before they start, so expired work never occupies a worker.
+     */
+    TimerId cancel_at(Deadline deadline, std::shared_ptr<CancellationSource> source)
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+
+      return insert_locked(
+          ticks_until_locked(deadline.value()),
+          0,
+          Kind::inline_expiry,
+          std::make_shared<Timer>(
+              [source = std::move(source)]()
+              {
+                source->request_cancel();
+              }),
+          TaskOptions{});
+    }
+
+    /**
+     * @brief Cancels a pending timer. Returns false if it already fired
+     * (one-shot) or was already cancelled.
+     *
+     * After true is returned, the callback is not started again, even if
+     * the ticker had already taken it off the wheel. A run that already
+     * started may still be executing; pool.wait_idle() waits for it.
+     */
+    bool cancel(TimerId id) noexcept
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+
+      if (!id.valid() || id.index >= nodes_.size())
+      {
+        return false;
+      }
+
+      Node &node = nodes_[id.index];
+
+      if (node.generation != id.generation || node.slot == npos)
+      {
+        return false;
+      }
+
+      node.timer->cancelled.store(true);
+      unlink_locked(id.index);
+      release_locked(id.index);
+
+      return true;
+    }
+
+    std::size_t size() const
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      return active_;
+    }
+
+    void stop() noexcept
+    {
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+
+        if (stopping_)
+        {
+          return;
+        }
+
+        stopping_ = true;
+      }
+
+      cv_.notify_all();
+
+      if (ticker_.joinable())
+      {
+        ticker_.join();
+      }
+    }
+
+  private:
+    static constexpr std::uint32_t npos = std::numeric_limits<std::uint32_t>::max();
+    static constexpr unsigned slot_bits = 8;
+    static constexpr std::size_t slots_per_level = std::size_t{1} << slot_bits;
+    static constexpr std::size_t level_count = 4;
+    static constexpr std::uint64_t slot_mask = slots_per_level - 1;
+    static constexpr std::uint64_t max_delta =
+        (std::uint64_t{1} << (slot_bits * level_count)) - 1;
+
+    enum class Kind : std::uint8_t
+    {
+      post,
+      inline_expiry,
+    };
+
+    // Shared with every posted run, which checks `cancelled` right before
+    // calling, so a run taken off the wheel before a cancel is skipped.
+    struct Timer
+    {
+      explicit Timer(Callback fn)
+          : callback(std::move(fn))
+      {
+      }
+
+      Callback callback;
+      std::atomic<bool> cancelled{false};
+    };
+
+    struct Link
+    {
+      std::shared_mutex mutex;
+      TimerWheel *wheel{nullptr};
+    };
+
+    struct Node
+    {
+      std::uint64_t expires{0};
+      std::uint64_t period{0};
+      std::uint32_t prev{npos};
+      std::uint32_t next{npos};
+      std::uint32_t slot{npos};
+      std::uint32_t generation{0};
+      Kind kind{Kind::post};
+      std::shared_ptr<Timer> timer;
+      TaskOptions options;
+    };
+
+    struct Due
+    {
+      Kind kind;
+      std::shared_ptr<Timer> timer;
+      TaskOptions options;
+    };
+
+    std::uint64_t ticks_for_locked(clock::duration duration) const noexcept
+    {
+      const auto ticks = (duration + tick_ - clock::duration{1}) / tick_;
+      return ticks > 0 ? static_cast<std::uint64_t>(ticks) : 1;
+    }
+
+    std::uint64_t ticks_until_locked(clock::time_point when) const noexcept
+    {
+      if (when <= start_)
+      {
+        return current_ + 1;
+      }
+
+      const auto ticks = static_cast<std::uint64_t>((when - start_ + tick_ - clock::duration{1}) / tick_);
+      return ticks > current_ ? ticks : current_ + 1;
+    }
+
+    TimerId insert_locked(
+        std::uint64_t expires,
+        std::uint64_t period,
+        Kind kind,
+        std::shared_ptr<Timer> timer,
+        TaskOptions options)
+    {
+      std::uint32_t index = free_head_;
+
+      if (index == npos)
+      {
+        index = static_cast<std::uint32_t>(nodes_.size());
+        nodes_.emplace_back();
+      }
+      else
+      {
+        free_head_ = nodes_[index].next;
+      }
+
+      Node &node = nodes_[index];
+      node.expires = expires;
+      node.period = period;
+      node.kind = kind;
+      node.timer = std::move(timer);
+      node.options = std::move(options);
+
+      link_locked(index);
+      ++active_;
+
+      return TimerId{index, node.generation};
+    }
+
+    void release_locked(std::uint32_t index) noexcept
+    {
+      Node &node = nodes_[index];
+
+      node.timer.reset();
+      node.options = TaskOptions{};
+      ++node.generation;
+      node.next = free_head_;
+      free_head_ = index;
+      --active_;
+    }
+
+    std::uint32_t slot_for_locked(std::uint64_t expires) const noexcept
+    {
+      std::uint64_t delta = expires > current_ ? expires - current_ : 0;
+
+      if (delta > max_delta)
+      {
+        delta = max_delta;
+        expires = current_ + max_delta;
+      }
+
+      std::size_t level = 0;
+      while (level + 1 < level_count && delta >= (std::uint64_t{1} << (slot_bits * (level + 1))))
+      {
+        ++level;
+      }
+
+      const std::uint64_t slot = (expires >> (slot_bits * level)) & slot_mask;
+      return static_cast<std::uint32_t>(level * slots_per_level + slot);
+    }
+
+    void link_locked(std::uint32_t index) noexcept
+    {
+      Node &node = nodes_[index];
+      const std::uint32_t slot = slot_for_locked(node.expires);
+
+      node.slot = slot;
+      node.prev = npos;
+      node.next = slots_[slot];
+
+      if (node.next != npos)
+      {
+        nodes_[node.next].prev = index;
+      }
+
+      slots_[slot] = index;
+    }
+
+    void unlink_locked(std::uint32_t index) noexcept
+    {
+      Node &node = nodes_[index];
+
+      if (node.prev != npos)
+      {
+        nodes_[node.prev].next = node.next;
+      }
+      else
+      {
+        slots_[node.slot] = node.next;
+      }
+
+      if (node.next != npos)
+      {
+        nodes_[node.next].prev = node.prev;
+      }
+
+      node.prev = npos;
+      node.next = npos;
+      node.slot = npos;
+    }
+
+    // Re-files every timer of one higher-level slot into finer slots.
+    void cascade_locked(std::size_t level, std::size_t slot) noexcept
+    {
+      std::uint32_t index = slots_[level * slots_per_level + slot];
+      slots_[level * slots_per_level + slot] = npos;
+
+      while (index != npos)
+      {
+        const std::uint32_t next = nodes_[index].next;
+        link_locked(index);
+        index = next;
+      }
+    }
+
+    // Advances one tick and moves due timers into @p due.
+    void advance_locked(std::vector<Due> &due)
+    {
+      ++current_;
+
+      for (std::size_t level = 1; level < level_count; ++level)
+      {
+        if (((current_ >> (slot_bits * (level - 1))) & slot_mask) != 0)
+        {
+          break;
+        }
+
+        cascade_locked(level, (current_ >> (slot_bits * level)) & slot_mask);
+      }
+
+      std::uint32_t index = slots_[current_ & slot_mask];
+      slots_[current_ & slot_mask] = npos;
+
+      while (index != npos)
+      {
+        Node &node = nodes_[index];
+        const std::uint32_t next = node.next;
+
+        node.prev = npos;
+        node.next = npos;
+        node.slot = npos;
+
+        due.push_back(Due{node.kind, node.timer, node.options});
+
+        if (node.period != 0)
+        {
+          node.expires = current_ + node.period;
+          link_locked(index);
+        }
+        else
+        {
+          release_locked(index);
+        }
+
+        index = next;
+      }
+    }
+
+    void run()
+    {
+      std::vector<Due> due;
+      std::unique_lock<std::mutex> lock(mutex_);
+
+      while (!stopping_)
+      {
+        const auto next_tick = start_ + tick_ * static_cast<clock::rep>(current_ + 1);
+
+        if (cv_.wait_until(lock, next_tick, [this]() { return stopping_; }))
+        {
+          break;
+        }
+
+        const auto elapsed = static_cast<std::uint64_t>((clock::now() - start_) / tick_);
+
+        while (current_ < elapsed)
+        {
+          advance_locked(due);
+        }
+
+        if (due.empty())
+        {
+          continue;
+        }
+
+        lock.unlock();
+
+        for (Due &item : due)
+        {
+          if (item.timer->cancelled.load())
+          {
+            continue;
+          }
+
+          if (item.kind == Kind::inline_expiry)
+          {
+            item.timer->callback();
+            continue;
+          }
+
+          pool_.post(
+              [timer = std::move(item.timer)]()
+              {
+                if (!timer->cancelled.load())
+                {
+                  timer->callback();
+                }
+              },
+              std::move(item.options));
+        }
+
+        due.clear();
+        lock.lock();
+      }
+    }
+
+    ThreadPool &pool_;
+    const clock::duration tick_;
+    const clock::time_point start_;
+
+    mutable std::mutex mutex_;
+    std::condition_variable cv_;
+    bool stopping_{false};
+
+    std::uint64_t current_{0};
+    std::array<std::uint32_t, slots_per_level * level_count> slots_{};
+    std::vector<Node> nodes_;
+    std::uint32_t free_head_{npos};
+    std::size_t active_{0};
+
+    std::shared_ptr<Link> link_;
+    std::thread ticker_;
+  };
+
+  /**
+   * @brief Posts @p fn with a deadline enforced by @p wheel.
+   *
+   * If the task is still queued when the deadline passes, the wheel
+   * cancels its token and the pool skips it. If it starts in time, it
+   * removes its own wheel entry first, through a Canceller, since the
+   * task may run after the wheel is gone.
+   */
+  template <class Fn>
+  bool post_before(ThreadPool &pool, TimerWheel &wheel, Deadline deadline, Fn &&fn)
+  {
+    auto source = std::make_shared<CancellationSource>();
+    auto id = std::make_shared<TimerId>();
+
+    TaskOptions options;
+    options.set_cancellation(source->token());
+
+    // Link the wheel entry before the task can start, so the task always
+    // sees a valid id to cancel.
+    *id = wheel.cancel_at(deadline, source);
+
+    const bool posted = pool.post(
+        [canceller = wheel.canceller(), id, fn = std::forward<Fn>(fn)]() mutable
+        {
+          canceller.cancel(*id);
+          fn();
+        },
+        options);
+
+    // A rejected task never runs, so nothing else would remove the entry.
+    if (!posted)
+    {
+      wheel.cancel(*id);
+    }
+    return posted;
+  }
+} // namespace timers
+
+namespace
+{
+  int failures = 0;
+
+  void check(bool ok, const char *what)
+  {
+    if (!ok)
+    {
+      std::cerr << "check failed: " << what << '\n';
+      ++failures;
+    }
+  }
+} // namespace
+
+int main()
+{
+  using namespace std::chrono_literals;
+
+  vix::threadpool::ThreadPool pool(4);
+  timers::TimerWheel wheel(pool, 10ms);
+
+  // 20k periodic jobs with intervals between 100 ms and 1 s.
+  constexpr std::size_t job_count = 20'000;
+
+  std::atomic<std::uint64_t> runs{0};
+  std::vector<timers::TimerId> jobs;
+  jobs.reserve(job_count);
+
+  const auto schedule_start = std::chrono::steady_clock::now();
+
+  for (std::size_t i = 0; i < job_count; ++i)
+  {
+    jobs.push_back(
+        wheel.schedule_every(
+            std::chrono::milliseconds{100 + static_cast<int>(i % 10) * 100},
+            [&runs]()
+            {
+              runs.fetch_add(1, std::memory_order_relaxed);
+            }));
+  }
+
+  const auto schedule_ns =
+      std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - schedule_start);
+
+  std::cout << "scheduled " << wheel.size() << " periodic jobs, "
+            << schedule_ns.count() / static_cast<long long>(job_count) << " ns/schedule\n";
+
+  // Job i fires every 100 + (i % 10) * 100 ms, so after t ms the jobs
+  // have fired sum(job_count / 10 * floor(t / interval)) times.
+  const auto expected_runs = [](std::chrono::milliseconds elapsed)
+  {
+    std::uint64_t total = 0;
+    for (int step = 1; step <= 10; ++step)
+    {
+      total += job_count / 10 * static_cast<std::uint64_t>(elapsed.count() / (step * 100));
+    }
+    return total;
+  };
+
+  std::this_thread::sleep_for(1s);
+
+  const std::uint64_t observed = runs.load();
+  const auto elapsed =
+      std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - schedule_start);
+
+  std::cout << "runs after 1s: " << observed << " (expected about " << expected_runs(1000ms) << ")\n";
+
+  // Late ticks or a busy pool may delay runs by a tick or two, never add any.
+  check(observed >= expected_runs(elapsed - 200ms), "periodic jobs ran less often than scheduled");
+  check(observed <= expected_runs(elapsed + 10ms), "periodic jobs ran more often than scheduled");
+
+  // Cancel every other job.
+  const auto cancel_start = std::chrono::steady_clock::now();
+
+  for (std::size_t i = 0; i < jobs.size(); i += 2)
+  {
+    wheel.cancel(jobs[i]);
+  }
+
+  const auto cancel_ns =
+      std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - cancel_start);
+
+  std::cout << "cancelled half, " << wheel.size() << " left, "
+            << cancel_ns.count() / static_cast<long long>(job_count / 2) << " ns/cancel\n";
+
+  for (std::size_t i = 1; i < jobs.size(); i += 2)
+  {
+    wheel.cancel(jobs[i]);
+  }
+
+  pool.wait_idle();
+  check(wheel.size() == 0, "cancelled jobs left wheel entries");
+
+  const std::uint64_t after_cancel = runs.load();
+  std::this_thread::sleep_for(250ms);
+  pool.wait_idle();
+  check(runs.load() == after_cancel, "cancelled jobs kept running");
+
+  // Deadlines: block every worker, then queue work that must start within 50 ms.
+  std::atomic<int> started{0};
+
+  for (std::size_t i = 0; i < pool.thread_count(); ++i)
+  {
+    pool.post(
+        []()
+        {
+          std::this_thread::sleep_for(200ms);
+        });
+  }
+
+  for (int i = 0; i < 100; ++i)
+  {
+    timers::post_before(
+        pool,
+        wheel,
+        vix::threadpool::Deadline::after(50ms),
+        [&started]()
+        {
+          started.fetch_add(1, std::memory_order_relaxed);
+        });
+  }
+
+  pool.wait_idle();
+
+  std::cout << "deadline tasks started: " << started.load()
+            << " / 100 (expired ones were skipped before running)\n";
+  std::cout << "wheel entries left: " << wheel.size() << '\n';
+
+  // Every worker was busy for 200 ms, well past the 50 ms deadline.
+  check(started.load() == 0, "deadline tasks ran after their deadline");
+  check(wheel.size() == 0, "deadline entries were not removed");
+
+  wheel.stop();
+  pool.shutdown();
+
+  if (failures != 0)
+  {
+    std::cerr << failures << " check(s) failed\n";
+    return 1;
+  }
+  return 0;
+}